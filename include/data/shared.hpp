@@ -3,6 +3,8 @@
 
 #include <vector>
 
+#include "orientation.hpp"
+
 struct DroneData;
 struct TelemetryData;
 
@@ -12,11 +14,15 @@ struct TelemetryData;
 struct DroneData
 {
     DroneData() : position{}, orientation{} {}
-    DroneData(glm::vec3 p, glm::vec3 o) : position(p), orientation(o) {}
+    DroneData(glm::vec3 p, glm::vec3 o) :
+        position(p),
+        orientation(o),
+        attitude(orientation_to_quat(o)) {}
 
     DroneData(const DroneData& rhs) :
         position(rhs.position),
-        orientation(rhs.orientation) {}
+        orientation(rhs.orientation),
+        attitude(rhs.attitude) {}
 
     DroneData& operator=(const DroneData& rhs)
     {
@@ -24,6 +30,7 @@ struct DroneData
         {
             position = rhs.position;
             orientation = rhs.orientation;
+            attitude = rhs.attitude;
         }
 
         return *this;
@@ -37,11 +44,17 @@ struct DroneData
     {
         position += rhs.position;
         orientation += rhs.orientation;
+        attitude = orientation_to_quat(orientation);
     }
 
     glm::vec3 position{};
     glm::vec3 orientation{};
 
+    // The rotation the renderer draws, with orientation as its angles for
+    // display. Samples are blended as quaternions, since blending the angles
+    // goes wrong where they wrap or near gimbal lock.
+    glm::quat attitude{1.0f, 0.0f, 0.0f, 0.0f};
+
     const float size = 0.2f;
 };
 
@@ -3,6 +3,7 @@
 
 #ifdef OS_LINUX
 
+#include <array>
 #include <atomic>
 #include <filesystem>
 #include <memory>
@@ -10,37 +11,73 @@
 #include <thread>
 #include <vector>
 
+#include <termios.h>
+
 #include "libserial/SerialStream.h"
 
-#include "bounded_buffer.hpp"
+#include "spsc_ring.hpp"
 #include "logger.hpp"
 
+/*
+ * Driver used to open and configure the port. Both backends share the same
+ * poll()-driven reader thread.
+ *
+ * LibSerial: Goes through libserial's SerialStream. Only the standard termios
+ *     baud rates are available.
+ * Termios: Talks to the tty directly via termios/termios2. Supports arbitrary
+ *     baud rates (BOTHER), VMIN/VTIME tuning, the ASYNC_LOW_LATENCY flag and
+ *     exclusive open (TIOCEXCL).
+ */
+enum class LinuxSerialBackend
+{
+    LibSerial,
+    Termios,
+};
+
 struct LinuxSerialPortConfig
 {
     LinuxSerialPortConfig(
-            LibSerial::BaudRate br_,
+            LinuxSerialBackend backend_,
+            std::size_t baud_rate_,
             LibSerial::CharacterSize cs_,
             LibSerial::FlowControl fc_,
             LibSerial::Parity py_,
             LibSerial::StopBits sb_) :
-        br(br_), cs(cs_), fc(fc_), py(py_), sb(sb_) {}
+        backend(backend_), baud_rate(baud_rate_),
+        cs(cs_), fc(fc_), py(py_), sb(sb_) {}
 
-    LibSerial::BaudRate br;
+    LinuxSerialBackend backend;
+    std::size_t baud_rate;  // bits/s
     LibSerial::CharacterSize cs;
     LibSerial::FlowControl fc;
     LibSerial::Parity py;
     LibSerial::StopBits sb;
+
+    /*
+     * Termios backend tuning. The port is read without blocking, so these
+     * act through poll(): with vtime 0, the port only reports readable once
+     * vmin bytes have arrived. Raising vmin lets the kernel batch bytes at high
+     * baud rates, at the cost of latency. A nonzero vtime makes the port
+     * readable from the first byte, and each read takes what has arrived.
+     */
+    cc_t vmin = 1;
+    cc_t vtime = 0;
+    bool low_latency = true;  // ASYNC_LOW_LATENCY, where the driver allows it
+    bool exclusive = true;    // TIOCEXCL
 };
 
 /*
- * Linux implementation of a serial port. Uses libserial library. Operates
- * synchronously.
+ * Linux implementation of a serial port. The port is opened and configured
+ * either through the libserial library or directly through termios, selectable
+ * at runtime while the port is closed. Reading happens on a background thread
+ * which blocks in poll() until the kernel has data, then drains it with a
+ * single read() straight into the byte ring.
  */
 class LinuxSerialPort
 {
 public:
     LinuxSerialPort(
-        std::shared_ptr<BoundedBuffer<char>>,
+        std::shared_ptr<SpscRing<char>>,
         LinuxSerialPortConfig const*);
     ~LinuxSerialPort();
 
@@ -60,6 +97,9 @@ public:
     bool start_reading();
     void stop_reading();
 
+    bool set_backend(LinuxSerialBackend);
+    LinuxSerialBackend get_backend() const { return backend; }
+
     bool is_open() const { return port_open; }
     bool is_reading() const { return port_reading.load(); }
     std::string get_port_name() const { return port_name; }
@@ -69,12 +109,28 @@ private:
      * Linux-specific state.
      */
     LinuxSerialPortConfig const* cfg;
-    LibSerial::SerialStream stream;
+    LinuxSerialBackend backend;
+
+    LibSerial::SerialStream stream;  // LibSerial backend
+    int tty_fd = -1;                 // Termios backend
+
+    bool open_termios(const std::string&);
+    bool config_libserial();
+    bool config_termios();
+    int port_fd();
+
+    // Scratch space for draining the kernel while the ring is full.
+    static constexpr std::size_t READ_CHUNK_SIZE = 4096;
+
+    std::thread reader_thread;
+    int stop_fd = -1;  // eventfd used to wake the reader thread on stop
+
+    void read_loop();
 
     /*
      * General serial port state.
      */
-    std::shared_ptr<BoundedBuffer<char>> buffer;
+    std::shared_ptr<SpscRing<char>> buffer;
 
     bool port_open = false;
     bool port_configured = false;
@@ -1,6 +1,7 @@
 #ifndef SERIAL_PORT
 #define SERIAL_PORT
 
+#include <functional>
 #include <memory>
 
 #ifdef OS_CYGWIN
@@ -22,10 +23,10 @@ class SerialPort
 {
 public:
 #ifdef OS_CYGWIN
-    explicit SerialPort(std::shared_ptr<BoundedBuffer<char>>);
+    explicit SerialPort(std::shared_ptr<SpscRing<char>>);
 #elif OS_LINUX
     SerialPort(
-        std::shared_ptr<BoundedBuffer<char>>,
+        std::shared_ptr<SpscRing<char>>,
         LinuxSerialPortConfig const*);
 #endif
     ~SerialPort();
@@ -45,12 +46,28 @@ public:
     bool start_reading();
     void stop_reading();
 
+    /*
+     * Starts and stops the byte ring's consumer along with the reader thread.
+     * The consumer is also stopped before reading starts, since the reader
+     * may have exited on its own and the driver may reset the ring.
+     */
+    void set_consumer_hooks(std::function<void()> on_start,
+                            std::function<void()> on_stop);
+
+#ifdef OS_LINUX
+    bool set_backend(LinuxSerialBackend);
+    LinuxSerialBackend get_backend() const;
+#endif
+
     bool is_open() const;
     bool is_reading() const;
     std::string get_port_name() const;
     std::vector<std::string> get_available_ports() const;
 
 private:
+    std::function<void()> consumer_start{};
+    std::function<void()> consumer_stop{};
+
 #ifdef OS_CYGWIN
     WindowsSerialPort windows_port;
 #elif OS_LINUX
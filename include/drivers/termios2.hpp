@@ -0,0 +1,18 @@
+#ifndef TERMIOS2_HPP
+#define TERMIOS2_HPP
+
+#ifdef OS_LINUX
+
+#include <cstddef>
+
+/*
+ * Sets an arbitrary baud rate (e.g. 1.5M, 2M or 3M) on an open tty using the
+ * Linux termios2 interface and the BOTHER flag. Lives in its own translation
+ * unit since <asm/termbits.h> cannot be included alongside glibc's
+ * <termios.h>. Returns false and sets errno on failure.
+ */
+bool set_custom_baud_rate(int fd, std::size_t baud_rate);
+
+#endif /* OS_LINUX */
+
+#endif /* TERMIOS2_HPP */
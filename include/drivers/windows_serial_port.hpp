@@ -16,13 +16,13 @@
 #include <Process.h>
 #include <windows.h>
 
-#include "bounded_buffer.hpp"
+#include "spsc_ring.hpp"
 #include "logger.hpp"
 
 class WindowsSerialPort
 {
 public:
-    explicit WindowsSerialPort(std::shared_ptr<BoundedBuffer<char>>);
+    explicit WindowsSerialPort(std::shared_ptr<SpscRing<char>>);
     ~WindowsSerialPort();
 
     // Disallow copying and moving.
@@ -63,7 +63,7 @@ private:
     /*
      * General serial port state.
      */
-    std::shared_ptr<BoundedBuffer<char>> buffer;
+    std::shared_ptr<SpscRing<char>> buffer;
 
     bool port_open = false;
     bool port_configured = false;
@@ -8,6 +8,7 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <stb_image.h>
 
@@ -221,9 +222,7 @@ void GraphicsManager::render_scene(Shader* shader)
     if (drone_data)
     {
         model = glm::translate(model, drone_data->position);
-        model = glm::rotate(model, glm::radians(drone_data->orientation.y), glm::vec3(1.0, 0.0, 0.0));  // pitch
-        model = glm::rotate(model, glm::radians(drone_data->orientation.z), glm::vec3(0.0, 1.0, 0.0));  // yaw
-        model = glm::rotate(model, glm::radians(drone_data->orientation.x), glm::vec3(0.0, 0.0, 1.0));  // roll
+        model = model * glm::mat4_cast(drone_data->attitude);
         model = glm::scale(model, glm::vec3(drone_scale_factor));
     }
     else
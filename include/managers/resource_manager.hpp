@@ -7,8 +7,6 @@ class ResourceManager
 {
 public:
     std::mutex viewer_mode_mutex;
-    std::mutex drone_data_mutex;
-    std::mutex camera_data_mutex;
 };
 
 #endif /* RESOURCE_MANAGER_HPP */
@@ -1,307 +1,692 @@
 #ifndef TELEMETRY_MANAGER_HPP
 #define TELEMETRY_MANAGER_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#include "attitude_estimator.hpp"
+#include "cobs_framer.hpp"
+#include "filters.hpp"
+#include "flight_recorder.hpp"
+#include "frame_scanner.hpp"
+#include "latency_histogram.hpp"
+#include "latest_value.hpp"
 #include "logger.hpp"
-#include "resource_manager.hpp"
+#include "position_estimator.hpp"
+#include "sample_history.hpp"
 #include "serial_port.hpp"
 #include "shared.hpp"
+#include "spsc_ring.hpp"
+#include "telemetry_format.hpp"
+#include "telemetry_framing.hpp"
+#include "telemetry_mode.hpp"
+#include "telemetry_schema.hpp"
 
-struct TelemetryData;
-struct TelemetryFormat;
+/*
+ * Returns the telemetry ring capacity needed to hold everything a link of the
+ * given baud rate can deliver while the consumer is stalled for max_stall
+ * (e.g. a slow frame or a window drag blocking the main loop). Each byte takes
+ * 10 bits on the wire with 8N1 framing. Never returns less than min_len.
+ */
+std::size_t telemetry_buffer_len(std::size_t baud_rate,
+                                 std::chrono::milliseconds max_stall,
+                                 std::size_t min_len)
+{
+    std::size_t bytes_per_sec = baud_rate / 10;
+    std::size_t len = bytes_per_sec * max_stall.count() / 1000;
+    return std::max(len, min_len);
+}
 
-struct TelemetryFormat
+/*
+ * Cumulative time spent in each stage of the telemetry pipeline. Framing is
+ * finding packets in the byte ring, decoding is converting their fields, and
+ * filtering includes publishing the result. A wakeup is one pass over
+ * everything the ring held.
+ */
+struct TelemetryPipelineStats
 {
-    TelemetryFormat(std::size_t packet_len_,
-                    char start_symbol_,
-                    char stop_symbol_,
-                    std::size_t conversion_factor_,
-                    std::size_t element_size_,
-                    std::vector<std::size_t> accel_offsets_,
-                    std::vector<std::size_t> rot_rate_offsets_) :
-        packet_len(packet_len_),
-        start_symbol(start_symbol_),
-        stop_symbol(stop_symbol_),
-        conversion_factor(conversion_factor_),
-        element_size(element_size_),
-        accel_offsets(accel_offsets_),
-        rot_rate_offsets(rot_rate_offsets_)
-    {}
-
-    const std::size_t packet_len;
-    const char start_symbol;
-    const char stop_symbol;
-    const std::size_t conversion_factor;
-    const std::size_t element_size;
-    const std::vector<std::size_t> accel_offsets{};
-    const std::vector<std::size_t> rot_rate_offsets{};
+    std::uint64_t wakeups{};
+    std::uint64_t packets{};
+    std::chrono::nanoseconds framing{};
+    std::chrono::nanoseconds decoding{};
+    std::chrono::nanoseconds filtering{};
+    std::chrono::nanoseconds longest_wakeup{};
 };
 
 /*
- * Telemetry data which comes from the telemetry board via an external serial
- * connection.
+ * Frames, decodes and filters telemetry on its own thread, woken by the serial
+ * reader as bytes arrive, so telemetry latency doesn't depend on the frame
+ * rate. The thread follows the serial port's reader thread. Each result is
+ * timestamped (by the drone's clock if the format has a DRONE_TIME_CHANNEL,
+ * otherwise from its arrival) and added to a short history, which is published
+ * through a LatestValue. sample_drone_data() evaluates the newest history at
+ * the time the render thread asks for, so neither side ever blocks the other
+ * and motion stays smooth whatever the packet and frame rates.
+ *
+ * process_telemetry() runs one pass of the pipeline and may also be called
+ * directly when the thread isn't running and the serial port is reading.
+ * Another producer, like a FlightReplay, can feed the ring instead of the
+ * serial reader while the thread is started by hand. Decoder state and link
+ * counters belong to whichever thread runs the pipeline.
  */
-class TelemetryData
+class TelemetryManager
 {
 public:
-    explicit TelemetryData(TelemetryFormat fmt_) : fmt(fmt_) {}
+    TelemetryManager(TelemetryMode mode_,
+                     TelemetryFormat fmt_,
+                     SerialPort* serial_port_,
+                     DroneData* drone_data_,
+                     std::shared_ptr<SpscRing<char>> telemetry_buffer_,
+                     LatencyMonitor* latency_monitor_) :
+        mode(mode_),
+        fmt(fmt_),
+        serial_port(serial_port_),
+        drone_data(drone_data_),
+        telemetry_buffer(telemetry_buffer_),
+        latency_monitor(latency_monitor_)
+    {
+        auto it = std::find(fmt.channel_names.begin(), fmt.channel_names.end(),
+            DRONE_TIME_CHANNEL);
+        if (it != fmt.channel_names.end())
+            time_channel = static_cast<std::size_t>(it - fmt.channel_names.begin());
+    }
+    ~TelemetryManager();
 
-    DroneData& operator=(const TelemetryData&);
+    // Disallow copying and moving, the pipeline thread refers to this.
+    TelemetryManager(const TelemetryManager&) = delete;
+    TelemetryManager& operator=(const TelemetryManager&) = delete;
+    TelemetryManager(TelemetryManager&&) = delete;
+    TelemetryManager& operator=(TelemetryManager&&) = delete;
 
-    bool extract_packet_data(const std::string& packet)
-    {
-        if (packet.size() != fmt.packet_len)
-        {
-            logger.log(LogLevel::error, "Packet incorrect length.\n");
-            return false;
-        }
+    bool init();
 
-        accel.x = std::stof(packet.substr(fmt.accel_offsets[0], fmt.element_size)) / fmt.conversion_factor;
-        accel.y = std::stof(packet.substr(fmt.accel_offsets[1], fmt.element_size)) / fmt.conversion_factor;
-        accel.z = std::stof(packet.substr(fmt.accel_offsets[2], fmt.element_size)) / fmt.conversion_factor;
+    /*
+     * Replaces the filter chain of one of the standard channels (see
+     * STANDARD_CHANNELS), with the stages applied in the given order. Channels
+     * without a chain pass samples through unfiltered. Only possible while the
+     * pipeline thread isn't running.
+     */
+    bool set_filter_chain(std::size_t channel, const std::vector<FilterSpec>&);
 
-        rot_rate.x = std::stof(packet.substr(fmt.rot_rate_offsets[0], fmt.element_size)) / fmt.conversion_factor;
-        rot_rate.y = std::stof(packet.substr(fmt.rot_rate_offsets[1], fmt.element_size)) / fmt.conversion_factor;
-        rot_rate.z = std::stof(packet.substr(fmt.rot_rate_offsets[2], fmt.element_size)) / fmt.conversion_factor;
+    /*
+     * Estimates orientation from the gyro and accelerometer channels of every
+     * decoded packet instead of filtering the raw rot_rate channels. Only
+     * possible while the pipeline thread isn't running. Best used with Lossless
+     * mode, since the estimator integrates over the samples it's given.
+     */
+    bool enable_attitude_estimator(const AttitudeEstimatorConfig&);
 
-        return true;
-    }
+    /*
+     * Estimates position by integrating the accelerometer channels of every
+     * decoded packet, corrected by the fix channels named in the
+     * configuration, instead of filtering the raw accel channels. Uses the
+     * attitude estimator's orientation if that is enabled too. Only possible
+     * while the pipeline thread isn't running.
+     */
+    bool enable_position_estimator(const PositionEstimatorConfig&);
 
-    // TODO change this to convert accel->pos and rot_rate->rot, not just pass
-    // the values through.
-    DroneData get_raw_drone_data() const
-    {
-        return DroneData(accel, rot_rate);
-    }
+    /*
+     * Copies every byte drained from the serial ring, and the channels of
+     * every decoded packet, to a flight recorder, or stops copying if nullptr.
+     * Only possible while the pipeline thread isn't running.
+     */
+    bool set_flight_recorder(FlightRecorder*);
 
-    glm::vec3 get_accel() const { return accel; }
-    glm::vec3 get_rot_rate() const { return rot_rate; }
-private:
-    TelemetryFormat fmt;
+    template <typename F>
+    std::size_t for_each_packet(F&&);
+    bool process_telemetry();
 
-    glm::vec3 accel{};
-    glm::vec3 rot_rate{};
-};
+    void start();
+    void stop();
+    bool is_running() const { return worker.joinable(); }
 
-/*
- * Definitions requiring complete definitions of DroneData and TelemetryData.
- */
-DroneData& DroneData::operator=(const TelemetryData& tel)
-{
-    position = tel.get_accel();
-    orientation = tel.get_rot_rate();
+    /*
+     * Sets drone_data to the drone's state at time t, interpolated from the
+     * newest published history, or extrapolated by up to max_extrapolation
+     * past its newest sample. Returns whether there was any history.
+     */
+    bool sample_drone_data(std::chrono::steady_clock::time_point t,
+                           std::chrono::steady_clock::duration max_extrapolation);
 
-    return *this;
-}
+    /*
+     * Newest sample in the history read by the last sample_drone_data(), or
+     * nullptr if there's none. Render thread only.
+     */
+    const TimedDroneData* get_newest_sample() const
+    {
+        const auto& h = published.read();
+        return h.size() ? &h.newest() : nullptr;
+    }
 
-class TelemetryManager
-{
-public:
-    TelemetryManager(std::size_t packet_len_,
-                     char start_symbol_,
-                     char stop_symbol_,
-                     std::size_t float_conversion_factor_,
-                     std::size_t float_format_len_,
-                     std::vector<std::size_t> accel_offsets_,
-                     std::vector<std::size_t> rot_rate_offsets_,
-                     SerialPort* serial_port_,
-                     DroneData* drone_data_,
-                     ResourceManager* resource_manager_,
-                     std::shared_ptr<BoundedBuffer<char>> telemetry_buffer_) :
-        packet_len(packet_len_),
-        start_symbol(start_symbol_),
-        stop_symbol(stop_symbol_),
-        float_conversion_factor(float_conversion_factor_),
-        float_format_len(float_format_len_),
-        accel_offsets(accel_offsets_),
-        rot_rate_offsets(rot_rate_offsets_),
-        serial_port(serial_port_),
-        drone_data(drone_data_),
-        resource_manager(resource_manager_),
-        telemetry_buffer(telemetry_buffer_)
-    {}
+    TelemetryPipelineStats get_pipeline_stats() const;
 
-    bool init();
+    TelemetryMode get_mode() const { return mode.load(); }
+    void set_mode(TelemetryMode mode_) { mode.store(mode_); }
 
-    DroneData filter_data(std::vector<DroneData>);
-    std::shared_ptr<std::string> build_latest_packet();
-    bool process_telemetry();
+    /*
+     * Link quality counters for binary formats. crc_errors counts frames
+     * which failed to decode or failed their CRC check, packets_lost counts
+     * gaps in the sequence numbers of valid packets.
+     */
+    std::size_t get_crc_errors() const { return cobs_framer.get_crc_errors(); }
+    std::size_t get_packets_lost() const { return cobs_framer.get_packets_lost(); }
+
+    /*
+     * Framing counters. Skipped bytes belong to no valid packet. Rejected
+     * packets failed framing (or, for COBS, decoding or the CRC check).
+     * Recovered packets were found by rescanning a rejected region, which only
+     * applies to ASCII framing; a COBS frame always ends at the next delimiter.
+     */
+    std::size_t get_bytes_skipped() const;
+    std::size_t get_packets_rejected() const;
+    std::size_t get_packets_recovered() const;
+
+    /*
+     * Every channel of the format, including extra channels defined by a
+     * schema, as decoded from the most recent packet.
+     */
+    const std::vector<std::string>& get_channel_names() const { return fmt.channel_names; }
+    const std::vector<float>& get_channels() const { return telemetry_data.get_channels(); }
 private:
-    const std::size_t packet_len;
-    const char start_symbol;
-    const char stop_symbol;
-    const std::size_t float_conversion_factor;
-    const std::size_t float_format_len;
-    const std::vector<std::size_t> accel_offsets;
-    const std::vector<std::size_t> rot_rate_offsets;
-
-    std::unique_ptr<TelemetryFormat> fmt;
+    std::atomic<TelemetryMode> mode;
+
+    const TelemetryFormat fmt;
     SerialPort* serial_port;
     DroneData* drone_data;
-    ResourceManager* resource_manager;
 
-    std::shared_ptr<BoundedBuffer<char>> telemetry_buffer;
-    bool build_new_packet = true;
-    std::string latest_packet{};
+    std::shared_ptr<SpscRing<char>> telemetry_buffer;
+    LatencyMonitor* latency_monitor;
+    FlightRecorder* flight_recorder = nullptr;
+
+    // Time of the most recent serial read before the current pass. Packets
+    // completed in the pass are taken to have arrived then.
+    std::chrono::steady_clock::time_point pass_received{};
+
+    // ASCII framing.
+    FrameScanner scanner{fmt.start_symbol, fmt.stop_symbol, fmt.packet_len};
+    std::vector<FrameCandidate> candidates{};
 
-    static constexpr std::size_t RAW_DATA_BUF_MAXLEN = 32;
-    std::vector<DroneData> raw_data_buf;
+    // COBS framing.
+    CobsFramer cobs_framer{fmt.packet_len, fmt.encoded_len};
+
+    // Copy of the newest packet in Latest mode.
+    std::string newest_packet{};
+
+    // Decoder state, kept across calls so the channel values stay available.
+    TelemetryData telemetry_data{fmt};
+
+    void process_packet(std::string_view);
+    void process_pass();
+
+    // Per-channel filters, in STANDARD_CHANNELS order, and their outputs.
+    std::array<FilterChain, STANDARD_CHANNELS.size()> filters{};
+    DroneData filtered{INITIAL_DRONE_DATA};
+
+    // Replaces the orientation filters when enabled.
+    std::optional<AttitudeEstimator> attitude_estimator;
+
+    // Replaces the position filters when enabled, with the format channels
+    // carrying its fixes, if any.
+    std::unique_ptr<PositionEstimator> position_estimator;
+    std::optional<std::array<std::size_t, 3>> fix_channels;
+
+    // Timestamped filtered results. The history is copied into published on
+    // every pipeline pass and read by the render thread.
+    static constexpr std::size_t HISTORY_LEN = 64;
+    std::optional<std::size_t> time_channel;
+    DroneClock drone_clock;
+    ArrivalClock arrival_clock;
+    SampleHistory<HISTORY_LEN> history;
+    LatestValue<SampleHistory<HISTORY_LEN>> published;
+
+    /*
+     * Pipeline thread. The idle timeout only bounds how long a lost wakeup
+     * could go unnoticed, data and stop requests wake the thread directly.
+     */
+    static constexpr std::chrono::milliseconds WORKER_IDLE_TIMEOUT{100};
+
+    std::thread worker;
+    std::atomic<bool> stop_requested = false;
+
+    void run();
+
+    // Stage timings, written by the pipeline thread only.
+    std::chrono::steady_clock::duration decode_time{};
+    std::chrono::steady_clock::duration filter_time{};
+    std::atomic<std::uint64_t> stat_wakeups{};
+    std::atomic<std::uint64_t> stat_packets{};
+    std::atomic<std::int64_t> stat_framing_ns{};
+    std::atomic<std::int64_t> stat_decoding_ns{};
+    std::atomic<std::int64_t> stat_filtering_ns{};
+    std::atomic<std::int64_t> stat_longest_wakeup_ns{};
 };
 
 bool TelemetryManager::init()
 {
-    /*
-     * Initialize communications interfaces.
-     */
-    fmt = std::make_unique<TelemetryFormat>(
-        packet_len,
-        start_symbol,
-        stop_symbol,
-        float_conversion_factor,
-        float_format_len,
-        accel_offsets,
-        rot_rate_offsets
-    );
+    // Schema programs are validated when the schema is loaded.
+    if (fmt.program.empty() &&
+        (fmt.accel_offsets.size() != 3 || fmt.rot_rate_offsets.size() != 3))
+    {
+        logger.log(LogLevel::fatal,
+            "TelemetryManager::init: Expected 3 accel and rot_rate offsets\n");
+        return false;
+    }
+    for (auto offsets : {&fmt.accel_offsets, &fmt.rot_rate_offsets})
+    {
+        for (auto offset : *offsets)
+        {
+            if (offset + fmt.element_size > fmt.packet_len)
+            {
+                logger.log(LogLevel::fatal, "TelemetryManager::init: Field ",
+                    "offset ", offset, " exceeds packet length\n");
+                return false;
+            }
+        }
+    }
+
+    newest_packet.reserve(fmt.packet_len);
+
+    if (serial_port)
+    {
+        serial_port->set_consumer_hooks([this]{ start(); }, [this]{ stop(); });
+        if (serial_port->is_reading())
+            start();
+    }
 
     return true;
 }
 
-/*
- * Implement simple moving average filter.
- */
-DroneData TelemetryManager::filter_data(std::vector<DroneData> buf)
+TelemetryManager::~TelemetryManager()
 {
-    DroneData sum{};
+    if (serial_port)
+        serial_port->set_consumer_hooks(nullptr, nullptr);
+    stop();
+}
 
-    for (auto& e : buf)
-        sum += e;
+void TelemetryManager::start()
+{
+    stop();
+    stop_requested.store(false);
+    worker = std::thread(&TelemetryManager::run, this);
+}
 
-    return DroneData{sum.position / (float)buf.size(),
-                     sum.orientation / (float)buf.size()};
+void TelemetryManager::stop()
+{
+    if (!worker.joinable())
+        return;
+
+    stop_requested.store(true);
+    telemetry_buffer->wake_consumer();
+    worker.join();
+
+    auto stats = get_pipeline_stats();
+    if (!stats.packets)
+        return;
+
+    using us = std::chrono::duration<double, std::micro>;
+    logger.log(LogLevel::info, "Telemetry pipeline: ", stats.packets,
+        " packets in ", stats.wakeups, " wakeups. Per packet: framing ",
+        us(stats.framing).count() / stats.packets, " us, decoding ",
+        us(stats.decoding).count() / stats.packets, " us, filtering ",
+        us(stats.filtering).count() / stats.packets, " us. Longest wakeup ",
+        us(stats.longest_wakeup).count(), " us\n");
 }
 
 /*
- * The telemetry-receiving module of the application processes drone data in a
- * streaming fashion. That is, only the most recent data from the drone is used.
- * The graphics portion of the application runs at 60Hz. At the moment the
- * telemetry processing module also runs at this same frequency of 60Hz, since
- * it is part of the main application loop. The main loop of the drone will
- * likely run at a higher rate, say 100-200Hz. Therefore, many packets will
- * be dropped. At the moment that is fine, but it means that the viewer won't be
- * able to run any kind of controls filters on the data since it does not
- * receive all of it.
- *
- * Now, onto this function. Since we are streaming the data in real-time and
- * don't care about loss, only the minimal amount of raw data is kept. To be
- * precise, the raw telemetry buffer is the size of two full packets, minus one.
- * This makes packet construction both simple and quick. As a quick example, say
- * the packet has a start symbol A, a stop symbol C, and a length of 3. Then the
- * following permutation are possible when the buffer is full:
- *
- *         1. | B | A | C | B | A |
- *   back  2. | C | B | A | C | B |  front
- *         3. | A | C | B | A | C |
- *
- * By searching first for the start symbol, then the stop symbol while ensuring
- * correct length, a complete uncorrupted packet can be built consistently.
+ * Pipeline thread. Sleeps until the serial reader (or a replay) commits bytes
+ * to the ring, then drains it.
  */
-std::shared_ptr<std::string> TelemetryManager::build_latest_packet()
+void TelemetryManager::run()
 {
-    char tmp{};
-    std::shared_ptr<char> result{};
+    while (!stop_requested.load())
+    {
+        telemetry_buffer->wait_readable_for(WORKER_IDLE_TIMEOUT);
+        if (stop_requested.load())
+            break;
+        process_pass();
+    }
+}
 
-    // If necessary, start building new packet. First, find the start symbol.
-    result = telemetry_buffer->try_pop();
-    if (build_new_packet)
+bool TelemetryManager::sample_drone_data(std::chrono::steady_clock::time_point t,
+    std::chrono::steady_clock::duration max_extrapolation)
+{
+    if (!drone_data)
+        return false;
+
+    published.update();
+    return published.read().sample_at(t, max_extrapolation, *drone_data);
+}
+
+TelemetryPipelineStats TelemetryManager::get_pipeline_stats() const
+{
+    using ns = std::chrono::nanoseconds;
+    TelemetryPipelineStats stats{};
+    stats.wakeups = stat_wakeups.load(std::memory_order_relaxed);
+    stats.packets = stat_packets.load(std::memory_order_relaxed);
+    stats.framing = ns(stat_framing_ns.load(std::memory_order_relaxed));
+    stats.decoding = ns(stat_decoding_ns.load(std::memory_order_relaxed));
+    stats.filtering = ns(stat_filtering_ns.load(std::memory_order_relaxed));
+    stats.longest_wakeup = ns(stat_longest_wakeup_ns.load(std::memory_order_relaxed));
+    return stats;
+}
+
+bool TelemetryManager::set_filter_chain(std::size_t channel,
+                                        const std::vector<FilterSpec>& specs)
+{
+    if (is_running())
     {
-        while (result)
-        {
-            if (*result == fmt->start_symbol)
-                break;
-            result = telemetry_buffer->try_pop();
-        }
+        logger.log(LogLevel::error, "TelemetryManager::set_filter_chain: \
+            Cannot change filters while the pipeline is running\n");
+        return false;
+    }
+    if (channel >= filters.size())
+    {
+        logger.log(LogLevel::error, "TelemetryManager::set_filter_chain: \
+            No standard channel ", channel, '\n');
+        return false;
     }
 
-    // Extract the rest of the packet.
-    while (result)
+    FilterChain chain;
+    for (auto& spec : specs)
     {
-        if (*result == fmt->stop_symbol)
-            break;
-        latest_packet += *result;
-        result = telemetry_buffer->try_pop();
+        auto stage = make_filter(spec);
+        if (!stage)
+            return false;
+        chain.add(std::move(stage));
     }
 
-    // Complete packet not built yet.
-    if (latest_packet.size() < fmt->packet_len)
+    filters[channel] = std::move(chain);
+    return true;
+}
+
+bool TelemetryManager::enable_attitude_estimator(const AttitudeEstimatorConfig& cfg)
+{
+    if (is_running())
+    {
+        logger.log(LogLevel::error, "TelemetryManager::enable_attitude_estimator: \
+            Cannot change the estimator while the pipeline is running\n");
+        return false;
+    }
+    if (!(cfg.sample_hz > 0.0f && cfg.beta >= 0.0f))
+    {
+        logger.log(LogLevel::error, "TelemetryManager::enable_attitude_estimator: \
+            Invalid sample rate or gain\n");
+        return false;
+    }
+
+    attitude_estimator.emplace(cfg);
+    return true;
+}
+
+bool TelemetryManager::enable_position_estimator(const PositionEstimatorConfig& cfg)
+{
+    if (is_running())
     {
-        build_new_packet = false;
-        return nullptr;
+        logger.log(LogLevel::error, "TelemetryManager::enable_position_estimator: \
+            Cannot change the estimator while the pipeline is running\n");
+        return false;
     }
 
-    // Finish building packet.
-    if ((latest_packet.size() == fmt->packet_len) &&
-        (latest_packet[0] == fmt->start_symbol))
+    std::optional<std::array<std::size_t, 3>> fix_indices;
+    if (cfg.fix_channels[0])
     {
-        std::string rv = latest_packet;
-        latest_packet.clear();
-        build_new_packet = true;
-        return std::make_shared<std::string>(rv);
+        const auto& names = fmt.channel_names;
+        fix_indices.emplace();
+        for (std::size_t i = 0; i < 3; i++)
+        {
+            auto it = cfg.fix_channels[i] ?
+                std::find(names.begin(), names.end(), cfg.fix_channels[i]) :
+                names.end();
+            if (it == names.end())
+            {
+                logger.log(LogLevel::error, "TelemetryManager::enable_position_estimator: \
+                    Format has no fix channel ", cfg.fix_channels[i] ? cfg.fix_channels[i] : "(null)", '\n');
+                return false;
+            }
+            (*fix_indices)[i] = static_cast<std::size_t>(it - names.begin());
+        }
     }
 
-    // Packet is complete but corrupted, restart.
-    latest_packet.clear();
-    build_new_packet = true;
-    return nullptr;
+    auto estimator = make_position_estimator(cfg);
+    if (!estimator)
+        return false;
+
+    position_estimator = std::move(estimator);
+    fix_channels = fix_indices;
+    return true;
 }
 
-bool TelemetryManager::process_telemetry()
+bool TelemetryManager::set_flight_recorder(FlightRecorder* recorder)
 {
-    auto packet_str = std::make_shared<std::string>();
+    if (is_running())
+    {
+        logger.log(LogLevel::error, "TelemetryManager::set_flight_recorder: \
+            Cannot change the recorder while the pipeline is running\n");
+        return false;
+    }
 
-    if (!serial_port)
-        logger.log(LogLevel::error, "TelemetryManager::process_telemetry: \
-            serial_port is null\n");
+    flight_recorder = recorder;
+    return true;
+}
 
-    if (serial_port && serial_port->is_reading())
+/*
+ * The telemetry-receiving module of the application processes drone data in a
+ * streaming fashion. It runs on the pipeline thread (see run()), which wakes
+ * whenever the serial reader or a replay commits bytes to the ring, so a
+ * wakeup may hold anything from part of a packet to a long backlog.
+ *
+ * Every byte which arrived since the last call is drained from the telemetry
+ * ring, a contiguous segment at a time, and fed to the framer for the link's
+ * format. on_packet is called with every complete packet in arrival order,
+ * while the packet still lies in the ring (or in the framer's buffer, for
+ * packets split across segments or COBS encoded), so it's never copied. The
+ * view is only valid during the call. Returns the number of packets found.
+ */
+template <typename F>
+std::size_t TelemetryManager::for_each_packet(F&& on_packet)
+{
+    std::size_t n = 0;
+    auto counted = [&](std::string_view packet)
+    {
+        n++;
+        on_packet(packet);
+    };
+
+    for (Span<const char> bytes = telemetry_buffer->read_available();
+         !bytes.empty();
+         bytes = telemetry_buffer->read_available())
     {
-        packet_str = build_latest_packet();
-        if (packet_str)
+        if (fmt.framing == TelemetryFraming::Ascii)
+        {
+            scanner.scan(bytes, candidates);
+            if (scanner.has_carried())
+                counted(scanner.carried());
+            for (auto& c : candidates)
+                counted(std::string_view(bytes.data() + c.offset, c.length));
+        }
+        else
         {
-            logger.log(LogLevel::info, "packet_str = ", *packet_str, '\n');
+            cobs_framer.frame(bytes, counted);
         }
+
+        if (flight_recorder)
+            flight_recorder->record_raw(pass_received, bytes);
+        telemetry_buffer->consume(bytes.size());
+    }
+
+    return n;
+}
+
+std::size_t TelemetryManager::get_bytes_skipped() const
+{
+    if (fmt.framing == TelemetryFraming::Ascii)
+        return scanner.get_bytes_skipped();
+    return cobs_framer.get_bytes_skipped();
+}
+
+std::size_t TelemetryManager::get_packets_rejected() const
+{
+    if (fmt.framing == TelemetryFraming::Ascii)
+        return scanner.get_packets_rejected();
+    return cobs_framer.get_crc_errors();
+}
+
+std::size_t TelemetryManager::get_packets_recovered() const
+{
+    if (fmt.framing == TelemetryFraming::Ascii)
+        return scanner.get_packets_recovered();
+    return 0;
+}
+
+void TelemetryManager::process_packet(std::string_view packet)
+{
+    using clock = std::chrono::steady_clock;
+    auto t0 = clock::now();
+
+    if (fmt.framing == TelemetryFraming::Ascii)
+        logger.log(LogLevel::debug, "packet = ", packet, '\n');
+
+    // Corrupted fields are dropped rather than ending the application, since
+    // line noise can keep a packet at the correct length.
+    if (!telemetry_data.extract_packet_data(packet))
+    {
+        decode_time += clock::now() - t0;
+        return;
+    }
+
+    auto t1 = clock::now();
+    DroneData raw = telemetry_data.get_raw_drone_data();
+    if (attitude_estimator)
+    {
+        attitude_estimator->update(telemetry_data.get_rot_rate(),
+            telemetry_data.get_accel());
+        filtered.attitude = attitude_estimator->get_orientation();
+        filtered.orientation = quat_to_orientation(filtered.attitude);
     }
     else
     {
-        return true;
+        for (int i = 0; i < 3; i++)
+            filtered.orientation[i] = filters[3 + i].process(raw.orientation[i]);
+        filtered.attitude = orientation_to_quat(filtered.orientation);
     }
 
-    auto telemetry_data = std::make_shared<TelemetryData>(*fmt);
-    if (packet_str)
+    if (position_estimator)
     {
-        if (!telemetry_data->extract_packet_data(*packet_str)) return false;
+        position_estimator->predict(telemetry_data.get_accel(),
+            telemetry_data.get_rot_rate(),
+            attitude_estimator ? attitude_estimator->get_orientation() : glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        if (fix_channels)
         {
-            if (raw_data_buf.size() >= RAW_DATA_BUF_MAXLEN)
-                raw_data_buf.erase(raw_data_buf.begin());
-            raw_data_buf.push_back(telemetry_data->get_raw_drone_data());
+            const auto& channels = telemetry_data.get_channels();
+            glm::vec3 fix(channels[(*fix_channels)[0]],
+                          channels[(*fix_channels)[1]],
+                          channels[(*fix_channels)[2]]);
+            if (std::isfinite(fix.x) && std::isfinite(fix.y) && std::isfinite(fix.z))
+                position_estimator->correct(fix);
         }
+        filtered.position = position_estimator->get_position();
+    }
+    else
+    {
+        for (int i = 0; i < 3; i++)
+            filtered.position[i] = filters[i].process(raw.position[i]);
+    }
+
+    // The pipeline is woken as bytes arrive, so t0 is the arrival time to
+    // within the wakeup latency.
+    auto time = time_channel ?
+        drone_clock.to_local(telemetry_data.get_channels()[*time_channel], t0) :
+        arrival_clock.to_local(t0);
+    auto t2 = clock::now();
+    history.push({filtered, time, pass_received, t2});
+
+    decode_time += t1 - t0;
+    filter_time += t2 - t1;
+
+    if (latency_monitor)
+    {
+        latency_monitor->record(LatencyStage::SerialToPacket, t0 - pass_received);
+        latency_monitor->record(LatencyStage::PacketToFilter, t2 - t0);
     }
 
-    // Filter input.
-    if (resource_manager)
+    if (flight_recorder)
+        flight_recorder->record_sample(time, telemetry_data.get_channels());
+}
+
+bool TelemetryManager::process_telemetry()
+{
+    if (!serial_port)
+        logger.log(LogLevel::error, "TelemetryManager::process_telemetry: \
+            serial_port is null\n");
+
+    if (!serial_port || !serial_port->is_reading())
+        return true;
+
+    process_pass();
+    return true;
+}
+
+/*
+ * In Latest mode only the newest packet of each pass reaches the filter, the
+ * rest are dropped. In Lossless mode every packet is filtered in order, so the
+ * filter sees the drone's actual sample rate rather than how often the
+ * pipeline happens to run.
+ */
+void TelemetryManager::process_pass()
+{
+    using clock = std::chrono::steady_clock;
+    pass_received = telemetry_buffer->last_write_time();
+    auto t0 = clock::now();
+    decode_time = {};
+    filter_time = {};
+
+    std::size_t n;
+    if (mode.load() == TelemetryMode::Lossless)
     {
-        std::lock_guard<std::mutex> g(resource_manager->drone_data_mutex);
-        *drone_data = filter_data(raw_data_buf);
+        n = for_each_packet([this](std::string_view packet)
+        {
+            process_packet(packet);
+        });
     }
     else
     {
-        logger.log(LogLevel::error, "TelemetryManager::process_telemetry: \
-            resource_manager is null\n");
+        n = for_each_packet([this](std::string_view packet)
+        {
+            newest_packet.assign(packet);
+        });
+        if (n)
+            process_packet(newest_packet);
     }
 
-    return true;
+    if (!n)
+        return;
+
+    auto t1 = clock::now();
+    published.store(history);
+    auto t2 = clock::now();
+
+    auto ns = [](clock::duration d)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+    };
+    stat_wakeups.fetch_add(1, std::memory_order_relaxed);
+    stat_packets.fetch_add(n, std::memory_order_relaxed);
+    stat_framing_ns.fetch_add(ns(t1 - t0 - decode_time - filter_time),
+        std::memory_order_relaxed);
+    stat_decoding_ns.fetch_add(ns(decode_time), std::memory_order_relaxed);
+    stat_filtering_ns.fetch_add(ns(filter_time + (t2 - t1)), std::memory_order_relaxed);
+    if (ns(t2 - t0) > stat_longest_wakeup_ns.load(std::memory_order_relaxed))
+        stat_longest_wakeup_ns.store(ns(t2 - t0), std::memory_order_relaxed);
 }
 
 #endif /* TELEMETRY_MANAGER_HPP */
@@ -1,11 +1,14 @@
 #ifndef TIMER_MANAGER_HPP
 #define TIMER_MANAGER_HPP
 
-#include <atomic>
 #include <chrono>
-#include <string>
-#include <thread>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "logger.hpp"
 
@@ -20,116 +23,285 @@ enum class TimerName : std::size_t
 };
 
 /*
- * Individual timer object.
+ * Refers to one arming of a timer. A handle goes stale once its timer fires
+ * or is cancelled, so cancelling through an old handle never affects a timer
+ * armed later in the same slot. Default-constructed handles are always stale.
  */
-class Timer
+class TimerHandle
 {
 public:
-    explicit Timer(std::chrono::duration<double, std::milli> timeout_) :
-        timeout(timeout_) {}
+    TimerHandle() = default;
 
-    bool is_finished() const;
-
-    bool start();
-    void stop();
+    bool operator==(const TimerHandle& rhs) const
+    {
+        return slot == rhs.slot && generation == rhs.generation;
+    }
+    bool operator!=(const TimerHandle& rhs) const { return !(*this == rhs); }
 private:
-    std::chrono::duration<double, std::milli> timeout;
+    friend class TimerManager;
 
-    std::atomic<bool> cancel = false;
-    std::atomic<bool> done = true;
+    TimerHandle(std::uint32_t slot_, std::uint32_t generation_) :
+        slot(slot_), generation(generation_) {}
+
+    std::uint32_t slot = 0;
+    std::uint32_t generation = 0;
 };
 
-bool Timer::is_finished() const
+/*
+ * Deadline timers, checked once per frame instead of by a thread per timer.
+ * Pending timers are kept in a binary min-heap ordered by deadline, and each
+ * timer's slot records its position in the heap, so arming and cancelling are
+ * O(log n) and checking for expired timers is O(1) when none are due. Slots
+ * are recycled through a free list, so a steady stream of timers allocates
+ * nothing once the vectors have grown.
+ *
+ * Timers fire from update(), on the thread calling it (the main loop), so
+ * callbacks need no locking but a timer fires up to a frame late. That's fine
+ * for debouncing input, which is what the viewer uses them for. Not
+ * thread-safe.
+ *
+ * Named timers wrap one deadline timer each, for the key debouncing done by
+ * WindowManager: a named timer is finished once its timeout has passed since
+ * it was last started.
+ */
+class TimerManager
 {
-    return done.load();
-}
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+
+    /*
+     * Arms a timer which fires in update() once the deadline has passed,
+     * calling callback if given. Callbacks may arm and cancel timers.
+     */
+    TimerHandle arm_at(Clock::time_point deadline, Callback callback = {});
+    template <typename Rep, typename Period>
+    TimerHandle arm(std::chrono::duration<Rep, Period> timeout, Callback callback = {})
+    {
+        return arm_at(Clock::now() + std::chrono::duration_cast<Clock::duration>(timeout),
+                      std::move(callback));
+    }
+
+    /*
+     * Returns false if the timer already fired or was cancelled.
+     */
+    bool cancel(TimerHandle);
+    bool is_pending(TimerHandle) const;
+
+    /*
+     * Fires every timer whose deadline is at or before now, in deadline
+     * order. Returns the number fired.
+     */
+    std::size_t update(Clock::time_point now = Clock::now());
+
+    std::optional<Clock::time_point> next_deadline() const;
+    std::size_t num_pending() const { return heap.size(); }
 
-bool Timer::start()
+    bool is_finished(TimerName) const;
+
+    bool register_timer(TimerName, std::chrono::duration<double, std::milli>);
+    bool start_timer(TimerName);
+    void stop_timer(TimerName);
+private:
+    static constexpr std::uint32_t NOT_IN_HEAP = ~std::uint32_t(0);
+
+    struct Slot
+    {
+        Clock::time_point deadline{};
+        std::uint32_t heap_pos = NOT_IN_HEAP;
+        // Never 0, the generation of default-constructed handles.
+        std::uint32_t generation = 1;
+        Callback callback{};
+    };
+
+    std::vector<Slot> slots;
+    std::vector<std::uint32_t> free_slots;
+    // Slot indices, ordered by their deadlines.
+    std::vector<std::uint32_t> heap;
+
+    struct NamedTimer
+    {
+        Clock::duration timeout;
+        TimerHandle handle{};
+    };
+    std::unordered_map<TimerName, NamedTimer> named;
+
+    bool before(std::uint32_t a, std::uint32_t b) const
+    {
+        return slots[heap[a]].deadline < slots[heap[b]].deadline;
+    }
+    void place(std::uint32_t pos, std::uint32_t slot)
+    {
+        heap[pos] = slot;
+        slots[slot].heap_pos = pos;
+    }
+    void sift_up(std::uint32_t pos);
+    void sift_down(std::uint32_t pos);
+    void remove(std::uint32_t slot);
+};
+
+TimerHandle TimerManager::arm_at(Clock::time_point deadline, Callback callback)
 {
-    if (done.load())
+    std::uint32_t slot;
+    if (!free_slots.empty())
     {
-        done.store(false);
-
-        std::thread start_thread([this]{
-            using namespace std::chrono_literals;
-
-            auto start_time = std::chrono::steady_clock::now();
-            auto current_time = std::chrono::steady_clock::now();
-
-            while (1)
-            {
-                if (cancel.load())
-                {
-                    cancel.store(false);
-                    return;
-                }
-
-                std::this_thread::sleep_for(1ms);
-                current_time = std::chrono::steady_clock::now();
-                if ((current_time - start_time) > timeout)
-                {
-                    done.store(true);
-                    break;
-                }
-            }
-        });
-        start_thread.detach();
-        return true;
+        slot = free_slots.back();
+        free_slots.pop_back();
     }
     else
     {
+        slot = static_cast<std::uint32_t>(slots.size());
+        slots.emplace_back();
+    }
+
+    Slot& s = slots[slot];
+    s.deadline = deadline;
+    s.callback = std::move(callback);
+
+    heap.push_back(slot);
+    s.heap_pos = static_cast<std::uint32_t>(heap.size() - 1);
+    sift_up(s.heap_pos);
+
+    return TimerHandle(slot, s.generation);
+}
+
+bool TimerManager::is_pending(TimerHandle handle) const
+{
+    return handle.slot < slots.size() &&
+        slots[handle.slot].generation == handle.generation &&
+        slots[handle.slot].heap_pos != NOT_IN_HEAP;
+}
+
+bool TimerManager::cancel(TimerHandle handle)
+{
+    if (!is_pending(handle))
         return false;
+
+    remove(handle.slot);
+    return true;
+}
+
+std::size_t TimerManager::update(Clock::time_point now)
+{
+    std::size_t fired = 0;
+    while (!heap.empty() && slots[heap[0]].deadline <= now)
+    {
+        std::uint32_t slot = heap[0];
+
+        // Free the slot before calling back, so the callback sees the timer as
+        // fired and may reuse the slot.
+        Callback callback = std::move(slots[slot].callback);
+        remove(slot);
+        fired++;
+
+        if (callback)
+            callback();
     }
+    return fired;
 }
 
-void Timer::stop()
+std::optional<TimerManager::Clock::time_point> TimerManager::next_deadline() const
 {
-    cancel.store(true);
+    if (heap.empty())
+        return std::nullopt;
+    return slots[heap[0]].deadline;
 }
 
 /*
- * Manages multiple timers.
+ * Takes the slot out of the heap and puts it on the free list. Bumping the
+ * generation makes every handle to it stale.
  */
-class TimerManager
+void TimerManager::remove(std::uint32_t slot)
 {
-public:
-    bool is_finished(TimerName) const;
+    Slot& s = slots[slot];
+    std::uint32_t pos = s.heap_pos;
+    std::uint32_t last = heap.back();
+    heap.pop_back();
 
-    bool register_timer(TimerName, std::chrono::duration<double, std::milli>);
-    bool start_timer(TimerName);
-    void stop_timer(TimerName);
-private:
-    std::unordered_map<TimerName, Timer> timers;
-};
+    if (pos < heap.size())
+    {
+        place(pos, last);
+        sift_up(pos);
+        sift_down(slots[last].heap_pos);
+    }
+
+    s.heap_pos = NOT_IN_HEAP;
+    if (++s.generation == 0)
+        s.generation = 1;
+    s.callback = nullptr;
+    free_slots.push_back(slot);
+}
+
+void TimerManager::sift_up(std::uint32_t pos)
+{
+    std::uint32_t slot = heap[pos];
+    while (pos > 0)
+    {
+        std::uint32_t parent = (pos - 1) / 2;
+        if (!(slots[slot].deadline < slots[heap[parent]].deadline))
+            break;
+        place(pos, heap[parent]);
+        pos = parent;
+    }
+    place(pos, slot);
+}
+
+void TimerManager::sift_down(std::uint32_t pos)
+{
+    const std::uint32_t n = static_cast<std::uint32_t>(heap.size());
+    std::uint32_t slot = heap[pos];
+    for (;;)
+    {
+        std::uint32_t child = 2 * pos + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && before(child + 1, child))
+            child++;
+        if (!(slots[heap[child]].deadline < slots[slot].deadline))
+            break;
+        place(pos, heap[child]);
+        pos = child;
+    }
+    place(pos, slot);
+}
 
 bool TimerManager::is_finished(TimerName timer_name) const
 {
-    return timers.at(timer_name).is_finished();
+    return !is_pending(named.at(timer_name).handle);
 }
 
 bool TimerManager::register_timer(TimerName timer_name, std::chrono::duration<double, std::milli> timeout)
 {
-    auto search = timers.find(timer_name);
-    if (search != std::end(timers))
+    auto search = named.find(timer_name);
+    if (search != std::end(named))
     {
         logger.log(LogLevel::error, "TimerManager::register_timer: Timer with that name already exists\n");
         return false;
     }
     else
     {
-        timers.emplace(timer_name, timeout);
+        named.emplace(timer_name,
+            NamedTimer{std::chrono::duration_cast<Clock::duration>(timeout)});
         return true;
     }
 }
 
+/*
+ * Returns false if the timer is still running.
+ */
 bool TimerManager::start_timer(TimerName timer_name)
 {
-    return timers.at(timer_name).start();
+    NamedTimer& timer = named.at(timer_name);
+    if (is_pending(timer.handle))
+        return false;
+
+    timer.handle = arm(timer.timeout);
+    return true;
 }
 
 void TimerManager::stop_timer(TimerName timer_name)
 {
-    timers.at(timer_name).stop();
+    cancel(named.at(timer_name).handle);
 }
 
 #endif /* TIMER_MANAGER_HPP */
@@ -1,10 +1,14 @@
 #ifndef UI_MANAGER_HPP
 #define UI_MANAGER_HPP
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -14,6 +18,8 @@
 #include "imgui_impl_opengl3.h"
 #include "implot.h"
 
+#include "flight_replay.hpp"
+#include "latency_histogram.hpp"
 #include "resource_manager.hpp"
 #include "serial_port.hpp"
 #include "shared.hpp"
@@ -71,9 +77,12 @@ public:
                  DroneData* drone_data_,
                  Camera* camera_,
                  SerialPort* serial_port_,
+                 LatencyMonitor* latency_monitor_,
+                 FlightReplay* flight_replay_,
                  bool show_demo_window_,
                  bool show_implot_demo_window_,
-                 bool show_camera_data_window_);
+                 bool show_camera_data_window_,
+                 bool show_latency_window_);
     ~UiManager();
 
     bool init();
@@ -103,6 +112,7 @@ private:
     bool show_demo_window;
     bool show_implot_demo_window;
     bool show_camera_data_window;
+    bool show_latency_window;
     const ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
     static constexpr float WINDOW_BUF = 20.0f;
@@ -111,14 +121,26 @@ private:
     UiWindowSettings mode_win;
     UiWindowSettings controls_t_win;
     UiWindowSettings controls_e_win;
+    UiWindowSettings controls_r_win;
     UiWindowSettings drone_win;
     UiWindowSettings camera_win;
+    UiWindowSettings latency_win;
 
     DroneData* drone_data;
     Camera* camera;
 
     SerialPort* serial_port;
 
+    LatencyMonitor* latency_monitor;
+    std::vector<float> latency_plot_x;
+    std::vector<float> latency_plot_y;
+
+    FlightReplay* flight_replay;
+    static constexpr std::array<double, 9> REPLAY_SPEEDS = {
+        0.25, 0.5, 1.0, 2.0, 5.0, 10.0, 25.0, 100.0, FlightReplay::UNPACED};
+    static constexpr std::array<const char*, 9> REPLAY_SPEED_NAMES = {
+        "0.25x", "0.5x", "1x", "2x", "5x", "10x", "25x", "100x", "Max"};
+
     unsigned int producer_n = 0;
     unsigned int consumer_n = 0;
 
@@ -134,29 +156,37 @@ UiManager::UiManager(GLFWwindow* window_,
                            DroneData* drone_data_,
                            Camera* camera_,
                            SerialPort* serial_port_,
+                           LatencyMonitor* latency_monitor_,
+                           FlightReplay* flight_replay_,
                            bool show_demo_window_,
                            bool show_implot_demo_window_,
-                           bool show_camera_data_window_) :
+                           bool show_camera_data_window_,
+                           bool show_latency_window_) :
     window(window_),
     glsl_version(glsl_version_),
+    rm(resource_manager_),
+    viewer_mode(viewer_mode_),
+    show_demo_window(show_demo_window_),
+    show_implot_demo_window(show_implot_demo_window_),
+    show_camera_data_window(show_camera_data_window_),
+    show_latency_window(show_latency_window_),
     fps_win(93.0, 32.0),
-    mode_win(165.0, 80.0),
+    mode_win(165.0, 100.0),
 #ifdef OS_CYGWIN
     controls_t_win(310.0, 130.0),
 #elif OS_LINUX
-    controls_t_win(275.0, 165.0),
+    controls_t_win(275.0, 210.0),
 #endif
     controls_e_win(290.0, 170.0),
+    controls_r_win(275.0, 130.0),
     drone_win(300.0, 480.0),
     camera_win(150.0, 220.0),
-    rm(resource_manager_),
-    viewer_mode(viewer_mode_),
+    latency_win(330.0, 300.0),
     drone_data(drone_data_),
     camera(camera_),
     serial_port(serial_port_),
-    show_implot_demo_window(show_implot_demo_window_),
-    show_demo_window(show_demo_window_),
-    show_camera_data_window(show_camera_data_window_)
+    latency_monitor(latency_monitor_),
+    flight_replay(flight_replay_)
 {
     screen_width = screen_width_;
     screen_height = screen_height_;
@@ -167,8 +197,12 @@ UiManager::UiManager(GLFWwindow* window_,
         mode_win.bottom() + WINDOW_BUF);
     controls_e_win.set_pos(screen_width - WINDOW_BUF - controls_e_win.width,
         mode_win.bottom() + WINDOW_BUF);
+    controls_r_win.set_pos(screen_width - WINDOW_BUF - controls_r_win.width,
+        mode_win.bottom() + WINDOW_BUF);
     drone_win.set_pos(WINDOW_BUF, fps_win.bottom() + WINDOW_BUF);
     camera_win.set_pos(WINDOW_BUF, drone_win.bottom() + WINDOW_BUF);
+    latency_win.set_pos(screen_width - WINDOW_BUF - latency_win.width,
+        controls_t_win.bottom() + WINDOW_BUF);
 }
 
 bool UiManager::init()
@@ -242,6 +276,9 @@ void UiManager::process_frame()
         case ViewerMode::Edit:
             e = 1;
             break;
+        case ViewerMode::Replay:
+            e = 2;
+            break;
         }
 
         if (!rm)
@@ -258,6 +295,11 @@ void UiManager::process_frame()
             std::lock_guard<std::mutex> g(rm->viewer_mode_mutex);
             *viewer_mode = ViewerMode::Edit;
         }
+        if (rm && ImGui::RadioButton("Replay (p)", &e, 2))
+        {
+            std::lock_guard<std::mutex> g(rm->viewer_mode_mutex);
+            *viewer_mode = ViewerMode::Replay;
+        }
 
         ImGui::End();
     }
@@ -310,6 +352,23 @@ void UiManager::process_frame()
                          port_list.data(),
                          port_list.size());
 
+#ifdef OS_LINUX
+            // Serial driver backend. Only takes effect on the next open.
+            if (serial_port)
+            {
+                int backend = static_cast<int>(serial_port->get_backend());
+                ImGui::Text("Serial backend:");
+                bool changed = ImGui::RadioButton("libserial", &backend,
+                    static_cast<int>(LinuxSerialBackend::LibSerial));
+                ImGui::SameLine();
+                changed |= ImGui::RadioButton("termios", &backend,
+                    static_cast<int>(LinuxSerialBackend::Termios));
+                if (changed)
+                    serial_port->set_backend(
+                        static_cast<LinuxSerialBackend>(backend));
+            }
+#endif
+
             ImGui::Text("Current serial port status:");
             if (serial_port && !serial_port->is_open())
             {
@@ -353,6 +412,49 @@ void UiManager::process_frame()
             ImGui::End();
             break;
         }
+        case ViewerMode::Replay:
+        {
+            ImGui::SetNextWindowSize(
+                ImVec2(controls_r_win.width, controls_r_win.height),
+                ImGuiCond_Always);
+            ImGui::SetNextWindowPos(
+                ImVec2(controls_r_win.xpos, controls_r_win.ypos),
+                ImGuiCond_Always);
+            ImGui::Begin("Replay Controls", NULL, imgui_window_flags);
+
+            if (!flight_replay || !flight_replay->is_open())
+            {
+                ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "No flight log");
+                ImGui::TextWrapped("Start with -P <dir> to replay a log recorded with -r <dir>.");
+                ImGui::End();
+                break;
+            }
+
+            auto speed_it = std::find(REPLAY_SPEEDS.begin(), REPLAY_SPEEDS.end(),
+                flight_replay->get_speed());
+            int speed_idx = speed_it == REPLAY_SPEEDS.end() ? 2 :
+                static_cast<int>(speed_it - REPLAY_SPEEDS.begin());
+            ImGui::SetNextItemWidth(80);
+            if (ImGui::Combo("Speed", &speed_idx, REPLAY_SPEED_NAMES.data(),
+                    static_cast<int>(REPLAY_SPEED_NAMES.size())))
+                flight_replay->set_speed(REPLAY_SPEEDS[speed_idx]);
+
+            using seconds = std::chrono::duration<float>;
+            float position = seconds(flight_replay->get_position()).count();
+            float duration = seconds(flight_replay->get_duration()).count();
+            ImGui::SetNextItemWidth(-1);
+            if (ImGui::SliderFloat("##Position", &position, 0.0f, duration, "%.1f s"))
+                flight_replay->seek(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    seconds(position)));
+
+            ImGui::Text("%.1f of %.1f s%s", position, duration,
+                flight_replay->is_finished() ? ", finished" : "");
+            ImGui::Text("Replayed %.1f MB",
+                flight_replay->get_bytes_replayed() / 1e6);
+
+            ImGui::End();
+            break;
+        }
         }
     }
 
@@ -445,6 +547,65 @@ void UiManager::process_frame()
             ImGui::End();
         }
     }
+
+    // Latency window.
+    if (latency_monitor && show_latency_window)
+    {
+        ImGui::SetNextWindowSize(ImVec2(latency_win.width, latency_win.height),
+            ImGuiCond_Always);
+        ImGui::SetNextWindowPos(ImVec2(latency_win.xpos, latency_win.ypos),
+            ImGuiCond_Always);
+        ImGui::Begin("Telemetry Latency", NULL, imgui_window_flags);
+
+        auto ms = [](std::chrono::nanoseconds d) { return d.count() / 1e6; };
+        ImGui::Columns(5, "latency_columns", false);
+        ImGui::SetColumnWidth(0, 120.0f);
+        for (auto heading : {"stage (ms)", "p50", "p95", "p99", "max"})
+        {
+            ImGui::Text("%s", heading);
+            ImGui::NextColumn();
+        }
+        for (std::size_t i = 0; i < LatencyMonitor::NUM_STAGES; i++)
+        {
+            auto s = latency_monitor->get(i).summarize();
+            ImGui::Text("%s", LatencyMonitor::STAGE_NAMES[i]);
+            ImGui::NextColumn();
+            for (auto d : {s.p50, s.p95, s.p99, s.max})
+            {
+                ImGui::Text("%.2f", ms(d));
+                ImGui::NextColumn();
+            }
+        }
+        ImGui::Columns(1);
+
+        // Distribution of the end-to-end latency, bucket by bucket.
+        auto& xs = latency_plot_x;
+        auto& ys = latency_plot_y;
+        xs.clear();
+        ys.clear();
+        const auto& total = latency_monitor->get(
+            static_cast<std::size_t>(LatencyStage::SerialToSwap));
+        for (std::size_t b = 0; b < LatencyHistogram::NUM_BUCKETS; b++)
+        {
+            if (auto c = total.get_count(b))
+            {
+                xs.push_back(LatencyHistogram::bucket_highest(b) / 1e6f);
+                ys.push_back(static_cast<float>(c));
+            }
+        }
+        if (!xs.empty())
+            ImGui::SetNextPlotRange(xs.front() * 0.9f, xs.back() * 1.1f, 0.0f,
+                *std::max_element(ys.begin(), ys.end()) * 1.1f, ImGuiCond_Always);
+        if (ImGui::BeginPlot("##Latency", "serial -> swap (ms)", NULL, {-1, 150},
+                ImPlotFlags_Default, ImAxisFlags_Default | ImAxisFlags_LogScale))
+        {
+            if (!xs.empty())
+                ImGui::Plot("frames", xs.data(), ys.data(), static_cast<int>(xs.size()));
+            ImGui::EndPlot();
+        }
+
+        ImGui::End();
+    }
 }
 
 void UiManager::render()
@@ -474,8 +635,12 @@ void UiManager::update_window_settings()
         mode_win.bottom() + WINDOW_BUF);
     controls_e_win.set_pos(screen_width - controls_e_win.width,
         mode_win.bottom() + WINDOW_BUF);
+    controls_r_win.set_pos(screen_width - controls_r_win.width,
+        mode_win.bottom() + WINDOW_BUF);
     drone_win.set_pos(WINDOW_BUF, fps_win.bottom() + WINDOW_BUF);
     camera_win.set_pos(WINDOW_BUF, drone_win.bottom() + WINDOW_BUF);
+    latency_win.set_pos(screen_width - latency_win.width - WINDOW_BUF,
+        controls_t_win.bottom() + WINDOW_BUF);
 }
 
 void UiManager::update_queue_data(unsigned int p, unsigned int c)
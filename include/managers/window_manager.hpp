@@ -1,9 +1,12 @@
 #ifndef WINDOW_MANAGER_HPP
 #define WINDOW_MANAGER_HPP
 
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <functional>
 #include <memory>
+#include <mutex>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -11,7 +14,9 @@
 #include <stb_image.h>
 
 #include "callbacks.hpp"
+#include "frame_scheduler.hpp"
 #include "logger.hpp"
+#include "resource_manager.hpp"
 #include "serial_port.hpp"
 #include "shared.hpp"
 #include "timer_manager.hpp"
@@ -57,6 +62,24 @@ public:
     void process_input();
     void swap_buffers();
     void poll_events();
+
+    /*
+     * Processes events, blocking for up to timeout until one arrives.
+     */
+    void wait_events(std::chrono::steady_clock::duration timeout);
+
+    /*
+     * 1 syncs buffer swaps to the display's refresh, 0 swaps immediately.
+     */
+    void set_swap_interval(int interval);
+
+    WindowActivity get_activity() const;
+
+    /*
+     * Counts window and input events, including those ImGui handles. Any
+     * change means something on screen may need to react.
+     */
+    std::uint64_t get_event_count() const { return event_count; }
 private:
     std::size_t screen_width;
     std::size_t screen_height;
@@ -79,11 +102,14 @@ private:
     // Timers.
     std::unique_ptr<TimerManager> timer_manager;
 
+    std::uint64_t event_count{};
+
     /*
      * Callback functions.
      */
     void framebuffer_size_callback(GLFWwindow* window, int width, int height);
     void cursor_callback(GLFWwindow* window, double xpos, double ypos);
+    void count_event() { event_count++; }
 };
 
 bool WindowManager::init()
@@ -156,6 +182,23 @@ bool WindowManager::init()
     glfwSetFramebufferSizeCallback(window, static_cast<void(*)(GLFWwindow*, int, int)>(FramebufferCallback<void(GLFWwindow*, int, int)>::callback));
     glfwSetCursorPosCallback(window, static_cast<void(*)(GLFWwindow*, double, double)>(CursorCallback<void(GLFWwindow*, double, double)>::callback));
 
+    // Events which only need counting. ImGui installs its own input callbacks
+    // later and chains these.
+    EventCallback<WindowEvent::MouseButton, void(GLFWwindow*, int, int, int)>::func = [this](GLFWwindow*, int, int, int) { count_event(); };
+    EventCallback<WindowEvent::Scroll, void(GLFWwindow*, double, double)>::func = [this](GLFWwindow*, double, double) { count_event(); };
+    EventCallback<WindowEvent::Key, void(GLFWwindow*, int, int, int, int)>::func = [this](GLFWwindow*, int, int, int, int) { count_event(); };
+    EventCallback<WindowEvent::Char, void(GLFWwindow*, unsigned int)>::func = [this](GLFWwindow*, unsigned int) { count_event(); };
+    EventCallback<WindowEvent::Focus, void(GLFWwindow*, int)>::func = [this](GLFWwindow*, int) { count_event(); };
+    EventCallback<WindowEvent::Iconify, void(GLFWwindow*, int)>::func = [this](GLFWwindow*, int) { count_event(); };
+    EventCallback<WindowEvent::Refresh, void(GLFWwindow*)>::func = [this](GLFWwindow*) { count_event(); };
+    glfwSetMouseButtonCallback(window, static_cast<void(*)(GLFWwindow*, int, int, int)>(EventCallback<WindowEvent::MouseButton, void(GLFWwindow*, int, int, int)>::callback));
+    glfwSetScrollCallback(window, static_cast<void(*)(GLFWwindow*, double, double)>(EventCallback<WindowEvent::Scroll, void(GLFWwindow*, double, double)>::callback));
+    glfwSetKeyCallback(window, static_cast<void(*)(GLFWwindow*, int, int, int, int)>(EventCallback<WindowEvent::Key, void(GLFWwindow*, int, int, int, int)>::callback));
+    glfwSetCharCallback(window, static_cast<void(*)(GLFWwindow*, unsigned int)>(EventCallback<WindowEvent::Char, void(GLFWwindow*, unsigned int)>::callback));
+    glfwSetWindowFocusCallback(window, static_cast<void(*)(GLFWwindow*, int)>(EventCallback<WindowEvent::Focus, void(GLFWwindow*, int)>::callback));
+    glfwSetWindowIconifyCallback(window, static_cast<void(*)(GLFWwindow*, int)>(EventCallback<WindowEvent::Iconify, void(GLFWwindow*, int)>::callback));
+    glfwSetWindowRefreshCallback(window, static_cast<void(*)(GLFWwindow*)>(EventCallback<WindowEvent::Refresh, void(GLFWwindow*)>::callback));
+
     /*
      * Load OpenGL function pointers.
      */
@@ -200,6 +243,9 @@ GLFWwindow* WindowManager::get_window() const
 
 void WindowManager::process_input()
 {
+    // Expire the key debounce timers.
+    timer_manager->update();
+
     /*
      * Exit application.
      */
@@ -239,6 +285,31 @@ void WindowManager::process_input()
         }
     }
 
+    /*
+     * Enter replay mode.
+     */
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS)
+    {
+        if (rm)
+        {
+            std::lock_guard<std::mutex> g(rm->viewer_mode_mutex);
+            *viewer_mode = ViewerMode::Replay;
+        }
+        else
+        {
+            logger.log(LogLevel::error, "WindowManager::process_input: \
+                rm pointer is null\n");
+        }
+    }
+
+    if (*viewer_mode == ViewerMode::Replay)
+    {
+        /*
+         * Show cursor, disables camera control.
+         */
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+    }
+
     if (*viewer_mode == ViewerMode::Telemetry)
     {
         /*
@@ -318,14 +389,12 @@ void WindowManager::process_input()
          */
         if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
         {
-            std::lock_guard<std::mutex> g(rm->drone_data_mutex);
             drone_data->position.y += 0.05f;
             if (drone_data->position.y > room_dimensions.y - (DRONE_OFFSET_TOP / 2))
                 drone_data->position.y = room_dimensions.y - (DRONE_OFFSET_TOP / 2);
         }
         if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
         {
-            std::lock_guard<std::mutex> g(rm->drone_data_mutex);
             drone_data->position.y -= 0.05f;
             if (drone_data->position.y < room_position.y + (DRONE_OFFSET_BOT / 2))
                 drone_data->position.y = room_position.y + (DRONE_OFFSET_BOT / 2);
@@ -337,20 +406,12 @@ void WindowManager::process_input()
         if (!camera)
             logger.log(LogLevel::error, "WindowManager::process_input: \
                 camera is null\n");
-        if (!rm)
-            logger.log(LogLevel::error, "WindowManager::process_input: \
-                rm is null\n");
         if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
         {
-            if (rm)
-            {
-                std::lock_guard<std::mutex> g(rm->drone_data_mutex);
-                *drone_data = INITIAL_DRONE_DATA;
-            }
+            *drone_data = INITIAL_DRONE_DATA;
 
-            if (camera && rm)
+            if (camera)
             {
-                std::lock_guard<std::mutex> g(rm->camera_data_mutex);
                 camera->set_position(CAMERA_POSITION_HEADON);
                 camera->set_front(CAMERA_FRONT_HEADON);
                 camera->set_pitch(CAMERA_PITCH_HEADON);
@@ -373,16 +434,42 @@ void WindowManager::poll_events()
     glfwPollEvents();
 }
 
+void WindowManager::wait_events(std::chrono::steady_clock::duration timeout)
+{
+    double seconds = std::chrono::duration<double>(timeout).count();
+    if (seconds > 0.0)
+        glfwWaitEventsTimeout(seconds);
+    else
+        glfwPollEvents();
+}
+
+void WindowManager::set_swap_interval(int interval)
+{
+    glfwSwapInterval(interval);
+}
+
+WindowActivity WindowManager::get_activity() const
+{
+    if (glfwGetWindowAttrib(window, GLFW_ICONIFIED))
+        return WindowActivity::Minimized;
+    if (!glfwGetWindowAttrib(window, GLFW_FOCUSED))
+        return WindowActivity::Background;
+    return WindowActivity::Focused;
+}
+
 /*
  * Callback functions.
  */
 void WindowManager::framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    count_event();
 }
 
 void WindowManager::cursor_callback(GLFWwindow* window, double xpos, double ypos)
 {
+    count_event();
+
     if (*viewer_mode == ViewerMode::Edit)
         if (camera)
             camera->update_angle(xpos, ypos);
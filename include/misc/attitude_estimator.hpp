@@ -0,0 +1,141 @@
+#ifndef ATTITUDE_ESTIMATOR_HPP
+#define ATTITUDE_ESTIMATOR_HPP
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "orientation.hpp"
+
+struct AttitudeEstimatorConfig
+{
+    float sample_hz;   // Nominal IMU sample rate, packets carry no timestamps.
+    float beta;        // Accelerometer correction gain, in rad/s.
+    float gyro_scale;  // Radians per second per rot_rate unit.
+};
+
+/*
+ * Madgwick's gradient descent attitude filter for a 6-axis IMU. Each sample
+ * integrates the gyro rates and nudges the result towards the attitude in
+ * which the measured acceleration points straight down, so gyro drift in roll
+ * and pitch is corrected while yaw (unobservable without a magnetometer) is
+ * integrated open loop.
+ *
+ * Inputs are in the viewer's frame (y up). The algorithm is written for a z up
+ * frame, so vectors are rotated into it by a cyclic permutation of the axes
+ * on the way in and out, which is a proper rotation and keeps handedness.
+ *
+ * All state is four floats and every update is straight-line float math with
+ * no allocation.
+ */
+class AttitudeEstimator
+{
+public:
+    explicit AttitudeEstimator(const AttitudeEstimatorConfig& cfg_) :
+        cfg(cfg_),
+        dt(1.0f / cfg_.sample_hz)
+    {}
+
+    /*
+     * gyro is in rot_rate units, accel in any unit (only its direction is
+     * used). A zero accel vector skips the correction step. Samples with a
+     * non-finite component would corrupt the state for good, so they're
+     * ignored.
+     */
+    void update(glm::vec3 gyro, glm::vec3 accel);
+
+    /*
+     * Body to world rotation in the viewer's frame.
+     */
+    glm::quat get_orientation() const { return glm::quat(q0, q2, q3, q1); }
+
+    /*
+     * The orientation in DroneData::orientation's convention.
+     */
+    glm::vec3 get_euler_degrees() const { return quat_to_orientation(get_orientation()); }
+private:
+    const AttitudeEstimatorConfig cfg;
+    const float dt;
+
+    // Body to world quaternion in the z up frame, w first.
+    float q0 = 1.0f;
+    float q1 = 0.0f;
+    float q2 = 0.0f;
+    float q3 = 0.0f;
+};
+
+void AttitudeEstimator::update(glm::vec3 gyro, glm::vec3 accel)
+{
+    for (int i = 0; i < 3; i++)
+        if (!std::isfinite(gyro[i]) || !std::isfinite(accel[i]))
+            return;
+
+    // Viewer (x, y, z) to z up (z, x, y).
+    float gx = gyro.z * cfg.gyro_scale;
+    float gy = gyro.x * cfg.gyro_scale;
+    float gz = gyro.y * cfg.gyro_scale;
+    float ax = accel.z;
+    float ay = accel.x;
+    float az = accel.y;
+
+    // Rate of change of the quaternion from the gyro.
+    float qdot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qdot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float qdot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float qdot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    float anorm2 = ax * ax + ay * ay + az * az;
+    if (anorm2 > 0.0f)
+    {
+        float inv = 1.0f / std::sqrt(anorm2);
+        ax *= inv;
+        ay *= inv;
+        az *= inv;
+
+        // Gradient of the error between measured and predicted gravity.
+        float _2q0 = 2.0f * q0;
+        float _2q1 = 2.0f * q1;
+        float _2q2 = 2.0f * q2;
+        float _2q3 = 2.0f * q3;
+        float _4q0 = 4.0f * q0;
+        float _4q1 = 4.0f * q1;
+        float _4q2 = 4.0f * q2;
+        float _8q1 = 8.0f * q1;
+        float _8q2 = 8.0f * q2;
+        float q0q0 = q0 * q0;
+        float q1q1 = q1 * q1;
+        float q2q2 = q2 * q2;
+        float q3q3 = q3 * q3;
+
+        float s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+        float s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 +
+            _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+        float s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 +
+            _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+        float s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+
+        float snorm2 = s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3;
+        if (snorm2 > 0.0f)
+        {
+            float k = cfg.beta / std::sqrt(snorm2);
+            qdot0 -= k * s0;
+            qdot1 -= k * s1;
+            qdot2 -= k * s2;
+            qdot3 -= k * s3;
+        }
+    }
+
+    q0 += qdot0 * dt;
+    q1 += qdot1 * dt;
+    q2 += qdot2 * dt;
+    q3 += qdot3 * dt;
+
+    float inv = 1.0f / std::sqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+    q0 *= inv;
+    q1 *= inv;
+    q2 *= inv;
+    q3 *= inv;
+}
+
+#endif /* ATTITUDE_ESTIMATOR_HPP */
@@ -1,15 +1,23 @@
 #ifndef BOUNDED_BUFFER_HPP
 #define BOUNDED_BUFFER_HPP
 
+#include <algorithm>
 #include <condition_variable>
 #include <chrono>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <queue>
 
+#include "span.hpp"
+
 /*
  * A bounded buffer for producer/consumer applications. Has multiple
  * pushing/popping interfaces and also tracks the number of "dropped packets"
  * (i.e. number of elements which were unsuccesfully pushed into a full buffer).
+ *
+ * Condition variables are only signaled when a thread is actually blocked on
+ * them, so producers and consumers which never wait don't pay for notifies.
  */
 template <typename T>
 class BoundedBuffer
@@ -40,12 +48,14 @@ public:
      * dereferencing.
      */
     bool try_push(const T&);
+    bool try_push(T&&);
     std::shared_ptr<T> try_pop();
 
     /*
      * Waits indefinitely.
      */
     void push_wait(const T&);
+    void push_wait(T&&);
     std::shared_ptr<T> pop_wait();
 
     /*
@@ -53,13 +63,40 @@ public:
      * specified in the constructor, not as an argument to these functions.
      */
     bool push_wait_for(const T&);
+    bool push_wait_for(T&&);
     std::shared_ptr<T> pop_wait_for();
 
+    /*
+     * Allocation-free versions of the pop interfaces above. The element is
+     * moved into the caller's storage instead of a freshly allocated
+     * shared_ptr. The bool overloads return false on failure and leave the
+     * argument untouched.
+     */
+    bool try_pop(T&);
+    std::optional<T> try_pop_value();
+    void pop_wait(T&);
+    bool pop_wait_for(T&);
+
     /*
      * If buffer not full, pushes normally. If buffer is full, clears space by
      * popping, then pushes.
      */
     void force_push(const T&);
+    void force_push(T&&);
+
+    /*
+     * Bulk interfaces. Each call takes the lock once and signals waiters at
+     * most once for the whole batch.
+     *
+     * push_n pushes as many elements as fit and counts the rest as dropped.
+     * force_push_n evicts old elements to make room for the whole span.
+     * try_pop_n pops up to n elements into the output iterator.
+     * All return the number of elements transferred.
+     */
+    std::size_t push_n(Span<const T>);
+    std::size_t force_push_n(Span<const T>);
+    template <typename OutputIt>
+    std::size_t try_pop_n(OutputIt, std::size_t);
 private:
     std::queue<T> q;
 
@@ -67,6 +104,10 @@ private:
     std::condition_variable q_has_element;
     std::condition_variable q_has_space;
 
+    // Number of threads blocked on each condition variable. Guarded by m.
+    std::size_t consumers_waiting{};
+    std::size_t producers_waiting{};
+
     // Capacity, since std::queue doesn't contain a capacity value.
     std::size_t cap;
     std::chrono::milliseconds timeout = std::chrono::milliseconds::zero();
@@ -74,6 +115,21 @@ private:
     // Number of "dropped packets", the number of elements that have been
     // unsuccessfully pushed into the buffer.
     std::size_t dropped{};
+
+    /*
+     * Helpers. All must be called with m held.
+     */
+    void notify_element(std::size_t n = 1);
+    void notify_space(std::size_t n = 1);
+
+    template <typename Pred>
+    void wait_element(std::unique_lock<std::mutex>&, Pred);
+    template <typename Pred>
+    bool wait_element_for(std::unique_lock<std::mutex>&, Pred);
+    template <typename Pred>
+    void wait_space(std::unique_lock<std::mutex>&, Pred);
+    template <typename Pred>
+    bool wait_space_for(std::unique_lock<std::mutex>&, Pred);
 };
 
 template <typename T>
@@ -124,16 +180,83 @@ void BoundedBuffer<T>::clear()
     std::lock_guard<std::mutex> g(m);
     while (!q.empty())
         q.pop();
+    notify_space(cap);
+}
+
+template <typename T>
+void BoundedBuffer<T>::notify_element(std::size_t n)
+{
+    if (!consumers_waiting)
+        return;
+    if (n > 1)
+        q_has_element.notify_all();
+    else
+        q_has_element.notify_one();
+}
+
+template <typename T>
+void BoundedBuffer<T>::notify_space(std::size_t n)
+{
+    if (!producers_waiting)
+        return;
+    if (n > 1)
+        q_has_space.notify_all();
+    else
+        q_has_space.notify_one();
+}
+
+template <typename T>
+template <typename Pred>
+void BoundedBuffer<T>::wait_element(std::unique_lock<std::mutex>& lk, Pred p)
+{
+    consumers_waiting++;
+    q_has_element.wait(lk, p);
+    consumers_waiting--;
+}
+
+template <typename T>
+template <typename Pred>
+bool BoundedBuffer<T>::wait_element_for(std::unique_lock<std::mutex>& lk, Pred p)
+{
+    consumers_waiting++;
+    bool rv = q_has_element.wait_for(lk, timeout, p);
+    consumers_waiting--;
+    return rv;
+}
+
+template <typename T>
+template <typename Pred>
+void BoundedBuffer<T>::wait_space(std::unique_lock<std::mutex>& lk, Pred p)
+{
+    producers_waiting++;
+    q_has_space.wait(lk, p);
+    producers_waiting--;
+}
+
+template <typename T>
+template <typename Pred>
+bool BoundedBuffer<T>::wait_space_for(std::unique_lock<std::mutex>& lk, Pred p)
+{
+    producers_waiting++;
+    bool rv = q_has_space.wait_for(lk, timeout, p);
+    producers_waiting--;
+    return rv;
 }
 
 template <typename T>
 bool BoundedBuffer<T>::try_push(const T& e)
+{
+    return try_push(T(e));
+}
+
+template <typename T>
+bool BoundedBuffer<T>::try_push(T&& e)
 {
     std::lock_guard<std::mutex> lk(m);
     if (q.size() != cap)
     {
-        q.push(e);
-        q_has_element.notify_one();
+        q.push(std::move(e));
+        notify_element();
         return true;
     }
     else
@@ -151,45 +274,56 @@ std::shared_ptr<T> BoundedBuffer<T>::try_pop()
     {
         return nullptr;
     }
-    auto rv = std::make_shared<T>(q.front());
+    auto rv = std::make_shared<T>(std::move(q.front()));
     q.pop();
-    q_has_space.notify_one();
+    notify_space();
     return rv;
 }
 
 template <typename T>
 void BoundedBuffer<T>::push_wait(const T& e)
+{
+    push_wait(T(e));
+}
+
+template <typename T>
+void BoundedBuffer<T>::push_wait(T&& e)
 {
     std::unique_lock<std::mutex> lk(m);
-    q_has_space.wait(lk, [this]{ return q.size() != cap; });
-    q.push(e);
+    wait_space(lk, [this]{ return q.size() != cap; });
+    q.push(std::move(e));
 
-    q_has_element.notify_one();
+    notify_element();
 }
 
 template <typename T>
 std::shared_ptr<T> BoundedBuffer<T>::pop_wait()
 {
     std::unique_lock<std::mutex> lk(m);
-    q_has_element.wait(lk, [this]{ return !q.empty(); });
-    auto rv = std::make_shared<T>(q.front());
+    wait_element(lk, [this]{ return !q.empty(); });
+    auto rv = std::make_shared<T>(std::move(q.front()));
     q.pop();
 
-    q_has_space.notify_one();
+    notify_space();
     return rv;
 }
 
 template <typename T>
 bool BoundedBuffer<T>::push_wait_for(const T& e)
+{
+    return push_wait_for(T(e));
+}
+
+template <typename T>
+bool BoundedBuffer<T>::push_wait_for(T&& e)
 {
     bool success;
     std::unique_lock<std::mutex> lk(m);
-    if (q_has_space.wait_for(lk,
-                             timeout,
-                             [this]{ return q.size() != cap; }))
+    if (wait_space_for(lk, [this]{ return q.size() != cap; }))
     {
-        q.push(e);
+        q.push(std::move(e));
         success = true;
+        notify_element();
     }
     else
     {
@@ -197,7 +331,6 @@ bool BoundedBuffer<T>::push_wait_for(const T& e)
         success = false;
     }
 
-    q_has_element.notify_one();
     return success;
 }
 
@@ -206,31 +339,150 @@ std::shared_ptr<T> BoundedBuffer<T>::pop_wait_for()
 {
     std::shared_ptr<T> rv;
     std::unique_lock<std::mutex> lk(m);
-    if (q_has_element.wait_for(lk, timeout, [this]{ return !q.empty(); }))
+    if (wait_element_for(lk, [this]{ return !q.empty(); }))
     {
-        rv = std::make_shared<T>(q.front());
+        rv = std::make_shared<T>(std::move(q.front()));
         q.pop();
+        notify_space();
     }
     else
     {
         rv = nullptr;
     }
 
-    q_has_space.notify_one();
     return rv;
 }
 
+template <typename T>
+bool BoundedBuffer<T>::try_pop(T& out)
+{
+    std::lock_guard<std::mutex> lk(m);
+    if (q.empty())
+    {
+        return false;
+    }
+    out = std::move(q.front());
+    q.pop();
+    notify_space();
+    return true;
+}
+
+template <typename T>
+std::optional<T> BoundedBuffer<T>::try_pop_value()
+{
+    std::lock_guard<std::mutex> lk(m);
+    if (q.empty())
+    {
+        return std::nullopt;
+    }
+    std::optional<T> rv{std::move(q.front())};
+    q.pop();
+    notify_space();
+    return rv;
+}
+
+template <typename T>
+void BoundedBuffer<T>::pop_wait(T& out)
+{
+    std::unique_lock<std::mutex> lk(m);
+    wait_element(lk, [this]{ return !q.empty(); });
+    out = std::move(q.front());
+    q.pop();
+
+    notify_space();
+}
+
+template <typename T>
+bool BoundedBuffer<T>::pop_wait_for(T& out)
+{
+    std::unique_lock<std::mutex> lk(m);
+    if (!wait_element_for(lk, [this]{ return !q.empty(); }))
+    {
+        return false;
+    }
+    out = std::move(q.front());
+    q.pop();
+
+    notify_space();
+    return true;
+}
+
 template <typename T>
 void BoundedBuffer<T>::force_push(const T& e)
+{
+    force_push(T(e));
+}
+
+template <typename T>
+void BoundedBuffer<T>::force_push(T&& e)
 {
     std::unique_lock<std::mutex> lk(m);
     if (q.size() == cap)
     {
         q.pop();
     }
-    q.push(e);
+    q.push(std::move(e));
+
+    notify_element();
+}
+
+template <typename T>
+std::size_t BoundedBuffer<T>::push_n(Span<const T> elements)
+{
+    std::lock_guard<std::mutex> lk(m);
+    std::size_t n = std::min(elements.size(), cap - q.size());
+    for (std::size_t i = 0; i < n; i++)
+    {
+        q.push(elements[i]);
+    }
+    dropped += elements.size() - n;
+
+    if (n)
+        notify_element(n);
+    return n;
+}
+
+template <typename T>
+std::size_t BoundedBuffer<T>::force_push_n(Span<const T> elements)
+{
+    if (elements.empty())
+        return 0;
+
+    std::lock_guard<std::mutex> lk(m);
+
+    // Only the last cap elements of the block can survive.
+    if (elements.size() > cap)
+    {
+        elements = elements.subspan(elements.size() - cap);
+    }
+    while (q.size() + elements.size() > cap)
+    {
+        q.pop();
+    }
+    for (auto& e : elements)
+    {
+        q.push(e);
+    }
+
+    notify_element(elements.size());
+    return elements.size();
+}
+
+template <typename T>
+template <typename OutputIt>
+std::size_t BoundedBuffer<T>::try_pop_n(OutputIt out, std::size_t n)
+{
+    std::lock_guard<std::mutex> lk(m);
+    n = std::min(n, q.size());
+    for (std::size_t i = 0; i < n; i++)
+    {
+        *out++ = std::move(q.front());
+        q.pop();
+    }
 
-    q_has_element.notify_one();
+    if (n)
+        notify_space(n);
+    return n;
 }
 
 #endif /* BOUNDED_BUFFER_HPP */
@@ -37,4 +37,34 @@ struct CursorCallback<Ret(Params...)>
 template <typename Ret, typename... Params>
 std::function<Ret(Params...)> CursorCallback<Ret(Params...)>::func;
 
+/*
+ * EventCallback. For callbacks which only need to know that an event happened.
+ * Tagged by event, since several GLFW callbacks share a signature.
+ */
+enum class WindowEvent
+{
+    MouseButton,
+    Scroll,
+    Key,
+    Char,
+    Focus,
+    Iconify,
+    Refresh,
+};
+
+template <WindowEvent E, typename T>
+struct EventCallback;
+
+template <WindowEvent E, typename Ret, typename... Params>
+struct EventCallback<E, Ret(Params...)>
+{
+    template <typename... Args>
+    static Ret callback(Args... args) { return func(args...); }
+
+    static std::function<Ret(Params...)> func;
+};
+
+template <WindowEvent E, typename Ret, typename... Params>
+std::function<Ret(Params...)> EventCallback<E, Ret(Params...)>::func;
+
 #endif /* CALLBACKS_HPP */
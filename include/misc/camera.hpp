@@ -1,14 +1,13 @@
 #ifndef CAMERA_HPP
 #define CAMERA_HPP
 
+#include <algorithm>
 #include <memory>
-#include <mutex>
 
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
 #include "logger.hpp"
-#include "resource_manager.hpp"
 #include "shared.hpp"
 
 enum class CameraSpeedSetting
@@ -20,13 +19,11 @@ enum class CameraSpeedSetting
 class Camera
 {
 public:
-    Camera(ResourceManager* rm_,
-           std::size_t screen_width,
+    Camera(std::size_t screen_width,
            std::size_t screen_height,
            glm::vec3 room_dimensions_,
            glm::vec3 position_,
            glm::vec3 front_) :
-        rm(rm_),
         lastx(screen_width / 2),
         lasty(screen_height / 2),
         room_dimensions(room_dimensions_),
@@ -55,11 +52,6 @@ public:
     void update_pov(double yoffset);
     void process_frame();
 private:
-    /*
-     * Data managers.
-     */
-    ResourceManager* rm;
-
     /*
      * Constants.
      */
@@ -67,6 +59,10 @@ private:
     const float mouse_sensitivity = 0.05f;
     const float collision_bias = 0.2f;
 
+    // The main loop may sleep for a long time when nothing changes, so a key
+    // pressed after a pause mustn't move the camera by the whole pause.
+    static constexpr float MAX_DELTA_TIME = 0.1f;
+
     /*
      * Internal state.
      */
@@ -193,14 +189,6 @@ void Camera::update_position(GLFWwindow* window)
 {
     float camera_speed = camera_speed_modifier * delta_time;
 
-    if (!rm)
-    {
-        logger.log(LogLevel::error, "Camera::update_position: rm is null\n");
-        return;
-    }
-
-    std::lock_guard<std::mutex> g(rm->camera_data_mutex);
-
     // Camera WASD.
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
         position += camera_speed * front;
@@ -228,14 +216,6 @@ void Camera::update_position(GLFWwindow* window)
 
 void Camera::update_angle(double xpos, double ypos)
 {
-    if (!rm)
-    {
-        logger.log(LogLevel::error, "Camera::update_angle: rm is null\n");
-        return;
-    }
-
-    std::lock_guard<std::mutex> g(rm->camera_data_mutex);
-
     if (first_mouse)
     {
         lastx = xpos;
@@ -268,14 +248,6 @@ void Camera::update_angle(double xpos, double ypos)
 
 void Camera::update_pov(double yoffset)
 {
-    if (!rm)
-    {
-        logger.log(LogLevel::error, "Camera::update_pov: rm is null\n");
-        return;
-    }
-
-    std::lock_guard<std::mutex> g(rm->camera_data_mutex);
-
     fov -= yoffset;
 
     if (fov <= 1.0f)
@@ -289,16 +261,8 @@ void Camera::update_pov(double yoffset)
  */
 void Camera::process_frame()
 {
-    if (!rm)
-    {
-        logger.log(LogLevel::error, "Camera::process_frame: rm is null\n");
-        return;
-    }
-
-    std::lock_guard<std::mutex> g(rm->camera_data_mutex);
-
     float current_frame = glfwGetTime();
-    delta_time = current_frame - last_frame;
+    delta_time = std::min(current_frame - last_frame, MAX_DELTA_TIME);
     last_frame = current_frame;
 }
 
@@ -0,0 +1,82 @@
+#ifndef COBS_HPP
+#define COBS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "span.hpp"
+
+/*
+ * Consistent Overhead Byte Stuffing. Encodes arbitrary bytes so that the
+ * output contains no zero bytes, which leaves 0x00 free to delimit frames on
+ * the wire. The overhead is one byte per 254 bytes of input (rounded up), and a
+ * receiver which loses sync only has to wait for the next zero byte.
+ *
+ * Neither function appends or expects the trailing delimiter.
+ */
+constexpr std::size_t cobs_max_encoded_len(std::size_t len)
+{
+    return len + len / 254 + 1;
+}
+
+/*
+ * Encodes src into dst, which must have room for cobs_max_encoded_len(src)
+ * bytes. Returns the encoded length.
+ */
+std::size_t cobs_encode(Span<const std::uint8_t> src, std::uint8_t* dst)
+{
+    std::size_t code_idx = 0;
+    std::size_t out = 1;
+    std::uint8_t code = 1;
+
+    for (std::uint8_t b : src)
+    {
+        if (b != 0)
+        {
+            dst[out++] = b;
+            code++;
+        }
+
+        if (b == 0 || code == 0xff)
+        {
+            dst[code_idx] = code;
+            code_idx = out++;
+            code = 1;
+        }
+    }
+    dst[code_idx] = code;
+
+    return out;
+}
+
+/*
+ * Decodes src into dst, which must have room for src.size() bytes. Returns
+ * false if src contains a zero byte or a code which runs past its end.
+ */
+bool cobs_decode(Span<const std::uint8_t> src, std::uint8_t* dst, std::size_t& len)
+{
+    std::size_t in = 0;
+    std::size_t out = 0;
+
+    while (in < src.size())
+    {
+        std::uint8_t code = src[in++];
+        if (code == 0 || in + code - 1 > src.size())
+            return false;
+
+        for (std::uint8_t i = 1; i < code; i++)
+        {
+            if (src[in] == 0)
+                return false;
+            dst[out++] = src[in++];
+        }
+
+        if (code != 0xff && in != src.size())
+            dst[out++] = 0;
+    }
+
+    len = out;
+    return true;
+}
+
+#endif /* COBS_HPP */
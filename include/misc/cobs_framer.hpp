@@ -0,0 +1,163 @@
+#ifndef COBS_FRAMER_HPP
+#define COBS_FRAMER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cobs.hpp"
+#include "crc16.hpp"
+#include "span.hpp"
+#include "telemetry_framing.hpp"
+
+/*
+ * Framing state which decides how the rest of the stream is framed. Two
+ * framers in the same state frame any following bytes identically.
+ */
+struct CobsFramerState
+{
+    bool synced = false;
+    std::size_t pending_len = 0;
+    bool have_seq = false;
+    std::uint16_t last_seq = 0;
+
+    bool operator==(const CobsFramerState& rhs) const
+    {
+        return synced == rhs.synced && pending_len == rhs.pending_len &&
+            have_seq == rhs.have_seq && last_seq == rhs.last_seq;
+    }
+    bool operator!=(const CobsFramerState& rhs) const { return !(*this == rhs); }
+};
+
+/*
+ * Framer for COBS-framed binary packets (see telemetry_framing.hpp). Frames
+ * have no start symbol, a frame begins right after the previous delimiter.
+ * Until the first delimiter is seen (or after an overlong frame) bytes are
+ * discarded, since the frame they belong to started before we were listening.
+ * Frames are decoded and their CRC checked before being passed on.
+ */
+class CobsFramer
+{
+public:
+    /*
+     * packet_len is the length after COBS decoding, encoded_len the longest
+     * valid frame on the wire (without delimiter).
+     */
+    CobsFramer(std::size_t packet_len_, std::size_t encoded_len_) :
+        packet_len(packet_len_),
+        encoded_len(encoded_len_),
+        decoded(encoded_len_ + 1)
+    {
+        // One byte of slack, since overlong frames are detected after the
+        // append.
+        pending.reserve(encoded_len + 1);
+    }
+
+    /*
+     * Calls on_packet with every valid packet completed by the bytes, in
+     * order. The view is only valid during the call.
+     */
+    template <typename F>
+    void frame(Span<const char> bytes, F& on_packet);
+
+    /*
+     * Link quality counters. crc_errors counts frames which failed to decode
+     * or failed their CRC check, packets_lost counts gaps in the sequence
+     * numbers of valid packets.
+     */
+    std::size_t get_crc_errors() const { return crc_errors; }
+    std::size_t get_packets_lost() const { return packets_lost; }
+    std::size_t get_bytes_skipped() const { return bytes_skipped; }
+
+    CobsFramerState get_state() const
+    {
+        return {synced, pending.size(), have_seq, last_seq};
+    }
+private:
+    const std::size_t packet_len;
+    const std::size_t encoded_len;
+
+    bool synced = false;
+    std::string pending{};
+    std::vector<std::uint8_t> decoded;
+
+    std::size_t crc_errors{};
+    std::size_t packets_lost{};
+    std::size_t bytes_skipped{};
+    bool have_seq = false;
+    std::uint16_t last_seq{};
+
+    template <typename F>
+    void accept(F& on_packet);
+};
+
+template <typename F>
+void CobsFramer::frame(Span<const char> bytes, F& on_packet)
+{
+    for (char c : bytes)
+    {
+        if (c != COBS_DELIMITER)
+        {
+            if (synced)
+            {
+                pending += c;
+
+                // Frame is too long to be valid, skip to the next delimiter.
+                if (pending.size() > encoded_len)
+                {
+                    crc_errors++;
+                    bytes_skipped += pending.size();
+                    pending.clear();
+                    synced = false;
+                }
+            }
+            else
+            {
+                bytes_skipped++;
+            }
+            continue;
+        }
+
+        if (synced && !pending.empty())
+            accept(on_packet);
+
+        pending.clear();
+        synced = true;
+    }
+}
+
+template <typename F>
+void CobsFramer::accept(F& on_packet)
+{
+    Span<const std::uint8_t> frame{
+        reinterpret_cast<const std::uint8_t*>(pending.data()),
+        pending.size()};
+
+    std::size_t len = 0;
+    if (!cobs_decode(frame, decoded.data(), len) || len != packet_len)
+    {
+        crc_errors++;
+        bytes_skipped += frame.size();
+        return;
+    }
+
+    Span<const std::uint8_t> body{decoded.data(), len - BINARY_CRC_LEN};
+    if (crc16_ccitt(body) != get_le16(decoded.data() + body.size()))
+    {
+        crc_errors++;
+        bytes_skipped += frame.size();
+        return;
+    }
+
+    std::uint16_t seq = get_le16(decoded.data());
+    if (have_seq)
+        packets_lost += static_cast<std::uint16_t>(seq - last_seq - 1);
+    last_seq = seq;
+    have_seq = true;
+
+    on_packet(std::string_view(reinterpret_cast<const char*>(decoded.data()), len));
+}
+
+#endif /* COBS_FRAMER_HPP */
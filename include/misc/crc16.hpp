@@ -0,0 +1,37 @@
+#ifndef CRC16_HPP
+#define CRC16_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "span.hpp"
+
+/*
+ * CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xffff, no reflection),
+ * the variant most commonly found in microcontroller libraries. Table driven,
+ * one lookup per byte.
+ */
+constexpr std::array<std::uint16_t, 256> make_crc16_table()
+{
+    std::array<std::uint16_t, 256> table{};
+    for (std::size_t i = 0; i < 256; i++)
+    {
+        std::uint16_t crc = static_cast<std::uint16_t>(i << 8);
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<std::uint16_t, 256> CRC16_TABLE = make_crc16_table();
+
+std::uint16_t crc16_ccitt(Span<const std::uint8_t> data)
+{
+    std::uint16_t crc = 0xffff;
+    for (std::uint8_t b : data)
+        crc = (crc << 8) ^ CRC16_TABLE[(crc >> 8) ^ b];
+    return crc;
+}
+
+#endif /* CRC16_HPP */
@@ -0,0 +1,62 @@
+#ifndef CRC32_HPP
+#define CRC32_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "span.hpp"
+
+/*
+ * CRC-32 (polynomial 0xedb88320 reflected, as in zlib and Ethernet). Used to
+ * check bulk data like flight logs, so it's computed eight bytes at a time
+ * with eight tables ("slicing-by-8"), several times faster than the bytewise
+ * loop of crc16_ccitt().
+ */
+constexpr std::array<std::array<std::uint32_t, 256>, 8> make_crc32_tables()
+{
+    std::array<std::array<std::uint32_t, 256>, 8> tables{};
+    for (std::uint32_t i = 0; i < 256; i++)
+    {
+        std::uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320u : crc >> 1;
+        tables[0][i] = crc;
+    }
+    for (std::size_t t = 1; t < 8; t++)
+        for (std::size_t i = 0; i < 256; i++)
+            tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xff];
+    return tables;
+}
+
+constexpr std::array<std::array<std::uint32_t, 256>, 8> CRC32_TABLES = make_crc32_tables();
+
+/*
+ * Continues a CRC over more data, so records can be checked piecewise. Pass
+ * the previous result, or 0 to start.
+ */
+std::uint32_t crc32_update(std::uint32_t crc, Span<const std::uint8_t> data)
+{
+    const auto& t = CRC32_TABLES;
+    const std::uint8_t* p = data.data();
+    std::size_t n = data.size();
+
+    crc = ~crc;
+    for (; n >= 8; p += 8, n -= 8)
+    {
+        std::uint32_t lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) |
+            (static_cast<std::uint32_t>(p[3]) << 24));
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^
+              t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+    for (; n; p++, n--)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+    return ~crc;
+}
+
+std::uint32_t crc32(Span<const std::uint8_t> data)
+{
+    return crc32_update(0, data);
+}
+
+#endif /* CRC32_HPP */
@@ -0,0 +1,75 @@
+#ifndef DOORBELL_HPP
+#define DOORBELL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+/*
+ * Lets a consumer sleep until a lock-free producer has published something.
+ * The producer publishes (e.g. advances a ring's head) and then rings. Ringing
+ * is a fence and a load unless the consumer is actually asleep, so a busy
+ * consumer costs the producer nothing.
+ *
+ * The consumer re-checks its own condition after announcing that it's about to
+ * sleep, and the producer checks for a sleeper after publishing. The fences on
+ * both sides guarantee at least one of them sees the other, so no wakeup is
+ * lost.
+ */
+class Doorbell
+{
+public:
+    /*
+     * Producer side. Wakes the consumer if it's waiting.
+     */
+    void ring()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!waiting.load(std::memory_order_relaxed))
+            return;
+        wake();
+    }
+
+    /*
+     * Wakes the consumer unconditionally, including a consumer which is just
+     * about to wait. Used to deliver requests like stopping, which the
+     * consumer's ready condition doesn't cover.
+     */
+    void wake()
+    {
+        {
+            std::lock_guard<std::mutex> g(m);
+            rung = true;
+        }
+        cv.notify_one();
+    }
+
+    /*
+     * Consumer side. Returns once ready() holds, the doorbell is rung or woken,
+     * or the timeout expires. Returns false on timeout.
+     */
+    template <typename Pred, typename Rep, typename Period>
+    bool wait_for(Pred ready, std::chrono::duration<Rep, Period> timeout);
+private:
+    std::mutex m;
+    std::condition_variable cv;
+    bool rung = false;  // Guarded by m.
+    std::atomic<bool> waiting{false};
+};
+
+template <typename Pred, typename Rep, typename Period>
+bool Doorbell::wait_for(Pred ready, std::chrono::duration<Rep, Period> timeout)
+{
+    std::unique_lock<std::mutex> lk(m);
+    waiting.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    bool rv = cv.wait_for(lk, timeout, [&]{ return rung || ready(); });
+
+    rung = false;
+    waiting.store(false, std::memory_order_relaxed);
+    return rv;
+}
+
+#endif /* DOORBELL_HPP */
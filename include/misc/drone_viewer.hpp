@@ -1,14 +1,22 @@
 #ifndef DRONE_VIEWER_HPP
 #define DRONE_VIEWER_HPP
 
+#include <chrono>
 #include <filesystem>
 #include <memory>
+#include <optional>
 #include <string>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include "camera.hpp"
+#include "filters.hpp"
+#include "flight_recorder.hpp"
+#include "flight_replay.hpp"
+#include "frame_scheduler.hpp"
+#include "latency_histogram.hpp"
 #include "window_manager.hpp"
 #include "ui_manager.hpp"
 #include "lights.hpp"
@@ -18,28 +26,121 @@
 #include "serial_port.hpp"
 #include "shader.hpp"
 #include "shared.hpp"
+#include "telemetry_format.hpp"
 #include "telemetry_manager.hpp"
+#include "telemetry_mode.hpp"
+#include "telemetry_schema.hpp"
 #include "vertex_data.hpp"
 #include "viewer_mode.hpp"
+#include "viewer_options.hpp"
 
 class DroneViewer
 {
 public:
+    explicit DroneViewer(const ViewerOptions& options_) : options(options_) {}
+    ~DroneViewer();
+
     bool init();
     bool is_running() const;
 
     bool process_frame();
 private:
+    const ViewerOptions options;
+
+    void update_replay();
+
+    /*
+     * Everything on screen which can change without a window event.
+     */
+    struct SceneState
+    {
+        glm::vec3 drone_position{};
+        glm::quat drone_attitude{};
+        glm::vec3 camera_position{};
+        glm::vec3 camera_front{};
+        ViewerMode viewer_mode{};
+        std::uint64_t event_count{};
+
+        bool operator==(const SceneState& rhs) const
+        {
+            return drone_position == rhs.drone_position &&
+                drone_attitude == rhs.drone_attitude &&
+                camera_position == rhs.camera_position &&
+                camera_front == rhs.camera_front &&
+                viewer_mode == rhs.viewer_mode &&
+                event_count == rhs.event_count;
+        }
+        bool operator!=(const SceneState& rhs) const { return !(*this == rhs); }
+    };
+    SceneState get_scene_state() const;
+
     /*
      * Telemetry.
      */
-    static constexpr std::size_t TELEMETRY_PACKET_LEN = 37;
-    static constexpr char TELEMETRY_START_SYMBOL = '|';
-    static constexpr char TELEMETRY_STOP_SYMBOL = '\n';
-    static constexpr std::size_t TELEMETRY_FLOAT_CONVERSION_FACTOR = 1000;
-    static constexpr std::size_t TELEMETRY_FLOAT_FORMAT_LEN = 5;
-    const std::vector<std::size_t> TELEMETRY_ACCEL_OFFSETS = {1, 7, 13};
-    const std::vector<std::size_t> TELEMETRY_ROT_RATE_OFFSETS = {19, 25, 31};
+    static constexpr TelemetryMode TELEMETRY_MODE = TelemetryMode::Lossless;
+
+    // Filter stages applied to each standard channel, in order.
+    const std::vector<FilterSpec> TELEMETRY_FILTERS = {
+        {FilterType::MovingAverage, 32},
+    };
+
+    // Derive orientation from the gyro and accelerometer with an attitude
+    // estimator instead of displaying the filtered rot_rate channels. Off by
+    // default, as the bundled sketch and simulator don't send physical IMU
+    // data. The sketch sends a packet every 10 ms; rot_rate is taken to be in
+    // deg/s.
+    static constexpr bool TELEMETRY_ESTIMATE_ATTITUDE = false;
+    static constexpr AttitudeEstimatorConfig TELEMETRY_ATTITUDE_ESTIMATOR{
+        100.0f,
+        0.1f,
+        3.14159265f / 180.0f,
+    };
+
+    // Derive position by integrating the accelerometer with an EKF instead of
+    // displaying the filtered accel channels. Off by default for the same
+    // reason. Without fix channels in the format the position dead-reckons
+    // and drifts. Accel is taken to be in g, world units in metres.
+    static constexpr bool TELEMETRY_ESTIMATE_POSITION = false;
+    const PositionEstimatorConfig TELEMETRY_POSITION_ESTIMATOR{
+        9,                              // states
+        100.0f,                         // sample_hz
+        9.81f,                          // accel_scale
+        3.14159265f / 180.0f,           // gyro_scale
+        9.81f,                          // gravity
+        0.05f,                          // accel_noise
+        0.001f,                         // accel_bias_walk
+        0.005f,                         // gyro_noise
+        0.0001f,                        // gyro_bias_walk
+        0.05f,                          // fix_noise
+        INITIAL_DRONE_DATA.position,    // initial_position
+        {"fix.x", "fix.y", "fix.z"},    // fix_channels
+    };
+
+    // The drone is drawn as it was this long ago, so most frames fall between
+    // two samples and are interpolated rather than extrapolated. One packet
+    // period of the sketch. Past the newest sample, motion is extrapolated for
+    // at most TELEMETRY_MAX_EXTRAPOLATION before the drone holds still.
+    static constexpr std::chrono::milliseconds TELEMETRY_RENDER_DELAY{10};
+    static constexpr std::chrono::milliseconds TELEMETRY_MAX_EXTRAPOLATION{50};
+
+    // The telemetry ring is sized to absorb the link's full rate for this
+    // long without the telemetry thread draining it.
+    static constexpr std::chrono::milliseconds TELEMETRY_MAX_STALL{500};
+    static constexpr std::size_t TELEMETRY_BUFFER_MIN_LEN = 4096;
+
+    // Flight log segments roll over at FLIGHT_SEGMENT_SIZE. The recorder's
+    // buffer absorbs about a second of disk stalls at 50 MB/s, far more than
+    // any serial link delivers.
+    static constexpr std::size_t FLIGHT_SEGMENT_SIZE = 64 << 20;
+    static constexpr std::size_t FLIGHT_BUFFER_SIZE = 64 << 20;
+
+    // Frame pacing. While the telemetry pipeline runs, an unchanged scene is
+    // checked for new samples once per packet period of the sketch. Unfocused
+    // windows are drawn at a lower rate, minimized ones not at all.
+    static constexpr double FRAME_BACKGROUND_FPS = 30.0;
+    static constexpr std::chrono::milliseconds FRAME_POLL_INTERVAL{10};
+    static constexpr std::chrono::milliseconds FRAME_IDLE_REFRESH{1000};
+    static constexpr unsigned FRAME_SETTLE_FRAMES = 3;
 
     static constexpr std::size_t SCREEN_WIDTH = 1200;
     static constexpr std::size_t SCREEN_HEIGHT = 900;
@@ -47,6 +148,7 @@ private:
     static constexpr bool SHOW_DEMO_WINDOW = false;
     static constexpr bool SHOW_IMPLOT_DEMO_WINDOW = false;
     static constexpr bool SHOW_CAMERA_DATA_WINDOW = true;
+    static constexpr bool SHOW_LATENCY_WINDOW = true;
 
     const std::string GLSL_VERSION = "#version 330";
 
@@ -106,13 +208,8 @@ private:
     static constexpr bool drone_flip_textures = false;
 
 #ifdef OS_LINUX
-    std::unique_ptr<const LinuxSerialPortConfig> linux_serial_cfg =
-        std::make_unique<const LinuxSerialPortConfig>(
-            LibSerial::BaudRate::BAUD_9600,
-            LibSerial::CharacterSize::CHAR_SIZE_8,
-            LibSerial::FlowControl::FLOW_CONTROL_NONE,
-            LibSerial::Parity::PARITY_NONE,
-            LibSerial::StopBits::STOP_BITS_1);
+    // The termios backend, as libserial only offers the standard baud rates.
+    std::unique_ptr<const LinuxSerialPortConfig> linux_serial_cfg;
 #endif
 
     /*
@@ -121,7 +218,14 @@ private:
     std::unique_ptr<ViewerMode> viewer_mode;
     std::unique_ptr<DroneData> drone_data;
     std::unique_ptr<Camera> camera;
-    std::shared_ptr<BoundedBuffer<char>> telemetry_buffer;
+    std::shared_ptr<SpscRing<char>> telemetry_buffer;
+    std::unique_ptr<LatencyMonitor> latency_monitor;
+    std::unique_ptr<FlightRecorder> flight_recorder;
+    std::unique_ptr<FlightReplay> flight_replay;
+    // Whether the serial reader was running when replay mode was entered.
+    bool resume_reading = false;
+    std::unique_ptr<FrameScheduler> frame_scheduler;
+    SceneState last_scene{};
 
     /*
      * OpenGL models.
@@ -158,10 +262,13 @@ bool DroneViewer::init()
     resource_manager = std::make_unique<ResourceManager>();
 
     /*
-     * Create telemetry buffer.
+     * Create telemetry buffer, sized for the configured link rate.
      */
-    telemetry_buffer =
-        std::make_shared<BoundedBuffer<char>>((TELEMETRY_PACKET_LEN * 2) - 1);
+    telemetry_buffer = std::make_shared<SpscRing<char>>(
+        telemetry_buffer_len(
+            options.baud_rate,
+            TELEMETRY_MAX_STALL,
+            TELEMETRY_BUFFER_MIN_LEN));
 
     /*
      * Initialize communications interfaces.
@@ -169,30 +276,52 @@ bool DroneViewer::init()
 #ifdef OS_CYGWIN
     serial_port = std::make_unique<SerialPort>(telemetry_buffer);
 #elif OS_LINUX
+    linux_serial_cfg = std::make_unique<const LinuxSerialPortConfig>(
+        LinuxSerialBackend::Termios,
+        options.baud_rate,
+        LibSerial::CharacterSize::CHAR_SIZE_8,
+        LibSerial::FlowControl::FLOW_CONTROL_NONE,
+        LibSerial::Parity::PARITY_NONE,
+        LibSerial::StopBits::STOP_BITS_1);
     serial_port = std::make_unique<SerialPort>(
         telemetry_buffer,
         linux_serial_cfg.get());
 #endif
 
     /*
-     * Attempt to auto-open a port if only one is available. Else, do nothing
-     * since ports can easily be opened once the application is running.
+     * Open the port given on the command line. Otherwise, attempt to auto-open
+     * a port if only one is available. Else, do nothing since ports can easily
+     * be opened once the application is running.
      */
-    serial_port->auto_open();
+    if (!options.serial_port.empty())
+    {
+        if (serial_port->open(options.serial_port))
+            serial_port->config();
+    }
+    else
+    {
+        serial_port->auto_open();
+    }
 
     /*
      * Initialize state.
      */
     viewer_mode = std::make_unique<ViewerMode>(ViewerMode::Telemetry);
     drone_data = std::make_unique<DroneData>(INITIAL_DRONE_DATA);
+    latency_monitor = std::make_unique<LatencyMonitor>();
     camera = std::make_unique<Camera>(
-        resource_manager.get(),
         SCREEN_WIDTH,
         SCREEN_HEIGHT,
         room_dimensions,
         CAMERA_POSITION_HEADON,
         CAMERA_FRONT_HEADON);
 
+    if (!options.replay_log.empty())
+    {
+        flight_replay = std::make_unique<FlightReplay>();
+        if (!flight_replay->open(options.replay_log)) return false;
+    }
+
     /*
      * Initialize data managers.
      */
@@ -208,6 +337,16 @@ bool DroneViewer::init()
         room_dimensions,
         room_position);
     if (!window_manager->init()) return false;
+    window_manager->set_swap_interval(options.vsync ? 1 : 0);
+
+    FrameSchedulerConfig frame_cfg{};
+    frame_cfg.target_fps = options.target_fps;
+    frame_cfg.background_fps = FRAME_BACKGROUND_FPS;
+    frame_cfg.poll_interval = FRAME_POLL_INTERVAL;
+    frame_cfg.idle_refresh = FRAME_IDLE_REFRESH;
+    frame_cfg.settle_frames = FRAME_SETTLE_FRAMES;
+    frame_cfg.render_on_demand = options.render_on_demand;
+    frame_scheduler = std::make_unique<FrameScheduler>(frame_cfg);
 
     ui_manager = std::make_unique<UiManager>(
         window_manager->get_window(),
@@ -219,9 +358,12 @@ bool DroneViewer::init()
         drone_data.get(),
         camera.get(),
         serial_port.get(),
+        latency_monitor.get(),
+        flight_replay.get(),
         SHOW_DEMO_WINDOW,
         SHOW_IMPLOT_DEMO_WINDOW,
-        SHOW_CAMERA_DATA_WINDOW);
+        SHOW_CAMERA_DATA_WINDOW,
+        SHOW_LATENCY_WINDOW);
     if (!ui_manager->init()) return false;
 
     graphics_manager = std::make_unique<GraphicsManager>(
@@ -233,18 +375,32 @@ bool DroneViewer::init()
         use_anti_aliasing);
     if (!graphics_manager->init()) return false;
 
+    auto telemetry_format = make_telemetry_format(
+        options.telemetry_framing, options.telemetry_schema);
+    if (!telemetry_format) return false;
+
     telemetry_manager = std::make_unique<TelemetryManager>(
-        TELEMETRY_PACKET_LEN,
-        TELEMETRY_START_SYMBOL,
-        TELEMETRY_STOP_SYMBOL,
-        TELEMETRY_FLOAT_CONVERSION_FACTOR,
-        TELEMETRY_FLOAT_FORMAT_LEN,
-        TELEMETRY_ACCEL_OFFSETS,
-        TELEMETRY_ROT_RATE_OFFSETS,
+        TELEMETRY_MODE,
+        *telemetry_format,
         serial_port.get(),
         drone_data.get(),
-        resource_manager.get(),
-        telemetry_buffer);
+        telemetry_buffer,
+        latency_monitor.get());
+    for (std::size_t i = 0; i < STANDARD_CHANNELS.size(); i++)
+        if (!telemetry_manager->set_filter_chain(i, TELEMETRY_FILTERS)) return false;
+    if (TELEMETRY_ESTIMATE_ATTITUDE &&
+        !telemetry_manager->enable_attitude_estimator(TELEMETRY_ATTITUDE_ESTIMATOR))
+        return false;
+    if (TELEMETRY_ESTIMATE_POSITION &&
+        !telemetry_manager->enable_position_estimator(TELEMETRY_POSITION_ESTIMATOR))
+        return false;
+    if (!options.flight_log.empty())
+    {
+        flight_recorder = std::make_unique<FlightRecorder>(
+            options.flight_log, FLIGHT_SEGMENT_SIZE, FLIGHT_BUFFER_SIZE);
+        if (!flight_recorder->start()) return false;
+        if (!telemetry_manager->set_flight_recorder(flight_recorder.get())) return false;
+    }
     if (!telemetry_manager->init()) return false;
 
     /*
@@ -311,34 +467,150 @@ bool DroneViewer::init()
     return true;
 }
 
+DroneViewer::~DroneViewer()
+{
+    // The telemetry thread records into the latency histograms, and is only
+    // destroyed after the destructor body, so stop it and its producers
+    // before dumping.
+    if (serial_port)
+        serial_port->stop_reading();
+    if (flight_replay)
+        flight_replay->stop();
+    if (telemetry_manager)
+        telemetry_manager->stop();
+
+    if (latency_monitor && !options.latency_log.empty())
+        latency_monitor->dump(options.latency_log);
+    if (frame_scheduler)
+        frame_scheduler->log_summary();
+}
+
+/*
+ * In replay mode the replay takes the serial reader's place as the producer of
+ * the telemetry ring, so the reader is stopped first. The pipeline thread is
+ * restarted by hand, since it's normally started along with the reader. On
+ * leaving replay mode the reader is restarted if it was running before, which
+ * restarts the pipeline too.
+ */
+void DroneViewer::update_replay()
+{
+    bool replay_mode = *viewer_mode == ViewerMode::Replay;
+    if (!flight_replay || replay_mode == flight_replay->is_running())
+        return;
+
+    if (replay_mode)
+        resume_reading = serial_port->is_reading();
+
+    serial_port->stop_reading();
+    telemetry_manager->stop();
+    flight_replay->stop();
+    telemetry_buffer->clear();
+
+    // Replayed telemetry isn't recorded again. With -r and -P naming the same
+    // directory it would be appended to the log being replayed.
+    if (flight_recorder)
+        telemetry_manager->set_flight_recorder(
+            replay_mode ? nullptr : flight_recorder.get());
+
+    if (replay_mode)
+    {
+        telemetry_manager->start();
+        flight_replay->start(telemetry_buffer);
+    }
+    else if (resume_reading)
+    {
+        resume_reading = false;
+        if (!serial_port->start_reading())
+            logger.log(LogLevel::error, "DroneViewer::update_replay: \
+                Cannot resume reading from the serial port\n");
+    }
+}
+
 bool DroneViewer::is_running() const
 {
     return !window_manager->should_window_close();
 }
 
+DroneViewer::SceneState DroneViewer::get_scene_state() const
+{
+    return {
+        drone_data->position,
+        drone_data->attitude,
+        camera->get_position(),
+        camera->get_front(),
+        *viewer_mode,
+        window_manager->get_event_count(),
+    };
+}
+
 bool DroneViewer::process_frame()
 {
     /*
      * Process input.
      */
     window_manager->process_input();
-    if (*viewer_mode == ViewerMode::Telemetry)
-        if (!telemetry_manager->process_telemetry()) return false;
+    update_replay();
+    const TimedDroneData* newest_sample = nullptr;
+    if (*viewer_mode == ViewerMode::Telemetry || *viewer_mode == ViewerMode::Replay)
+    {
+        telemetry_manager->sample_drone_data(
+            std::chrono::steady_clock::now() - TELEMETRY_RENDER_DELAY,
+            TELEMETRY_MAX_EXTRAPOLATION);
+        if (telemetry_manager->is_running())
+            newest_sample = telemetry_manager->get_newest_sample();
+    }
+
+    camera->process_frame();
 
     /*
-     * Render. Order between ui_manager and graphics_manager is important.
+     * Only draw when something on screen changed, at the rate the frame
+     * scheduler allows.
      */
-    camera->process_frame();
-    ui_manager->process_frame();
-    ui_manager->render();
-    graphics_manager->process_frame();
-    ui_manager->render_draw_data();
+    auto frame_start = std::chrono::steady_clock::now();
+    auto activity = window_manager->get_activity();
+    auto scene = get_scene_state();
+    if (scene != last_scene)
+    {
+        frame_scheduler->mark_dirty();
+        last_scene = scene;
+    }
+
+    if (frame_scheduler->should_render(activity, frame_start))
+    {
+        /*
+         * Render. Order between ui_manager and graphics_manager is important.
+         */
+        ui_manager->process_frame();
+        ui_manager->render();
+        graphics_manager->process_frame();
+        ui_manager->render_draw_data();
+
+        /*
+         * Swap buffers. With vsync, the swap returns once the frame is queued
+         * for display, which is as close to presentation as can be observed
+         * here.
+         */
+        auto drawn = std::chrono::steady_clock::now();
+        window_manager->swap_buffers();
+        auto swapped = std::chrono::steady_clock::now();
+        frame_scheduler->frame_rendered(frame_start, swapped);
+
+        if (newest_sample)
+        {
+            latency_monitor->record(LatencyStage::FilterToDraw, drawn - newest_sample->processed);
+            latency_monitor->record(LatencyStage::DrawToSwap, swapped - drawn);
+            latency_monitor->record(LatencyStage::SerialToSwap, swapped - newest_sample->received);
+        }
+    }
 
     /*
-     * Swap buffers and poll I/O events.
+     * Wait for I/O events until the next frame or check for new telemetry is
+     * due. The telemetry pipeline runs on its own thread meanwhile.
      */
-    window_manager->swap_buffers();
-    window_manager->poll_events();
+    window_manager->wait_events(frame_scheduler->time_to_wait(
+        activity,
+        std::chrono::steady_clock::now(),
+        telemetry_manager->is_running()));
 
     return true;
 }
@@ -0,0 +1,253 @@
+#ifndef FILTERS_HPP
+#define FILTERS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "logger.hpp"
+
+/*
+ * Streaming filters for telemetry channels. Each stage consumes one sample and
+ * updates its output incrementally, in constant time per sample except for the
+ * median, instead of recomputing it over the whole window. Stages are chained
+ * per channel in a FilterChain.
+ */
+class FilterStage
+{
+public:
+    virtual ~FilterStage() = default;
+    virtual float process(float) = 0;
+};
+
+/*
+ * Mean of the last window samples, as a running sum over a ring of samples.
+ * The sum is kept in double precision so adding and removing samples doesn't
+ * accumulate rounding error over long runs. Until the window fills, the mean
+ * is over the samples seen so far.
+ */
+class MovingAverage : public FilterStage
+{
+public:
+    explicit MovingAverage(std::size_t window) : samples(window) {}
+
+    float process(float x) override
+    {
+        if (count == samples.size())
+            sum -= samples[next];
+        else
+            count++;
+
+        samples[next] = x;
+        sum += x;
+        next = next + 1 == samples.size() ? 0 : next + 1;
+
+        return static_cast<float>(sum / count);
+    }
+private:
+    std::vector<float> samples;
+    std::size_t next = 0;
+    std::size_t count = 0;
+    double sum = 0.0;
+};
+
+/*
+ * y += alpha * (x - y), seeded with the first sample.
+ */
+class ExponentialMovingAverage : public FilterStage
+{
+public:
+    explicit ExponentialMovingAverage(float alpha_) : alpha(alpha_) {}
+
+    float process(float x) override
+    {
+        if (!seeded)
+        {
+            y = x;
+            seeded = true;
+        }
+        y += alpha * (x - y);
+        return y;
+    }
+private:
+    const float alpha;
+    float y = 0.0f;
+    bool seeded = false;
+};
+
+/*
+ * Second order IIR section in transposed direct form II, with coefficients
+ * normalized so a0 = 1.
+ */
+class Biquad : public FilterStage
+{
+public:
+    Biquad(float b0_, float b1_, float b2_, float a1_, float a2_) :
+        b0(b0_), b1(b1_), b2(b2_), a1(a1_), a2(a2_)
+    {}
+
+    /*
+     * Butterworth low-pass (Q = 1/sqrt(2)) by the bilinear transform, as in
+     * the RBJ audio EQ cookbook. cutoff_hz must lie below sample_hz / 2.
+     */
+    static Biquad butterworth_lowpass(float cutoff_hz, float sample_hz);
+
+    float process(float x) override
+    {
+        if (!seeded)
+        {
+            // Start from steady state at the first sample instead of from
+            // zero, so the output doesn't ramp up from the origin.
+            float dc_gain = (b0 + b1 + b2) / (1.0f + a1 + a2);
+            float y0 = x * dc_gain;
+            s1 = y0 - b0 * x;
+            s2 = b2 * x - a2 * y0;
+            seeded = true;
+        }
+
+        float y = b0 * x + s1;
+        s1 = b1 * x - a1 * y + s2;
+        s2 = b2 * x - a2 * y;
+        return y;
+    }
+private:
+    const float b0, b1, b2, a1, a2;
+    float s1 = 0.0f;
+    float s2 = 0.0f;
+    bool seeded = false;
+};
+
+Biquad Biquad::butterworth_lowpass(float cutoff_hz, float sample_hz)
+{
+    const double pi = 3.14159265358979323846;
+    double w0 = 2.0 * pi * cutoff_hz / sample_hz;
+    double alpha = std::sin(w0) / (2.0 * std::sqrt(0.5));
+    double cosw0 = std::cos(w0);
+    double a0 = 1.0 + alpha;
+
+    return Biquad(
+        static_cast<float>((1.0 - cosw0) / 2.0 / a0),
+        static_cast<float>((1.0 - cosw0) / a0),
+        static_cast<float>((1.0 - cosw0) / 2.0 / a0),
+        static_cast<float>(-2.0 * cosw0 / a0),
+        static_cast<float>((1.0 - alpha) / a0));
+}
+
+/*
+ * Median of the last window samples. Besides the ring of samples in arrival
+ * order, the window is kept sorted, so each sample costs one binary search to
+ * remove the oldest sample and one to insert the new one. Shifting the
+ * elements in between is a single memmove; for the windows used here that is
+ * faster than balancing two heaps or ordered sets, which chase pointers and
+ * allocate a node per sample.
+ */
+class SlidingMedian : public FilterStage
+{
+public:
+    explicit SlidingMedian(std::size_t window) : samples(window)
+    {
+        sorted.reserve(window);
+    }
+
+    float process(float x) override
+    {
+        if (sorted.size() == samples.size())
+            sorted.erase(std::lower_bound(sorted.begin(), sorted.end(), samples[next]));
+
+        samples[next] = x;
+        next = next + 1 == samples.size() ? 0 : next + 1;
+        sorted.insert(std::upper_bound(sorted.begin(), sorted.end(), x), x);
+
+        std::size_t n = sorted.size();
+        if (n % 2)
+            return sorted[n / 2];
+        return (sorted[n / 2 - 1] + sorted[n / 2]) / 2.0f;
+    }
+private:
+    std::vector<float> samples;
+    std::size_t next = 0;
+    std::vector<float> sorted;
+};
+
+/*
+ * Stages applied in order to one channel. An empty chain passes samples
+ * through unchanged. Non-finite samples (e.g. a NaN in a float32 field) would
+ * poison the stages' state, so they're dropped and the previous output is
+ * returned instead.
+ */
+class FilterChain
+{
+public:
+    void add(std::unique_ptr<FilterStage> stage) { stages.push_back(std::move(stage)); }
+    bool empty() const { return stages.empty(); }
+
+    float process(float x)
+    {
+        if (!std::isfinite(x))
+            return output;
+
+        for (auto& stage : stages)
+            x = stage->process(x);
+        output = x;
+        return x;
+    }
+private:
+    std::vector<std::unique_ptr<FilterStage>> stages;
+    float output = 0.0f;
+};
+
+/*
+ * Declarative description of a stage, so chains can be configured as plain
+ * data. Only the parameters of the given type are used.
+ */
+enum class FilterType
+{
+    MovingAverage,
+    ExponentialMovingAverage,
+    ButterworthLowpass,
+    SlidingMedian,
+};
+
+struct FilterSpec
+{
+    FilterType type;
+    std::size_t window = 1;   // MovingAverage, SlidingMedian
+    float alpha = 1.0f;       // ExponentialMovingAverage
+    float cutoff_hz = 0.0f;   // ButterworthLowpass
+    float sample_hz = 0.0f;   // ButterworthLowpass
+};
+
+/*
+ * Returns nullptr (and logs why) if the parameters are invalid.
+ */
+std::unique_ptr<FilterStage> make_filter(const FilterSpec& spec)
+{
+    switch (spec.type)
+    {
+    case FilterType::MovingAverage:
+        if (spec.window == 0)
+            break;
+        return std::make_unique<MovingAverage>(spec.window);
+    case FilterType::ExponentialMovingAverage:
+        if (!(spec.alpha > 0.0f && spec.alpha <= 1.0f))
+            break;
+        return std::make_unique<ExponentialMovingAverage>(spec.alpha);
+    case FilterType::ButterworthLowpass:
+        if (!(spec.cutoff_hz > 0.0f && spec.cutoff_hz < spec.sample_hz / 2))
+            break;
+        return std::make_unique<Biquad>(
+            Biquad::butterworth_lowpass(spec.cutoff_hz, spec.sample_hz));
+    case FilterType::SlidingMedian:
+        if (spec.window == 0)
+            break;
+        return std::make_unique<SlidingMedian>(spec.window);
+    }
+
+    logger.log(LogLevel::error, "make_filter: Invalid parameters for filter type ",
+        static_cast<int>(spec.type), '\n');
+    return nullptr;
+}
+
+#endif /* FILTERS_HPP */
@@ -0,0 +1,546 @@
+#ifndef FLIGHT_RECORDER_HPP
+#define FLIGHT_RECORDER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "crc32.hpp"
+#include "logger.hpp"
+#include "span.hpp"
+#include "spsc_ring.hpp"
+#include "telemetry_framing.hpp"
+
+namespace fs = std::filesystem;
+
+/*
+ * On-disk layout of a flight log. A log is a directory of segment files named
+ * by sequence number (000001.flight, 000002.flight, ...), so they sort in
+ * recording order. Each segment is a header followed by records, all
+ * little-endian:
+ *
+ *     header: magic "PRFLIGHT" | version (u32) | header length (u32) |
+ *             segment number (u64) | steady clock at open (i64 ns) |
+ *             system clock at open (i64 ns)
+ *     record: payload length (u32) | type (u16) | reserved (u16) |
+ *             time (i64 ns, steady clock) | payload | crc32 (u32)
+ *
+ * The CRC covers the record header and payload. A segment ends at the first
+ * record which is truncated or fails its CRC, which is where a crash leaves
+ * it. The two clocks in the header relate record times to wall-clock time.
+ */
+enum class FlightRecordType : std::uint16_t
+{
+    Raw = 1,     // Bytes as drained from the serial ring.
+    Sample = 2,  // Every channel of a decoded packet, as float32.
+};
+
+constexpr char FLIGHT_SEGMENT_MAGIC[8] = {'P', 'R', 'F', 'L', 'I', 'G', 'H', 'T'};
+constexpr std::uint32_t FLIGHT_LOG_VERSION = 1;
+constexpr std::size_t FLIGHT_SEGMENT_HEADER_LEN = 40;
+constexpr std::size_t FLIGHT_RECORD_HEADER_LEN = 16;
+constexpr std::size_t FLIGHT_RECORD_CRC_LEN = 4;
+constexpr const char* FLIGHT_SEGMENT_EXTENSION = ".flight";
+
+struct FlightSegmentHeader
+{
+    std::uint64_t number{};
+    std::int64_t steady_ns{};
+    std::int64_t system_ns{};
+};
+
+struct FlightRecord
+{
+    std::uint16_t type{};
+    std::int64_t time_ns{};
+    Span<const char> payload{};
+};
+
+bool parse_flight_segment_header(Span<const char> segment, FlightSegmentHeader& out)
+{
+    auto p = reinterpret_cast<const std::uint8_t*>(segment.data());
+    if (segment.size() < FLIGHT_SEGMENT_HEADER_LEN ||
+        std::memcmp(p, FLIGHT_SEGMENT_MAGIC, sizeof(FLIGHT_SEGMENT_MAGIC)) != 0 ||
+        get_le32(p + 8) != FLIGHT_LOG_VERSION ||
+        get_le32(p + 12) != FLIGHT_SEGMENT_HEADER_LEN)
+        return false;
+
+    out.number = get_le64(p + 16);
+    out.steady_ns = static_cast<std::int64_t>(get_le64(p + 24));
+    out.system_ns = static_cast<std::int64_t>(get_le64(p + 32));
+    return true;
+}
+
+/*
+ * Calls on_record with every valid record of a segment from offset pos, which
+ * must be a record boundary, up to offset end, in order. The payload points
+ * into the segment. Returns the offset after the last valid record, which is
+ * short of end if a record is truncated or fails its CRC.
+ */
+template <typename F>
+std::size_t for_each_flight_record(Span<const char> segment, std::size_t pos,
+                                   std::size_t end, F&& on_record)
+{
+    end = std::min(end, segment.size());
+    while (pos <= end && end - pos >= FLIGHT_RECORD_HEADER_LEN + FLIGHT_RECORD_CRC_LEN)
+    {
+        auto p = reinterpret_cast<const std::uint8_t*>(segment.data() + pos);
+        std::size_t payload_len = get_le32(p);
+        if (payload_len > end - pos - FLIGHT_RECORD_HEADER_LEN - FLIGHT_RECORD_CRC_LEN)
+            break;
+
+        std::size_t checked_len = FLIGHT_RECORD_HEADER_LEN + payload_len;
+        if (crc32({p, checked_len}) != get_le32(p + checked_len))
+            break;
+
+        FlightRecord record;
+        record.type = get_le16(p + 4);
+        record.time_ns = static_cast<std::int64_t>(get_le64(p + 8));
+        record.payload = segment.subspan(pos + FLIGHT_RECORD_HEADER_LEN, payload_len);
+        on_record(record);
+
+        pos += checked_len + FLIGHT_RECORD_CRC_LEN;
+    }
+    return pos;
+}
+
+/*
+ * Calls on_record with every valid record of a segment, in order. The
+ * payload points into the segment. Returns the length of the valid prefix of
+ * the segment, header included, or 0 if the header is invalid.
+ */
+template <typename F>
+std::size_t for_each_flight_record(Span<const char> segment, F&& on_record)
+{
+    FlightSegmentHeader header;
+    if (!parse_flight_segment_header(segment, header))
+        return 0;
+
+    return for_each_flight_record(segment, FLIGHT_SEGMENT_HEADER_LEN, segment.size(),
+                                  std::forward<F>(on_record));
+}
+
+/*
+ * Segment files of a log directory in recording order. Other files are
+ * ignored.
+ */
+std::vector<fs::path> list_flight_segments(const fs::path& dir)
+{
+    std::vector<fs::path> segments;
+    std::error_code ec;
+    for (auto& entry : fs::directory_iterator(dir, ec))
+    {
+        auto stem = entry.path().stem().string();
+        if (entry.is_regular_file(ec) &&
+            entry.path().extension() == FLIGHT_SEGMENT_EXTENSION &&
+            !stem.empty() &&
+            std::all_of(stem.begin(), stem.end(), [](char c) { return c >= '0' && c <= '9'; }))
+            segments.push_back(entry.path());
+    }
+
+    // Names are zero padded, but may outgrow the padding.
+    std::sort(segments.begin(), segments.end(), [](const fs::path& a, const fs::path& b)
+    {
+        auto sa = a.stem().string();
+        auto sb = b.stem().string();
+        return sa.size() != sb.size() ? sa.size() < sb.size() : sa < sb;
+    });
+    return segments;
+}
+
+/*
+ * Cuts a segment back to its valid prefix, e.g. after a crash while it was
+ * being written. A segment without a valid header is removed. Returns false
+ * if the file couldn't be read or changed.
+ */
+bool recover_flight_segment(const fs::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> contents((std::istreambuf_iterator<char>(file)),
+                               std::istreambuf_iterator<char>());
+    if (!file.eof() && file.fail())
+    {
+        logger.log(LogLevel::error, "recover_flight_segment: Cannot read ", path, '\n');
+        return false;
+    }
+    file.close();
+
+    std::size_t valid = for_each_flight_record(contents, [](const FlightRecord&) {});
+    if (valid == contents.size())
+        return true;
+
+    std::error_code ec;
+    if (valid == 0)
+    {
+        logger.log(LogLevel::warning, "recover_flight_segment: Removing ", path,
+            ", its header is incomplete\n");
+        fs::remove(path, ec);
+    }
+    else
+    {
+        logger.log(LogLevel::warning, "recover_flight_segment: Truncating ", path,
+            " from ", contents.size(), " to ", valid, " bytes\n");
+        fs::resize_file(path, valid, ec);
+    }
+    if (ec)
+    {
+        logger.log(LogLevel::error, "recover_flight_segment: ", ec.message(), '\n');
+        return false;
+    }
+    return true;
+}
+
+struct FlightRecorderStats
+{
+    std::uint64_t records{};
+    std::uint64_t records_dropped{};
+    std::uint64_t bytes_written{};
+    std::uint64_t segments{};
+};
+
+/*
+ * Appends records to a flight log from a background thread, so whoever
+ * records never waits for the disk. Records are copied into a ring, and every
+ * FLUSH_INTERVAL the writer thread moves everything queued to the current
+ * segment with one large write. A new segment is started whenever the next
+ * record would take the current one past segment_size.
+ *
+ * If the ring is full (the disk has fallen behind by buffer_size bytes) the
+ * record is dropped and counted instead. Only one thread may record.
+ *
+ * Starting recovers the newest existing segment of the directory, in case the
+ * previous session crashed, and continues with a new one.
+ */
+class FlightRecorder
+{
+public:
+    FlightRecorder(const fs::path& dir_, std::size_t segment_size_, std::size_t buffer_size_) :
+        dir(dir_),
+        segment_size(segment_size_),
+        buffer(buffer_size_)
+    {}
+    ~FlightRecorder();
+
+    // Disallow copying and moving, the writer thread refers to this.
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+    FlightRecorder(FlightRecorder&&) = delete;
+    FlightRecorder& operator=(FlightRecorder&&) = delete;
+
+    bool start();
+    void stop();
+    bool is_running() const { return writer.joinable(); }
+
+    /*
+     * Queue a record. Return false if it was dropped.
+     */
+    bool record_raw(std::chrono::steady_clock::time_point, Span<const char> bytes);
+    bool record_sample(std::chrono::steady_clock::time_point, const std::vector<float>& channels);
+
+    FlightRecorderStats get_stats() const;
+private:
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{20};
+
+    template <typename F>
+    bool queue(FlightRecordType, std::chrono::steady_clock::time_point,
+               std::size_t payload_len, F&& write_payload);
+
+    void run();
+    bool flush();
+    bool open_segment();
+    bool close_segment();
+    bool write_segment(const char*, std::size_t);
+
+    const fs::path dir;
+    const std::size_t segment_size;
+    SpscRing<char> buffer;
+
+    // Producer's record under construction.
+    std::vector<char> scratch{};
+
+    // Writer state.
+    std::vector<char> batch{};
+    int fd = -1;
+    std::uint64_t segment_number = 0;
+    std::size_t segment_len = 0;
+
+    std::thread writer;
+    std::atomic<bool> stop_requested = false;
+    std::atomic<bool> accepting = false;
+
+    std::atomic<std::uint64_t> stat_records{};
+    std::atomic<std::uint64_t> stat_records_dropped{};
+    std::atomic<std::uint64_t> stat_bytes_written{};
+    std::atomic<std::uint64_t> stat_segments{};
+};
+
+FlightRecorder::~FlightRecorder()
+{
+    stop();
+}
+
+bool FlightRecorder::start()
+{
+    if (is_running())
+        return true;
+
+    if (segment_size < FLIGHT_SEGMENT_HEADER_LEN + FLIGHT_RECORD_HEADER_LEN + FLIGHT_RECORD_CRC_LEN)
+    {
+        logger.log(LogLevel::error, "FlightRecorder::start: Segment size ",
+            segment_size, " is too small\n");
+        return false;
+    }
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec)
+    {
+        logger.log(LogLevel::error, "FlightRecorder::start: Cannot create ", dir,
+            ": ", ec.message(), '\n');
+        return false;
+    }
+
+    auto segments = list_flight_segments(dir);
+    if (!segments.empty())
+    {
+        if (!recover_flight_segment(segments.back()))
+            return false;
+        segment_number = std::stoull(segments.back().stem().string());
+    }
+
+    if (!open_segment())
+        return false;
+
+    batch.reserve(buffer.capacity());
+    stop_requested.store(false);
+    writer = std::thread(&FlightRecorder::run, this);
+    accepting.store(true);
+    logger.log(LogLevel::info, "Recording flight log to ", dir, '\n');
+    return true;
+}
+
+void FlightRecorder::stop()
+{
+    if (!writer.joinable())
+        return;
+
+    accepting.store(false);
+    stop_requested.store(true);
+    writer.join();
+
+    auto stats = get_stats();
+    logger.log(LogLevel::info, "Flight log: ", stats.records, " records, ",
+        stats.bytes_written, " bytes in ", stats.segments, " segments, ",
+        stats.records_dropped, " records dropped\n");
+}
+
+FlightRecorderStats FlightRecorder::get_stats() const
+{
+    FlightRecorderStats stats{};
+    stats.records = stat_records.load(std::memory_order_relaxed);
+    stats.records_dropped = stat_records_dropped.load(std::memory_order_relaxed);
+    stats.bytes_written = stat_bytes_written.load(std::memory_order_relaxed);
+    stats.segments = stat_segments.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool FlightRecorder::record_raw(std::chrono::steady_clock::time_point time,
+                                Span<const char> bytes)
+{
+    return queue(FlightRecordType::Raw, time, bytes.size(), [&](char* dst)
+    {
+        std::copy(bytes.begin(), bytes.end(), dst);
+    });
+}
+
+bool FlightRecorder::record_sample(std::chrono::steady_clock::time_point time,
+                                   const std::vector<float>& channels)
+{
+    return queue(FlightRecordType::Sample, time, channels.size() * 4, [&](char* dst)
+    {
+        auto p = reinterpret_cast<std::uint8_t*>(dst);
+        for (float value : channels)
+        {
+            put_le_float(p, value);
+            p += 4;
+        }
+    });
+}
+
+/*
+ * The record is assembled in scratch and copied into the ring with a single
+ * write, so the writer thread only ever sees whole records.
+ */
+template <typename F>
+bool FlightRecorder::queue(FlightRecordType type, std::chrono::steady_clock::time_point time,
+                           std::size_t payload_len, F&& write_payload)
+{
+    std::size_t len = FLIGHT_RECORD_HEADER_LEN + payload_len + FLIGHT_RECORD_CRC_LEN;
+    if (!accepting.load(std::memory_order_relaxed) ||
+        len > buffer.capacity() - buffer.size())
+    {
+        stat_records_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    scratch.resize(len);
+    auto p = reinterpret_cast<std::uint8_t*>(scratch.data());
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch());
+    put_le32(p, static_cast<std::uint32_t>(payload_len));
+    put_le16(p + 4, static_cast<std::uint16_t>(type));
+    put_le16(p + 6, 0);
+    put_le64(p + 8, static_cast<std::uint64_t>(ns.count()));
+    write_payload(scratch.data() + FLIGHT_RECORD_HEADER_LEN);
+    put_le32(p + len - FLIGHT_RECORD_CRC_LEN,
+        crc32({p, FLIGHT_RECORD_HEADER_LEN + payload_len}));
+
+    buffer.write(scratch);
+    stat_records.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/*
+ * Writer thread. A failed write ends recording; the ring then fills up and
+ * further records are dropped.
+ */
+void FlightRecorder::run()
+{
+    bool ok = true;
+    while (ok && !stop_requested.load())
+    {
+        std::this_thread::sleep_for(FLUSH_INTERVAL);
+        ok = flush();
+    }
+    if (ok)
+        flush();
+    close_segment();
+}
+
+/*
+ * Moves every queued record to disk, splitting the batch where a segment
+ * fills up.
+ */
+bool FlightRecorder::flush()
+{
+    for (Span<const char> bytes = buffer.read_available();
+         !bytes.empty();
+         bytes = buffer.read_available())
+    {
+        batch.insert(batch.end(), bytes.begin(), bytes.end());
+        buffer.consume(bytes.size());
+    }
+
+    std::size_t begin = 0;
+    std::size_t pos = 0;
+    while (batch.size() - pos >= FLIGHT_RECORD_HEADER_LEN)
+    {
+        std::size_t len = FLIGHT_RECORD_HEADER_LEN + FLIGHT_RECORD_CRC_LEN +
+            get_le32(reinterpret_cast<const std::uint8_t*>(batch.data() + pos));
+        if (batch.size() - pos < len)
+            break;
+
+        // A record longer than a whole segment gets a segment of its own.
+        std::size_t pending = segment_len + (pos - begin);
+        if (pending + len > segment_size && pending > FLIGHT_SEGMENT_HEADER_LEN)
+        {
+            if (!write_segment(batch.data() + begin, pos - begin) ||
+                !close_segment() || !open_segment())
+                return false;
+            begin = pos;
+        }
+        pos += len;
+    }
+
+    bool ok = write_segment(batch.data() + begin, pos - begin);
+    batch.erase(batch.begin(), batch.begin() + pos);
+    return ok;
+}
+
+bool FlightRecorder::open_segment()
+{
+    segment_number++;
+    char name[32];
+    std::snprintf(name, sizeof(name), "%06llu%s",
+        static_cast<unsigned long long>(segment_number), FLIGHT_SEGMENT_EXTENSION);
+    fs::path path = dir / name;
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        logger.log(LogLevel::error, "FlightRecorder::open_segment: Cannot open ",
+            path, ": ", std::strerror(errno), '\n');
+        return false;
+    }
+
+    auto ns = [](auto time)
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            time.time_since_epoch()).count());
+    };
+    std::uint8_t header[FLIGHT_SEGMENT_HEADER_LEN];
+    std::memcpy(header, FLIGHT_SEGMENT_MAGIC, sizeof(FLIGHT_SEGMENT_MAGIC));
+    put_le32(header + 8, FLIGHT_LOG_VERSION);
+    put_le32(header + 12, FLIGHT_SEGMENT_HEADER_LEN);
+    put_le64(header + 16, segment_number);
+    put_le64(header + 24, ns(std::chrono::steady_clock::now()));
+    put_le64(header + 32, ns(std::chrono::system_clock::now()));
+
+    segment_len = 0;
+    stat_segments.fetch_add(1, std::memory_order_relaxed);
+    return write_segment(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+/*
+ * Syncs the segment before closing it, so at most the newest segment can be
+ * left with a torn tail.
+ */
+bool FlightRecorder::close_segment()
+{
+    if (fd < 0)
+        return true;
+
+    bool ok = ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    fd = -1;
+    if (!ok)
+        logger.log(LogLevel::error, "FlightRecorder::close_segment: ",
+            std::strerror(errno), '\n');
+    return ok;
+}
+
+bool FlightRecorder::write_segment(const char* data, std::size_t len)
+{
+    while (len)
+    {
+        ssize_t n = ::write(fd, data, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            logger.log(LogLevel::error, "FlightRecorder::write_segment: ",
+                std::strerror(errno), '\n');
+            return false;
+        }
+        data += n;
+        len -= static_cast<std::size_t>(n);
+        segment_len += static_cast<std::size_t>(n);
+        stat_bytes_written.fetch_add(static_cast<std::uint64_t>(n), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+#endif /* FLIGHT_RECORDER_HPP */
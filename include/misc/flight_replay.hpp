@@ -0,0 +1,395 @@
+#ifndef FLIGHT_REPLAY_HPP
+#define FLIGHT_REPLAY_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "flight_recorder.hpp"
+#include "logger.hpp"
+#include "mapped_file.hpp"
+#include "span.hpp"
+#include "spsc_ring.hpp"
+
+namespace fs = std::filesystem;
+
+/*
+ * Plays a flight log back into a byte ring in place of the serial reader, so
+ * the recorded bytes go through the same framing, decoding and filtering as
+ * live telemetry. Only the raw records are replayed; decoded samples are
+ * produced afresh by the pipeline.
+ *
+ * Bytes are paced by their recorded times at a speed of MIN_SPEED to
+ * MAX_SPEED, or written as fast as the pipeline consumes them when the speed
+ * is UNPACED, which measures the throughput of the whole pipeline. Unlike the
+ * serial reader, replay waits for room in the ring rather than dropping data.
+ *
+ * Segments are memory mapped. Every INDEX_STRIDE raw records, a sparse index
+ * keeps the record's time and location, so a seek is a binary search followed
+ * by a scan of at most INDEX_STRIDE records.
+ *
+ * Times are measured from the start of the log. Recording sessions appended
+ * to the same log are played back to back: a segment which starts before the
+ * previous one ended, or more than MAX_GAP after it, is shifted to follow it.
+ */
+class FlightReplay
+{
+public:
+    static constexpr double UNPACED = 0.0;
+    static constexpr double MIN_SPEED = 0.25;
+    static constexpr double MAX_SPEED = 100.0;
+
+    FlightReplay() = default;
+    ~FlightReplay();
+
+    // Disallow copying and moving, the replay thread refers to this.
+    FlightReplay(const FlightReplay&) = delete;
+    FlightReplay& operator=(const FlightReplay&) = delete;
+    FlightReplay(FlightReplay&&) = delete;
+    FlightReplay& operator=(FlightReplay&&) = delete;
+
+    /*
+     * Maps and indexes every segment of a log directory. Only possible while
+     * not playing.
+     */
+    bool open(const fs::path& dir);
+    bool is_open() const { return !segments.empty(); }
+
+    /*
+     * Plays from the current position into ring, which must have no other
+     * producer while playing. The replay thread idles at the end of the log
+     * until seek() or stop().
+     */
+    bool start(std::shared_ptr<SpscRing<char>> ring);
+    void stop();
+    bool is_running() const { return player.joinable(); }
+
+    /*
+     * May be called from any thread. The speed is clamped to
+     * [MIN_SPEED, MAX_SPEED] unless it's UNPACED.
+     */
+    void set_speed(double);
+    double get_speed() const { return speed.load(); }
+    void seek(std::chrono::nanoseconds);
+
+    std::chrono::nanoseconds get_position() const
+    {
+        return std::chrono::nanoseconds(position_ns.load(std::memory_order_relaxed));
+    }
+    std::chrono::nanoseconds get_duration() const { return std::chrono::nanoseconds(duration_ns); }
+    bool is_finished() const { return finished.load(); }
+
+    std::uint64_t get_bytes_replayed() const { return bytes_replayed.load(std::memory_order_relaxed); }
+private:
+    static constexpr std::size_t INDEX_STRIDE = 256;
+    static constexpr std::chrono::seconds MAX_GAP{10};
+
+    // Longest the replay thread sleeps before checking for seeks, speed
+    // changes and stop requests.
+    static constexpr std::chrono::milliseconds MAX_SLEEP{20};
+    // Back-off while the ring is full.
+    static constexpr std::chrono::microseconds FULL_RING_WAIT{100};
+
+    struct Segment
+    {
+        MappedFile file;
+        std::size_t valid_len;
+        std::int64_t time_offset_ns;  // Added to record times to get log times.
+    };
+
+    struct Cursor
+    {
+        std::size_t segment;
+        std::size_t offset;
+    };
+
+    struct IndexEntry
+    {
+        std::int64_t log_time_ns;
+        Cursor cursor;
+    };
+
+    // The next raw record at or after the cursor, moving the cursor to it.
+    // Returns false at the end of the log.
+    bool next_raw(Cursor&, FlightRecord&) const;
+    Cursor find(std::int64_t log_time_ns) const;
+
+    void run();
+    bool write_all(Span<const char>);
+
+    std::vector<Segment> segments{};
+    std::vector<IndexEntry> index{};
+    std::int64_t duration_ns = 0;
+
+    std::shared_ptr<SpscRing<char>> ring;
+    Cursor cursor{};
+
+    std::thread player;
+    std::atomic<bool> stop_requested = false;
+    std::atomic<double> speed = 1.0;
+    std::atomic<std::int64_t> seek_request = -1;
+    std::atomic<std::int64_t> position_ns = 0;
+    std::atomic<bool> finished = false;
+    std::atomic<std::uint64_t> bytes_replayed{};
+};
+
+FlightReplay::~FlightReplay()
+{
+    stop();
+}
+
+bool FlightReplay::open(const fs::path& dir)
+{
+    if (is_running())
+    {
+        logger.log(LogLevel::error, "FlightReplay::open: Cannot open a log while playing\n");
+        return false;
+    }
+
+    segments.clear();
+    index.clear();
+    duration_ns = 0;
+    cursor = {};
+    position_ns.store(0);
+    finished.store(false);
+
+    std::size_t raw_records = 0;
+    bool have_time = false;
+    std::int64_t log_start_ns = 0;
+    std::int64_t last_log_ns = 0;
+    for (auto& path : list_flight_segments(dir))
+    {
+        Segment segment{};
+        if (!segment.file.open(path))
+            return false;
+
+        Span<const char> data = segment.file.data();
+        bool first_record = true;
+        std::size_t segment_index = segments.size();
+        segment.valid_len = for_each_flight_record(data, [&](const FlightRecord& record)
+        {
+            if (record.type != static_cast<std::uint16_t>(FlightRecordType::Raw))
+                return;
+
+            if (first_record)
+            {
+                std::int64_t gap = record.time_ns - last_log_ns;
+                if (!have_time)
+                    log_start_ns = record.time_ns;
+                else if (gap < 0 || gap > std::chrono::nanoseconds(MAX_GAP).count())
+                    segment.time_offset_ns = last_log_ns - record.time_ns;
+                have_time = true;
+                first_record = false;
+            }
+
+            // Within a segment, times never go backwards.
+            last_log_ns = std::max(last_log_ns, record.time_ns + segment.time_offset_ns);
+            if (raw_records++ % INDEX_STRIDE == 0)
+            {
+                std::size_t offset = static_cast<std::size_t>(
+                    record.payload.data() - data.data()) - FLIGHT_RECORD_HEADER_LEN;
+                index.push_back({last_log_ns - log_start_ns, {segment_index, offset}});
+            }
+        });
+        if (segment.valid_len < data.size())
+            logger.log(LogLevel::warning, "FlightReplay::open: Ignoring ",
+                data.size() - segment.valid_len, " invalid bytes at the end of ", path, '\n');
+
+        segment.time_offset_ns -= log_start_ns;
+        segments.push_back(std::move(segment));
+    }
+
+    if (!raw_records)
+    {
+        logger.log(LogLevel::error, "FlightReplay::open: No raw telemetry in ", dir, '\n');
+        segments.clear();
+        index.clear();
+        return false;
+    }
+
+    duration_ns = last_log_ns - log_start_ns;
+    logger.log(LogLevel::info, "Opened flight log ", dir, ": ", segments.size(),
+        " segments, ", raw_records, " raw records, ", duration_ns / 1e9, " s\n");
+    return true;
+}
+
+bool FlightReplay::next_raw(Cursor& c, FlightRecord& record) const
+{
+    for (; c.segment < segments.size(); c = {c.segment + 1, FLIGHT_SEGMENT_HEADER_LEN})
+    {
+        const Segment& segment = segments[c.segment];
+        c.offset = std::max(c.offset, FLIGHT_SEGMENT_HEADER_LEN);
+        while (c.offset < segment.valid_len)
+        {
+            // Records were validated by open().
+            auto p = reinterpret_cast<const std::uint8_t*>(segment.file.data().data() + c.offset);
+            std::size_t payload_len = get_le32(p);
+            if (get_le16(p + 4) == static_cast<std::uint16_t>(FlightRecordType::Raw))
+            {
+                record.type = get_le16(p + 4);
+                record.time_ns = static_cast<std::int64_t>(get_le64(p + 8)) + segment.time_offset_ns;
+                record.payload = segment.file.data().subspan(
+                    c.offset + FLIGHT_RECORD_HEADER_LEN, payload_len);
+                return true;
+            }
+            c.offset += FLIGHT_RECORD_HEADER_LEN + payload_len + FLIGHT_RECORD_CRC_LEN;
+        }
+    }
+    return false;
+}
+
+/*
+ * First raw record at or after the given log time.
+ */
+FlightReplay::Cursor FlightReplay::find(std::int64_t log_time_ns) const
+{
+    auto it = std::upper_bound(index.begin(), index.end(), log_time_ns,
+        [](std::int64_t t, const IndexEntry& e) { return t < e.log_time_ns; });
+    Cursor c = it == index.begin() ? Cursor{0, 0} : std::prev(it)->cursor;
+
+    FlightRecord record;
+    while (next_raw(c, record) && record.time_ns < log_time_ns)
+        c.offset += FLIGHT_RECORD_HEADER_LEN + record.payload.size() + FLIGHT_RECORD_CRC_LEN;
+    return c;
+}
+
+bool FlightReplay::start(std::shared_ptr<SpscRing<char>> ring_)
+{
+    stop();
+    if (!is_open() || !ring_)
+    {
+        logger.log(LogLevel::error, "FlightReplay::start: No log or ring\n");
+        return false;
+    }
+
+    ring = ring_;
+    stop_requested.store(false);
+    player = std::thread(&FlightReplay::run, this);
+    return true;
+}
+
+void FlightReplay::stop()
+{
+    if (!player.joinable())
+        return;
+
+    stop_requested.store(true);
+    player.join();
+}
+
+void FlightReplay::set_speed(double s)
+{
+    speed.store(s == UNPACED ? UNPACED : std::clamp(s, MIN_SPEED, MAX_SPEED));
+}
+
+void FlightReplay::seek(std::chrono::nanoseconds t)
+{
+    seek_request.store(std::clamp<std::int64_t>(t.count(), 0, duration_ns));
+    finished.store(false);
+}
+
+/*
+ * Replay thread. Pacing is anchored at a (wall time, log time) pair, which is
+ * reset whenever the speed changes or playback jumps, so changes take effect
+ * from the current position.
+ */
+void FlightReplay::run()
+{
+    using clock = std::chrono::steady_clock;
+    using std::chrono::nanoseconds;
+
+    bool anchored = false;
+    clock::time_point anchor_wall{};
+    std::int64_t anchor_log_ns = 0;
+    double anchor_speed = 0.0;
+
+    clock::time_point t0 = clock::now();
+    std::uint64_t bytes_at_t0 = bytes_replayed.load();
+
+    while (!stop_requested.load())
+    {
+        std::int64_t target = seek_request.exchange(-1);
+        if (target >= 0)
+        {
+            cursor = find(target);
+            position_ns.store(target);
+            finished.store(false);
+            anchored = false;
+            t0 = clock::now();
+            bytes_at_t0 = bytes_replayed.load();
+        }
+
+        FlightRecord record;
+        if (!next_raw(cursor, record))
+        {
+            if (!finished.exchange(true))
+            {
+                std::chrono::duration<double> elapsed = clock::now() - t0;
+                double bytes = static_cast<double>(bytes_replayed.load() - bytes_at_t0);
+                logger.log(LogLevel::info, "Replay finished: ", bytes / 1e6,
+                    " MB in ", elapsed.count(), " s, ", bytes / 1e6 / elapsed.count(),
+                    " MB/s\n");
+            }
+            std::this_thread::sleep_for(MAX_SLEEP);
+            continue;
+        }
+
+        double s = speed.load();
+        if (!anchored || s != anchor_speed)
+        {
+            anchor_wall = clock::now();
+            anchor_log_ns = record.time_ns;
+            anchor_speed = s;
+            anchored = true;
+        }
+
+        if (s != UNPACED)
+        {
+            auto due = anchor_wall + std::chrono::duration_cast<clock::duration>(
+                nanoseconds(static_cast<std::int64_t>((record.time_ns - anchor_log_ns) / s)));
+            auto now = clock::now();
+            if (due > now)
+            {
+                std::this_thread::sleep_for(std::min<clock::duration>(due - now, MAX_SLEEP));
+                continue;
+            }
+        }
+
+        if (!write_all(record.payload))
+            continue;
+        position_ns.store(record.time_ns, std::memory_order_relaxed);
+        cursor.offset += FLIGHT_RECORD_HEADER_LEN + record.payload.size() + FLIGHT_RECORD_CRC_LEN;
+    }
+}
+
+/*
+ * Only writes what fits, since the ring counts anything beyond that as
+ * dropped. Returns false if a stop interrupted the write. Seeks wait for the
+ * whole record to be written, so the pipeline never sees the front of a
+ * record without the rest of it.
+ */
+bool FlightReplay::write_all(Span<const char> bytes)
+{
+    while (!bytes.empty())
+    {
+        std::size_t room = ring->capacity() - ring->size();
+        std::size_t n = ring->write(bytes.first(std::min(room, bytes.size())));
+        bytes = bytes.subspan(n);
+        bytes_replayed.fetch_add(n, std::memory_order_relaxed);
+        if (bytes.empty())
+            break;
+        if (stop_requested.load())
+            return false;
+        std::this_thread::sleep_for(FULL_RING_WAIT);
+    }
+    return true;
+}
+
+#endif /* FLIGHT_REPLAY_HPP */
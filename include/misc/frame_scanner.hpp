@@ -0,0 +1,335 @@
+#ifndef FRAME_SCANNER_HPP
+#define FRAME_SCANNER_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "span.hpp"
+
+/*
+ * A packet found by FrameScanner, located by offset into the scanned chunk.
+ * length includes the start symbol but not the stop symbol.
+ */
+struct FrameCandidate
+{
+    std::size_t offset;
+    std::size_t length;
+};
+
+/*
+ * Framing state which decides how the rest of the stream is framed: the
+ * partial packet carried into the next chunk, if any, and how much of it lies
+ * in a region claimed by a rejected packet. Two scanners in the same state
+ * frame any following bytes identically.
+ */
+struct FrameScannerState
+{
+    std::size_t carried_len = 0;
+    std::size_t rejected_len = 0;
+
+    bool operator==(const FrameScannerState& rhs) const
+    {
+        return carried_len == rhs.carried_len && rejected_len == rhs.rejected_len;
+    }
+    bool operator!=(const FrameScannerState& rhs) const { return !(*this == rhs); }
+};
+
+/*
+ * Bulk framer for start/stop delimited packets. Instead of inspecting one byte
+ * at a time, each chunk is first turned into two bitmaps marking every start
+ * and stop symbol, 64 bytes per word, using SIMD compares (AVX2 when compiled
+ * with -mavx2, otherwise SSE2, with a scalar fallback for other targets). The
+ * framing state machine then jumps from delimiter to delimiter with
+ * count-trailing-zeros, so the bytes inside a packet are never visited.
+ *
+ * A packet begins at a start symbol and must end in a stop symbol exactly
+ * packet_len bytes later. Packets which end early or run long are rejected,
+ * and the search for the next start symbol resumes right after the rejected
+ * one's start symbol, so a valid packet hidden inside the rejected region is
+ * still found.
+ *
+ * Complete packets inside a chunk are reported as candidates pointing into
+ * the chunk, so they can be decoded in place. A packet split across chunks is
+ * reassembled internally and reported through carried() instead; it always
+ * precedes the chunk's candidates.
+ */
+class FrameScanner
+{
+public:
+    FrameScanner(char start_symbol_, char stop_symbol_, std::size_t packet_len_) :
+        start_symbol(start_symbol_),
+        stop_symbol(stop_symbol_),
+        packet_len(packet_len_)
+    {
+        carry.reserve(packet_len);
+        carried_packet.reserve(packet_len);
+    }
+
+    void scan(Span<const char> chunk, std::vector<FrameCandidate>& out);
+
+    bool has_carried() const { return carry_ready; }
+    std::string_view carried() const { return carried_packet; }
+
+    /*
+     * Link quality counters. Skipped bytes are those not part of any accepted
+     * packet or its stop symbol. A packet counts as recovered if it began
+     * inside a region claimed by a rejected packet, i.e. it would have been
+     * lost without rescanning.
+     */
+    std::size_t get_bytes_skipped() const
+    {
+        return stream_pos - packets_accepted * (packet_len + 1) -
+            (in_packet ? carry.size() : 0);
+    }
+    std::size_t get_packets_accepted() const { return packets_accepted; }
+    std::size_t get_packets_recovered() const { return packets_recovered; }
+    std::size_t get_packets_rejected() const { return packets_rejected; }
+
+    FrameScannerState get_state() const
+    {
+        if (!in_packet)
+            return {};
+        std::size_t rejected = rejected_until > carry_begin ? rejected_until - carry_begin : 0;
+        return {carry.size(), std::min(rejected, carry.size())};
+    }
+private:
+    const char start_symbol;
+    const char stop_symbol;
+    const std::size_t packet_len;
+
+    std::vector<std::uint64_t> start_bits{};
+    std::vector<std::uint64_t> stop_bits{};
+
+    // Partial packet carried over from previous chunks, and the last such
+    // packet to be completed (a new partial packet may start in the same
+    // chunk).
+    bool in_packet = false;
+    bool carry_ready = false;
+    std::string carry{};
+    std::string carried_packet{};
+
+    // Stream positions, counted in bytes since the scanner was created.
+    std::size_t stream_pos{};
+    std::size_t carry_begin{};
+    std::size_t rejected_until{};
+
+    std::size_t packets_accepted{};
+    std::size_t packets_recovered{};
+    std::size_t packets_rejected{};
+
+    void build_masks(Span<const char>);
+    static std::size_t next_set(const std::vector<std::uint64_t>&,
+                                std::size_t from, std::size_t limit);
+};
+
+/*
+ * Marks every start and stop symbol in the chunk, one bit per byte.
+ */
+void FrameScanner::build_masks(Span<const char> chunk)
+{
+    const std::size_t n = chunk.size();
+    const std::size_t words = (n + 63) / 64;
+    start_bits.resize(words);
+    stop_bits.resize(words);
+
+    const char* p = chunk.data();
+    std::size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i start_v = _mm256_set1_epi8(start_symbol);
+    const __m256i stop_v = _mm256_set1_epi8(stop_symbol);
+    for (; i + 64 <= n; i += 64)
+    {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 32));
+        std::uint64_t s =
+            static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, start_v))) |
+            static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, start_v)))) << 32;
+        std::uint64_t e =
+            static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, stop_v))) |
+            static_cast<std::uint64_t>(static_cast<std::uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, stop_v)))) << 32;
+        start_bits[i / 64] = s;
+        stop_bits[i / 64] = e;
+    }
+#elif defined(__SSE2__)
+    const __m128i start_v = _mm_set1_epi8(start_symbol);
+    const __m128i stop_v = _mm_set1_epi8(stop_symbol);
+    for (; i + 64 <= n; i += 64)
+    {
+        std::uint64_t s = 0;
+        std::uint64_t e = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 16 * k));
+            s |= static_cast<std::uint64_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(v, start_v))) << (16 * k);
+            e |= static_cast<std::uint64_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(v, stop_v))) << (16 * k);
+        }
+        start_bits[i / 64] = s;
+        stop_bits[i / 64] = e;
+    }
+#endif
+
+    // Tail, or the whole chunk without SIMD.
+    for (; i < n; i += 64)
+    {
+        std::uint64_t s = 0;
+        std::uint64_t e = 0;
+        const std::size_t len = std::min<std::size_t>(64, n - i);
+        for (std::size_t j = 0; j < len; j++)
+        {
+            s |= std::uint64_t(p[i + j] == start_symbol) << j;
+            e |= std::uint64_t(p[i + j] == stop_symbol) << j;
+        }
+        start_bits[i / 64] = s;
+        stop_bits[i / 64] = e;
+    }
+}
+
+/*
+ * Returns the position of the first set bit in [from, limit), or limit if
+ * there is none.
+ */
+std::size_t FrameScanner::next_set(const std::vector<std::uint64_t>& bits,
+                                   std::size_t from, std::size_t limit)
+{
+    if (from >= limit)
+        return limit;
+
+    std::size_t word = from / 64;
+    std::uint64_t w = bits[word] & (~std::uint64_t(0) << (from % 64));
+    const std::size_t last_word = (limit - 1) / 64;
+
+    while (!w)
+    {
+        if (++word > last_word)
+            return limit;
+        w = bits[word];
+    }
+
+    std::size_t pos = word * 64 + __builtin_ctzll(w);
+    return pos < limit ? pos : limit;
+}
+
+void FrameScanner::scan(Span<const char> chunk, std::vector<FrameCandidate>& out)
+{
+    out.clear();
+    carry_ready = false;
+
+    const std::size_t n = chunk.size();
+    build_masks(chunk);
+
+    std::size_t pos = 0;
+    while (pos < n)
+    {
+        std::size_t begin;
+        std::size_t collected;
+        if (in_packet)
+        {
+            // Continuing a packet from the previous chunk.
+            begin = 0;
+            collected = carry.size();
+        }
+        else
+        {
+            begin = next_set(start_bits, pos, n);
+            if (begin == n)
+                break;
+            pos = begin + 1;
+            collected = 1;
+        }
+
+        // The stop symbol has to be exactly packet_len bytes after the start.
+        // Any earlier stop ends the packet short.
+        const std::size_t expected = pos + (packet_len - collected);
+        const std::size_t limit = std::min(expected + 1, n);
+        const std::size_t stop = next_set(stop_bits, pos, limit);
+
+        if (stop == limit && limit == n && n <= expected)
+        {
+            // Ran out of data before the packet could end. Carry it over.
+            if (in_packet)
+            {
+                carry.append(chunk.data(), n);
+            }
+            else
+            {
+                carry.assign(chunk.data() + begin, n - begin);
+                carry_begin = stream_pos + begin;
+            }
+            in_packet = true;
+            break;
+        }
+
+        if (stop == expected)
+        {
+            std::size_t packet_begin = in_packet ? carry_begin : stream_pos + begin;
+            if (packet_begin < rejected_until)
+                packets_recovered++;
+            packets_accepted++;
+
+            if (in_packet)
+            {
+                carry.append(chunk.data(), stop);
+                carried_packet.swap(carry);
+                carry_ready = true;
+            }
+            else
+            {
+                out.push_back(FrameCandidate{begin, packet_len});
+            }
+
+            in_packet = false;
+            pos = stop + 1;
+            continue;
+        }
+
+        /*
+         * Rejected, either because the stop symbol came early or because it
+         * wasn't where it belongs. The rejected packet may have swallowed the
+         * start of a valid one (e.g. a corrupted stop symbol merges two
+         * packets), so rescan everything after its start symbol instead of
+         * resuming after the region it claimed.
+         */
+        packets_rejected++;
+        rejected_until = std::max(rejected_until,
+            stream_pos + std::min(stop, expected) + 1);
+
+        if (in_packet)
+        {
+            // The rejected packet began in an earlier chunk. Rescan the part
+            // still held in the carry buffer first, then this chunk.
+            std::size_t next = carry.find(start_symbol, 1);
+            if (next != std::string::npos)
+            {
+                carry.erase(0, next);
+                carry_begin += next;
+            }
+            else
+            {
+                in_packet = false;
+            }
+            pos = 0;
+            continue;
+        }
+
+        pos = begin + 1;
+    }
+
+    stream_pos += n;
+}
+
+#endif /* FRAME_SCANNER_HPP */
@@ -0,0 +1,227 @@
+#ifndef FRAME_SCHEDULER_HPP
+#define FRAME_SCHEDULER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+#include "latency_histogram.hpp"
+#include "logger.hpp"
+
+/*
+ * How visible the window is, which bounds how often it's worth drawing.
+ */
+enum class WindowActivity
+{
+    Focused,
+    Background,
+    Minimized,
+};
+
+struct FrameSchedulerConfig
+{
+    // Frame rate cap while focused. 0 leaves pacing to the swap, i.e. the
+    // display's refresh rate with vsync and uncapped without.
+    double target_fps = 0.0;
+
+    // Frame rate cap while the window is visible but unfocused.
+    double background_fps = 30.0;
+
+    // How often to look for changes which don't wake the main loop with a
+    // window event, such as new telemetry, while there's a source of them.
+    std::chrono::milliseconds poll_interval{16};
+
+    // An unchanged scene is still redrawn this often, so text which changes
+    // on its own (FPS, latency plots, port lists) doesn't go stale.
+    std::chrono::milliseconds idle_refresh{1000};
+
+    // Frames drawn after the last change. ImGui reacts to some input a frame
+    // late, e.g. hover highlights and windows sizing to their contents.
+    unsigned settle_frames = 3;
+
+    // Draw every frame the cap allows, whether anything changed or not.
+    bool render_on_demand = true;
+};
+
+/*
+ * Decides when the main loop draws. A frame is drawn when something visible
+ * changed (the caller says so with mark_dirty()) and the frame rate cap for
+ * the window's activity allows it, or when the idle refresh is due. Nothing is
+ * drawn while minimized. Between frames, the main loop blocks on window events
+ * for time_to_wait(), so an unchanged scene costs a wakeup per poll interval
+ * at most rather than a full frame per vblank.
+ *
+ * Frame deadlines advance by whole periods from the previous deadline rather
+ * than from when the frame was actually drawn, so waking up late from the
+ * event wait doesn't lower the average frame rate.
+ *
+ * Also measures the distribution of frame intervals and of the time spent
+ * drawing and swapping each frame. An interval is only recorded when the loop
+ * wanted a frame for the whole of it, so the gaps of an idle scene don't show
+ * up as dropped frames.
+ */
+class FrameScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit FrameScheduler(const FrameSchedulerConfig& cfg_) :
+        cfg(cfg_),
+        period(fps_period(cfg_.target_fps)),
+        background_period(std::max(period, fps_period(cfg_.background_fps)))
+    {
+    }
+
+    /*
+     * Something visible changed, so draw it and the settle frames after it.
+     */
+    void mark_dirty() { pending_frames = 1 + cfg.settle_frames; }
+
+    bool should_render(WindowActivity, Clock::time_point now);
+
+    /*
+     * Records a frame drawn from start until its swap returned at end. start
+     * must be the time passed to the should_render() call which allowed it.
+     */
+    void frame_rendered(Clock::time_point start, Clock::time_point end);
+
+    /*
+     * How long the main loop may block on window events before the next
+     * frame or poll is due. polling is whether something other than window
+     * events can change the scene, e.g. a running telemetry pipeline.
+     */
+    Clock::duration time_to_wait(WindowActivity, Clock::time_point now, bool polling) const;
+
+    const LatencyHistogram& get_frame_intervals() const { return frame_intervals; }
+    const LatencyHistogram& get_frame_costs() const { return frame_costs; }
+    std::uint64_t get_frames_rendered() const { return frames_rendered; }
+    std::uint64_t get_frames_skipped() const { return frames_skipped; }
+
+    void log_summary() const;
+private:
+    const FrameSchedulerConfig cfg;
+    const Clock::duration period;
+    const Clock::duration background_period;
+
+    // The first frame is always drawn.
+    unsigned pending_frames = 1;
+    bool have_frame = false;
+    bool idle_since_frame = true;
+    WindowActivity frame_activity = WindowActivity::Focused;
+    Clock::time_point last_frame{};
+    Clock::time_point next_due{};
+
+    std::uint64_t frames_rendered{};
+    std::uint64_t frames_skipped{};
+    LatencyHistogram frame_intervals{};
+    LatencyHistogram frame_costs{};
+
+    static Clock::duration fps_period(double fps)
+    {
+        if (!(fps > 0.0))
+            return Clock::duration::zero();
+        return std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / fps));
+    }
+
+    bool wants_frame(Clock::time_point now) const
+    {
+        return !cfg.render_on_demand || pending_frames > 0 || !have_frame ||
+            now - last_frame >= cfg.idle_refresh;
+    }
+
+    /*
+     * Frames are paced at the rate of the activity they were drawn in. A
+     * window regaining focus goes back to the focused rate straight away.
+     */
+    Clock::time_point due(WindowActivity activity) const
+    {
+        if (activity == WindowActivity::Focused && have_frame)
+            return std::min(next_due, last_frame + period);
+        return next_due;
+    }
+};
+
+bool FrameScheduler::should_render(WindowActivity activity, Clock::time_point now)
+{
+    if (activity == WindowActivity::Minimized || !wants_frame(now))
+    {
+        idle_since_frame = true;
+        frames_skipped++;
+        return false;
+    }
+    if (now < due(activity))
+    {
+        frames_skipped++;
+        return false;
+    }
+    frame_activity = activity;
+    return true;
+}
+
+void FrameScheduler::frame_rendered(Clock::time_point start, Clock::time_point end)
+{
+    if (have_frame && !idle_since_frame)
+        frame_intervals.record(start - last_frame);
+    frame_costs.record(end - start);
+
+    // More than a period behind means the frame was held back by something
+    // other than the cap, so there's no lost time to catch up on.
+    auto p = frame_activity == WindowActivity::Background ? background_period : period;
+    next_due += p;
+    if (next_due <= start)
+        next_due = start + p;
+
+    last_frame = start;
+    have_frame = true;
+    if (pending_frames > 0)
+        pending_frames--;
+    // Unless another frame is already wanted, the loop goes idle until
+    // something changes.
+    idle_since_frame = cfg.render_on_demand && pending_frames == 0;
+    frames_rendered++;
+}
+
+FrameScheduler::Clock::duration FrameScheduler::time_to_wait(
+    WindowActivity activity, Clock::time_point now, bool polling) const
+{
+    // Restoring the window is an event, so a minimized window only needs to
+    // wake up for the idle refresh.
+    if (activity == WindowActivity::Minimized)
+        return cfg.idle_refresh;
+
+    Clock::time_point wake;
+    if (wants_frame(now))
+    {
+        wake = due(activity);
+    }
+    else
+    {
+        wake = last_frame + cfg.idle_refresh;
+        if (polling)
+        {
+            auto poll = std::max<Clock::duration>(cfg.poll_interval,
+                activity == WindowActivity::Background ? background_period : period);
+            wake = std::min(wake, now + poll);
+        }
+    }
+    return std::max(wake - now, Clock::duration::zero());
+}
+
+void FrameScheduler::log_summary() const
+{
+    auto ms = [](std::chrono::nanoseconds d) { return d.count() / 1e6; };
+    auto interval = frame_intervals.summarize();
+    auto cost = frame_costs.summarize();
+
+    logger.log(LogLevel::info, "Frames: ", frames_rendered, " drawn, ",
+        frames_skipped, " skipped\n");
+    logger.log(LogLevel::info, "Frame interval (ms): p50 ", ms(interval.p50),
+        ", p95 ", ms(interval.p95), ", p99 ", ms(interval.p99),
+        ", max ", ms(interval.max), '\n');
+    logger.log(LogLevel::info, "Draw and swap (ms): p50 ", ms(cost.p50),
+        ", p95 ", ms(cost.p95), ", p99 ", ms(cost.p99),
+        ", max ", ms(cost.max), '\n');
+}
+
+#endif /* FRAME_SCHEDULER_HPP */
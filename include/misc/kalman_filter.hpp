@@ -0,0 +1,82 @@
+#ifndef KALMAN_FILTER_HPP
+#define KALMAN_FILTER_HPP
+
+#include <cstddef>
+
+#include "small_matrix.hpp"
+
+/*
+ * Covariance bookkeeping of an error-state extended Kalman filter with N
+ * states. The model owns the nominal state and propagates it itself, since
+ * that's the nonlinear part; the filter tracks the covariance of the error
+ * around it, linearized by the Jacobians the model passes in, and turns
+ * measurements into a correction for the model to apply.
+ */
+template <std::size_t N>
+class ExtendedKalmanFilter
+{
+public:
+    using StateVector = Matrix<N, 1>;
+    using StateMatrix = Matrix<N, N>;
+
+    explicit ExtendedKalmanFilter(const StateMatrix& P0) : P(P0) {}
+
+    /*
+     * P = F * P * F^T + Q, for state transition Jacobian F and process noise
+     * Q accumulated over the step.
+     */
+    void predict(const StateMatrix& F, const StateMatrix& Q)
+    {
+        P = F * P * F.transpose() + Q;
+        symmetrize();
+    }
+
+    /*
+     * Fuses an M-dimensional measurement, given its innovation y (measured
+     * minus predicted), Jacobian H and noise covariance R, and stores the
+     * resulting error estimate in dx. The covariance is updated in Joseph
+     * form, P = (I - KH) P (I - KH)^T + K R K^T, which stays symmetric
+     * positive definite in float precision where the short form
+     * (I - KH) P doesn't. Returns false, leaving P untouched, if the
+     * innovation covariance is singular.
+     */
+    template <std::size_t M>
+    bool update(const Matrix<M, 1>& y, const Matrix<M, N>& H,
+                const Matrix<M, M>& R, StateVector& dx);
+
+    const StateMatrix& get_covariance() const { return P; }
+private:
+    void symmetrize()
+    {
+        for (std::size_t r = 0; r < N; r++)
+            for (std::size_t c = r + 1; c < N; c++)
+            {
+                float v = 0.5f * (P(r, c) + P(c, r));
+                P(r, c) = v;
+                P(c, r) = v;
+            }
+    }
+
+    StateMatrix P;
+};
+
+template <std::size_t N>
+template <std::size_t M>
+bool ExtendedKalmanFilter<N>::update(const Matrix<M, 1>& y, const Matrix<M, N>& H,
+                                     const Matrix<M, M>& R, StateVector& dx)
+{
+    Matrix<N, M> PHt = P * H.transpose();
+    Matrix<M, M> S_inv;
+    if (!spd_inverse(H * PHt + R, S_inv))
+        return false;
+
+    Matrix<N, M> K = PHt * S_inv;
+    dx = K * y;
+
+    StateMatrix IKH = StateMatrix::identity() - K * H;
+    P = IKH * P * IKH.transpose() + K * R * K.transpose();
+    symmetrize();
+    return true;
+}
+
+#endif /* KALMAN_FILTER_HPP */
@@ -0,0 +1,222 @@
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+#include "logger.hpp"
+
+namespace fs = std::filesystem;
+
+struct LatencySummary
+{
+    std::uint64_t count{};
+    std::chrono::nanoseconds p50{};
+    std::chrono::nanoseconds p95{};
+    std::chrono::nanoseconds p99{};
+    std::chrono::nanoseconds max{};
+};
+
+/*
+ * Histogram of durations with logarithmic buckets, like HdrHistogram: each
+ * power of two is split into SUB_BUCKETS linear buckets, so any recorded value
+ * is known to within about 3% from nanoseconds up to minutes, in fixed memory.
+ * Values past the top bucket are counted in it.
+ *
+ * Only one thread may record, as a bucket increment is a relaxed load and
+ * store rather than a read-modify-write. Any thread may read; a reader racing
+ * the writer sees counts that are at most a sample or two behind.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr std::uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT = 40;  // 2^41 ns is about 37 minutes.
+    static constexpr std::size_t NUM_BUCKETS =
+        SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    void record(std::chrono::nanoseconds);
+
+    LatencySummary summarize() const;
+    std::uint64_t get_count(std::size_t bucket) const
+    {
+        return counts[bucket].load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Range of values counted in a bucket, inclusive.
+     */
+    static std::uint64_t bucket_lowest(std::size_t bucket);
+    static std::uint64_t bucket_highest(std::size_t bucket);
+private:
+    static std::size_t bucket_of(std::uint64_t ns);
+
+    std::array<std::atomic<std::uint64_t>, NUM_BUCKETS> counts{};
+    std::atomic<std::uint64_t> total{};
+    std::atomic<std::uint64_t> max_ns{};
+};
+
+std::size_t LatencyHistogram::bucket_of(std::uint64_t ns)
+{
+    if (ns < SUB_BUCKETS)
+        return static_cast<std::size_t>(ns);
+
+    unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(ns));
+    if (exponent > MAX_EXPONENT)
+        return NUM_BUCKETS - 1;
+
+    // The SUB_BUCKET_BITS bits below the leading one pick the linear bucket.
+    unsigned shift = exponent - SUB_BUCKET_BITS;
+    std::uint64_t sub = (ns >> shift) & (SUB_BUCKETS - 1);
+    return static_cast<std::size_t>(SUB_BUCKETS + shift * SUB_BUCKETS + sub);
+}
+
+std::uint64_t LatencyHistogram::bucket_lowest(std::size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    std::uint64_t shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+    std::uint64_t sub = (bucket - SUB_BUCKETS) % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub) << shift;
+}
+
+std::uint64_t LatencyHistogram::bucket_highest(std::size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket;
+
+    std::uint64_t shift = (bucket - SUB_BUCKETS) / SUB_BUCKETS;
+    return bucket_lowest(bucket) + (std::uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds d)
+{
+    std::uint64_t ns = d.count() > 0 ? static_cast<std::uint64_t>(d.count()) : 0;
+    auto& c = counts[bucket_of(ns)];
+    c.store(c.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    total.store(total.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (ns > max_ns.load(std::memory_order_relaxed))
+        max_ns.store(ns, std::memory_order_relaxed);
+}
+
+/*
+ * Percentiles are reported as the highest value of their bucket, so they never
+ * understate the latency.
+ */
+LatencySummary LatencyHistogram::summarize() const
+{
+    LatencySummary s{};
+    s.count = total.load(std::memory_order_relaxed);
+    s.max = std::chrono::nanoseconds(max_ns.load(std::memory_order_relaxed));
+    if (!s.count)
+        return s;
+
+    struct Target { double fraction; std::chrono::nanoseconds* out; };
+    Target targets[] = {{0.50, &s.p50}, {0.95, &s.p95}, {0.99, &s.p99}};
+    std::size_t next_target = 0;
+
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < NUM_BUCKETS && next_target < std::size(targets); b++)
+    {
+        seen += get_count(b);
+        while (next_target < std::size(targets) &&
+               seen >= targets[next_target].fraction * s.count)
+        {
+            *targets[next_target].out = std::min(s.max,
+                std::chrono::nanoseconds(bucket_highest(b)));
+            next_target++;
+        }
+    }
+    return s;
+}
+
+/*
+ * Where the time goes between a byte arriving on the serial port and the
+ * frame showing it being presented:
+ *
+ *   SerialToPacket:  serial read returned -> packet framed
+ *   PacketToFilter:  packet framed -> filtered sample published
+ *   FilterToDraw:    newest published sample -> frame's draw calls submitted
+ *   DrawToSwap:      draw calls submitted -> glfwSwapBuffers returned
+ *   SerialToSwap:    serial read of the newest sample -> glfwSwapBuffers
+ *                    returned, i.e. how stale the pose on screen is
+ *
+ * The first two are recorded per packet by the telemetry thread, the rest per
+ * frame by the render thread.
+ */
+enum class LatencyStage
+{
+    SerialToPacket,
+    PacketToFilter,
+    FilterToDraw,
+    DrawToSwap,
+    SerialToSwap,
+};
+
+class LatencyMonitor
+{
+public:
+    static constexpr std::size_t NUM_STAGES = 5;
+    static constexpr std::array<const char*, NUM_STAGES> STAGE_NAMES = {
+        "serial -> packet",
+        "packet -> filter",
+        "filter -> draw",
+        "draw -> swap",
+        "serial -> swap",
+    };
+
+    void record(LatencyStage stage, std::chrono::steady_clock::duration d)
+    {
+        histograms[static_cast<std::size_t>(stage)].record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(d));
+    }
+
+    const LatencyHistogram& get(std::size_t stage) const { return histograms[stage]; }
+
+    /*
+     * Writes a summary and the non-empty buckets of every stage.
+     */
+    bool dump(const fs::path&) const;
+private:
+    std::array<LatencyHistogram, NUM_STAGES> histograms{};
+};
+
+bool LatencyMonitor::dump(const fs::path& path) const
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        logger.log(LogLevel::error, "LatencyMonitor::dump: Cannot open ", path, '\n');
+        return false;
+    }
+
+    auto us = [](std::chrono::nanoseconds d) { return d.count() / 1000.0; };
+    for (std::size_t i = 0; i < NUM_STAGES; i++)
+    {
+        auto s = histograms[i].summarize();
+        file << "# " << STAGE_NAMES[i] << ": count " << s.count
+             << ", p50 " << us(s.p50) << " us, p95 " << us(s.p95)
+             << " us, p99 " << us(s.p99) << " us, max " << us(s.max) << " us\n";
+        file << "# lowest_ns highest_ns count\n";
+        for (std::size_t b = 0; b < LatencyHistogram::NUM_BUCKETS; b++)
+        {
+            if (auto c = histograms[i].get_count(b))
+                file << LatencyHistogram::bucket_lowest(b) << ' '
+                     << LatencyHistogram::bucket_highest(b) << ' ' << c << '\n';
+        }
+        file << '\n';
+    }
+
+    logger.log(LogLevel::info, "Wrote latency histograms to ", path, '\n');
+    return static_cast<bool>(file);
+}
+
+#endif /* LATENCY_HISTOGRAM_HPP */
@@ -0,0 +1,84 @@
+#ifndef LATEST_VALUE_HPP
+#define LATEST_VALUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/*
+ * Publishes the latest value of some state from one writer thread to one
+ * reader thread, as a triple buffer. The writer fills its own slot and swaps
+ * it with the shared middle slot; the reader swaps the middle slot with its
+ * own when it holds something newer. Each side performs one atomic exchange
+ * per operation and neither ever waits for the other, however fast the writer
+ * runs. Intermediate values the reader never picked up are overwritten.
+ *
+ * The reader's value stays put between update() calls, so a frame can call
+ * update() once at its start and see one consistent value throughout.
+ */
+template <typename T>
+class LatestValue
+{
+public:
+    explicit LatestValue(const T& initial = T{});
+
+    // Disallow copying and moving.
+    LatestValue(const LatestValue&) = delete;
+    LatestValue& operator=(const LatestValue&) = delete;
+    LatestValue(LatestValue&&) = delete;
+    LatestValue& operator=(LatestValue&&) = delete;
+
+    /*
+     * Writer interface.
+     */
+    void store(const T&);
+
+    /*
+     * Reader interface. update() picks up the newest stored value, if any was
+     * stored since the previous update(), and returns whether it did. read()
+     * returns the value picked up last.
+     */
+    bool update();
+    const T& read() const { return slots[front].value; }
+private:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    // The middle index carries a flag marking a value the reader hasn't seen.
+    static constexpr unsigned INDEX_MASK = 3;
+    static constexpr unsigned FRESH = 4;
+
+    struct alignas(CACHE_LINE_SIZE) Slot
+    {
+        T value;
+    };
+    std::array<Slot, 3> slots;
+
+    alignas(CACHE_LINE_SIZE) unsigned back = 0;        // Writer-owned.
+    alignas(CACHE_LINE_SIZE) std::atomic<unsigned> middle{1};
+    alignas(CACHE_LINE_SIZE) unsigned front = 2;       // Reader-owned.
+};
+
+template <typename T>
+LatestValue<T>::LatestValue(const T& initial) :
+    slots{Slot{initial}, Slot{initial}, Slot{initial}}
+{
+}
+
+template <typename T>
+void LatestValue<T>::store(const T& value)
+{
+    slots[back].value = value;
+    back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+template <typename T>
+bool LatestValue<T>::update()
+{
+    if (!(middle.load(std::memory_order_relaxed) & FRESH))
+        return false;
+
+    front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+}
+
+#endif /* LATEST_VALUE_HPP */
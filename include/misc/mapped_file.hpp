@@ -0,0 +1,102 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "logger.hpp"
+#include "span.hpp"
+
+namespace fs = std::filesystem;
+
+/*
+ * A file mapped read-only into memory.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept :
+        ptr(std::exchange(other.ptr, nullptr)),
+        len(std::exchange(other.len, 0))
+    {}
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        close();
+        ptr = std::exchange(other.ptr, nullptr);
+        len = std::exchange(other.len, 0);
+        return *this;
+    }
+
+    bool open(const fs::path&);
+    void close();
+
+    Span<const char> data() const { return {static_cast<const char*>(ptr), len}; }
+private:
+    void* ptr = nullptr;
+    std::size_t len = 0;
+};
+
+bool MappedFile::open(const fs::path& path)
+{
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        logger.log(LogLevel::error, "MappedFile::open: Cannot open ", path, ": ",
+            std::strerror(errno), '\n');
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        logger.log(LogLevel::error, "MappedFile::open: Cannot stat ", path, ": ",
+            std::strerror(errno), '\n');
+        ::close(fd);
+        return false;
+    }
+
+    // An empty file can't be mapped, but is a valid (empty) mapping.
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    if (size)
+    {
+        void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            logger.log(LogLevel::error, "MappedFile::open: Cannot map ", path, ": ",
+                std::strerror(errno), '\n');
+            ::close(fd);
+            return false;
+        }
+        ::madvise(p, size, MADV_SEQUENTIAL);
+        ptr = p;
+        len = size;
+    }
+
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (ptr)
+        ::munmap(ptr, len);
+    ptr = nullptr;
+    len = 0;
+}
+
+#endif /* MAPPED_FILE_HPP */
@@ -0,0 +1,34 @@
+#ifndef ORIENTATION_HPP
+#define ORIENTATION_HPP
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+/*
+ * Conversions between DroneData::orientation and quaternions. The renderer
+ * applies orientation as a rotation about x by pitch, then y by yaw, then z by
+ * roll, with the angles in degrees and stored as (roll, pitch, yaw).
+ */
+glm::quat orientation_to_quat(const glm::vec3& orientation)
+{
+    glm::vec3 r = glm::radians(orientation);
+    return glm::angleAxis(r.y, glm::vec3(1.0f, 0.0f, 0.0f)) *
+           glm::angleAxis(r.z, glm::vec3(0.0f, 1.0f, 0.0f)) *
+           glm::angleAxis(r.x, glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+glm::vec3 quat_to_orientation(const glm::quat& q)
+{
+    // Decompose M = Rx(pitch) * Ry(yaw) * Rz(roll). glm matrices are indexed
+    // [column][row].
+    glm::mat3 m = glm::mat3_cast(q);
+    float yaw = std::asin(glm::clamp(m[2][0], -1.0f, 1.0f));
+    float pitch = std::atan2(-m[2][1], m[2][2]);
+    float roll = std::atan2(-m[1][0], m[0][0]);
+
+    return glm::degrees(glm::vec3(roll, pitch, yaw));
+}
+
+#endif /* ORIENTATION_HPP */
@@ -0,0 +1,304 @@
+#ifndef POSITION_ESTIMATOR_HPP
+#define POSITION_ESTIMATOR_HPP
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "kalman_filter.hpp"
+#include "logger.hpp"
+
+struct PositionEstimatorConfig
+{
+    std::size_t states;       // 9 or 15, see InertialEkf.
+    float sample_hz;          // Nominal IMU sample rate.
+    float accel_scale;        // World units/s^2 per accel unit.
+    float gyro_scale;         // Radians per second per rot_rate unit.
+    float gravity;            // World units/s^2, pointing down -y.
+
+    // Continuous noise densities (units/s^2/sqrt(Hz) etc.), so the tuning
+    // doesn't change with the sample rate.
+    float accel_noise;
+    float accel_bias_walk;
+    float gyro_noise;
+    float gyro_bias_walk;
+
+    // Standard deviation of external position fixes, in world units.
+    float fix_noise;
+
+    glm::vec3 initial_position;
+
+    // Format channels carrying x, y and z of an external position fix (e.g.
+    // from motion capture or GPS), or nullptr to dead-reckon. A non-finite
+    // value in a packet means no fix in that packet.
+    std::array<const char*, 3> fix_channels;
+};
+
+/*
+ * Estimates position and velocity by integrating the accelerometer at the IMU
+ * rate, corrected by external position fixes when available.
+ */
+class PositionEstimator
+{
+public:
+    virtual ~PositionEstimator() = default;
+
+    /*
+     * Propagates one IMU sample. attitude is the body to world rotation from
+     * the attitude estimator (identity when there isn't one), used by models
+     * which don't track attitude themselves.
+     */
+    virtual void predict(glm::vec3 accel, glm::vec3 rot_rate, const glm::quat& attitude) = 0;
+
+    /*
+     * Fuses a position fix. Returns false if it was rejected as numerically
+     * unusable.
+     */
+    virtual bool correct(glm::vec3 fix) = 0;
+
+    virtual glm::vec3 get_position() const = 0;
+    virtual glm::vec3 get_velocity() const = 0;
+};
+
+/*
+ * Error-state EKF for strapdown inertial navigation in the viewer's frame
+ * (y up). The error state is laid out in groups of three axes:
+ *
+ *   9 states:  position, velocity, accelerometer bias. Attitude is taken from
+ *              the attitude estimator.
+ *   15 states: additionally attitude error (in the body frame) and gyro bias.
+ *              Attitude is integrated from the gyro here, and position fixes
+ *              correct it through its correlation with the velocity error.
+ *
+ * Nominal state is propagated in full and the filter estimates the error
+ * around it, which is injected and reset after every fix.
+ */
+template <std::size_t N>
+class InertialEkf : public PositionEstimator
+{
+    static_assert(N == 9 || N == 15, "InertialEkf has 9 or 15 states");
+public:
+    explicit InertialEkf(const PositionEstimatorConfig&);
+
+    void predict(glm::vec3 accel, glm::vec3 rot_rate, const glm::quat& attitude) override;
+    bool correct(glm::vec3 fix) override;
+
+    glm::vec3 get_position() const override { return position; }
+    glm::vec3 get_velocity() const override { return velocity; }
+    glm::quat get_attitude() const { return attitude; }
+    glm::vec3 get_accel_bias() const { return accel_bias; }
+
+    const ExtendedKalmanFilter<N>& get_filter() const { return ekf; }
+private:
+    static constexpr bool OWN_ATTITUDE = N == 15;
+
+    // Offsets of the state groups.
+    static constexpr std::size_t POS = 0;
+    static constexpr std::size_t VEL = 3;
+    static constexpr std::size_t ACCEL_BIAS = 6;
+    static constexpr std::size_t ATTITUDE = 9;
+    static constexpr std::size_t GYRO_BIAS = 12;
+
+    using StateMatrix = typename ExtendedKalmanFilter<N>::StateMatrix;
+    using StateVector = typename ExtendedKalmanFilter<N>::StateVector;
+
+    static StateMatrix initial_covariance(const PositionEstimatorConfig&);
+    static StateMatrix process_noise(const PositionEstimatorConfig&, float dt);
+    static Matrix<3, 3> fix_covariance(const PositionEstimatorConfig&);
+
+    const PositionEstimatorConfig cfg;
+    const float dt;
+    const StateMatrix Q;
+    const Matrix<3, 3> R;
+    ExtendedKalmanFilter<N> ekf;
+
+    glm::vec3 position;
+    glm::vec3 velocity{};
+    glm::vec3 accel_bias{};
+    glm::quat attitude{1.0f, 0.0f, 0.0f, 0.0f};
+    glm::vec3 gyro_bias{};
+};
+
+namespace position_estimator_detail
+{
+
+// Cross product matrix: skew(a) * b = cross(a, b).
+inline glm::mat3 skew(const glm::vec3& a)
+{
+    // Column-major.
+    return glm::mat3(0.0f, a.z, -a.y,
+                     -a.z, 0.0f, a.x,
+                     a.y, -a.x, 0.0f);
+}
+
+// Quaternion of the rotation vector theta.
+inline glm::quat rotation_vector_quat(const glm::vec3& theta)
+{
+    float angle = glm::length(theta);
+    if (angle < 1e-6f)
+        return glm::normalize(glm::quat(1.0f, 0.5f * theta.x, 0.5f * theta.y, 0.5f * theta.z));
+    return glm::angleAxis(angle, theta / angle);
+}
+
+}  // namespace position_estimator_detail
+
+template <std::size_t N>
+InertialEkf<N>::InertialEkf(const PositionEstimatorConfig& cfg_) :
+    cfg(cfg_),
+    dt(1.0f / cfg_.sample_hz),
+    Q(process_noise(cfg_, 1.0f / cfg_.sample_hz)),
+    R(fix_covariance(cfg_)),
+    ekf(initial_covariance(cfg_)),
+    position(cfg_.initial_position)
+{}
+
+/*
+ * The initial position is known to about the accuracy of a fix and the
+ * vehicle starts roughly at rest (0.1 g * 1 s) and level (5 degrees). Biases
+ * start at zero with a spread typical of consumer MEMS parts (0.02 g and
+ * 1 degree/s).
+ */
+template <std::size_t N>
+typename InertialEkf<N>::StateMatrix
+InertialEkf<N>::initial_covariance(const PositionEstimatorConfig& cfg)
+{
+    const float deg = 3.14159265f / 180.0f;
+    float variances[] = {
+        cfg.fix_noise * cfg.fix_noise,
+        0.1f * cfg.gravity * 0.1f * cfg.gravity,
+        0.02f * cfg.gravity * 0.02f * cfg.gravity,
+        5.0f * deg * 5.0f * deg,
+        1.0f * deg * 1.0f * deg,
+    };
+
+    StateMatrix P{};
+    for (std::size_t i = 0; i < N; i++)
+        P(i, i) = variances[i / 3];
+    return P;
+}
+
+template <std::size_t N>
+typename InertialEkf<N>::StateMatrix
+InertialEkf<N>::process_noise(const PositionEstimatorConfig& cfg, float dt)
+{
+    // Position picks up noise only through velocity.
+    float variances[] = {
+        0.0f,
+        cfg.accel_noise * cfg.accel_noise * dt,
+        cfg.accel_bias_walk * cfg.accel_bias_walk * dt,
+        cfg.gyro_noise * cfg.gyro_noise * dt,
+        cfg.gyro_bias_walk * cfg.gyro_bias_walk * dt,
+    };
+
+    StateMatrix Q{};
+    for (std::size_t i = 0; i < N; i++)
+        Q(i, i) = variances[i / 3];
+    return Q;
+}
+
+template <std::size_t N>
+Matrix<3, 3> InertialEkf<N>::fix_covariance(const PositionEstimatorConfig& cfg)
+{
+    Matrix<3, 3> R{};
+    for (std::size_t i = 0; i < 3; i++)
+        R(i, i) = cfg.fix_noise * cfg.fix_noise;
+    return R;
+}
+
+template <std::size_t N>
+void InertialEkf<N>::predict(glm::vec3 accel, glm::vec3 rot_rate,
+                             const glm::quat& external_attitude)
+{
+    using namespace position_estimator_detail;
+
+    for (int i = 0; i < 3; i++)
+        if (!std::isfinite(accel[i]) || !std::isfinite(rot_rate[i]))
+            return;
+
+    // Specific force in the body frame.
+    glm::vec3 f = accel * cfg.accel_scale - accel_bias;
+
+    glm::vec3 w{};
+    if constexpr (OWN_ATTITUDE)
+    {
+        w = rot_rate * cfg.gyro_scale - gyro_bias;
+        attitude = glm::normalize(attitude * rotation_vector_quat(w * dt));
+    }
+    else
+    {
+        attitude = external_attitude;
+    }
+    glm::mat3 rot = glm::mat3_cast(attitude);
+
+    glm::vec3 a = rot * f + glm::vec3(0.0f, -cfg.gravity, 0.0f);
+    position += velocity * dt + 0.5f * a * dt * dt;
+    velocity += a * dt;
+
+    // First order discretization of the error dynamics.
+    const glm::mat3 I(1.0f);
+    StateMatrix F = StateMatrix::identity();
+    F.set_block(POS, VEL, I * dt);
+    F.set_block(VEL, ACCEL_BIAS, -rot * dt);
+    if constexpr (OWN_ATTITUDE)
+    {
+        F.set_block(VEL, ATTITUDE, -rot * skew(f) * dt);
+        F.set_block(ATTITUDE, ATTITUDE, I - skew(w) * dt);
+        F.set_block(ATTITUDE, GYRO_BIAS, -I * dt);
+    }
+
+    ekf.predict(F, Q);
+}
+
+template <std::size_t N>
+bool InertialEkf<N>::correct(glm::vec3 fix)
+{
+    using namespace position_estimator_detail;
+
+    Matrix<3, N> H{};
+    for (std::size_t i = 0; i < 3; i++)
+        H(i, POS + i) = 1.0f;
+
+    Matrix<3, 1> y{};
+    y.set_segment(0, fix - position);
+
+    StateVector dx;
+    if (!ekf.update(y, H, R, dx))
+        return false;
+
+    // Inject the error estimate into the nominal state. The covariance reset
+    // after injecting an attitude error is the identity to first order, so
+    // it's left out.
+    position += dx.segment(POS);
+    velocity += dx.segment(VEL);
+    accel_bias += dx.segment(ACCEL_BIAS);
+    if constexpr (OWN_ATTITUDE)
+    {
+        attitude = glm::normalize(attitude * rotation_vector_quat(dx.segment(ATTITUDE)));
+        gyro_bias += dx.segment(GYRO_BIAS);
+    }
+    return true;
+}
+
+/*
+ * Returns nullptr (and logs why) if the configuration is invalid.
+ */
+std::unique_ptr<PositionEstimator> make_position_estimator(const PositionEstimatorConfig& cfg)
+{
+    bool valid = cfg.sample_hz > 0.0f && cfg.fix_noise > 0.0f &&
+        cfg.accel_noise >= 0.0f && cfg.accel_bias_walk >= 0.0f &&
+        cfg.gyro_noise >= 0.0f && cfg.gyro_bias_walk >= 0.0f;
+
+    if (valid && cfg.states == 9)
+        return std::make_unique<InertialEkf<9>>(cfg);
+    if (valid && cfg.states == 15)
+        return std::make_unique<InertialEkf<15>>(cfg);
+
+    logger.log(LogLevel::error, "make_position_estimator: Invalid configuration\n");
+    return nullptr;
+}
+
+#endif /* POSITION_ESTIMATOR_HPP */
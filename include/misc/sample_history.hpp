@@ -0,0 +1,240 @@
+#ifndef SAMPLE_HISTORY_HPP
+#define SAMPLE_HISTORY_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "orientation.hpp"
+#include "shared.hpp"
+
+/*
+ * A DroneData sample and the local time it describes. received and processed
+ * record when its packet was read from the serial port and when the sample
+ * was ready, for latency measurement.
+ */
+struct TimedDroneData
+{
+    DroneData data{};
+    std::chrono::steady_clock::time_point time{};
+    std::chrono::steady_clock::time_point received{};
+    std::chrono::steady_clock::time_point processed{};
+};
+
+/*
+ * The last N samples in time order, for rendering the drone at an arbitrary
+ * time rather than at whenever the last packet happened to arrive. Storage is
+ * a fixed ring, so the pipeline can push at the packet rate and publish the
+ * whole history with one copy.
+ */
+template <std::size_t N>
+class SampleHistory
+{
+public:
+    /*
+     * A sample stamped before the newest one (e.g. when the clock offset
+     * tightens) is moved up to the newest one's time, to keep the history
+     * ordered.
+     */
+    void push(const TimedDroneData& sample)
+    {
+        samples[next] = sample;
+        if (count && sample.time < newest().time)
+            samples[next].time = newest().time;
+        next = next + 1 == N ? 0 : next + 1;
+        count = std::min(count + 1, N);
+    }
+
+    std::size_t size() const { return count; }
+
+    // Oldest first.
+    const TimedDroneData& operator[](std::size_t i) const
+    {
+        return samples[(next + N - count + i) % N];
+    }
+
+    const TimedDroneData& newest() const { return (*this)[count - 1]; }
+
+    /*
+     * The drone's state at time t. Between samples, position is interpolated
+     * linearly and attitude by slerp, with orientation recomputed from it. Past the newest sample, both continue
+     * at the rate between the last two samples for at most max_extrapolation,
+     * then hold. Before the oldest sample the oldest is returned. Returns false
+     * if the history is empty.
+     */
+    bool sample_at(std::chrono::steady_clock::time_point t,
+                   std::chrono::steady_clock::duration max_extrapolation,
+                   DroneData& out) const;
+private:
+    // glm::slerp takes the shorter way round, whichever sign the samples'
+    // quaternions have.
+    static DroneData blend(const DroneData& a, const DroneData& b, float u)
+    {
+        DroneData out;
+        out.position = glm::mix(a.position, b.position, u);
+        out.attitude = glm::normalize(glm::slerp(a.attitude, b.attitude, u));
+        out.orientation = quat_to_orientation(out.attitude);
+        return out;
+    }
+
+    std::array<TimedDroneData, N> samples{};
+    std::size_t next = 0;
+    std::size_t count = 0;
+};
+
+template <std::size_t N>
+bool SampleHistory<N>::sample_at(std::chrono::steady_clock::time_point t,
+                                 std::chrono::steady_clock::duration max_extrapolation,
+                                 DroneData& out) const
+{
+    using seconds = std::chrono::duration<float>;
+
+    if (!count)
+        return false;
+
+    // Newest sample at or before t. Samples sharing a timestamp (e.g. a burst
+    // stamped on arrival) resolve to the latest of them.
+    std::size_t i = count;
+    while (i > 0 && (*this)[i - 1].time > t)
+        i--;
+    if (i == 0)
+    {
+        out = (*this)[0].data;
+        return true;
+    }
+
+    const TimedDroneData& a = (*this)[i - 1];
+    if (i < count)
+    {
+        const TimedDroneData& b = (*this)[i];
+        float u = seconds(t - a.time).count() / seconds(b.time - a.time).count();
+        out = blend(a.data, b.data, u);
+        return true;
+    }
+
+    // Past the newest sample. Extrapolate along the segment from the previous
+    // distinct timestamp.
+    std::size_t j = count - 1;
+    while (j > 0 && (*this)[j - 1].time == a.time)
+        j--;
+    if (j == 0 || max_extrapolation <= max_extrapolation.zero())
+    {
+        out = a.data;
+        return true;
+    }
+
+    const TimedDroneData& prev = (*this)[j - 1];
+    auto ahead = std::min(t - a.time, max_extrapolation);
+    float u = 1.0f + seconds(ahead).count() / seconds(a.time - prev.time).count();
+    out = blend(prev.data, a.data, u);
+    return true;
+}
+
+/*
+ * Maps the drone's clock onto the local steady clock, so samples are placed
+ * at the time the drone measured them rather than when a radio or USB burst
+ * delivered them. Transport only ever adds delay, so the offset between the
+ * clocks is taken from the least delayed sample seen: the minimum of arrival
+ * time minus drone time. The minimum may creep up by max_drift seconds per
+ * second, so a drone clock running slower than the local one is followed too.
+ * A drone clock going backwards (e.g. a reboot) restarts the estimate.
+ */
+class DroneClock
+{
+public:
+    explicit DroneClock(double max_drift_ = 1e-4) : max_drift(max_drift_) {}
+
+    std::chrono::steady_clock::time_point to_local(
+        double drone_seconds, std::chrono::steady_clock::time_point arrival);
+private:
+    using seconds = std::chrono::duration<double>;
+
+    const double max_drift;
+    bool synced = false;
+    double last_drone_seconds = 0.0;
+    seconds offset{};
+};
+
+std::chrono::steady_clock::time_point DroneClock::to_local(
+    double drone_seconds, std::chrono::steady_clock::time_point arrival)
+{
+    if (!std::isfinite(drone_seconds))
+        return arrival;
+
+    seconds candidate = seconds(arrival.time_since_epoch()) - seconds(drone_seconds);
+    if (!synced || drone_seconds < last_drone_seconds)
+    {
+        offset = candidate;
+        synced = true;
+    }
+    else
+    {
+        offset += seconds((drone_seconds - last_drone_seconds) * max_drift);
+        offset = std::min(offset, candidate);
+    }
+    last_drone_seconds = drone_seconds;
+
+    return std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            seconds(drone_seconds) + offset));
+}
+
+/*
+ * Timestamps samples which carry no drone time. Links deliver in bursts, so
+ * samples taken at a steady rate arrive several at once and then not at all,
+ * and stamping them on arrival would make the drone jump and stall. Instead
+ * each sample is placed one sample period after the previous one, but no later
+ * than its arrival and no more than max_lag before it. The period is a moving
+ * average of the time between arrivals, which bursts don't bias.
+ */
+class ArrivalClock
+{
+public:
+    explicit ArrivalClock(std::chrono::steady_clock::duration max_lag_ =
+                              std::chrono::milliseconds(100),
+                          double alpha_ = 0.01) :
+        max_lag(max_lag_),
+        alpha(alpha_)
+    {}
+
+    std::chrono::steady_clock::time_point to_local(std::chrono::steady_clock::time_point arrival);
+private:
+    using seconds = std::chrono::duration<double>;
+
+    const std::chrono::steady_clock::duration max_lag;
+    const double alpha;
+    std::size_t count = 0;
+    std::chrono::steady_clock::time_point last_arrival{};
+    std::chrono::steady_clock::time_point last_stamp{};
+    seconds period{};
+};
+
+std::chrono::steady_clock::time_point ArrivalClock::to_local(
+    std::chrono::steady_clock::time_point arrival)
+{
+    using std::chrono::duration_cast;
+    using duration = std::chrono::steady_clock::duration;
+
+    if (count == 0)
+    {
+        last_stamp = arrival;
+    }
+    else
+    {
+        seconds interval = arrival - last_arrival;
+        period = count == 1 ? interval : period + alpha * (interval - period);
+        last_stamp = std::clamp(last_stamp + duration_cast<duration>(period),
+            arrival - max_lag, arrival);
+    }
+
+    count++;
+    last_arrival = arrival;
+    return last_stamp;
+}
+
+#endif /* SAMPLE_HISTORY_HPP */
@@ -0,0 +1,150 @@
+#ifndef SMALL_MATRIX_HPP
+#define SMALL_MATRIX_HPP
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+/*
+ * Fixed-size row-major float matrix for the Kalman filters. Dimensions are
+ * template parameters, so storage lives inline (no allocation) and every loop
+ * has constant bounds the compiler can unroll and vectorize. glm stops at 4x4,
+ * which is why this exists.
+ */
+template <std::size_t R, std::size_t C>
+struct Matrix
+{
+    std::array<float, R * C> m{};
+
+    float& operator()(std::size_t r, std::size_t c) { return m[r * C + c]; }
+    float operator()(std::size_t r, std::size_t c) const { return m[r * C + c]; }
+
+    static Matrix identity()
+    {
+        static_assert(R == C, "identity() needs a square matrix");
+        Matrix I{};
+        for (std::size_t i = 0; i < R; i++)
+            I(i, i) = 1.0f;
+        return I;
+    }
+
+    Matrix<C, R> transpose() const
+    {
+        Matrix<C, R> t{};
+        for (std::size_t r = 0; r < R; r++)
+            for (std::size_t c = 0; c < C; c++)
+                t(c, r) = (*this)(r, c);
+        return t;
+    }
+
+    Matrix& operator+=(const Matrix& rhs)
+    {
+        for (std::size_t i = 0; i < R * C; i++)
+            m[i] += rhs.m[i];
+        return *this;
+    }
+
+    Matrix& operator-=(const Matrix& rhs)
+    {
+        for (std::size_t i = 0; i < R * C; i++)
+            m[i] -= rhs.m[i];
+        return *this;
+    }
+
+    /*
+     * 3x3 blocks and 3-vector segments, for models which lay out their state
+     * as groups of three axes.
+     */
+    void set_block(std::size_t r, std::size_t c, const glm::mat3& b)
+    {
+        // glm is column-major: b[col][row].
+        for (std::size_t i = 0; i < 3; i++)
+            for (std::size_t j = 0; j < 3; j++)
+                (*this)(r + i, c + j) = b[j][i];
+    }
+
+    glm::vec3 segment(std::size_t r) const
+    {
+        static_assert(C == 1, "segment() needs a column vector");
+        return glm::vec3(m[r], m[r + 1], m[r + 2]);
+    }
+
+    void set_segment(std::size_t r, const glm::vec3& v)
+    {
+        static_assert(C == 1, "set_segment() needs a column vector");
+        m[r] = v.x;
+        m[r + 1] = v.y;
+        m[r + 2] = v.z;
+    }
+};
+
+template <std::size_t R, std::size_t C>
+Matrix<R, C> operator+(Matrix<R, C> a, const Matrix<R, C>& b) { return a += b; }
+
+template <std::size_t R, std::size_t C>
+Matrix<R, C> operator-(Matrix<R, C> a, const Matrix<R, C>& b) { return a -= b; }
+
+template <std::size_t R, std::size_t K, std::size_t C>
+Matrix<R, C> operator*(const Matrix<R, K>& a, const Matrix<K, C>& b)
+{
+    // i-k-j order streams through rows of b and the result, so the inner
+    // loop vectorizes.
+    Matrix<R, C> p{};
+    for (std::size_t i = 0; i < R; i++)
+        for (std::size_t k = 0; k < K; k++)
+        {
+            float aik = a(i, k);
+            for (std::size_t j = 0; j < C; j++)
+                p(i, j) += aik * b(k, j);
+        }
+    return p;
+}
+
+/*
+ * Inverts a symmetric positive definite matrix by Cholesky decomposition.
+ * Returns false, leaving inv untouched, if the matrix isn't positive definite.
+ */
+template <std::size_t N>
+bool spd_inverse(const Matrix<N, N>& a, Matrix<N, N>& inv)
+{
+    // a = L * L^T, L lower triangular.
+    Matrix<N, N> L{};
+    for (std::size_t j = 0; j < N; j++)
+    {
+        float d = a(j, j);
+        for (std::size_t k = 0; k < j; k++)
+            d -= L(j, k) * L(j, k);
+        if (!(d > 0.0f))
+            return false;
+        L(j, j) = std::sqrt(d);
+
+        for (std::size_t i = j + 1; i < N; i++)
+        {
+            float s = a(i, j);
+            for (std::size_t k = 0; k < j; k++)
+                s -= L(i, k) * L(j, k);
+            L(i, j) = s / L(j, j);
+        }
+    }
+
+    // inv(a) = inv(L)^T * inv(L), with inv(L) by forward substitution.
+    Matrix<N, N> Linv{};
+    for (std::size_t c = 0; c < N; c++)
+    {
+        Linv(c, c) = 1.0f / L(c, c);
+        for (std::size_t i = c + 1; i < N; i++)
+        {
+            float s = 0.0f;
+            for (std::size_t k = c; k < i; k++)
+                s -= L(i, k) * Linv(k, c);
+            Linv(i, c) = s / L(i, i);
+        }
+    }
+
+    inv = Linv.transpose() * Linv;
+    return true;
+}
+
+#endif /* SMALL_MATRIX_HPP */
@@ -0,0 +1,70 @@
+#ifndef SPAN_HPP
+#define SPAN_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Non-owning view of a contiguous run of elements. A minimal stand-in for
+ * C++20's std::span, since the project builds as C++17.
+ */
+template <typename T>
+class Span
+{
+public:
+    constexpr Span() = default;
+    constexpr Span(T* data_, std::size_t size_) : ptr(data_), len(size_) {}
+
+    template <std::size_t N>
+    constexpr Span(T (&arr)[N]) : ptr(arr), len(N) {}
+
+    // Span<T> -> Span<const T>.
+    template <typename U,
+              typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+    constexpr Span(const Span<U>& other) :
+        ptr(other.data()), len(other.size()) {}
+
+    // Any contiguous container (std::vector, std::array, std::string).
+    template <typename C,
+              typename = std::enable_if_t<std::is_convertible_v<
+                  decltype(std::declval<C&>().data()), T*>>>
+    constexpr Span(C& c) : ptr(c.data()), len(c.size()) {}
+
+    constexpr T* data() const { return ptr; }
+    constexpr std::size_t size() const { return len; }
+    constexpr bool empty() const { return len == 0; }
+
+    constexpr T* begin() const { return ptr; }
+    constexpr T* end() const { return ptr + len; }
+
+    constexpr T& operator[](std::size_t i) const
+    {
+        assert(i < len);
+        return ptr[i];
+    }
+
+    constexpr Span first(std::size_t n) const
+    {
+        assert(n <= len);
+        return Span(ptr, n);
+    }
+
+    constexpr Span subspan(std::size_t offset) const
+    {
+        assert(offset <= len);
+        return Span(ptr + offset, len - offset);
+    }
+
+    constexpr Span subspan(std::size_t offset, std::size_t n) const
+    {
+        assert(offset + n <= len);
+        return Span(ptr + offset, n);
+    }
+private:
+    T* ptr = nullptr;
+    std::size_t len = 0;
+};
+
+#endif /* SPAN_HPP */
@@ -0,0 +1,235 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+#include "doorbell.hpp"
+#include "span.hpp"
+
+/*
+ * A wait-free ring buffer for exactly one producer thread and one consumer
+ * thread. Unlike BoundedBuffer, elements are moved in batches through spans
+ * and neither side ever takes a lock or allocates.
+ *
+ * The head index is only written by the producer and the tail index only by
+ * the consumer. Each lives on its own cache line, together with the owning
+ * side's cached copy of the other index, so the two threads don't bounce a
+ * shared line on every operation.
+ *
+ * When the ring is full, writes are truncated and the excess elements are
+ * counted as dropped. The producer cannot discard old data on the consumer's
+ * behalf without breaking the single-writer rule for the tail index.
+ *
+ * A consumer with nothing else to do can sleep in wait_readable_for(). Only
+ * then does the producer take a lock, to wake it.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+    // Capacity is rounded up to the next power of two.
+    explicit SpscRing(std::size_t cap_);
+
+    // Disallow copying and moving.
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+    SpscRing(SpscRing&&) = delete;
+    SpscRing& operator=(SpscRing&&) = delete;
+
+    bool empty() const;
+    std::size_t size() const;
+    std::size_t capacity() const { return cap; }
+    std::size_t dropped_elements() const;
+
+    /*
+     * Producer interface. write() copies as much of the span as fits and
+     * returns the number of elements written. Alternatively, write_available()
+     * exposes the contiguous free region so data can be produced in place
+     * (e.g. by read()), followed by commit() with the number of elements
+     * actually produced.
+     */
+    std::size_t write(Span<const T>);
+    Span<T> write_available();
+    void commit(std::size_t);
+
+    /*
+     * Consumer interface. read_available() returns the contiguous readable
+     * region starting at the tail; if the readable data wraps around the end
+     * of the storage, the remainder is returned by the next call after
+     * consume(). Elements in the span stay valid until consumed.
+     */
+    Span<const T> read_available();
+    void consume(std::size_t);
+
+    /*
+     * Blocks the consumer until elements are readable, wake_consumer() is
+     * called or the timeout expires. Returns false on timeout.
+     */
+    template <typename Rep, typename Period>
+    bool wait_readable_for(std::chrono::duration<Rep, Period>);
+    void wake_consumer() { doorbell.wake(); }
+
+    /*
+     * When the producer last added elements, e.g. when a serial read
+     * returned, for measuring how long data waits downstream.
+     */
+    std::chrono::steady_clock::time_point last_write_time() const
+    {
+        return std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(
+                write_time.load(std::memory_order_relaxed)));
+    }
+
+    /*
+     * Discards all readable elements. Consumer-side operation.
+     */
+    void clear();
+private:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    static std::size_t round_up_pow2(std::size_t);
+
+    void stamp_write()
+    {
+        write_time.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+            std::memory_order_relaxed);
+    }
+
+    const std::size_t cap;
+    const std::size_t mask;
+    std::unique_ptr<T[]> storage;
+
+    // Producer-owned line.
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head{};
+    std::size_t cached_tail{};
+    std::atomic<std::size_t> dropped{};
+    std::atomic<std::chrono::steady_clock::rep> write_time{};
+
+    // Consumer-owned line.
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail{};
+    std::size_t cached_head{};
+
+    alignas(CACHE_LINE_SIZE) Doorbell doorbell;
+};
+
+template <typename T>
+SpscRing<T>::SpscRing(std::size_t cap_) :
+    cap(round_up_pow2(cap_)),
+    mask(round_up_pow2(cap_) - 1),
+    storage(std::make_unique<T[]>(round_up_pow2(cap_)))
+{
+}
+
+template <typename T>
+std::size_t SpscRing<T>::round_up_pow2(std::size_t n)
+{
+    std::size_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+template <typename T>
+bool SpscRing<T>::empty() const
+{
+    return size() == 0;
+}
+
+template <typename T>
+std::size_t SpscRing<T>::size() const
+{
+    return head.load(std::memory_order_acquire) -
+        tail.load(std::memory_order_acquire);
+}
+
+template <typename T>
+std::size_t SpscRing<T>::dropped_elements() const
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+std::size_t SpscRing<T>::write(Span<const T> src)
+{
+    std::size_t h = head.load(std::memory_order_relaxed);
+    if (cap - (h - cached_tail) < src.size())
+        cached_tail = tail.load(std::memory_order_acquire);
+
+    std::size_t n = std::min(src.size(), cap - (h - cached_tail));
+    std::size_t idx = h & mask;
+    std::size_t first_len = std::min(n, cap - idx);
+
+    std::copy(src.begin(), src.begin() + first_len, storage.get() + idx);
+    std::copy(src.begin() + first_len, src.begin() + n, storage.get());
+
+    if (n)
+        stamp_write();
+    head.store(h + n, std::memory_order_release);
+    if (n)
+        doorbell.ring();
+
+    if (n != src.size())
+        dropped.fetch_add(src.size() - n, std::memory_order_relaxed);
+    return n;
+}
+
+template <typename T>
+Span<T> SpscRing<T>::write_available()
+{
+    std::size_t h = head.load(std::memory_order_relaxed);
+    cached_tail = tail.load(std::memory_order_acquire);
+
+    std::size_t idx = h & mask;
+    std::size_t n = std::min(cap - (h - cached_tail), cap - idx);
+    return Span<T>(storage.get() + idx, n);
+}
+
+template <typename T>
+void SpscRing<T>::commit(std::size_t n)
+{
+    if (n)
+        stamp_write();
+    head.store(head.load(std::memory_order_relaxed) + n,
+        std::memory_order_release);
+    if (n)
+        doorbell.ring();
+}
+
+template <typename T>
+Span<const T> SpscRing<T>::read_available()
+{
+    std::size_t t = tail.load(std::memory_order_relaxed);
+    if (cached_head == t)
+        cached_head = head.load(std::memory_order_acquire);
+
+    std::size_t idx = t & mask;
+    std::size_t n = std::min(cached_head - t, cap - idx);
+    return Span<const T>(storage.get() + idx, n);
+}
+
+template <typename T>
+void SpscRing<T>::consume(std::size_t n)
+{
+    tail.store(tail.load(std::memory_order_relaxed) + n,
+        std::memory_order_release);
+}
+
+template <typename T>
+template <typename Rep, typename Period>
+bool SpscRing<T>::wait_readable_for(std::chrono::duration<Rep, Period> timeout)
+{
+    return doorbell.wait_for([this]{ return !empty(); }, timeout);
+}
+
+template <typename T>
+void SpscRing<T>::clear()
+{
+    cached_head = head.load(std::memory_order_acquire);
+    tail.store(cached_head, std::memory_order_release);
+}
+
+#endif /* SPSC_RING_HPP */
@@ -0,0 +1,97 @@
+#ifndef STATIC_TELEMETRY_FORMAT_HPP
+#define STATIC_TELEMETRY_FORMAT_HPP
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+/*
+ * An ASCII telemetry layout fixed at compile time. Field offsets are given in
+ * the order accel x, y, z, rot_rate x, y, z. Since every offset and width is a
+ * constant, StaticTelemetryDecoder compiles down to straight-line code with
+ * no loads from the format and no loop over fields.
+ *
+ * Layouts which are only known at runtime (e.g. loaded from a schema) use
+ * TelemetryFormat's runtime decoders instead.
+ */
+template <std::size_t PacketLen,
+          char StartSymbol,
+          char StopSymbol,
+          std::size_t ConversionFactor,
+          std::size_t ElementSize,
+          std::size_t... FieldOffsets>
+struct StaticTelemetryFormat
+{
+    static_assert(sizeof...(FieldOffsets) == 6,
+        "Expected 3 accel offsets followed by 3 rot_rate offsets");
+    static_assert(((FieldOffsets + ElementSize <= PacketLen) && ...),
+        "Field exceeds packet length");
+    static_assert(ElementSize > 0 && ElementSize <= 9,
+        "Field width must fit an int");
+
+    static constexpr std::size_t packet_len = PacketLen;
+    static constexpr char start_symbol = StartSymbol;
+    static constexpr char stop_symbol = StopSymbol;
+    static constexpr std::size_t conversion_factor = ConversionFactor;
+    static constexpr float inv_conversion_factor = 1.0f / ConversionFactor;
+    static constexpr std::size_t element_size = ElementSize;
+    static constexpr std::array<std::size_t, 6> offsets{FieldOffsets...};
+};
+
+template <typename Fmt>
+class StaticTelemetryDecoder
+{
+public:
+    /*
+     * Same contract as TelemetryData::extract_packet_data for ASCII formats:
+     * every field must be a zero-padded, optionally negative integer which
+     * fills its whole width. The outputs are only written on success.
+     */
+    static bool decode(std::string_view packet, glm::vec3& accel, glm::vec3& rot_rate)
+    {
+        if (packet.size() != Fmt::packet_len)
+            return false;
+
+        float values[6];
+        if (!decode_fields(packet.data(), values, std::make_index_sequence<6>{}))
+            return false;
+
+        accel = glm::vec3(values[0], values[1], values[2]);
+        rot_rate = glm::vec3(values[3], values[4], values[5]);
+        return true;
+    }
+private:
+    template <std::size_t... I>
+    static bool decode_fields(const char* packet, float (&values)[6],
+                              std::index_sequence<I...>)
+    {
+        // Non-short-circuiting, so all six fields are parsed branch-free.
+        return (parse_field<Fmt::offsets[I]>(packet, values[I]) & ...);
+    }
+
+    template <std::size_t Offset>
+    static bool parse_field(const char* packet, float& out)
+    {
+        const char* p = packet + Offset;
+        const bool neg = p[0] == '-';
+
+        // Unsigned, so garbage digits wrap instead of overflowing.
+        unsigned value = 0;
+        bool ok = Fmt::element_size > std::size_t(neg);
+        for (std::size_t i = neg; i < Fmt::element_size; i++)
+        {
+            unsigned digit = static_cast<unsigned char>(p[i]) - unsigned('0');
+            ok &= digit < 10;
+            value = value * 10 + digit;
+        }
+
+        float v = static_cast<float>(value);
+        out = (neg ? -v : v) * Fmt::inv_conversion_factor;
+        return ok;
+    }
+};
+
+#endif /* STATIC_TELEMETRY_FORMAT_HPP */
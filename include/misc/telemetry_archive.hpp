@@ -0,0 +1,892 @@
+#ifndef TELEMETRY_ARCHIVE_HPP
+#define TELEMETRY_ARCHIVE_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "crc32.hpp"
+#include "logger.hpp"
+#include "mapped_file.hpp"
+#include "span.hpp"
+#include "telemetry_framing.hpp"
+
+namespace fs = std::filesystem;
+
+/*
+ * Compact long-term storage for decoded telemetry. Samples are cut into blocks
+ * covering a fixed duration, and within a block each channel is stored as a
+ * column, so a channel's values sit next to each other and are packed
+ * together. A block header holds the block's time range and each channel's
+ * range, and an index at the end of the file locates every block, so a time
+ * range can be found without decoding anything. All little-endian:
+ *
+ *     header: magic "PRARCHIV" | version (u32) | channel count (u32) |
+ *             block duration (i64 ns) | time quantum (i64 ns) |
+ *             per channel: name length (u16) | name
+ *     block:  sample count (u32) | body length (u32) | first time (i64 ns) |
+ *             last time (i64 ns) | body crc32 (u32) | reserved (u32) |
+ *             per channel: min (f32) | max (f32)
+ *             body: time column, then one column per channel, each
+ *             preceded by its length (u32)
+ *     index:  per block: first time (i64 ns) | last time (i64 ns) |
+ *             offset (u64) | sample count (u32) | reserved (u32)
+ *     footer: index offset (u64) | block count (u64) | magic "PRAINDEX"
+ *
+ * The time column holds the deltas of deltas of the times after the first,
+ * which are near zero at a steady rate, zigzag encoded: a bit width (u8), the
+ * values packed at that width, then as varints those too large for it, whose
+ * packed value is all ones. Times are counted in time quanta from the block's
+ * first time, rounding down; a quantum of 1 ns keeps every time exact.
+ *
+ * A channel column is a header (encoding (u8) | bit width (u8) |
+ * reserved (u16) | step (f32) | base (i64) | scale (i64)) followed by one
+ * value per sample packed at the bit width. Telemetry values are integers
+ * times a fixed step (e.g. 0.001 for the ASCII format), so where some step
+ * reproduces every value of the column bit for bit, the integers are stored
+ * instead, divided by their greatest common divisor, either as offsets from
+ * the block minimum or as deltas, whichever packs smaller. Columns with no
+ * such step (e.g. from float32 formats) store each value's bits XORed with
+ * the previous value's. Either way the floats decoded are exactly those
+ * written.
+ */
+enum class ArchiveColumnEncoding : std::uint8_t
+{
+    FrameOfReference = 0,  // value = float(base + packed * scale) * step
+    Delta = 1,             // q = previous q + unzigzag(packed) * scale, value = float(q) * step
+    FloatXor = 2,          // bits = previous bits ^ packed, first bits = base
+};
+
+constexpr char ARCHIVE_MAGIC[8] = {'P', 'R', 'A', 'R', 'C', 'H', 'I', 'V'};
+constexpr char ARCHIVE_INDEX_MAGIC[8] = {'P', 'R', 'A', 'I', 'N', 'D', 'E', 'X'};
+constexpr std::uint32_t ARCHIVE_VERSION = 1;
+constexpr std::size_t ARCHIVE_HEADER_LEN = 32;        // Up to the channel names.
+constexpr std::size_t ARCHIVE_BLOCK_HEADER_LEN = 32;  // Up to the channel ranges.
+constexpr std::size_t ARCHIVE_COLUMN_HEADER_LEN = 24;
+constexpr std::size_t ARCHIVE_INDEX_ENTRY_LEN = 32;
+constexpr std::size_t ARCHIVE_FOOTER_LEN = 24;
+constexpr std::size_t ARCHIVE_MAX_BLOCK_SAMPLES = 1 << 16;
+
+// Packed values are read with one unaligned 64-bit load each, which may run
+// up to 7 bytes past a column. The index and footer always follow the last
+// block, so this stays within the file.
+constexpr unsigned ARCHIVE_MAX_BIT_WIDTH = 57;
+
+/*
+ * Steps tried when quantizing a column, after the step which worked for the
+ * channel's previous block: decimal scale factors as written in schemas, and
+ * the binary ones of fixed-point sensors.
+ */
+constexpr std::array<float, 23> ARCHIVE_QUANTIZATION_STEPS = {
+    1.0f, 0.1f, 0.01f, 0.001f, 0.0001f, 0.00001f, 0.000001f,
+    0x1p-1f, 0x1p-2f, 0x1p-3f, 0x1p-4f, 0x1p-5f, 0x1p-6f, 0x1p-7f, 0x1p-8f,
+    0x1p-9f, 0x1p-10f, 0x1p-11f, 0x1p-12f, 0x1p-13f, 0x1p-14f, 0x1p-15f, 0x1p-16f,
+};
+
+struct ArchiveBlockInfo
+{
+    std::int64_t first_time_ns{};
+    std::int64_t last_time_ns{};
+    std::uint64_t offset{};
+    std::uint32_t count{};
+};
+
+/*
+ * A decoded block. values holds each channel's column in turn.
+ */
+struct ArchiveBlock
+{
+    std::vector<std::int64_t> times{};
+    std::vector<float> values{};
+
+    std::size_t size() const { return times.size(); }
+    Span<const float> column(std::size_t channel) const
+    {
+        return {values.data() + channel * times.size(), times.size()};
+    }
+};
+
+struct ArchiveWriterStats
+{
+    std::uint64_t samples{};
+    std::uint64_t blocks{};
+    std::uint64_t bytes{};
+    // Columns written with each ArchiveColumnEncoding.
+    std::array<std::uint64_t, 3> columns{};
+};
+
+std::uint64_t zigzag_encode(std::int64_t v)
+{
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+std::int64_t zigzag_decode(std::uint64_t v)
+{
+    return static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+}
+
+void put_varint(std::vector<std::uint8_t>& out, std::uint64_t v)
+{
+    for (; v >= 0x80; v >>= 7)
+        out.push_back(static_cast<std::uint8_t>(v | 0x80));
+    out.push_back(static_cast<std::uint8_t>(v));
+}
+
+/*
+ * Reads a varint from [p, end). Returns the position after it, or nullptr if
+ * it runs past end.
+ */
+const std::uint8_t* get_varint(const std::uint8_t* p, const std::uint8_t* end, std::uint64_t& v)
+{
+    v = 0;
+    for (unsigned shift = 0; p < end && shift < 64; shift += 7)
+    {
+        std::uint8_t b = *p++;
+        v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return p;
+    }
+    return nullptr;
+}
+
+unsigned bits_needed(std::uint64_t v)
+{
+    return v ? 64 - static_cast<unsigned>(__builtin_clzll(v)) : 0;
+}
+
+/*
+ * Appends values of a fixed bit width to a byte vector, least significant bit
+ * first.
+ */
+class BitPacker
+{
+public:
+    BitPacker(std::vector<std::uint8_t>& out_, unsigned width_) :
+        out(out_),
+        width(width_)
+    {}
+
+    void put(std::uint64_t v)
+    {
+        acc |= v << fill;
+        fill += width;
+        for (; fill >= 8; fill -= 8, acc >>= 8)
+            out.push_back(static_cast<std::uint8_t>(acc));
+    }
+
+    void finish()
+    {
+        if (fill)
+            out.push_back(static_cast<std::uint8_t>(acc));
+        acc = 0;
+        fill = 0;
+    }
+private:
+    std::vector<std::uint8_t>& out;
+    const unsigned width;
+    std::uint64_t acc = 0;
+    unsigned fill = 0;
+};
+
+/*
+ * Calls f with each of n values packed at width bits from p. Reads up to 7
+ * bytes past the packed values.
+ */
+template <typename F>
+void unpack_bits(const std::uint8_t* p, unsigned width, std::size_t n, F&& f)
+{
+    const std::uint64_t mask = (std::uint64_t{1} << width) - 1;
+    std::size_t bit = 0;
+    for (std::size_t i = 0; i < n; i++, bit += width)
+        f(i, (get_le64(p + (bit >> 3)) >> (bit & 7)) & mask);
+}
+
+/*
+ * Writes an archive from samples in time order. Samples are collected until
+ * they span the block duration (or ARCHIVE_MAX_BLOCK_SAMPLES), then encoded
+ * and written as a block. close() writes the last block and the index; an
+ * archive which wasn't closed can't be read.
+ */
+class ArchiveWriter
+{
+public:
+    ArchiveWriter(const std::vector<std::string>& channel_names_,
+                  std::chrono::nanoseconds block_duration,
+                  std::chrono::nanoseconds time_quantum = std::chrono::nanoseconds(1)) :
+        channel_names(channel_names_),
+        block_duration_ns(std::max<std::int64_t>(1, block_duration.count())),
+        time_quantum_ns(std::max<std::int64_t>(1, time_quantum.count())),
+        steps(channel_names_.size(), 0.0f),
+        columns(channel_names_.size())
+    {}
+    ~ArchiveWriter() { close(); }
+
+    bool open(const fs::path&);
+    bool close();
+
+    /*
+     * Adds a sample with a value for every channel. Returns false if the
+     * sample is out of time order or the archive can't be written.
+     */
+    bool append(std::int64_t time_ns, Span<const float> values);
+
+    ArchiveWriterStats get_stats() const { return stats; }
+private:
+    bool flush_block();
+    void encode_times(std::vector<std::uint8_t>&);
+    void encode_column(std::size_t channel, std::vector<std::uint8_t>&);
+    bool write(const std::vector<std::uint8_t>&);
+
+    const std::vector<std::string> channel_names;
+    const std::int64_t block_duration_ns;
+    const std::int64_t time_quantum_ns;
+
+    std::ofstream file{};
+    fs::path path{};
+    std::vector<ArchiveBlockInfo> index{};
+    ArchiveWriterStats stats{};
+
+    // Step which quantized each channel's previous block, or 0.
+    std::vector<float> steps;
+
+    // Block being collected.
+    std::vector<std::int64_t> times{};
+    std::vector<std::vector<float>> columns;
+
+    // Encoding scratch space.
+    std::vector<std::uint8_t> block{};
+    std::vector<std::uint8_t> column{};
+    std::vector<std::int64_t> quantized{};
+    std::vector<std::uint64_t> zigzags{};
+};
+
+bool ArchiveWriter::open(const fs::path& path_)
+{
+    close();
+
+    path = path_;
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        logger.log(LogLevel::error, "ArchiveWriter::open: Cannot open ", path, '\n');
+        return false;
+    }
+
+    index.clear();
+    stats = {};
+    std::fill(steps.begin(), steps.end(), 0.0f);
+
+    std::vector<std::uint8_t> header(ARCHIVE_HEADER_LEN);
+    std::memcpy(header.data(), ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+    put_le32(header.data() + 8, ARCHIVE_VERSION);
+    put_le32(header.data() + 12, static_cast<std::uint32_t>(channel_names.size()));
+    put_le64(header.data() + 16, static_cast<std::uint64_t>(block_duration_ns));
+    put_le64(header.data() + 24, static_cast<std::uint64_t>(time_quantum_ns));
+    for (const auto& name : channel_names)
+    {
+        std::size_t len = std::min<std::size_t>(name.size(), 0xffff);
+        header.resize(header.size() + 2);
+        put_le16(header.data() + header.size() - 2, static_cast<std::uint16_t>(len));
+        header.insert(header.end(), name.begin(), name.begin() + len);
+    }
+    return write(header);
+}
+
+bool ArchiveWriter::append(std::int64_t time_ns, Span<const float> values)
+{
+    if (!file.is_open())
+        return false;
+
+    if (values.size() != channel_names.size())
+    {
+        logger.log(LogLevel::error, "ArchiveWriter::append: Expected ",
+            channel_names.size(), " channels, got ", values.size(), '\n');
+        return false;
+    }
+
+    std::int64_t last = !times.empty() ? times.back() :
+        !index.empty() ? index.back().last_time_ns : time_ns;
+    if (time_ns < last)
+    {
+        logger.log(LogLevel::error, "ArchiveWriter::append: Sample at ", time_ns,
+            " ns is before the previous one\n");
+        return false;
+    }
+
+    if (!times.empty() && (time_ns - times.front() >= block_duration_ns ||
+                           times.size() == ARCHIVE_MAX_BLOCK_SAMPLES))
+    {
+        if (!flush_block())
+            return false;
+    }
+
+    times.push_back(time_ns);
+    for (std::size_t c = 0; c < columns.size(); c++)
+        columns[c].push_back(values[c]);
+    return true;
+}
+
+bool ArchiveWriter::close()
+{
+    if (!file.is_open())
+        return true;
+
+    bool ok = flush_block();
+
+    std::vector<std::uint8_t> trailer(index.size() * ARCHIVE_INDEX_ENTRY_LEN + ARCHIVE_FOOTER_LEN);
+    std::uint8_t* p = trailer.data();
+    for (const auto& entry : index)
+    {
+        put_le64(p, static_cast<std::uint64_t>(entry.first_time_ns));
+        put_le64(p + 8, static_cast<std::uint64_t>(entry.last_time_ns));
+        put_le64(p + 16, entry.offset);
+        put_le32(p + 24, entry.count);
+        put_le32(p + 28, 0);
+        p += ARCHIVE_INDEX_ENTRY_LEN;
+    }
+    put_le64(p, stats.bytes);
+    put_le64(p + 8, index.size());
+    std::memcpy(p + 16, ARCHIVE_INDEX_MAGIC, sizeof(ARCHIVE_INDEX_MAGIC));
+    ok = write(trailer) && ok;
+
+    file.close();
+    if (ok && !file)
+    {
+        logger.log(LogLevel::error, "ArchiveWriter::close: Cannot write ", path, '\n');
+        ok = false;
+    }
+    return ok;
+}
+
+bool ArchiveWriter::flush_block()
+{
+    std::size_t n = times.size();
+    if (!n)
+        return true;
+
+    std::size_t header_len = ARCHIVE_BLOCK_HEADER_LEN + 8 * columns.size();
+    block.assign(header_len, 0);
+
+    std::size_t len_pos = block.size();
+    block.resize(block.size() + 4);
+    encode_times(block);
+    put_le32(block.data() + len_pos, static_cast<std::uint32_t>(block.size() - len_pos - 4));
+
+    for (std::size_t c = 0; c < columns.size(); c++)
+    {
+        column.clear();
+        encode_column(c, column);
+        block.resize(block.size() + 4);
+        put_le32(block.data() + block.size() - 4, static_cast<std::uint32_t>(column.size()));
+        block.insert(block.end(), column.begin(), column.end());
+
+        // NaNs are left out of the range.
+        float lo = std::numeric_limits<float>::quiet_NaN();
+        float hi = lo;
+        for (float v : columns[c])
+        {
+            lo = std::isnan(lo) || v < lo ? v : lo;
+            hi = std::isnan(hi) || v > hi ? v : hi;
+        }
+        put_le_float(block.data() + ARCHIVE_BLOCK_HEADER_LEN + 8 * c, lo);
+        put_le_float(block.data() + ARCHIVE_BLOCK_HEADER_LEN + 8 * c + 4, hi);
+    }
+
+    std::size_t body_len = block.size() - header_len;
+    std::uint8_t* p = block.data();
+    put_le32(p, static_cast<std::uint32_t>(n));
+    put_le32(p + 4, static_cast<std::uint32_t>(body_len));
+    put_le64(p + 8, static_cast<std::uint64_t>(times.front()));
+    put_le64(p + 16, static_cast<std::uint64_t>(times.back()));
+    put_le32(p + 24, crc32({p + header_len, body_len}));
+    put_le32(p + 28, 0);
+
+    ArchiveBlockInfo info;
+    info.first_time_ns = times.front();
+    info.last_time_ns = times.back();
+    info.offset = stats.bytes;
+    info.count = static_cast<std::uint32_t>(n);
+    index.push_back(info);
+
+    stats.samples += n;
+    stats.blocks++;
+    times.clear();
+    for (auto& c : columns)
+        c.clear();
+    return write(block);
+}
+
+void ArchiveWriter::encode_times(std::vector<std::uint8_t>& out)
+{
+    std::vector<std::uint64_t>& dods = zigzags;
+    dods.clear();
+    std::int64_t prev = 0;
+    std::int64_t prev_delta = 0;
+    for (std::size_t i = 1; i < times.size(); i++)
+    {
+        std::int64_t q = (times[i] - times[0]) / time_quantum_ns;
+        std::int64_t delta = q - prev;
+        dods.push_back(zigzag_encode(delta - prev_delta));
+        prev = q;
+        prev_delta = delta;
+    }
+
+    // Width 0 holds only zeros. Otherwise the largest value of a width is an
+    // escape; pick the width for which packed values plus escaped ones are
+    // smallest.
+    auto varint_len = [](std::uint64_t v) { return bits_needed(v) / 7 + 1; };
+    unsigned width = 0;
+    std::size_t best = 0;
+    for (std::uint64_t v : dods)
+        best = v ? std::numeric_limits<std::size_t>::max() : best;
+    for (unsigned w = 1; w <= ARCHIVE_MAX_BIT_WIDTH && best; w++)
+    {
+        std::uint64_t escape = (std::uint64_t{1} << w) - 1;
+        std::size_t bits = dods.size() * w;
+        for (std::size_t i = 0; i < dods.size() && bits < best; i++)
+            bits += dods[i] >= escape ? 8 * varint_len(dods[i]) : 0;
+        if (bits < best)
+        {
+            best = bits;
+            width = w;
+        }
+    }
+
+    out.push_back(static_cast<std::uint8_t>(width));
+    BitPacker packer(out, width);
+    std::uint64_t escape = (std::uint64_t{1} << width) - 1;
+    for (std::uint64_t v : dods)
+        packer.put(width && v >= escape ? escape : v);
+    packer.finish();
+    for (std::uint64_t v : dods)
+    {
+        if (width && v >= escape)
+            put_varint(out, v);
+    }
+}
+
+/*
+ * Finds integers q with float(q) * step == value, bit for bit, for every
+ * value. Fails for NaN, -0, and values which aren't multiples of step.
+ */
+bool quantize(Span<const float> values, float step, std::vector<std::int64_t>& q)
+{
+    constexpr double MAX_Q = std::numeric_limits<std::int32_t>::max();
+
+    q.resize(values.size());
+    for (std::size_t i = 0; i < values.size(); i++)
+    {
+        double r = std::nearbyint(static_cast<double>(values[i]) / step);
+        if (!(std::fabs(r) <= MAX_Q))
+            return false;
+
+        q[i] = static_cast<std::int64_t>(r);
+        float back = static_cast<float>(q[i]) * step;
+        if (std::memcmp(&back, &values[i], sizeof(float)) != 0)
+            return false;
+    }
+    return true;
+}
+
+void ArchiveWriter::encode_column(std::size_t channel, std::vector<std::uint8_t>& out)
+{
+    Span<const float> values = columns[channel];
+    std::size_t n = values.size();
+
+    float step = 0.0f;
+    if (steps[channel] != 0.0f && quantize(values, steps[channel], quantized))
+        step = steps[channel];
+    for (std::size_t i = 0; step == 0.0f && i < ARCHIVE_QUANTIZATION_STEPS.size(); i++)
+    {
+        if (quantize(values, ARCHIVE_QUANTIZATION_STEPS[i], quantized))
+            step = ARCHIVE_QUANTIZATION_STEPS[i];
+    }
+    steps[channel] = step;
+
+    ArchiveColumnEncoding encoding;
+    unsigned width;
+    std::int64_t base;
+    std::int64_t scale;
+    if (step != 0.0f)
+    {
+        auto [lo_it, hi_it] = std::minmax_element(quantized.begin(), quantized.end());
+        std::int64_t lo = *lo_it;
+        std::uint64_t for_gcd = 0;
+        for (std::int64_t q : quantized)
+            for_gcd = std::gcd(for_gcd, static_cast<std::uint64_t>(q - lo));
+        unsigned for_width = for_gcd ? bits_needed((*hi_it - lo) / for_gcd) : 0;
+
+        std::uint64_t delta_gcd = 0;
+        for (std::size_t i = 1; i < n; i++)
+        {
+            std::int64_t d = quantized[i] - quantized[i - 1];
+            delta_gcd = std::gcd(delta_gcd, static_cast<std::uint64_t>(d < 0 ? -d : d));
+        }
+        std::uint64_t max_zigzag = 0;
+        for (std::size_t i = 1; delta_gcd && i < n; i++)
+        {
+            std::int64_t d = (quantized[i] - quantized[i - 1]) / static_cast<std::int64_t>(delta_gcd);
+            max_zigzag = std::max(max_zigzag, zigzag_encode(d));
+        }
+        unsigned delta_width = bits_needed(max_zigzag);
+
+        if (delta_width * (n - 1) < for_width * n)
+        {
+            encoding = ArchiveColumnEncoding::Delta;
+            width = delta_width;
+            base = quantized[0];
+            scale = static_cast<std::int64_t>(std::max<std::uint64_t>(1, delta_gcd));
+        }
+        else
+        {
+            encoding = ArchiveColumnEncoding::FrameOfReference;
+            width = for_width;
+            base = lo;
+            scale = static_cast<std::int64_t>(std::max<std::uint64_t>(1, for_gcd));
+        }
+    }
+    else
+    {
+        encoding = ArchiveColumnEncoding::FloatXor;
+        quantized.resize(n);
+        std::uint32_t prev = 0;
+        std::uint64_t all = 0;
+        for (std::size_t i = 0; i < n; i++)
+        {
+            std::uint32_t bits;
+            std::memcpy(&bits, &values[i], sizeof(bits));
+            quantized[i] = bits;
+            all |= i ? bits ^ prev : 0;
+            prev = bits;
+        }
+        width = bits_needed(all);
+        base = quantized[0];
+        scale = 1;
+    }
+
+    out.resize(ARCHIVE_COLUMN_HEADER_LEN);
+    out[0] = static_cast<std::uint8_t>(encoding);
+    out[1] = static_cast<std::uint8_t>(width);
+    put_le16(out.data() + 2, 0);
+    put_le_float(out.data() + 4, step);
+    put_le64(out.data() + 8, static_cast<std::uint64_t>(base));
+    put_le64(out.data() + 16, static_cast<std::uint64_t>(scale));
+
+    BitPacker packer(out, width);
+    switch (encoding)
+    {
+    case ArchiveColumnEncoding::FrameOfReference:
+        for (std::int64_t q : quantized)
+            packer.put(static_cast<std::uint64_t>((q - base) / scale));
+        break;
+    case ArchiveColumnEncoding::Delta:
+        for (std::size_t i = 1; i < n; i++)
+            packer.put(zigzag_encode((quantized[i] - quantized[i - 1]) / scale));
+        break;
+    case ArchiveColumnEncoding::FloatXor:
+        for (std::size_t i = 1; i < n; i++)
+            packer.put(static_cast<std::uint64_t>(quantized[i] ^ quantized[i - 1]));
+        break;
+    }
+    packer.finish();
+    stats.columns[static_cast<std::size_t>(encoding)]++;
+}
+
+bool ArchiveWriter::write(const std::vector<std::uint8_t>& bytes)
+{
+    file.write(reinterpret_cast<const char*>(bytes.data()),
+               static_cast<std::streamsize>(bytes.size()));
+    if (!file)
+    {
+        logger.log(LogLevel::error, "ArchiveWriter: Cannot write ", path, '\n');
+        return false;
+    }
+    stats.bytes += bytes.size();
+    return true;
+}
+
+/*
+ * Reads an archive through a memory mapping. Opening reads only the header
+ * and index; blocks are decoded on demand.
+ */
+class ArchiveReader
+{
+public:
+    bool open(const fs::path&);
+
+    const std::vector<std::string>& get_channel_names() const { return channel_names; }
+    std::chrono::nanoseconds get_block_duration() const { return std::chrono::nanoseconds(block_duration_ns); }
+    std::chrono::nanoseconds get_time_quantum() const { return std::chrono::nanoseconds(time_quantum_ns); }
+    const std::vector<ArchiveBlockInfo>& get_index() const { return index; }
+
+    /*
+     * The first block ending at or after time_ns, or the number of blocks if
+     * there is none.
+     */
+    std::size_t find_block(std::int64_t time_ns) const;
+
+    /*
+     * A channel's smallest and largest value in a block, from the block
+     * header. NaN if the channel has no values but NaN.
+     */
+    bool get_channel_range(std::size_t block, std::size_t channel, float& min, float& max) const;
+
+    bool decode_block(std::size_t block, ArchiveBlock&) const;
+private:
+    const std::uint8_t* block_header(std::size_t block) const;
+    bool decode_times(const std::uint8_t*, std::size_t len, std::int64_t first, std::int64_t* out,
+                      std::size_t n) const;
+    bool decode_column(const std::uint8_t*, std::size_t len, float* out, std::size_t n) const;
+
+    MappedFile file{};
+    const std::uint8_t* bytes = nullptr;
+    std::uint64_t index_offset = 0;
+
+    std::vector<std::string> channel_names{};
+    std::int64_t block_duration_ns = 0;
+    std::int64_t time_quantum_ns = 1;
+    std::vector<ArchiveBlockInfo> index{};
+};
+
+bool ArchiveReader::open(const fs::path& path)
+{
+    index.clear();
+    channel_names.clear();
+    if (!file.open(path))
+        return false;
+
+    Span<const char> data = file.data();
+    bytes = reinterpret_cast<const std::uint8_t*>(data.data());
+    std::size_t size = data.size();
+
+    auto fail = [&](const char* why)
+    {
+        logger.log(LogLevel::error, "ArchiveReader::open: ", path, ": ", why, '\n');
+        file.close();
+        index.clear();
+        channel_names.clear();
+        return false;
+    };
+
+    if (size < ARCHIVE_HEADER_LEN + ARCHIVE_FOOTER_LEN ||
+        std::memcmp(bytes, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0)
+        return fail("Not an archive");
+    if (get_le32(bytes + 8) != ARCHIVE_VERSION)
+        return fail("Unsupported version");
+
+    const std::uint8_t* footer = bytes + size - ARCHIVE_FOOTER_LEN;
+    if (std::memcmp(footer + 16, ARCHIVE_INDEX_MAGIC, sizeof(ARCHIVE_INDEX_MAGIC)) != 0)
+        return fail("No index, the archive may not have been closed");
+
+    std::size_t num_channels = get_le32(bytes + 12);
+    block_duration_ns = static_cast<std::int64_t>(get_le64(bytes + 16));
+    time_quantum_ns = static_cast<std::int64_t>(get_le64(bytes + 24));
+    index_offset = get_le64(footer);
+    std::uint64_t num_blocks = get_le64(footer + 8);
+
+    std::uint64_t index_len = size - ARCHIVE_FOOTER_LEN - ARCHIVE_HEADER_LEN;
+    if (index_offset < ARCHIVE_HEADER_LEN || time_quantum_ns < 1 ||
+        num_blocks > index_len / ARCHIVE_INDEX_ENTRY_LEN ||
+        index_offset + num_blocks * ARCHIVE_INDEX_ENTRY_LEN + ARCHIVE_FOOTER_LEN != size)
+        return fail("Corrupt header or footer");
+
+    std::size_t pos = ARCHIVE_HEADER_LEN;
+    for (std::size_t c = 0; c < num_channels; c++)
+    {
+        if (index_offset - pos < 2)
+            return fail("Corrupt channel names");
+        std::size_t len = get_le16(bytes + pos);
+        if (index_offset - pos - 2 < len)
+            return fail("Corrupt channel names");
+        channel_names.emplace_back(reinterpret_cast<const char*>(bytes + pos + 2), len);
+        pos += 2 + len;
+    }
+
+    std::size_t block_header_len = ARCHIVE_BLOCK_HEADER_LEN + 8 * num_channels;
+    index.resize(num_blocks);
+    const std::uint8_t* p = bytes + index_offset;
+    for (std::size_t i = 0; i < num_blocks; i++, p += ARCHIVE_INDEX_ENTRY_LEN)
+    {
+        auto& entry = index[i];
+        entry.first_time_ns = static_cast<std::int64_t>(get_le64(p));
+        entry.last_time_ns = static_cast<std::int64_t>(get_le64(p + 8));
+        entry.offset = get_le64(p + 16);
+        entry.count = get_le32(p + 24);
+        if (entry.offset < pos || entry.offset > index_offset ||
+            index_offset - entry.offset < block_header_len ||
+            (i && (entry.offset <= index[i - 1].offset ||
+                   entry.first_time_ns < index[i - 1].last_time_ns)))
+            return fail("Corrupt index");
+    }
+    return true;
+}
+
+std::size_t ArchiveReader::find_block(std::int64_t time_ns) const
+{
+    auto it = std::lower_bound(index.begin(), index.end(), time_ns,
+        [](const ArchiveBlockInfo& b, std::int64_t t) { return b.last_time_ns < t; });
+    return static_cast<std::size_t>(it - index.begin());
+}
+
+const std::uint8_t* ArchiveReader::block_header(std::size_t block) const
+{
+    return block < index.size() ? bytes + index[block].offset : nullptr;
+}
+
+bool ArchiveReader::get_channel_range(std::size_t block, std::size_t channel,
+                                      float& min, float& max) const
+{
+    const std::uint8_t* p = block_header(block);
+    if (!p || channel >= channel_names.size())
+        return false;
+
+    p += ARCHIVE_BLOCK_HEADER_LEN + 8 * channel;
+    min = get_le_float(p);
+    max = get_le_float(p + 4);
+    return true;
+}
+
+bool ArchiveReader::decode_block(std::size_t block, ArchiveBlock& out) const
+{
+    const std::uint8_t* p = block_header(block);
+    if (!p)
+        return false;
+
+    auto fail = [&](const char* why)
+    {
+        logger.log(LogLevel::error, "ArchiveReader::decode_block: Block ", block, ": ", why, '\n');
+        return false;
+    };
+
+    std::size_t num_channels = channel_names.size();
+    std::size_t header_len = ARCHIVE_BLOCK_HEADER_LEN + 8 * num_channels;
+    std::size_t n = get_le32(p);
+    std::size_t body_len = get_le32(p + 4);
+    if (n == 0 || n != index[block].count ||
+        body_len > index_offset - index[block].offset - header_len)
+        return fail("Corrupt header");
+
+    const std::uint8_t* body = p + header_len;
+    if (crc32({body, body_len}) != get_le32(p + 24))
+        return fail("CRC mismatch");
+
+    out.times.resize(n);
+    out.values.resize(n * num_channels);
+
+    const std::uint8_t* end = body + body_len;
+    for (std::size_t c = 0; c <= num_channels; c++)
+    {
+        if (end - body < 4)
+            return fail("Truncated body");
+        std::size_t len = get_le32(body);
+        body += 4;
+        if (static_cast<std::size_t>(end - body) < len)
+            return fail("Truncated body");
+
+        bool ok = c == 0 ?
+            decode_times(body, len, static_cast<std::int64_t>(get_le64(p + 8)), out.times.data(), n) :
+            decode_column(body, len, out.values.data() + (c - 1) * n, n);
+        if (!ok)
+            return fail("Corrupt column");
+        body += len;
+    }
+    return true;
+}
+
+bool ArchiveReader::decode_times(const std::uint8_t* p, std::size_t len, std::int64_t first,
+                                 std::int64_t* out, std::size_t n) const
+{
+    if (len < 1 || p[0] > ARCHIVE_MAX_BIT_WIDTH)
+        return false;
+
+    const unsigned width = p[0];
+    const std::uint64_t escape = (std::uint64_t{1} << width) - 1;
+    const std::uint8_t* packed = p + 1;
+    const std::uint8_t* escaped = packed + ((n - 1) * width + 7) / 8;
+    const std::uint8_t* end = p + len;
+    if (escaped > end)
+        return false;
+
+    std::int64_t q = 0;
+    std::int64_t delta = 0;
+    bool ok = true;
+    out[0] = first;
+    unpack_bits(packed, width, n - 1, [&](std::size_t i, std::uint64_t v)
+    {
+        if (width && v == escape && !(escaped = get_varint(escaped, end, v)))
+        {
+            // Finish the loop with zeros rather than break out of it.
+            ok = false;
+            escaped = end;
+            v = 0;
+        }
+        delta += zigzag_decode(v);
+        q += delta;
+        out[i + 1] = first + q * time_quantum_ns;
+    });
+    return ok && escaped == end;
+}
+
+bool ArchiveReader::decode_column(const std::uint8_t* p, std::size_t len, float* out,
+                                  std::size_t n) const
+{
+    if (len < ARCHIVE_COLUMN_HEADER_LEN)
+        return false;
+
+    auto encoding = static_cast<ArchiveColumnEncoding>(p[0]);
+    unsigned width = p[1];
+    float step = get_le_float(p + 4);
+    std::int64_t base = static_cast<std::int64_t>(get_le64(p + 8));
+    std::int64_t scale = static_cast<std::int64_t>(get_le64(p + 16));
+    const std::uint8_t* packed = p + ARCHIVE_COLUMN_HEADER_LEN;
+
+    std::size_t count = encoding == ArchiveColumnEncoding::FrameOfReference ? n : n - 1;
+    if (width > ARCHIVE_MAX_BIT_WIDTH ||
+        len - ARCHIVE_COLUMN_HEADER_LEN != (count * width + 7) / 8)
+        return false;
+
+    switch (encoding)
+    {
+    case ArchiveColumnEncoding::FrameOfReference:
+        unpack_bits(packed, width, count, [&](std::size_t i, std::uint64_t v)
+        {
+            out[i] = static_cast<float>(base + static_cast<std::int64_t>(v) * scale) * step;
+        });
+        return true;
+    case ArchiveColumnEncoding::Delta:
+    {
+        std::int64_t q = base;
+        out[0] = static_cast<float>(q) * step;
+        unpack_bits(packed, width, count, [&](std::size_t i, std::uint64_t v)
+        {
+            q += zigzag_decode(v) * scale;
+            out[i + 1] = static_cast<float>(q) * step;
+        });
+        return true;
+    }
+    case ArchiveColumnEncoding::FloatXor:
+    {
+        auto bits = static_cast<std::uint32_t>(base);
+        std::memcpy(out, &bits, sizeof(bits));
+        unpack_bits(packed, width, count, [&](std::size_t i, std::uint64_t v)
+        {
+            bits ^= static_cast<std::uint32_t>(v);
+            std::memcpy(out + i + 1, &bits, sizeof(bits));
+        });
+        return true;
+    }
+    }
+    return false;
+}
+
+#endif /* TELEMETRY_ARCHIVE_HPP */
@@ -0,0 +1,661 @@
+#ifndef TELEMETRY_FORMAT_HPP
+#define TELEMETRY_FORMAT_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#include "cobs.hpp"
+#include "logger.hpp"
+#include "shared.hpp"
+#include "static_telemetry_format.hpp"
+#include "telemetry_framing.hpp"
+#include "telemetry_schema.hpp"
+
+struct TelemetryData;
+struct TelemetryFormat;
+
+struct TelemetryFormat
+{
+    /*
+     * ASCII format, with each field at a fixed offset.
+     */
+    TelemetryFormat(std::size_t packet_len_,
+                    char start_symbol_,
+                    char stop_symbol_,
+                    std::size_t conversion_factor_,
+                    std::size_t element_size_,
+                    std::vector<std::size_t> accel_offsets_,
+                    std::vector<std::size_t> rot_rate_offsets_) :
+        framing(TelemetryFraming::Ascii),
+        packet_len(packet_len_),
+        encoded_len(packet_len_),
+        start_symbol(start_symbol_),
+        stop_symbol(stop_symbol_),
+        conversion_factor(conversion_factor_),
+        inv_conversion_factor(1.0f / conversion_factor_),
+        element_size(element_size_),
+        accel_offsets(accel_offsets_),
+        rot_rate_offsets(rot_rate_offsets_)
+    {}
+
+    /*
+     * ASCII format fixed at compile time, see static_telemetry_format.hpp.
+     * Packets are decoded by the layout's specialized decoder.
+     */
+    template <typename Fmt>
+    explicit TelemetryFormat(Fmt) :
+        framing(TelemetryFraming::Ascii),
+        packet_len(Fmt::packet_len),
+        encoded_len(Fmt::packet_len),
+        start_symbol(Fmt::start_symbol),
+        stop_symbol(Fmt::stop_symbol),
+        conversion_factor(Fmt::conversion_factor),
+        inv_conversion_factor(Fmt::inv_conversion_factor),
+        element_size(Fmt::element_size),
+        accel_offsets(Fmt::offsets.begin(), Fmt::offsets.begin() + 3),
+        rot_rate_offsets(Fmt::offsets.begin() + 3, Fmt::offsets.end()),
+        static_decoder(&StaticTelemetryDecoder<Fmt>::decode)
+    {}
+
+    /*
+     * COBS-framed binary format. The layout follows from the field type, see
+     * telemetry_framing.hpp. packet_len is the length after COBS decoding,
+     * encoded_len the longest valid frame on the wire (without delimiter).
+     */
+    TelemetryFormat(TelemetryFraming framing_,
+                    std::size_t conversion_factor_) :
+        framing(framing_),
+        packet_len(binary_packet_len(framing_, NUM_FIELDS)),
+        encoded_len(cobs_max_encoded_len(binary_packet_len(framing_, NUM_FIELDS))),
+        start_symbol(COBS_DELIMITER),
+        stop_symbol(COBS_DELIMITER),
+        conversion_factor(conversion_factor_),
+        inv_conversion_factor(1.0f / conversion_factor_),
+        element_size(binary_field_len(framing_)),
+        accel_offsets(binary_offsets(framing_, 0)),
+        rot_rate_offsets(binary_offsets(framing_, 3))
+    {}
+
+    /*
+     * Format loaded from a schema file. Fields are decoded by running the
+     * schema's program instead of through the offset lists.
+     */
+    explicit TelemetryFormat(const TelemetrySchema& schema) :
+        framing(schema.framing),
+        packet_len(schema.packet_len),
+        encoded_len(schema.framing == TelemetryFraming::Ascii ?
+            schema.packet_len : cobs_max_encoded_len(schema.packet_len)),
+        start_symbol(schema.start_symbol),
+        stop_symbol(schema.framing == TelemetryFraming::Ascii ?
+            schema.stop_symbol : COBS_DELIMITER),
+        conversion_factor(1),
+        inv_conversion_factor(1.0f),
+        element_size(0),
+        program(schema.program),
+        runs(schema.runs),
+        scales(schema.scales),
+        signs(schema.signs),
+        channel_names(schema.channel_names)
+    {}
+
+    const TelemetryFraming framing;
+    const std::size_t packet_len;
+    const std::size_t encoded_len;
+    const char start_symbol;
+    const char stop_symbol;
+    const std::size_t conversion_factor;
+    const float inv_conversion_factor;
+    const std::size_t element_size;
+    const std::vector<std::size_t> accel_offsets{};
+    const std::vector<std::size_t> rot_rate_offsets{};
+
+    // Only set for compile-time formats.
+    bool (* const static_decoder)(std::string_view, glm::vec3&, glm::vec3&) = nullptr;
+
+    // Only used by schema formats.
+    const std::vector<DecodeOp> program{};
+    const std::vector<DecodeRun> runs{};
+    const std::vector<float> scales{};
+    const std::vector<std::uint32_t> signs{};
+    const std::vector<std::string> channel_names{
+        STANDARD_CHANNELS.begin(), STANDARD_CHANNELS.end()};
+private:
+    static constexpr std::size_t NUM_FIELDS = 6;
+
+    static std::vector<std::size_t> binary_offsets(TelemetryFraming framing,
+                                                   std::size_t first_field)
+    {
+        std::vector<std::size_t> offsets;
+        for (std::size_t i = first_field; i < first_field + 3; i++)
+            offsets.push_back(BINARY_SEQ_LEN + i * binary_field_len(framing));
+        return offsets;
+    }
+};
+
+/*
+ * Telemetry data which comes from the telemetry board via an external serial
+ * connection.
+ */
+class TelemetryData
+{
+public:
+    /*
+     * Bad packets are logged unless log_errors_ is false, for callers which
+     * count them instead or can't share the logger between threads.
+     */
+    explicit TelemetryData(const TelemetryFormat& fmt_, bool log_errors_ = true) :
+        fmt(fmt_),
+        log_errors(log_errors_),
+        runs(compile_runs(fmt_)),
+        channels(fmt_.channel_names.size())
+    {}
+
+    DroneData& operator=(const TelemetryData&);
+
+    /*
+     * Decodes a complete packet in place.
+     *
+     * ASCII fields are fixed-width, zero-padded signed integers which must fill
+     * their whole width. Binary packets have already passed their CRC check
+     * during framing. Integer fields are scaled by the reciprocal of the
+     * conversion factor.
+     */
+    bool extract_packet_data(std::string_view packet)
+    {
+        if (packet.size() != fmt.packet_len)
+        {
+            if (log_errors)
+                logger.log(LogLevel::error, "Packet incorrect length.\n");
+            return false;
+        }
+
+        if (fmt.static_decoder)
+        {
+            if (!fmt.static_decoder(packet, accel, rot_rate))
+            {
+                if (log_errors)
+                    logger.log(LogLevel::error, "Packet field malformed.\n");
+                return false;
+            }
+            set_standard_channels();
+            return true;
+        }
+
+        if (!fmt.program.empty())
+        {
+            if (fmt.framing != TelemetryFraming::Ascii)
+                seq = get_le16(reinterpret_cast<const std::uint8_t*>(packet.data()));
+            return run_program(packet);
+        }
+
+        if (fmt.framing != TelemetryFraming::Ascii)
+        {
+            auto bytes = reinterpret_cast<const std::uint8_t*>(packet.data());
+            seq = get_le16(bytes);
+            for (std::size_t i = 0; i < 3; i++)
+            {
+                accel[i] = binary_field(bytes + fmt.accel_offsets[i]);
+                rot_rate[i] = binary_field(bytes + fmt.rot_rate_offsets[i]);
+            }
+            set_standard_channels();
+            return true;
+        }
+
+        bool ok = true;
+        for (std::size_t i = 0; i < 3; i++)
+        {
+            ok &= parse_field(packet, fmt.accel_offsets[i], accel[i]);
+            ok &= parse_field(packet, fmt.rot_rate_offsets[i], rot_rate[i]);
+        }
+
+        if (!ok)
+        {
+            if (log_errors)
+                logger.log(LogLevel::error, "Packet field malformed.\n");
+            return false;
+        }
+
+        set_standard_channels();
+        return true;
+    }
+
+    // Passes the values through; accel->pos and rot_rate->rot are done by
+    // TelemetryManager's position and attitude estimators when enabled.
+    DroneData get_raw_drone_data() const
+    {
+        return DroneData(accel, rot_rate);
+    }
+
+    glm::vec3 get_accel() const { return accel; }
+    glm::vec3 get_rot_rate() const { return rot_rate; }
+
+    // Sequence number of the last binary packet.
+    std::uint16_t get_seq() const { return seq; }
+
+    // Value of every channel in the format, indexed like its channel_names.
+    const std::vector<float>& get_channels() const { return channels; }
+private:
+    /*
+     * A run of a schema's program bound to the loop specialized for its type
+     * and field width, with its fields' tables and, for a binary run, where
+     * it starts in the packet and the channels looked up in advance.
+     */
+    struct CompiledRun;
+    using RunDecoder = bool (*)(const CompiledRun&, const std::uint8_t*, float*);
+
+    struct CompiledRun
+    {
+        RunDecoder decode;
+        const DecodeOp* ops;
+        const float* scales;
+        const std::uint32_t* signs;
+        std::size_t count;
+        std::size_t offset;
+        std::size_t channel;
+    };
+
+    const TelemetryFormat& fmt;
+    const bool log_errors;
+
+    // One per run of the format's program.
+    const std::vector<CompiledRun> runs;
+
+    /*
+     * Picks each run's decoder once rather than per packet. Each is a
+     * function of its own, so none of them weighs on the code generated for
+     * the others.
+     */
+    static std::vector<CompiledRun> compile_runs(const TelemetryFormat& fmt)
+    {
+        std::vector<CompiledRun> runs;
+        for (const DecodeRun& run : fmt.runs)
+        {
+            const DecodeOp& first = fmt.program[run.first];
+            CompiledRun compiled{nullptr, &first, fmt.scales.data() + run.first,
+                fmt.signs.data() + run.first, run.count, first.offset, first.channel};
+            switch (run.type)
+            {
+            case DecodeOpType::Ascii:
+                switch (run.ascii_width)
+                {
+                case 1: compiled.decode = ascii_decoder<1>(run); break;
+                case 2: compiled.decode = ascii_decoder<2>(run); break;
+                case 3: compiled.decode = ascii_decoder<3>(run); break;
+                case 4: compiled.decode = ascii_decoder<4>(run); break;
+                case 5: compiled.decode = ascii_decoder<5>(run); break;
+                case 6: compiled.decode = ascii_decoder<6>(run); break;
+                case 7: compiled.decode = ascii_decoder<7>(run); break;
+                case 8: compiled.decode = ascii_decoder<8>(run); break;
+                default: compiled.decode = &decode_ascii_run<0, false>; break;
+                }
+                break;
+            case DecodeOpType::Int8: compiled.decode = &decode_binary_run<std::uint8_t>; break;
+            case DecodeOpType::Int16: compiled.decode = &decode_binary_run<std::uint16_t>; break;
+            case DecodeOpType::Int32: compiled.decode = &decode_binary_run<std::uint32_t>; break;
+            default: compiled.decode = &decode_binary_run<float>; break;
+            }
+            runs.push_back(compiled);
+        }
+        return runs;
+    }
+
+    template <std::size_t Width>
+    static RunDecoder ascii_decoder(const DecodeRun& run)
+    {
+        return run.ascii_backward ? &decode_ascii_run<Width, true> :
+            &decode_ascii_run<Width, false>;
+    }
+
+    /*
+     * Executes a schema format's decode program, one loop per run. Offsets
+     * and widths were checked against the packet length when the schema was
+     * loaded.
+     */
+    bool run_program(std::string_view packet)
+    {
+        auto bytes = reinterpret_cast<const std::uint8_t*>(packet.data());
+        float* out = channels.data();
+
+        bool ok = true;
+        for (const CompiledRun& run : runs)
+            ok &= run.decode(run, bytes, out);
+
+        if (!ok)
+        {
+            if (log_errors)
+                logger.log(LogLevel::error, "Packet field malformed.\n");
+            return false;
+        }
+
+        accel = glm::vec3(out[0], out[1], out[2]);
+        rot_rate = glm::vec3(out[3], out[4], out[5]);
+        return true;
+    }
+
+    /*
+     * An ASCII run whose fields are all Width wide with 8 bytes readable from
+     * their start, or up to their end if Backward, or any ASCII run for a
+     * Width of 0.
+     */
+    template <std::size_t Width, bool Backward>
+    static bool decode_ascii_run(const CompiledRun& run, const std::uint8_t* bytes, float* out)
+    {
+        const DecodeOp* op = run.ops;
+        const float* scale = run.scales;
+
+        bool ok = true;
+        std::size_t i = 0;
+#if defined(__SSE2__)
+        if constexpr (Width != 0)
+        {
+            for (; i + 2 <= run.count; i += 2)
+            {
+                std::int32_t v0;
+                std::int32_t v1;
+                ok &= parse_decimal8_pair<Width, Backward>(bytes + op[i].offset,
+                    bytes + op[i + 1].offset, v0, v1);
+                out[op[i].channel] = static_cast<float>(v0) * scale[i];
+                out[op[i + 1].channel] = static_cast<float>(v1) * scale[i + 1];
+            }
+        }
+#endif
+        for (; i < run.count; i++)
+        {
+            std::int32_t v;
+            if constexpr (Width == 0)
+                ok &= parse_decimal(bytes + op[i].offset, op[i].width, v);
+            else
+                ok &= parse_decimal8<Width, Backward>(bytes + op[i].offset, v);
+            out[op[i].channel] = static_cast<float>(v) * scale[i];
+        }
+        return ok;
+    }
+
+    /*
+     * A binary run of fields of type T, which stands for both signednesses of
+     * an integer type. The fields and their channels are consecutive.
+     */
+    template <typename T>
+    static bool decode_binary_run(const CompiledRun& run, const std::uint8_t* bytes, float* out)
+    {
+        const std::uint8_t* src = bytes + run.offset;
+        float* dst = out + run.channel;
+        const float* scale = run.scales;
+        const std::uint32_t* sign = run.signs;
+
+#if defined(__SSE2__)
+        // Eight int16 fields at a time, the last eight overlapping the ones
+        // before rather than leaving some for the loop below.
+        if constexpr (sizeof(T) == 2)
+        {
+            if (run.count >= 8)
+            {
+                for (std::size_t i = 0;; i += 8)
+                {
+                    i = std::min<std::size_t>(i, run.count - 8);
+                    __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+                    __m128i sign_lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sign + i));
+                    __m128i sign_hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sign + i + 4));
+                    __m128i lo = _mm_unpacklo_epi16(raw, _mm_setzero_si128());
+                    __m128i hi = _mm_unpackhi_epi16(raw, _mm_setzero_si128());
+                    lo = _mm_sub_epi32(_mm_xor_si128(lo, sign_lo), sign_lo);
+                    hi = _mm_sub_epi32(_mm_xor_si128(hi, sign_hi), sign_hi);
+                    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), _mm_loadu_ps(scale + i)));
+                    _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), _mm_loadu_ps(scale + i + 4)));
+                    if (i + 8 == run.count)
+                        return true;
+                }
+            }
+        }
+#endif
+        for (std::size_t i = 0; i < run.count; i++)
+        {
+            const std::uint8_t* p = src + i * sizeof(T);
+            float value;
+            if constexpr (std::is_same_v<T, float>)
+                value = get_le_float(p);
+            else if constexpr (sizeof(T) == 4)
+                value = static_cast<float>(static_cast<std::int64_t>(get_le32(p) ^ sign[i]) -
+                    static_cast<std::int64_t>(sign[i]));
+            else if constexpr (sizeof(T) == 2)
+                value = static_cast<float>(static_cast<std::int32_t>(
+                    (get_le16(p) ^ sign[i]) - sign[i]));
+            else
+                value = static_cast<float>(static_cast<std::int32_t>((p[0] ^ sign[i]) - sign[i]));
+            dst[i] = value * scale[i];
+        }
+        return true;
+    }
+
+    /*
+     * Parses a schema's ASCII field: a zero-padded, optionally negative
+     * integer filling its whole width, which must fit an int. Like
+     * StaticTelemetryDecoder's parser, but for a width only known at runtime.
+     * v is written even on failure.
+     */
+    static bool parse_decimal(const std::uint8_t* p, std::size_t width, std::int32_t& v)
+    {
+        const bool neg = p[0] == '-';
+
+        // The minus sign is read as a leading zero, so the loop runs the same
+        // number of times for every field of a width. Schemas allow up to 11
+        // characters, which can't overflow 64 bits.
+        std::uint64_t value = 0;
+        bool ok = width > std::size_t(neg);
+        for (std::size_t i = 0; i < width; i++)
+        {
+            unsigned digit = p[i] - unsigned('0');
+            digit = i == 0 && neg ? 0 : digit;
+            ok &= digit < 10;
+            value = value * 10 + digit;
+        }
+
+        ok &= value <= (neg ? 0x80000000u : 0x7fffffffu);
+        v = static_cast<std::int32_t>(neg ? 0 - value : value);
+        return ok;
+    }
+
+    /*
+     * The field Width wide at p, in the top bytes of a word, which are the
+     * end of the number since the word is little-endian, with '0' filled in
+     * below as leading zeros. The word is read from p on, or if Backward, up
+     * to the end of the field.
+     */
+    template <std::size_t Width, bool Backward>
+    static std::uint64_t load_decimal8(const std::uint8_t* p)
+    {
+        static_assert(Width > 0 && Width <= 8, "Field must fit a word");
+        constexpr unsigned PAD = 8 * (8 - Width);
+        constexpr std::uint64_t BELOW = (std::uint64_t(1) << PAD) - 1;
+
+        std::uint64_t word;
+        if constexpr (Backward)
+            word = get_le64(p - (8 - Width)) & ~BELOW;
+        else
+            word = get_le64(p) << PAD;
+        return word | (0x3030303030303030 & BELOW);
+    }
+
+    /*
+     * parse_decimal for a field Width wide with a word readable at it, see
+     * load_decimal8. All the digits are checked and combined at once in the
+     * word, without branches, since the sign of real data is unpredictable.
+     */
+    template <std::size_t Width, bool Backward>
+    static bool parse_decimal8(const std::uint8_t* p, std::int32_t& v)
+    {
+        constexpr unsigned PAD = 8 * (8 - Width);
+        constexpr std::uint64_t ZEROS = 0x3030303030303030;
+        const unsigned neg = p[0] == '-';
+
+        // The minus sign is read as a leading zero too.
+        std::uint64_t chunk = load_decimal8<Width, Backward>(p);
+        chunk += std::uint64_t(('0' - '-') * neg) << PAD;
+
+        // Every byte must now be 0 to 9. Bytes below '0' borrow and bytes
+        // above '9' reach 0x80 when 0x76 is added, so either sets a top bit.
+        chunk -= ZEROS;
+        bool ok = (Width > neg) &
+            ((((chunk + 0x7676767676767676) | chunk) & 0x8080808080808080) == 0);
+
+        // Combine neighbouring digits into pairs, then the pairs into the
+        // whole number.
+        chunk = chunk * 10 + (chunk >> 8);
+        chunk = ((chunk & 0x000000ff000000ff) * (100 + (1000000ull << 32)) +
+                 ((chunk >> 16) & 0x000000ff000000ff) * (1 + (10000ull << 32))) >> 32;
+
+        auto value = static_cast<std::int32_t>(chunk);
+        std::int32_t sign = -static_cast<std::int32_t>(neg);
+        v = (value ^ sign) - sign;
+        return ok;
+    }
+
+#if defined(__SSE2__)
+    /*
+     * parse_decimal8 for two fields at once, one per half of an SSE register.
+     * The digits are combined with multiply-adds rather than the 64-bit
+     * multiplies, which SSE2 lacks.
+     */
+    template <std::size_t Width, bool Backward>
+    static bool parse_decimal8_pair(const std::uint8_t* p0, const std::uint8_t* p1,
+                                    std::int32_t& v0, std::int32_t& v1)
+    {
+        constexpr unsigned PAD = 8 * (8 - Width);
+        const unsigned neg0 = p0[0] == '-';
+        const unsigned neg1 = p1[0] == '-';
+
+        // As in parse_decimal8, but a minus sign is cleared to a zero digit
+        // after the digits are found.
+        __m128i chunk = _mm_set_epi64x(
+            static_cast<long long>(load_decimal8<Width, Backward>(p1)),
+            static_cast<long long>(load_decimal8<Width, Backward>(p0)));
+        __m128i minus = _mm_and_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('-')),
+            _mm_set1_epi64x(static_cast<long long>(std::uint64_t(0xff) << PAD)));
+        __m128i digits = _mm_andnot_si128(minus, _mm_sub_epi8(chunk, _mm_set1_epi8('0')));
+
+        // Every byte must be 0 to 9, so saturate to 0 when 9 is subtracted.
+        __m128i above_9 = _mm_subs_epu8(digits, _mm_set1_epi8(9));
+        bool ok = (Width > neg0) & (Width > neg1) &
+            (_mm_movemask_epi8(_mm_cmpeq_epi8(above_9, _mm_setzero_si128())) == 0xffff);
+
+        // Digits into pairs, pairs into groups of four, then the two groups of
+        // each field into its number.
+        __m128i pairs = _mm_add_epi16(
+            _mm_mullo_epi16(_mm_and_si128(digits, _mm_set1_epi16(0xff)), _mm_set1_epi16(10)),
+            _mm_srli_epi16(digits, 8));
+        __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32((1 << 16) | 100));
+        quads = _mm_packs_epi32(quads, quads);
+        __m128i values = _mm_madd_epi16(quads, _mm_set1_epi32((1 << 16) | 10000));
+
+        std::int32_t sign0 = -static_cast<std::int32_t>(neg0);
+        std::int32_t sign1 = -static_cast<std::int32_t>(neg1);
+        v0 = (_mm_cvtsi128_si32(values) ^ sign0) - sign0;
+        v1 = (_mm_cvtsi128_si32(_mm_srli_si128(values, 4)) ^ sign1) - sign1;
+        return ok;
+    }
+#endif
+
+    // Fixed formats only have the standard channels, in STANDARD_CHANNELS
+    // order.
+    void set_standard_channels()
+    {
+        for (std::size_t i = 0; i < 3; i++)
+        {
+            channels[i] = accel[i];
+            channels[3 + i] = rot_rate[i];
+        }
+    }
+
+    bool parse_field(std::string_view packet, std::size_t offset, float& out) const
+    {
+        const char* first = packet.data() + offset;
+        const char* last = first + fmt.element_size;
+
+        int value;
+        auto [ptr, ec] = std::from_chars(first, last, value);
+        if (ec != std::errc() || ptr != last)
+            return false;
+
+        out = value * fmt.inv_conversion_factor;
+        return true;
+    }
+
+    float binary_field(const std::uint8_t* p) const
+    {
+        if (fmt.framing == TelemetryFraming::CobsFloat32)
+            return get_le_float(p);
+        return static_cast<std::int16_t>(get_le16(p)) * fmt.inv_conversion_factor;
+    }
+
+    glm::vec3 accel{};
+    glm::vec3 rot_rate{};
+    std::uint16_t seq{};
+    std::vector<float> channels;
+};
+
+/*
+ * Definitions requiring complete definitions of DroneData and TelemetryData.
+ */
+DroneData& DroneData::operator=(const TelemetryData& tel)
+{
+    position = tel.get_accel();
+    orientation = tel.get_rot_rate();
+    attitude = orientation_to_quat(orientation);
+
+    return *this;
+}
+
+/*
+ * The ground station's ASCII packets, as sent by the bundled Arduino sketch and
+ * prometheus_sim. Field offsets: accel x, y, z, then rot_rate x, y, z.
+ */
+constexpr std::size_t GROUND_STATION_PACKET_LEN = 37;
+constexpr char GROUND_STATION_START_SYMBOL = '|';
+constexpr char GROUND_STATION_STOP_SYMBOL = '\n';
+constexpr std::size_t GROUND_STATION_CONVERSION_FACTOR = 1000;
+constexpr std::size_t GROUND_STATION_FIELD_LEN = 5;
+
+using GroundStationFormat = StaticTelemetryFormat<
+    GROUND_STATION_PACKET_LEN,
+    GROUND_STATION_START_SYMBOL,
+    GROUND_STATION_STOP_SYMBOL,
+    GROUND_STATION_CONVERSION_FACTOR,
+    GROUND_STATION_FIELD_LEN,
+    1, 7, 13,
+    19, 25, 31>;
+
+/*
+ * A schema file takes precedence if given. Otherwise the ASCII layout is
+ * fixed at compile time by GroundStationFormat, and binary layouts follow from
+ * the field type.
+ */
+std::optional<TelemetryFormat> make_telemetry_format(TelemetryFraming framing,
+                                                     const std::string& schema_path)
+{
+    if (!schema_path.empty())
+    {
+        auto schema = load_telemetry_schema(schema_path);
+        if (!schema) return std::nullopt;
+        return TelemetryFormat(*schema);
+    }
+
+    if (framing != TelemetryFraming::Ascii)
+        return TelemetryFormat(framing, GROUND_STATION_CONVERSION_FACTOR);
+
+    return TelemetryFormat(GroundStationFormat{});
+}
+
+#endif /* TELEMETRY_FORMAT_HPP */
@@ -0,0 +1,101 @@
+#ifndef TELEMETRY_FRAMING_HPP
+#define TELEMETRY_FRAMING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * Wire formats for telemetry packets.
+ *
+ * Ascii is the ground station's original format: fixed-width decimal fields
+ * between a start symbol and a stop symbol.
+ *
+ * The Cobs formats are binary. Each packet is COBS encoded and terminated by a
+ * zero byte. Before encoding, a packet is laid out as follows, all
+ * little-endian:
+ *
+ *     seq (u16) | fields (int16 or float32) | crc (u16)
+ *
+ * seq increments by one per packet so the receiver can count lost packets, and
+ * the CRC-16/CCITT covers seq and the fields. int16 fields are scaled by the
+ * format's conversion factor like the ASCII fields, float32 fields are sent in
+ * physical units.
+ */
+enum class TelemetryFraming : std::uint8_t
+{
+    Ascii,
+    CobsInt16,
+    CobsFloat32,
+};
+
+constexpr char COBS_DELIMITER = '\0';
+constexpr std::size_t BINARY_SEQ_LEN = 2;
+constexpr std::size_t BINARY_CRC_LEN = 2;
+
+constexpr std::size_t binary_field_len(TelemetryFraming framing)
+{
+    return framing == TelemetryFraming::CobsFloat32 ? 4 : 2;
+}
+
+constexpr std::size_t binary_packet_len(TelemetryFraming framing,
+                                        std::size_t num_fields)
+{
+    return BINARY_SEQ_LEN + num_fields * binary_field_len(framing) +
+        BINARY_CRC_LEN;
+}
+
+/*
+ * Little-endian accessors, independent of host byte order.
+ */
+void put_le16(std::uint8_t* p, std::uint16_t v)
+{
+    p[0] = static_cast<std::uint8_t>(v);
+    p[1] = static_cast<std::uint8_t>(v >> 8);
+}
+
+std::uint16_t get_le16(const std::uint8_t* p)
+{
+    return static_cast<std::uint16_t>(p[0] | (p[1] << 8));
+}
+
+std::uint32_t get_le32(const std::uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) |
+        (static_cast<std::uint32_t>(p[3]) << 24);
+}
+
+void put_le32(std::uint8_t* p, std::uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+}
+
+void put_le64(std::uint8_t* p, std::uint64_t v)
+{
+    for (int i = 0; i < 8; i++)
+        p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+}
+
+std::uint64_t get_le64(const std::uint8_t* p)
+{
+    return get_le32(p) | (static_cast<std::uint64_t>(get_le32(p + 4)) << 32);
+}
+
+void put_le_float(std::uint8_t* p, float f)
+{
+    std::uint32_t v;
+    std::memcpy(&v, &f, sizeof(v));
+    for (int i = 0; i < 4; i++)
+        p[i] = static_cast<std::uint8_t>(v >> (8 * i));
+}
+
+float get_le_float(const std::uint8_t* p)
+{
+    std::uint32_t v = get_le32(p);
+    float f;
+    std::memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+#endif /* TELEMETRY_FRAMING_HPP */
@@ -0,0 +1,17 @@
+#ifndef TELEMETRY_MODE_HPP
+#define TELEMETRY_MODE_HPP
+
+#include <cstdint>
+
+/*
+ * How many of the packets received since the previous pipeline pass are
+ * processed. Latest only uses the newest complete packet, Lossless feeds every
+ * complete packet through the filter in arrival order.
+ */
+enum class TelemetryMode : std::uint8_t
+{
+    Latest,
+    Lossless,
+};
+
+#endif /* TELEMETRY_MODE_HPP */
@@ -0,0 +1,381 @@
+#ifndef TELEMETRY_SCHEMA_HPP
+#define TELEMETRY_SCHEMA_HPP
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "logger.hpp"
+#include "telemetry_framing.hpp"
+
+namespace fs = std::filesystem;
+
+/*
+ * Packet layouts described in a text file, so new fields can be added without
+ * recompiling. Example (see assets/schemas):
+ *
+ *     framing ascii          # ascii, cobs or cobs-f32
+ *     length 43              # packet length (decoded length for cobs)
+ *     start 0x7c             # start/stop symbols, ascii only
+ *     stop 0x0a
+ *
+ *     # field <name> <offset> <width> <type> <scale> [channel]
+ *     field ax 1 5 ascii 0.001 accel.x
+ *     field batt 37 5 ascii 0.001
+ *
+ * Types are ascii (fixed-width decimal integer), i8, u8, i16, u16, i32, u32
+ * and f32 (little-endian). Each decoded value is multiplied by its scale and
+ * written to its channel, which defaults to the field name. The channels
+ * accel.{x,y,z} and rot_rate.{x,y,z} drive the drone model; any other channel
+ * name creates an extra channel.
+ *
+ * On load, the fields are compiled into a flat table of DecodeOps with every
+ * name already resolved to a channel index, and the table is cut into
+ * DecodeRuns of consecutive fields which decode the same way. Decoding a
+ * packet is then one call per run, to a loop specialized for it, with every
+ * choice made up front.
+ */
+enum class DecodeOpType : std::uint8_t
+{
+    Ascii,
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+};
+
+struct DecodeOp
+{
+    DecodeOpType type;
+    std::uint8_t width;
+    std::uint16_t offset;
+    std::uint16_t channel;
+};
+
+/*
+ * Consecutive ops decoded by the same loop. type is Ascii, Float32 or the
+ * signed type of the ops' width, which stands for the unsigned one too.
+ *
+ * A binary run's fields are back to back in the packet and go to consecutive
+ * channels, so the run is a plain loop which the compiler can vectorize. An
+ * ASCII run's ascii_width is set when every field has that width and 8 bytes
+ * of packet from its offset on, or up to its end if ascii_backward is set, so
+ * each can be parsed as one word by code specialized for the width.
+ */
+struct DecodeRun
+{
+    DecodeOpType type;
+    std::uint8_t ascii_width;
+    bool ascii_backward;
+    std::uint16_t first;
+    std::uint16_t count;
+};
+
+/*
+ * Channels with a fixed index, in this order, ahead of any extra channels.
+ */
+const std::array<std::string, 6> STANDARD_CHANNELS = {
+    "accel.x", "accel.y", "accel.z",
+    "rot_rate.x", "rot_rate.y", "rot_rate.z",
+};
+
+/*
+ * Optional channel carrying the drone's clock in seconds, used to timestamp
+ * samples instead of their arrival time. Channels are floats, so resolution
+ * degrades to about 1 ms after 4.6 hours of drone uptime.
+ */
+const std::string DRONE_TIME_CHANNEL = "time";
+
+struct TelemetrySchema
+{
+    TelemetryFraming framing = TelemetryFraming::Ascii;
+    std::size_t packet_len{};
+    char start_symbol = '|';
+    char stop_symbol = '\n';
+
+    std::vector<DecodeOp> program{};
+    std::vector<DecodeRun> runs{};
+
+    // Indexed like program, and kept apart from it so that a run's values are
+    // contiguous for vector loads. A sign is the sign bit of a signed integer
+    // type and 0 otherwise: (raw ^ sign) - sign sign-extends the raw bits, so
+    // signed and unsigned fields decode alike.
+    std::vector<float> scales{};
+    std::vector<std::uint32_t> signs{};
+
+    std::vector<std::string> channel_names{};
+};
+
+namespace schema_detail
+{
+
+bool parse_type(const std::string& s, DecodeOpType& type, std::size_t& size,
+                std::uint32_t& sign)
+{
+    struct TypeName
+    {
+        const char* name;
+        DecodeOpType type;
+        std::size_t size;
+        std::uint32_t sign;
+    };
+    static const TypeName types[] = {
+        {"ascii", DecodeOpType::Ascii, 0, 0},
+        {"i8", DecodeOpType::Int8, 1, 0x80},
+        {"u8", DecodeOpType::UInt8, 1, 0},
+        {"i16", DecodeOpType::Int16, 2, 0x8000},
+        {"u16", DecodeOpType::UInt16, 2, 0},
+        {"i32", DecodeOpType::Int32, 4, 0x80000000},
+        {"u32", DecodeOpType::UInt32, 4, 0},
+        {"f32", DecodeOpType::Float32, 4, 0},
+    };
+
+    for (auto& t : types)
+    {
+        if (s == t.name)
+        {
+            type = t.type;
+            size = t.size;
+            sign = t.sign;
+            return true;
+        }
+    }
+    return false;
+}
+
+DecodeOpType run_type(DecodeOpType type)
+{
+    switch (type)
+    {
+    case DecodeOpType::UInt8: return DecodeOpType::Int8;
+    case DecodeOpType::UInt16: return DecodeOpType::Int16;
+    case DecodeOpType::UInt32: return DecodeOpType::Int32;
+    default: return type;
+    }
+}
+
+/*
+ * Cuts a checked program into runs, each as long as possible.
+ */
+std::vector<DecodeRun> group_runs(const std::vector<DecodeOp>& program,
+                                  std::size_t packet_len)
+{
+    std::vector<DecodeRun> runs;
+    for (std::size_t i = 0; i < program.size(); i++)
+    {
+        const DecodeOp& op = program[i];
+        DecodeOpType type = run_type(op.type);
+
+        // Fields near the end of the packet are read from the word ending
+        // with them instead.
+        bool forward = op.offset + 8u <= packet_len;
+        bool backward = !forward && op.offset + op.width >= 8u;
+        std::uint8_t ascii_width =
+            op.type == DecodeOpType::Ascii && op.width <= 8 && (forward || backward) ?
+            op.width : 0;
+        bool ascii_backward = ascii_width != 0 && backward;
+
+        if (!runs.empty())
+        {
+            DecodeRun& run = runs.back();
+            const DecodeOp& first = program[run.first];
+            bool joins = run.type == type && run.ascii_width == ascii_width &&
+                run.ascii_backward == ascii_backward;
+            if (type != DecodeOpType::Ascii)
+                joins &= op.offset == first.offset + run.count * first.width &&
+                    op.channel == first.channel + run.count;
+            if (joins)
+            {
+                run.count++;
+                continue;
+            }
+        }
+        runs.push_back({type, ascii_width, ascii_backward, static_cast<std::uint16_t>(i), 1});
+    }
+    return runs;
+}
+
+bool parse_framing(const std::string& s, TelemetryFraming& framing)
+{
+    if (s == "ascii")
+        framing = TelemetryFraming::Ascii;
+    else if (s == "cobs")
+        framing = TelemetryFraming::CobsInt16;
+    else if (s == "cobs-f32")
+        framing = TelemetryFraming::CobsFloat32;
+    else
+        return false;
+    return true;
+}
+
+std::size_t resolve_channel(const std::string& name,
+                            std::vector<std::string>& channel_names)
+{
+    for (std::size_t i = 0; i < channel_names.size(); i++)
+    {
+        if (channel_names[i] == name)
+            return i;
+    }
+    channel_names.push_back(name);
+    return channel_names.size() - 1;
+}
+
+/*
+ * Parses a start/stop symbol, given as a number in any base strtol accepts.
+ */
+bool parse_symbol(const std::string& s, char& symbol)
+{
+    char* end;
+    errno = 0;
+    long value = std::strtol(s.c_str(), &end, 0);
+    if (end == s.c_str() || *end != '\0' || errno == ERANGE ||
+        value < 0 || value > 255)
+        return false;
+    symbol = static_cast<char>(value);
+    return true;
+}
+
+}  // namespace schema_detail
+
+/*
+ * Loads and compiles a schema file. Errors are logged with their line number
+ * and result in std::nullopt.
+ */
+std::optional<TelemetrySchema> load_telemetry_schema(const fs::path& path)
+{
+    using namespace schema_detail;
+
+    std::ifstream file(path);
+    if (!file)
+    {
+        logger.log(LogLevel::error, "load_telemetry_schema: Cannot open ",
+            path, '\n');
+        return std::nullopt;
+    }
+
+    TelemetrySchema schema{};
+    schema.channel_names.assign(STANDARD_CHANNELS.begin(), STANDARD_CHANNELS.end());
+
+    auto fail = [&](std::size_t line_num, const std::string& msg)
+    {
+        logger.log(LogLevel::error, "load_telemetry_schema: ", path, ":",
+            line_num, ": ", msg, '\n');
+        return std::nullopt;
+    };
+
+    std::string line;
+    std::size_t line_num = 0;
+    while (std::getline(file, line))
+    {
+        line_num++;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream ss(line);
+        std::string keyword;
+        if (!(ss >> keyword))
+            continue;
+
+        if (keyword == "framing")
+        {
+            std::string value;
+            if (!(ss >> value) || !parse_framing(value, schema.framing))
+                return fail(line_num, "Unknown framing");
+        }
+        else if (keyword == "length")
+        {
+            if (!(ss >> schema.packet_len) || schema.packet_len == 0)
+                return fail(line_num, "Invalid length");
+        }
+        else if (keyword == "start" || keyword == "stop")
+        {
+            std::string value;
+            if (!(ss >> value))
+                return fail(line_num, "Missing symbol");
+            if (!parse_symbol(value, keyword == "start" ? schema.start_symbol : schema.stop_symbol))
+                return fail(line_num, "Invalid symbol " + value + ", expected 0-255");
+        }
+        else if (keyword == "field")
+        {
+            std::string name;
+            std::string type_name;
+            std::size_t offset;
+            std::size_t width;
+            float scale;
+            if (!(ss >> name >> offset >> width >> type_name >> scale))
+                return fail(line_num, "Expected: field <name> <offset> <width> <type> <scale> [channel]");
+
+            std::string channel = name;
+            ss >> channel;
+
+            DecodeOpType type;
+            std::size_t type_size;
+            std::uint32_t sign;
+            if (!parse_type(type_name, type, type_size, sign))
+                return fail(line_num, "Unknown type " + type_name);
+            if (type_size && width != type_size)
+                return fail(line_num, "Width doesn't match type " + type_name);
+            if (width == 0 || width > 11)
+                return fail(line_num, "Invalid width");
+            // DecodeOp holds offsets and channels in 16 bits, so anything
+            // larger is rejected before it can wrap.
+            if (offset > UINT16_MAX)
+                return fail(line_num, "Offset " + std::to_string(offset) + " too large");
+            std::size_t channel_index = resolve_channel(channel, schema.channel_names);
+            if (channel_index > UINT16_MAX)
+                return fail(line_num, "Too many channels");
+
+            DecodeOp op{};
+            op.type = type;
+            op.width = static_cast<std::uint8_t>(width);
+            op.offset = static_cast<std::uint16_t>(offset);
+            op.channel = static_cast<std::uint16_t>(channel_index);
+            schema.program.push_back(op);
+            schema.scales.push_back(scale);
+            schema.signs.push_back(sign);
+        }
+        else
+        {
+            return fail(line_num, "Unknown keyword " + keyword);
+        }
+    }
+
+    /*
+     * Check the program against the packet layout, so decoding never has to.
+     */
+    if (schema.packet_len == 0)
+        return fail(line_num, "Missing length");
+    if (schema.program.empty())
+        return fail(line_num, "No fields");
+    if (schema.program.size() > UINT16_MAX)
+        return fail(line_num, "Too many fields");
+
+    bool binary = schema.framing != TelemetryFraming::Ascii;
+    std::size_t first = binary ? BINARY_SEQ_LEN : 0;
+    std::size_t last = binary ? schema.packet_len - BINARY_CRC_LEN : schema.packet_len;
+    if (binary && schema.packet_len < BINARY_SEQ_LEN + BINARY_CRC_LEN)
+        return fail(line_num, "Length too short for sequence number and CRC");
+
+    for (auto& op : schema.program)
+    {
+        if (op.offset < first || op.offset + op.width > last)
+            return fail(line_num, "Field at offset " + std::to_string(op.offset) +
+                " lies outside the packet's data");
+        if (binary == (op.type == DecodeOpType::Ascii))
+            return fail(line_num, "Field types don't match the framing");
+    }
+
+    schema.runs = group_runs(schema.program, schema.packet_len);
+    return schema;
+}
+
+#endif /* TELEMETRY_SCHEMA_HPP */
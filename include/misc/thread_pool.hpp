@@ -0,0 +1,99 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * A fixed set of worker threads running submitted tasks in submission order.
+ * Meant for batches of coarse tasks (milliseconds or more each), so a single
+ * locked queue is plenty. The destructor runs the tasks still queued before
+ * joining the workers.
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(std::size_t num_threads)
+    {
+        if (num_threads == 0)
+            num_threads = 1;
+        for (std::size_t i = 0; i < num_threads; i++)
+            workers.emplace_back([this] { run(); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    // Disallow copying and moving.
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    std::size_t size() const { return workers.size(); }
+
+    /*
+     * Queues f to run on a worker. The future holds its result.
+     */
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& f);
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    bool stopping = false;
+
+    void run();
+};
+
+template <typename F>
+std::future<std::invoke_result_t<F>> ThreadPool::submit(F&& f)
+{
+    // std::function needs a copyable target, so the task is shared.
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(
+        std::forward<F>(f));
+    auto result = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.emplace_back([task] { (*task)(); });
+    }
+    wakeup.notify_one();
+    return result;
+}
+
+void ThreadPool::run()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+#endif /* THREAD_POOL_HPP */
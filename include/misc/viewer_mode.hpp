@@ -7,6 +7,7 @@ enum class ViewerMode : std::uint8_t
 {
     Telemetry,
     Edit,
+    Replay,
 };
 
 #endif /* VIEWER_MODE_HPP */
@@ -0,0 +1,145 @@
+#ifndef VIEWER_OPTIONS_HPP
+#define VIEWER_OPTIONS_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <getopt.h>
+
+#include "logger.hpp"
+#include "telemetry_framing.hpp"
+
+/*
+ * Command line options for the viewer.
+ */
+struct ViewerOptions
+{
+    // Serial port to open on startup, instead of auto-detecting one. Needed
+    // for ports which aren't listed in /dev/serial, such as the pty created by
+    // prometheus_sim.
+    std::string serial_port{};
+
+    // Baud rate of the serial link. Rates other than the standard termios
+    // ones (e.g. 1500000, 2000000, 3000000) are set through BOTHER. Linux
+    // only; the Windows driver stays at 9600.
+    std::size_t baud_rate = 9600;
+
+    // Wire format of the telemetry link.
+    TelemetryFraming telemetry_framing = TelemetryFraming::Ascii;
+
+    // Schema file describing the packet layout. Overrides telemetry_framing.
+    std::string telemetry_schema{};
+
+    // File to write the latency histograms to on exit.
+    std::string latency_log{};
+
+    // Directory to record a flight log to.
+    std::string flight_log{};
+
+    // Flight log to play back in replay mode.
+    std::string replay_log{};
+
+    // Frame rate cap. 0 leaves it to vsync, or uncapped without vsync.
+    double target_fps = 0.0;
+
+    // Sync buffer swaps to the display's refresh.
+    bool vsync = true;
+
+    // Only draw frames when something on screen changed.
+    bool render_on_demand = true;
+};
+
+void print_viewer_usage(const char* argv0)
+{
+    std::cout << "Usage: " << argv0 << " [options]\n"
+              << "  -p <port>  Serial port to open on startup\n"
+              << "  -b <baud>  Serial baud rate, any rate the device supports "
+                 "(default 9600)\n"
+              << "  -f <fmt>   Telemetry format: ascii, cobs, cobs-f32 "
+                 "(default ascii)\n"
+              << "  -s <file>  Telemetry schema file, overrides -f\n"
+              << "  -l <file>  Write latency histograms to file on exit\n"
+              << "  -r <dir>   Record raw telemetry and samples to a flight log\n"
+              << "  -P <dir>   Flight log to play back in replay mode (p)\n"
+              << "  -F <fps>   Frame rate cap, 0 for none (default 0)\n"
+              << "  -V         Disable vsync, for frame rates above the display's\n"
+              << "  -a         Draw every frame, even if nothing changed\n"
+              << "  -h         Show this help\n";
+}
+
+bool parse_viewer_options(int argc, char** argv, ViewerOptions& opts)
+{
+    int flag;
+    while ((flag = getopt(argc, argv, "p:b:f:s:l:r:P:F:Vah")) != -1)
+    {
+        switch (flag)
+        {
+        case 'p':
+            opts.serial_port = optarg;
+            break;
+        case 'b':
+        {
+            char* end;
+            unsigned long baud = std::strtoul(optarg, &end, 10);
+            if (*end != '\0' || baud == 0)
+            {
+                logger.log(LogLevel::error, "Invalid baud rate: ", optarg, '\n');
+                return false;
+            }
+            opts.baud_rate = baud;
+            break;
+        }
+        case 's':
+            opts.telemetry_schema = optarg;
+            break;
+        case 'l':
+            opts.latency_log = optarg;
+            break;
+        case 'r':
+            opts.flight_log = optarg;
+            break;
+        case 'P':
+            opts.replay_log = optarg;
+            break;
+        case 'F':
+        {
+            char* end;
+            opts.target_fps = std::strtod(optarg, &end);
+            if (*end != '\0' || !(opts.target_fps >= 0.0))
+            {
+                logger.log(LogLevel::error, "Invalid frame rate: ", optarg, '\n');
+                return false;
+            }
+            break;
+        }
+        case 'V':
+            opts.vsync = false;
+            break;
+        case 'a':
+            opts.render_on_demand = false;
+            break;
+        case 'f':
+            if (std::strcmp(optarg, "ascii") == 0)
+                opts.telemetry_framing = TelemetryFraming::Ascii;
+            else if (std::strcmp(optarg, "cobs") == 0)
+                opts.telemetry_framing = TelemetryFraming::CobsInt16;
+            else if (std::strcmp(optarg, "cobs-f32") == 0)
+                opts.telemetry_framing = TelemetryFraming::CobsFloat32;
+            else
+            {
+                logger.log(LogLevel::error, "Unknown telemetry format: ",
+                    optarg, '\n');
+                return false;
+            }
+            break;
+        default:
+            print_viewer_usage(argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#endif /* VIEWER_OPTIONS_HPP */
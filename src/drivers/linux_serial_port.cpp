@@ -2,11 +2,73 @@
 
 #ifdef OS_LINUX
 
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "termios2.hpp"
+
+namespace
+{
+
+/*
+ * Standard baud rates, usable by both backends. Anything else requires the
+ * termios backend.
+ */
+struct StandardBaudRate
+{
+    std::size_t rate;
+    speed_t speed;
+    LibSerial::BaudRate libserial_rate;
+};
+
+constexpr StandardBaudRate STANDARD_BAUD_RATES[] = {
+    {1200,    B1200,    LibSerial::BaudRate::BAUD_1200},
+    {2400,    B2400,    LibSerial::BaudRate::BAUD_2400},
+    {4800,    B4800,    LibSerial::BaudRate::BAUD_4800},
+    {9600,    B9600,    LibSerial::BaudRate::BAUD_9600},
+    {19200,   B19200,   LibSerial::BaudRate::BAUD_19200},
+    {38400,   B38400,   LibSerial::BaudRate::BAUD_38400},
+    {57600,   B57600,   LibSerial::BaudRate::BAUD_57600},
+    {115200,  B115200,  LibSerial::BaudRate::BAUD_115200},
+    {230400,  B230400,  LibSerial::BaudRate::BAUD_230400},
+    {460800,  B460800,  LibSerial::BaudRate::BAUD_460800},
+    {500000,  B500000,  LibSerial::BaudRate::BAUD_500000},
+    {576000,  B576000,  LibSerial::BaudRate::BAUD_576000},
+    {921600,  B921600,  LibSerial::BaudRate::BAUD_921600},
+    {1000000, B1000000, LibSerial::BaudRate::BAUD_1000000},
+    {1152000, B1152000, LibSerial::BaudRate::BAUD_1152000},
+    {1500000, B1500000, LibSerial::BaudRate::BAUD_1500000},
+    {2000000, B2000000, LibSerial::BaudRate::BAUD_2000000},
+    {2500000, B2500000, LibSerial::BaudRate::BAUD_2500000},
+    {3000000, B3000000, LibSerial::BaudRate::BAUD_3000000},
+    {3500000, B3500000, LibSerial::BaudRate::BAUD_3500000},
+    {4000000, B4000000, LibSerial::BaudRate::BAUD_4000000},
+};
+
+const StandardBaudRate* find_standard_baud_rate(std::size_t rate)
+{
+    for (auto& b : STANDARD_BAUD_RATES)
+        if (b.rate == rate)
+            return &b;
+    return nullptr;
+}
+
+}  // namespace
+
 LinuxSerialPort::LinuxSerialPort(
-        std::shared_ptr<BoundedBuffer<char>> buffer_,
+        std::shared_ptr<SpscRing<char>> buffer_,
         LinuxSerialPortConfig const* cfg_) :
     buffer{buffer_},
     cfg(cfg_),
+    backend(cfg_ ? cfg_->backend : LinuxSerialBackend::LibSerial),
     stream{}
 {
 }
@@ -56,21 +118,56 @@ bool LinuxSerialPort::open(const std::string& port)
         return false;
     }
 
-    try
+    if (backend == LinuxSerialBackend::Termios)
     {
-        logger.log(LogLevel::info, "Opening ", port, '\n');
-        stream.Open(port.c_str());
+        if (!open_termios(port))
+            return false;
     }
-    catch (const LibSerial::OpenFailed&)
+    else
     {
-        logger.log(LogLevel::warning, "Failed to open serial port: ", port, '\n');
-        return false;
+        try
+        {
+            logger.log(LogLevel::info, "Opening ", port, '\n');
+            stream.Open(port.c_str());
+        }
+        catch (const LibSerial::OpenFailed&)
+        {
+            logger.log(LogLevel::warning, "Failed to open serial port: ", port, '\n');
+            return false;
+        }
     }
     port_open = true;
     port_name = port;
     return true;
 }
 
+bool LinuxSerialPort::open_termios(const std::string& port)
+{
+    logger.log(LogLevel::info, "Opening ", port, " (termios)\n");
+
+    // Non-blocking, so a missing carrier can't hang open(), and so the reader
+    // thread's read() can never block where a stop request can't reach it.
+    // The waiting is done in poll(), which still honours VMIN.
+    tty_fd = ::open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (tty_fd < 0)
+    {
+        logger.log(LogLevel::warning, "Failed to open serial port: ", port,
+            ": ", std::strerror(errno), '\n');
+        return false;
+    }
+
+    if (cfg && cfg->exclusive && ioctl(tty_fd, TIOCEXCL) < 0)
+    {
+        logger.log(LogLevel::warning, "Failed to get exclusive access to ",
+            port, ": ", std::strerror(errno), '\n');
+        ::close(tty_fd);
+        tty_fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
 bool LinuxSerialPort::auto_open()
 {
     find_ports();
@@ -103,7 +200,13 @@ void LinuxSerialPort::close()
     buffer->clear();
     available_ports.clear();
 
-    stream.Close();
+    if (tty_fd >= 0)
+    {
+        ::close(tty_fd);
+        tty_fd = -1;
+    }
+    if (stream.IsOpen())
+        stream.Close();
 }
 
 bool LinuxSerialPort::config()
@@ -121,25 +224,143 @@ bool LinuxSerialPort::config()
 
     logger.log(LogLevel::info, "Configuring ", port_name, "\n");
 
-    if (cfg)
-    {
-        stream.SetBaudRate(cfg->br);
-        stream.SetCharacterSize(cfg->cs);
-        stream.SetFlowControl(cfg->fc);
-        stream.SetParity(cfg->py);
-        stream.SetStopBits(cfg->sb);
-    }
-    else
+    if (!cfg)
     {
         logger.log(LogLevel::error, "LinuxSerialPort::config: cfg pointer is \
             null");
         return false;
     }
 
+    bool rv = (backend == LinuxSerialBackend::Termios) ?
+        config_termios() :
+        config_libserial();
+    if (!rv)
+        return false;
+
     port_configured = true;
     return true;
 }
 
+bool LinuxSerialPort::config_libserial()
+{
+    auto baud = find_standard_baud_rate(cfg->baud_rate);
+    if (!baud)
+    {
+        logger.log(LogLevel::error, "Baud rate ", cfg->baud_rate,
+            " requires the termios backend\n");
+        return false;
+    }
+
+    stream.SetBaudRate(baud->libserial_rate);
+    stream.SetCharacterSize(cfg->cs);
+    stream.SetFlowControl(cfg->fc);
+    stream.SetParity(cfg->py);
+    stream.SetStopBits(cfg->sb);
+
+    return true;
+}
+
+bool LinuxSerialPort::config_termios()
+{
+    termios tio{};
+    if (tcgetattr(tty_fd, &tio) < 0)
+    {
+        logger.log(LogLevel::error, "tcgetattr failed: ", std::strerror(errno), '\n');
+        return false;
+    }
+
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+
+    // LibSerial's character size values are the termios CSx flags.
+    tio.c_cflag &= ~CSIZE;
+    tio.c_cflag |= static_cast<tcflag_t>(cfg->cs);
+
+    tio.c_cflag &= ~(PARENB | PARODD);
+    if (cfg->py == LibSerial::Parity::PARITY_EVEN)
+        tio.c_cflag |= PARENB;
+    else if (cfg->py == LibSerial::Parity::PARITY_ODD)
+        tio.c_cflag |= PARENB | PARODD;
+
+    if (cfg->sb == LibSerial::StopBits::STOP_BITS_2)
+        tio.c_cflag |= CSTOPB;
+    else
+        tio.c_cflag &= ~CSTOPB;
+
+    tio.c_cflag &= ~CRTSCTS;
+    tio.c_iflag &= ~(IXON | IXOFF | IXANY);
+    if (cfg->fc == LibSerial::FlowControl::FLOW_CONTROL_HARDWARE)
+        tio.c_cflag |= CRTSCTS;
+    else if (cfg->fc == LibSerial::FlowControl::FLOW_CONTROL_SOFTWARE)
+        tio.c_iflag |= IXON | IXOFF;
+
+    tio.c_cc[VMIN] = cfg->vmin;
+    tio.c_cc[VTIME] = cfg->vtime;
+
+    auto baud = find_standard_baud_rate(cfg->baud_rate);
+    if (baud)
+    {
+        cfsetispeed(&tio, baud->speed);
+        cfsetospeed(&tio, baud->speed);
+    }
+
+    if (tcsetattr(tty_fd, TCSANOW, &tio) < 0)
+    {
+        logger.log(LogLevel::error, "tcsetattr failed: ", std::strerror(errno), '\n');
+        return false;
+    }
+
+    // Non-standard rates go through termios2.
+    if (!baud && !set_custom_baud_rate(tty_fd, cfg->baud_rate))
+    {
+        logger.log(LogLevel::error, "Failed to set custom baud rate ",
+            cfg->baud_rate, ": ", std::strerror(errno), '\n');
+        return false;
+    }
+
+    // Ask the driver to push received bytes to the tty layer immediately
+    // instead of batching them. Not every driver supports this (e.g. ptys), so
+    // failure is only worth a note.
+    if (cfg->low_latency)
+    {
+        serial_struct ss{};
+        if (ioctl(tty_fd, TIOCGSERIAL, &ss) == 0)
+        {
+            ss.flags |= ASYNC_LOW_LATENCY;
+            if (ioctl(tty_fd, TIOCSSERIAL, &ss) < 0)
+                logger.log(LogLevel::warning, "Failed to set low latency mode: ",
+                    std::strerror(errno), '\n');
+        }
+        else
+        {
+            logger.log(LogLevel::info, port_name,
+                " does not support low latency mode\n");
+        }
+    }
+
+    tcflush(tty_fd, TCIFLUSH);
+    return true;
+}
+
+int LinuxSerialPort::port_fd()
+{
+    if (backend == LinuxSerialBackend::Termios)
+        return tty_fd;
+    return stream.GetFileDescriptor();
+}
+
+bool LinuxSerialPort::set_backend(LinuxSerialBackend backend_)
+{
+    if (port_open)
+    {
+        logger.log(LogLevel::warning, "Cannot change backend of an open port\n");
+        return false;
+    }
+
+    backend = backend_;
+    return true;
+}
+
 bool LinuxSerialPort::start_reading()
 {
     if (is_reading())
@@ -158,30 +379,119 @@ bool LinuxSerialPort::start_reading()
         return false;
     }
 
+    // Reap a reader thread which exited on its own (e.g. device hung up).
+    if (reader_thread.joinable())
+        stop_reading();
+
+    stop_fd = eventfd(0, EFD_NONBLOCK);
+    if (stop_fd < 0)
+    {
+        logger.log(LogLevel::error, "Failed to create reader stop event: ",
+            std::strerror(errno), '\n');
+        return false;
+    }
+
     port_reading.store(true);
+    reader_thread = std::thread(&LinuxSerialPort::read_loop, this);
+
+    return true;
+}
 
-    std::thread t1([&](){
-        while (port_reading.load())
+void LinuxSerialPort::stop_reading()
+{
+    port_reading.store(false);
+
+    if (reader_thread.joinable())
+    {
+        // Wake the reader thread out of poll().
+        std::uint64_t one = 1;
+        if (::write(stop_fd, &one, sizeof(one)) < 0)
+            logger.log(LogLevel::error, "Failed to signal reader thread: ",
+                std::strerror(errno), '\n');
+        reader_thread.join();
+    }
+
+    if (stop_fd >= 0)
+    {
+        ::close(stop_fd);
+        stop_fd = -1;
+    }
+}
+
+/*
+ * Reader thread. Sleeps in poll() while the link is idle, so an idle port costs
+ * no CPU. Once the kernel reports data, everything available is pulled with one
+ * read() directly into the byte ring and published with a single commit.
+ */
+void LinuxSerialPort::read_loop()
+{
+    std::array<char, READ_CHUNK_SIZE> chunk;
+
+    pollfd fds[2];
+    fds[0].fd = port_fd();
+    fds[0].events = POLLIN;
+    fds[1].fd = stop_fd;
+    fds[1].events = POLLIN;
+
+    while (port_reading.load())
+    {
+        int rv = poll(fds, 2, -1);
+        if (rv < 0)
         {
-            if (stream.IsDataAvailable())
-            {
-                using namespace std::chrono_literals;
+            if (errno == EINTR)
+                continue;
+            logger.log(LogLevel::error, "LinuxSerialPort::read_loop: poll failed: ",
+                std::strerror(errno), '\n');
+            break;
+        }
 
-                char recv_byte;
-                stream.get(recv_byte);
-                buffer->force_push(recv_byte);
+        if (fds[1].revents & POLLIN)
+            break;
+
+        // A hung-up tty reports POLLIN along with POLLHUP, and read() then
+        // returns 0 forever, so a hangup is only noticed once no bytes came.
+        ssize_t n = 0;
+        if (fds[0].revents & POLLIN)
+        {
+            // Read straight into the ring's free region. If the consumer has
+            // fallen behind and the ring is full, the data still has to be
+            // drained from the kernel (or poll() would spin), so read it into
+            // scratch space and let the ring count it as dropped.
+            Span<char> dst = buffer->write_available();
+            bool in_place = !dst.empty();
+            if (!in_place)
+                dst = Span<char>(chunk.data(), chunk.size());
 
-                std::this_thread::sleep_for(1us);
+            n = ::read(fds[0].fd, dst.data(), dst.size());
+            if (n > 0)
+            {
+                if (in_place)
+                    buffer->commit(static_cast<std::size_t>(n));
+                else
+                    buffer->write(dst.first(static_cast<std::size_t>(n)));
+            }
+            else if (n < 0 && errno != EAGAIN && errno != EINTR)
+            {
+                logger.log(LogLevel::error, "LinuxSerialPort::read_loop: read failed: ",
+                    std::strerror(errno), '\n');
+                break;
+            }
+            else if (n == 0)
+            {
+                logger.log(LogLevel::warning, "Serial device ", port_name,
+                    " hung up\n");
+                break;
             }
         }
-    });
-    t1.detach();
 
-    return true;
-}
+        if (n <= 0 && (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)))
+        {
+            logger.log(LogLevel::warning, "Serial device ", port_name,
+                " hung up\n");
+            break;
+        }
+    }
 
-void LinuxSerialPort::stop_reading()
-{
     port_reading.store(false);
 }
 
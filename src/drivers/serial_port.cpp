@@ -2,13 +2,13 @@
 
 #ifdef OS_CYGWIN
 explicit SerialPort::SerialPort(
-        std::shared_ptr<BoundedBuffer<char>> byte_buffer_) :
+        std::shared_ptr<SpscRing<char>> byte_buffer_) :
     windows_port{byte_buffer_}
 {
 }
 #elif OS_LINUX
 SerialPort::SerialPort(
-        std::shared_ptr<BoundedBuffer<char>> byte_buffer_,
+        std::shared_ptr<SpscRing<char>> byte_buffer_,
         LinuxSerialPortConfig const* cfg_) :
     linux_port(byte_buffer_, cfg_)
 {
@@ -60,11 +60,18 @@ bool SerialPort::config()
 
 bool SerialPort::start_reading()
 {
+    if (consumer_stop && !is_reading())
+        consumer_stop();
+
 #ifdef OS_CYGWIN
-    return windows_port.start_reading();
+    bool rv = windows_port.start_reading();
 #elif OS_LINUX
-    return linux_port.start_reading();
+    bool rv = linux_port.start_reading();
 #endif
+
+    if (rv && consumer_start)
+        consumer_start();
+    return rv;
 }
 
 void SerialPort::stop_reading()
@@ -74,7 +81,30 @@ void SerialPort::stop_reading()
 #elif OS_LINUX
     linux_port.stop_reading();
 #endif
+
+    if (consumer_stop)
+        consumer_stop();
+}
+
+void SerialPort::set_consumer_hooks(std::function<void()> on_start,
+                                    std::function<void()> on_stop)
+{
+    consumer_start = std::move(on_start);
+    consumer_stop = std::move(on_stop);
+}
+
+#ifdef OS_LINUX
+bool SerialPort::set_backend(LinuxSerialBackend backend)
+{
+    return linux_port.set_backend(backend);
 }
+
+LinuxSerialBackend SerialPort::get_backend() const
+{
+    return linux_port.get_backend();
+}
+#endif
+
 bool SerialPort::is_open() const
 {
 #ifdef OS_CYGWIN
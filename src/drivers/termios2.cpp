@@ -0,0 +1,27 @@
+#include "termios2.hpp"
+
+#ifdef OS_LINUX
+
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+
+bool set_custom_baud_rate(int fd, std::size_t baud_rate)
+{
+    struct termios2 tio;
+    if (ioctl(fd, TCGETS2, &tio) < 0)
+        return false;
+
+    // Output speed.
+    tio.c_cflag &= ~CBAUD;
+    tio.c_cflag |= BOTHER;
+    tio.c_ospeed = baud_rate;
+
+    // Input speed.
+    tio.c_cflag &= ~(CBAUD << IBSHIFT);
+    tio.c_cflag |= BOTHER << IBSHIFT;
+    tio.c_ispeed = baud_rate;
+
+    return ioctl(fd, TCSETS2, &tio) == 0;
+}
+
+#endif /* OS_LINUX */
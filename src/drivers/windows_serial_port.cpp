@@ -2,7 +2,7 @@
 
 #ifdef OS_CYGWIN
 
-explicit WindowsSerialPort::WindowsSerialPort(std::shared_ptr<BoundedBuffer<char>> buffer_)
+explicit WindowsSerialPort::WindowsSerialPort(std::shared_ptr<SpscRing<char>> buffer_)
     : buffer{buffer_}
 {
 }
@@ -281,7 +281,7 @@ unsigned WindowsSerialPort::async_receive(void* params)
                         }
                         if (bytes_read > 0)
                         {
-                            com_ptr->buffer->force_push(tmp_buf[0]);
+                            com_ptr->buffer->write(Span<const char>(tmp_buf, bytes_read));
                         }
                     } while (bytes_read > 0);
                     CloseHandle(ov_read.hEvent);
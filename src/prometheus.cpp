@@ -2,16 +2,20 @@
 
 #include "drone_viewer.hpp"
 #include "logger.hpp"
+#include "viewer_options.hpp"
 
 Logger logger = Logger(LogLevel::info);
 
-int main()
+int main(int argc, char** argv)
 {
 #ifdef TEST_MODE
     logger.log(LogLevel::info, "Test mode: Enabled\n");
 #endif
 
-    DroneViewer viewer{};
+    ViewerOptions options{};
+    if (!parse_viewer_options(argc, argv, options)) return -1;
+
+    DroneViewer viewer{options};
     if (!viewer.init()) return -1;
 
     while (viewer.is_running())
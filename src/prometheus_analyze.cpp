@@ -0,0 +1,858 @@
+/*
+ * Headless flight log analyzer. Runs the raw telemetry of a flight log
+ * (recorded with prometheus -r) through the viewer's framing, decoding and
+ * filtering, without any graphics, and reports per-channel statistics,
+ * dropouts and the packet error rate:
+ *
+ *     ./build/prometheus_analyze -j 8 -c flight.csv flights/
+ *
+ * The log is cut into chunks at record boundaries which are analyzed in
+ * parallel. Framing state can't be known at a chunk's start without the bytes
+ * before it, so each chunk is framed speculatively: the tail of the previous
+ * chunk is run through a fresh framer and fresh filters first, and only what
+ * follows is counted. When the results are merged in order, the framing state
+ * the chunk started from is checked against the state the previous chunk
+ * actually ended in. They almost always agree, since a framer resynchronizes
+ * within a packet or two, and the chunk's result is then exactly what a single
+ * pass would have found. Otherwise the chunk is analyzed again from the
+ * previous chunk's framer. Filter state is only warmed up, not carried over,
+ * so filtered values right after a chunk boundary can differ from a single
+ * pass by rounding.
+ */
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+
+#include "cobs_framer.hpp"
+#include "filters.hpp"
+#include "flight_recorder.hpp"
+#include "frame_scanner.hpp"
+#include "logger.hpp"
+#include "mapped_file.hpp"
+#include "span.hpp"
+#include "telemetry_format.hpp"
+#include "telemetry_framing.hpp"
+#include "telemetry_schema.hpp"
+#include "thread_pool.hpp"
+
+Logger logger = Logger(LogLevel::info);
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t DEFAULT_CHUNK_MB = 16;
+
+// Log bytes before a chunk which are run through the framer and filters
+// first. Enough for the framers to resynchronize many times over and for the
+// default filters to settle.
+constexpr std::size_t WARMUP_LEN = 64 * 1024;
+
+struct AnalyzeOptions
+{
+    std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t chunk_len = DEFAULT_CHUNK_MB << 20;
+    TelemetryFraming framing = TelemetryFraming::Ascii;
+    std::string schema_path{};
+    // The viewer's default filters.
+    std::vector<FilterSpec> filters{{FilterType::MovingAverage, 32}};
+    std::chrono::milliseconds gap_threshold{100};
+    fs::path csv_path{};
+    fs::path log_dir{};
+};
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options] <flight log directory>\n"
+        "  -j <n>      Worker threads (default: one per core)\n"
+        "  -f <fmt>    Telemetry format: ascii, cobs or cobs-f32 (default ascii)\n"
+        "  -s <file>   Packet schema, overrides -f\n"
+        "  -F <spec>   Filter stage applied to each standard channel; repeat\n"
+        "              for a chain. ma:<window>, ema:<alpha>,\n"
+        "              lowpass:<cutoff hz>:<sample hz>, median:<window> or\n"
+        "              none (default ma:32, as in the viewer)\n"
+        "  -g <ms>     Shortest gap between packets reported as a dropout\n"
+        "              (default 100)\n"
+        "  -c <file>   Write every packet's channels to a CSV file\n"
+        "  -C <MB>     Chunk size (default %zu)\n"
+        "  -h          Show this help\n",
+        argv0, DEFAULT_CHUNK_MB);
+}
+
+/*
+ * Parses a filter stage from the command line. Returns false (and logs why)
+ * if it's malformed or its parameters are invalid.
+ */
+bool parse_filter_spec(const std::string& arg, FilterSpec& out)
+{
+    std::size_t colon = arg.find(':');
+    std::string name = arg.substr(0, colon);
+    std::vector<double> params;
+    while (colon != std::string::npos)
+    {
+        std::size_t next = arg.find(':', colon + 1);
+        params.push_back(std::strtod(arg.substr(colon + 1, next - colon - 1).c_str(), nullptr));
+        colon = next;
+    }
+
+    auto window = [&] { return params[0] >= 1.0 ? static_cast<std::size_t>(params[0]) : 0; };
+
+    out = FilterSpec{FilterType::MovingAverage};
+    if (name == "ma" && params.size() == 1)
+    {
+        out.window = window();
+    }
+    else if (name == "ema" && params.size() == 1)
+    {
+        out.type = FilterType::ExponentialMovingAverage;
+        out.alpha = static_cast<float>(params[0]);
+    }
+    else if (name == "lowpass" && params.size() == 2)
+    {
+        out.type = FilterType::ButterworthLowpass;
+        out.cutoff_hz = static_cast<float>(params[0]);
+        out.sample_hz = static_cast<float>(params[1]);
+    }
+    else if (name == "median" && params.size() == 1)
+    {
+        out.type = FilterType::SlidingMedian;
+        out.window = window();
+    }
+    else
+    {
+        logger.log(LogLevel::error, "Unknown filter: ", arg, '\n');
+        return false;
+    }
+
+    return make_filter(out) != nullptr;
+}
+
+bool parse_options(int argc, char** argv, AnalyzeOptions& opts)
+{
+    bool default_filters = true;
+    int flag;
+    while ((flag = getopt(argc, argv, "j:f:s:F:g:c:C:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'j': opts.threads = std::strtoul(optarg, nullptr, 10); break;
+        case 'f':
+            if (std::strcmp(optarg, "ascii") == 0)
+                opts.framing = TelemetryFraming::Ascii;
+            else if (std::strcmp(optarg, "cobs") == 0)
+                opts.framing = TelemetryFraming::CobsInt16;
+            else if (std::strcmp(optarg, "cobs-f32") == 0)
+                opts.framing = TelemetryFraming::CobsFloat32;
+            else
+            {
+                logger.log(LogLevel::error, "Unknown telemetry format: ", optarg, '\n');
+                return false;
+            }
+            break;
+        case 's': opts.schema_path = optarg; break;
+        case 'F':
+        {
+            if (default_filters)
+            {
+                opts.filters.clear();
+                default_filters = false;
+            }
+            if (std::strcmp(optarg, "none") == 0)
+                break;
+            FilterSpec spec{FilterType::MovingAverage};
+            if (!parse_filter_spec(optarg, spec))
+                return false;
+            opts.filters.push_back(spec);
+            break;
+        }
+        case 'g': opts.gap_threshold = std::chrono::milliseconds(std::strtoll(optarg, nullptr, 10)); break;
+        case 'c': opts.csv_path = optarg; break;
+        case 'C': opts.chunk_len = std::strtoull(optarg, nullptr, 10) << 20; break;
+        default:
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+
+    if (argc - optind != 1)
+    {
+        print_usage(argv[0]);
+        return false;
+    }
+    opts.log_dir = argv[optind];
+
+    if (opts.threads == 0 || opts.chunk_len == 0 || opts.gap_threshold.count() <= 0)
+    {
+        logger.log(LogLevel::error, "Threads, chunk size and gap threshold must be positive\n");
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * A run of whole records of one segment, analyzed as a unit. The records
+ * from tail on warm up the next chunk.
+ */
+struct Chunk
+{
+    std::size_t segment;
+    std::size_t begin;
+    std::size_t end;
+    std::size_t tail;
+};
+
+/*
+ * Cuts a segment into chunks of about chunk_len bytes. Records are only
+ * walked by their length fields here; their CRCs are checked when the chunks
+ * are analyzed.
+ */
+std::vector<Chunk> plan_chunks(Span<const char> data, std::size_t segment,
+                               std::size_t chunk_len)
+{
+    std::vector<Chunk> chunks;
+    FlightSegmentHeader header;
+    if (!parse_flight_segment_header(data, header))
+        return chunks;
+
+    // Starts of the records in the last WARMUP_LEN bytes.
+    std::deque<std::size_t> recent;
+    std::size_t pos = FLIGHT_SEGMENT_HEADER_LEN;
+    std::size_t begin = pos;
+    while (data.size() - pos >= FLIGHT_RECORD_HEADER_LEN + FLIGHT_RECORD_CRC_LEN)
+    {
+        std::size_t payload_len = get_le32(reinterpret_cast<const std::uint8_t*>(data.data() + pos));
+        if (payload_len > data.size() - pos - FLIGHT_RECORD_HEADER_LEN - FLIGHT_RECORD_CRC_LEN)
+            break;
+
+        recent.push_back(pos);
+        pos += FLIGHT_RECORD_HEADER_LEN + payload_len + FLIGHT_RECORD_CRC_LEN;
+        while (recent.size() > 1 && recent.front() + WARMUP_LEN < pos)
+            recent.pop_front();
+
+        if (pos - begin >= chunk_len)
+        {
+            chunks.push_back({segment, begin, pos, recent.front()});
+            begin = pos;
+            recent.clear();
+        }
+    }
+    if (pos > begin)
+        chunks.push_back({segment, begin, pos, recent.empty() ? begin : recent.front()});
+    return chunks;
+}
+
+/*
+ * Running statistics of one channel. Non-finite values are left out.
+ */
+struct ChannelStats
+{
+    std::uint64_t count = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+    double sum = 0.0;
+    double sum_sq = 0.0;
+
+    void add(double x)
+    {
+        if (!std::isfinite(x))
+            return;
+        count++;
+        min = std::min(min, x);
+        max = std::max(max, x);
+        sum += x;
+        sum_sq += x * x;
+    }
+
+    void merge(const ChannelStats& rhs)
+    {
+        count += rhs.count;
+        min = std::min(min, rhs.min);
+        max = std::max(max, rhs.max);
+        sum += rhs.sum;
+        sum_sq += rhs.sum_sq;
+    }
+};
+
+/*
+ * Stretches longer than the gap threshold without a packet. Packets are
+ * timed by the record they completed in. Negative gaps, where a new session
+ * was appended to the log, aren't dropouts.
+ */
+struct GapStats
+{
+    std::uint64_t count = 0;
+    std::int64_t total_ns = 0;
+    std::int64_t longest_ns = 0;
+    std::int64_t longest_at_ns = 0;
+
+    void add(std::int64_t from_ns, std::int64_t to_ns, std::int64_t threshold_ns)
+    {
+        std::int64_t gap = to_ns - from_ns;
+        if (gap < threshold_ns)
+            return;
+        count++;
+        total_ns += gap;
+        if (gap > longest_ns)
+        {
+            longest_ns = gap;
+            longest_at_ns = from_ns;
+        }
+    }
+
+    void merge(const GapStats& rhs)
+    {
+        count += rhs.count;
+        total_ns += rhs.total_ns;
+        if (rhs.longest_ns > longest_ns)
+        {
+            longest_ns = rhs.longest_ns;
+            longest_at_ns = rhs.longest_at_ns;
+        }
+    }
+};
+
+/*
+ * Framing counters, as differences between two points in the stream.
+ */
+struct FramerCounts
+{
+    std::size_t rejected = 0;
+    std::size_t recovered = 0;
+    std::size_t lost = 0;
+    std::size_t bytes_skipped = 0;
+
+    FramerCounts operator-(const FramerCounts& rhs) const
+    {
+        return {rejected - rhs.rejected, recovered - rhs.recovered,
+                lost - rhs.lost, bytes_skipped - rhs.bytes_skipped};
+    }
+
+    void merge(const FramerCounts& rhs)
+    {
+        rejected += rhs.rejected;
+        recovered += rhs.recovered;
+        lost += rhs.lost;
+        bytes_skipped += rhs.bytes_skipped;
+    }
+};
+
+struct FramerState
+{
+    FrameScannerState ascii{};
+    CobsFramerState cobs{};
+
+    bool operator==(const FramerState& rhs) const { return ascii == rhs.ascii && cobs == rhs.cobs; }
+    bool operator!=(const FramerState& rhs) const { return !(*this == rhs); }
+};
+
+/*
+ * The framer for the format, as in TelemetryManager. Copyable, so a chunk can
+ * continue from the framer another chunk ended with.
+ */
+class Framer
+{
+public:
+    explicit Framer(const TelemetryFormat& fmt)
+    {
+        if (fmt.framing == TelemetryFraming::Ascii)
+            scanner.emplace(fmt.start_symbol, fmt.stop_symbol, fmt.packet_len);
+        else
+            cobs.emplace(fmt.packet_len, fmt.encoded_len);
+    }
+
+    template <typename F>
+    void frame(Span<const char> bytes, F& on_packet)
+    {
+        if (!scanner)
+        {
+            cobs->frame(bytes, on_packet);
+            return;
+        }
+
+        scanner->scan(bytes, candidates);
+        if (scanner->has_carried())
+            on_packet(scanner->carried());
+        for (auto& c : candidates)
+            on_packet(std::string_view(bytes.data() + c.offset, c.length));
+    }
+
+    FramerState get_state() const
+    {
+        if (scanner)
+            return {scanner->get_state(), {}};
+        return {{}, cobs->get_state()};
+    }
+
+    FramerCounts get_counts() const
+    {
+        if (scanner)
+            return {scanner->get_packets_rejected(), scanner->get_packets_recovered(), 0,
+                    scanner->get_bytes_skipped()};
+        return {cobs->get_crc_errors(), 0, cobs->get_packets_lost(), cobs->get_bytes_skipped()};
+    }
+private:
+    std::optional<FrameScanner> scanner;
+    std::vector<FrameCandidate> candidates;
+    std::optional<CobsFramer> cobs;
+};
+
+/*
+ * Everything the analysis needs, shared read-only by the workers.
+ */
+struct Analysis
+{
+    const AnalyzeOptions& opts;
+    const TelemetryFormat& fmt;
+    const std::vector<MappedFile>& segments;
+    const std::vector<Chunk>& chunks;
+    bool filtered = false;
+    bool csv = false;
+};
+
+struct ChunkResult
+{
+    FramerState start_state{};
+    FramerState end_state{};
+    std::optional<Framer> end_framer{};
+    FramerCounts counts{};
+
+    std::uint64_t packets = 0;
+    std::uint64_t decode_errors = 0;
+    std::vector<ChannelStats> raw{};
+    std::array<ChannelStats, STANDARD_CHANNELS.size()> filtered{};
+
+    GapStats gaps{};
+    std::optional<std::int64_t> first_ns{};
+    std::int64_t last_ns = 0;
+
+    std::uint64_t log_bytes = 0;
+    std::uint64_t raw_bytes = 0;
+    // Offset of the first invalid record, if the chunk has one.
+    std::optional<std::size_t> invalid_at{};
+
+    std::string csv{};
+};
+
+/*
+ * Frames, decodes and filters one chunk's raw records. Everything before
+ * start_counting() only warms up the framer and filters.
+ */
+class ChunkAnalyzer
+{
+public:
+    explicit ChunkAnalyzer(const Analysis& a_) :
+        a(a_),
+        framer(std::in_place, a_.fmt),
+        data(a_.fmt, false)
+    {
+        for (auto& chain : filters)
+            for (auto& spec : a.opts.filters)
+                chain.add(make_filter(spec));
+        result.raw.resize(a.fmt.channel_names.size());
+    }
+
+    /*
+     * Feeds the chunk's Raw records from offset begin. Returns the offset
+     * after the last valid one.
+     */
+    std::size_t feed(const Chunk& chunk, std::size_t begin)
+    {
+        Span<const char> segment = a.segments[chunk.segment].data();
+        return for_each_flight_record(segment, begin, chunk.end, [&](const FlightRecord& record)
+        {
+            if (counting)
+                result.log_bytes += FLIGHT_RECORD_HEADER_LEN + record.payload.size() +
+                    FLIGHT_RECORD_CRC_LEN;
+            if (record.type != static_cast<std::uint16_t>(FlightRecordType::Raw))
+                return;
+
+            if (counting)
+                result.raw_bytes += record.payload.size();
+            auto on_packet = [&](std::string_view packet) { process(packet, record.time_ns); };
+            framer->frame(record.payload, on_packet);
+        });
+    }
+
+    /*
+     * Starts counting, optionally from another framer instead of the
+     * warmed-up one.
+     */
+    void start_counting(std::optional<Framer> start = std::nullopt)
+    {
+        if (start)
+            framer.emplace(std::move(*start));
+        result.start_state = framer->get_state();
+        start_counts = framer->get_counts();
+        counting = true;
+    }
+
+    ChunkResult finish()
+    {
+        result.end_state = framer->get_state();
+        result.counts = framer->get_counts() - start_counts;
+        result.end_framer.emplace(std::move(*framer));
+        return std::move(result);
+    }
+private:
+    const Analysis& a;
+    std::optional<Framer> framer;
+    TelemetryData data;
+    std::array<FilterChain, STANDARD_CHANNELS.size()> filters{};
+    std::array<float, STANDARD_CHANNELS.size()> filtered{};
+
+    bool counting = false;
+    FramerCounts start_counts{};
+    ChunkResult result{};
+
+    void process(std::string_view packet, std::int64_t time_ns);
+    void write_csv_row(std::int64_t time_ns);
+};
+
+void ChunkAnalyzer::process(std::string_view packet, std::int64_t time_ns)
+{
+    if (counting)
+        result.packets++;
+
+    if (!data.extract_packet_data(packet))
+    {
+        if (counting)
+            result.decode_errors++;
+        return;
+    }
+
+    if (a.filtered)
+    {
+        glm::vec3 accel = data.get_accel();
+        glm::vec3 rot_rate = data.get_rot_rate();
+        for (std::size_t i = 0; i < 3; i++)
+        {
+            filtered[i] = filters[i].process(accel[i]);
+            filtered[3 + i] = filters[3 + i].process(rot_rate[i]);
+        }
+    }
+
+    if (!counting)
+        return;
+
+    const auto& channels = data.get_channels();
+    for (std::size_t i = 0; i < channels.size(); i++)
+        result.raw[i].add(channels[i]);
+    if (a.filtered)
+    {
+        for (std::size_t i = 0; i < filtered.size(); i++)
+            result.filtered[i].add(filtered[i]);
+    }
+
+    if (result.first_ns)
+        result.gaps.add(result.last_ns, time_ns,
+            std::chrono::nanoseconds(a.opts.gap_threshold).count());
+    else
+        result.first_ns = time_ns;
+    result.last_ns = time_ns;
+
+    if (a.csv)
+        write_csv_row(time_ns);
+}
+
+void ChunkAnalyzer::write_csv_row(std::int64_t time_ns)
+{
+    char buf[32];
+    auto append = [&](auto value)
+    {
+        auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        result.csv.append(buf, ptr);
+    };
+
+    append(time_ns);
+    for (float v : data.get_channels())
+    {
+        result.csv += ',';
+        append(v);
+    }
+    if (a.filtered)
+    {
+        for (float v : filtered)
+        {
+            result.csv += ',';
+            append(v);
+        }
+    }
+    result.csv += '\n';
+}
+
+/*
+ * Analyzes chunk i, warmed up by the tail of chunk i - 1. If start is given
+ * the chunk continues from that framer instead.
+ */
+ChunkResult analyze_chunk(const Analysis& a, std::size_t i, std::optional<Framer> start = std::nullopt)
+{
+    const Chunk& chunk = a.chunks[i];
+    ChunkAnalyzer analyzer(a);
+    if (i > 0)
+    {
+        const Chunk& prev = a.chunks[i - 1];
+        analyzer.feed(prev, prev.tail);
+    }
+
+    analyzer.start_counting(std::move(start));
+    std::size_t valid = analyzer.feed(chunk, chunk.begin);
+
+    ChunkResult result = analyzer.finish();
+    if (valid != chunk.end)
+        result.invalid_at = valid;
+    return result;
+}
+
+/*
+ * Merged results of every chunk, in log order.
+ */
+struct Totals
+{
+    FramerCounts counts{};
+    std::uint64_t packets = 0;
+    std::uint64_t decode_errors = 0;
+    std::vector<ChannelStats> raw{};
+    std::array<ChannelStats, STANDARD_CHANNELS.size()> filtered{};
+    GapStats gaps{};
+    std::optional<std::int64_t> first_ns{};
+    std::int64_t last_ns = 0;
+    std::uint64_t log_bytes = 0;
+    std::uint64_t raw_bytes = 0;
+    std::size_t chunks = 0;
+    std::size_t reanalyzed = 0;
+
+    void merge(const ChunkResult& r, std::int64_t gap_threshold_ns)
+    {
+        counts.merge(r.counts);
+        packets += r.packets;
+        decode_errors += r.decode_errors;
+        for (std::size_t i = 0; i < raw.size(); i++)
+            raw[i].merge(r.raw[i]);
+        for (std::size_t i = 0; i < filtered.size(); i++)
+            filtered[i].merge(r.filtered[i]);
+
+        if (r.first_ns)
+        {
+            if (first_ns)
+                gaps.add(last_ns, *r.first_ns, gap_threshold_ns);
+            else
+                first_ns = r.first_ns;
+            last_ns = r.last_ns;
+        }
+        gaps.merge(r.gaps);
+
+        log_bytes += r.log_bytes;
+        raw_bytes += r.raw_bytes;
+        chunks++;
+    }
+};
+
+void print_channel(const std::string& name, const ChannelStats& s)
+{
+    if (!s.count)
+    {
+        std::printf("%-24s %12d\n", name.c_str(), 0);
+        return;
+    }
+    double mean = s.sum / s.count;
+    double rms = std::sqrt(s.sum_sq / s.count);
+    std::printf("%-24s %12llu %12.6g %12.6g %12.6g %12.6g\n", name.c_str(),
+        static_cast<unsigned long long>(s.count), s.min, s.max, mean, rms);
+}
+
+void print_report(const Analysis& a, const Totals& t, double seconds)
+{
+    std::printf("%-24s %12s %12s %12s %12s %12s\n",
+        "channel", "count", "min", "max", "mean", "rms");
+    for (std::size_t i = 0; i < t.raw.size(); i++)
+        print_channel(a.fmt.channel_names[i], t.raw[i]);
+    if (a.filtered)
+    {
+        for (std::size_t i = 0; i < t.filtered.size(); i++)
+            print_channel(STANDARD_CHANNELS[i] + " (filtered)", t.filtered[i]);
+    }
+
+    // Every packet sent is either delivered, rejected by framing or missing
+    // from the sequence numbers.
+    std::uint64_t sent = t.packets + t.counts.rejected + t.counts.lost;
+    std::uint64_t bad = t.decode_errors + t.counts.rejected + t.counts.lost;
+    std::printf("\nPackets: %llu decoded, %llu malformed, %zu rejected by framing "
+        "(%zu recovered), %zu lost, %zu bytes skipped\n",
+        static_cast<unsigned long long>(t.packets - t.decode_errors),
+        static_cast<unsigned long long>(t.decode_errors),
+        t.counts.rejected, t.counts.recovered, t.counts.lost, t.counts.bytes_skipped);
+    std::printf("Packet error rate: %.6f%%\n", sent ? 100.0 * bad / sent : 0.0);
+
+    double span_s = t.first_ns ? (t.last_ns - *t.first_ns) * 1e-9 : 0.0;
+    std::printf("Dropouts over %lld ms: %llu, %.3f s of %.3f s in total",
+        static_cast<long long>(a.opts.gap_threshold.count()),
+        static_cast<unsigned long long>(t.gaps.count), t.gaps.total_ns * 1e-9, span_s);
+    if (t.gaps.count)
+        std::printf(", longest %.3f s at %.3f s", t.gaps.longest_ns * 1e-9,
+            (t.gaps.longest_at_ns - *t.first_ns) * 1e-9);
+    std::printf("\n");
+
+    logger.log(LogLevel::info, "Analyzed ", t.log_bytes, " log bytes (", t.raw_bytes,
+        " raw) in ", t.chunks, " chunks on ", a.opts.threads, " threads in ", seconds,
+        " s, ", t.log_bytes / seconds / 1e6, " MB/s; ", t.reanalyzed,
+        " chunks reanalyzed after a framing mismatch\n");
+}
+
+bool analyze(const AnalyzeOptions& opts, const TelemetryFormat& fmt)
+{
+    auto start = Clock::now();
+
+    auto paths = list_flight_segments(opts.log_dir);
+    if (paths.empty())
+    {
+        logger.log(LogLevel::error, "No flight log segments in ", opts.log_dir, '\n');
+        return false;
+    }
+
+    std::vector<MappedFile> segments(paths.size());
+    for (std::size_t i = 0; i < paths.size(); i++)
+    {
+        if (!segments[i].open(paths[i]))
+            return false;
+    }
+
+    ThreadPool pool(opts.threads);
+
+    // Cut every segment into chunks.
+    std::vector<std::future<std::vector<Chunk>>> plans;
+    for (std::size_t i = 0; i < segments.size(); i++)
+        plans.push_back(pool.submit([&, i] { return plan_chunks(segments[i].data(), i, opts.chunk_len); }));
+    std::vector<Chunk> chunks;
+    for (std::size_t i = 0; i < plans.size(); i++)
+    {
+        auto plan = plans[i].get();
+        if (plan.empty())
+            logger.log(LogLevel::warning, "Skipping ", paths[i], ", it has no valid header or records\n");
+        chunks.insert(chunks.end(), plan.begin(), plan.end());
+    }
+
+    std::ofstream csv;
+    if (!opts.csv_path.empty())
+    {
+        csv.open(opts.csv_path, std::ios::binary);
+        if (!csv)
+        {
+            logger.log(LogLevel::error, "Cannot open ", opts.csv_path, '\n');
+            return false;
+        }
+        csv << "time_ns";
+        for (auto& name : fmt.channel_names)
+            csv << ',' << name;
+        if (!opts.filters.empty())
+        {
+            for (auto& name : STANDARD_CHANNELS)
+                csv << ',' << name << ".filtered";
+        }
+        csv << '\n';
+    }
+
+    Analysis a{opts, fmt, segments, chunks, !opts.filters.empty(), csv.is_open()};
+    const std::int64_t gap_threshold_ns = std::chrono::nanoseconds(opts.gap_threshold).count();
+
+    Totals totals;
+    totals.raw.resize(fmt.channel_names.size());
+
+    // Chunks are analyzed ahead of the merge, bounded so that only a few
+    // chunks' results (and CSV rows) are held at a time.
+    const std::size_t window = 2 * pool.size();
+    std::deque<std::future<ChunkResult>> pending;
+    std::size_t next = 0;
+
+    std::optional<Framer> prev_framer;
+    // Set once the stream before the next chunk isn't the previous chunk,
+    // since a segment ended early.
+    bool prev_skipped = false;
+    std::optional<std::size_t> invalid_segment;
+
+    for (std::size_t i = 0; i < chunks.size(); i++)
+    {
+        for (; next < chunks.size() && next < i + window; next++)
+            pending.push_back(pool.submit([&a, next] { return analyze_chunk(a, next); }));
+
+        ChunkResult speculative = pending.front().get();
+        pending.pop_front();
+
+        // The rest of a segment after an invalid record isn't part of the log.
+        if (invalid_segment == chunks[i].segment)
+        {
+            prev_skipped = true;
+            continue;
+        }
+
+        bool mismatch = prev_framer &&
+            (prev_skipped || speculative.start_state != prev_framer->get_state());
+        ChunkResult result = mismatch ? analyze_chunk(a, i, *prev_framer) : std::move(speculative);
+        totals.reanalyzed += mismatch;
+        prev_skipped = false;
+
+        if (result.invalid_at)
+        {
+            logger.log(LogLevel::warning, paths[chunks[i].segment], " ends at an invalid record at offset ",
+                *result.invalid_at, '\n');
+            invalid_segment = chunks[i].segment;
+        }
+
+        totals.merge(result, gap_threshold_ns);
+        if (csv.is_open())
+            csv.write(result.csv.data(), result.csv.size());
+        prev_framer.reset();
+        prev_framer.emplace(std::move(*result.end_framer));
+    }
+
+    if (csv.is_open())
+    {
+        csv.close();
+        if (!csv)
+        {
+            logger.log(LogLevel::error, "Cannot write ", opts.csv_path, '\n');
+            return false;
+        }
+    }
+
+    print_report(a, totals, std::chrono::duration<double>(Clock::now() - start).count());
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    AnalyzeOptions opts{};
+    if (!parse_options(argc, argv, opts))
+        return 1;
+
+    auto fmt = make_telemetry_format(opts.framing, opts.schema_path);
+    if (!fmt)
+        return 1;
+
+    return analyze(opts, *fmt) ? 0 : 1;
+}
@@ -0,0 +1,381 @@
+/*
+ * Flight log to telemetry archive converter. Reads the decoded samples of a
+ * flight log (recorded with prometheus -r) and writes them to a compressed
+ * columnar archive (see telemetry_archive.hpp):
+ *
+ *     ./build/prometheus_archive flights/ flights.archive
+ *
+ * With -v, the archive is then decoded and compared with the log sample by
+ * sample, and the decoding speed is measured.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include "flight_recorder.hpp"
+#include "logger.hpp"
+#include "mapped_file.hpp"
+#include "span.hpp"
+#include "telemetry_archive.hpp"
+#include "telemetry_framing.hpp"
+#include "telemetry_schema.hpp"
+
+Logger logger = Logger(LogLevel::info);
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+using Clock = std::chrono::steady_clock;
+
+// Decoding is timed over at least this long.
+constexpr std::chrono::milliseconds MIN_BENCHMARK_TIME{500};
+
+struct ArchiveOptions
+{
+    std::chrono::nanoseconds block_duration = std::chrono::seconds(1);
+    // Sample times are local estimates, good to tens of microseconds at best,
+    // and their nanoseconds would cost more than the values.
+    std::chrono::nanoseconds time_quantum = std::chrono::microseconds(1);
+    std::string schema_path{};
+    bool verify = false;
+    fs::path log_dir{};
+    fs::path archive_path{};
+};
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options] <flight log directory> <archive>\n"
+        "  -b <ms>     Block duration (default 1000)\n"
+        "  -q <ns>     Time quantum; times are rounded down to a multiple of\n"
+        "              it (default 1000, 1 for exact times)\n"
+        "  -s <file>   Packet schema the log was recorded with, to name the\n"
+        "              channels\n"
+        "  -v          Decode the archive, compare it with the log and\n"
+        "              measure the decoding speed\n"
+        "  -h          Show this help\n",
+        argv0);
+}
+
+bool parse_options(int argc, char** argv, ArchiveOptions& opts)
+{
+    int flag;
+    while ((flag = getopt(argc, argv, "b:q:s:vh")) != -1)
+    {
+        switch (flag)
+        {
+        case 'b':
+            opts.block_duration = std::chrono::milliseconds(std::strtoll(optarg, nullptr, 10));
+            break;
+        case 'q': opts.time_quantum = std::chrono::nanoseconds(std::strtoll(optarg, nullptr, 10)); break;
+        case 's': opts.schema_path = optarg; break;
+        case 'v': opts.verify = true; break;
+        default:
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+
+    if (argc - optind != 2)
+    {
+        print_usage(argv[0]);
+        return false;
+    }
+    opts.log_dir = argv[optind];
+    opts.archive_path = argv[optind + 1];
+
+    if (opts.block_duration.count() <= 0 || opts.time_quantum.count() <= 0)
+    {
+        logger.log(LogLevel::error, "Block duration and time quantum must be positive\n");
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * The sample records of a flight log, in order. Sessions appended to the same
+ * log may go back in time (the steady clock restarts with the machine), and
+ * are moved up to follow the previous sample, as the archive needs samples in
+ * time order.
+ */
+class SampleReader
+{
+public:
+    explicit SampleReader(const fs::path& dir) : segments(list_flight_segments(dir)) {}
+
+    std::size_t num_segments() const { return segments.size(); }
+
+    /*
+     * Calls on_sample(time_ns, channels) for every sample and on_raw(bytes)
+     * for every raw record. Returns false if a segment can't be read.
+     */
+    template <typename S, typename R>
+    bool for_each(S&& on_sample, R&& on_raw);
+private:
+    std::vector<fs::path> segments;
+};
+
+template <typename S, typename R>
+bool SampleReader::for_each(S&& on_sample, R&& on_raw)
+{
+    std::vector<float> channels;
+    std::int64_t last_ns = std::numeric_limits<std::int64_t>::min();
+    std::int64_t shift_ns = 0;
+
+    for (const auto& path : segments)
+    {
+        MappedFile segment;
+        if (!segment.open(path))
+            return false;
+
+        for_each_flight_record(segment.data(), [&](const FlightRecord& record)
+        {
+            if (record.type == static_cast<std::uint16_t>(FlightRecordType::Raw))
+            {
+                on_raw(record.payload);
+                return;
+            }
+            if (record.type != static_cast<std::uint16_t>(FlightRecordType::Sample))
+                return;
+
+            auto p = reinterpret_cast<const std::uint8_t*>(record.payload.data());
+            channels.resize(record.payload.size() / 4);
+            for (std::size_t i = 0; i < channels.size(); i++)
+                channels[i] = get_le_float(p + 4 * i);
+
+            std::int64_t t = record.time_ns + shift_ns;
+            if (t < last_ns)
+            {
+                logger.log(LogLevel::warning, "Sample in ", path.filename(),
+                    " goes back in time by ", last_ns - t, " ns, moving it and"
+                    " the rest of the log up\n");
+                shift_ns += last_ns - t;
+                t = last_ns;
+            }
+            last_ns = t;
+            on_sample(t, Span<const float>(channels));
+        });
+    }
+    return true;
+}
+
+/*
+ * Channel names for a log with num_channels channels: the schema's if given,
+ * else the standard channels, with any others numbered.
+ */
+std::optional<std::vector<std::string>> channel_names(const ArchiveOptions& opts,
+                                                      std::size_t num_channels)
+{
+    std::vector<std::string> names(STANDARD_CHANNELS.begin(), STANDARD_CHANNELS.end());
+    if (!opts.schema_path.empty())
+    {
+        auto schema = load_telemetry_schema(opts.schema_path);
+        if (!schema)
+            return std::nullopt;
+        names = schema->channel_names;
+    }
+
+    if (names.size() < num_channels)
+    {
+        for (std::size_t i = names.size(); i < num_channels; i++)
+            names.push_back("channel." + std::to_string(i));
+    }
+    names.resize(num_channels);
+    return names;
+}
+
+bool convert(const ArchiveOptions& opts, SampleReader& log)
+{
+    std::optional<ArchiveWriter> writer;
+    std::size_t num_channels = 0;
+    std::uint64_t raw_bytes = 0;
+    std::uint64_t skipped = 0;
+    bool ok = true;
+
+    bool read = log.for_each([&](std::int64_t time_ns, Span<const float> channels)
+    {
+        if (!ok)
+            return;
+        if (!writer)
+        {
+            auto names = channel_names(opts, channels.size());
+            if (!names)
+            {
+                ok = false;
+                return;
+            }
+            num_channels = channels.size();
+            writer.emplace(*names, opts.block_duration, opts.time_quantum);
+            ok = writer->open(opts.archive_path);
+            if (!ok)
+                return;
+        }
+
+        if (channels.size() != num_channels)
+            skipped++;
+        else
+            ok = writer->append(time_ns, channels);
+    },
+    [&](Span<const char> bytes) { raw_bytes += bytes.size(); });
+
+    if (!writer)
+    {
+        logger.log(LogLevel::error, "No samples in ", opts.log_dir, '\n');
+        return false;
+    }
+    ok = writer->close() && read && ok;
+    if (!ok)
+        return false;
+
+    if (skipped)
+        logger.log(LogLevel::warning, "Skipped ", skipped, " samples without ",
+            num_channels, " channels\n");
+
+    auto stats = writer->get_stats();
+    std::uint64_t float_bytes = stats.samples * (8 + 4 * num_channels);
+    logger.log(LogLevel::info, "Wrote ", stats.samples, " samples of ", num_channels,
+        " channels in ", stats.blocks, " blocks, ", stats.bytes, " bytes (",
+        static_cast<double>(stats.bytes) / std::max<std::uint64_t>(1, stats.samples),
+        " per sample)\n");
+    logger.log(LogLevel::info, "Columns: ", stats.columns[0], " frame of reference, ",
+        stats.columns[1], " delta, ", stats.columns[2], " float\n");
+    logger.log(LogLevel::info, "Compression: ",
+        static_cast<double>(raw_bytes) / stats.bytes, "x against ", raw_bytes,
+        " raw telemetry bytes, ", static_cast<double>(float_bytes) / stats.bytes,
+        "x against ", float_bytes, " bytes of times and floats\n");
+    return true;
+}
+
+/*
+ * Decodes the archive alongside the log and checks that every time and value
+ * came back exactly (times to the time quantum).
+ */
+bool verify(const ArchiveOptions& opts, SampleReader& log)
+{
+    ArchiveReader reader;
+    if (!reader.open(opts.archive_path))
+        return false;
+
+    const std::size_t num_channels = reader.get_channel_names().size();
+    const std::size_t num_blocks = reader.get_index().size();
+    const std::int64_t quantum = reader.get_time_quantum().count();
+
+    ArchiveBlock block;
+    std::size_t next_block = 0;
+    std::size_t pos = 0;
+    std::uint64_t compared = 0;
+    std::uint64_t mismatches = 0;
+
+    auto mismatch = [&](const std::string& what)
+    {
+        if (!mismatches++)
+            logger.log(LogLevel::error, "Sample ", compared, ": ", what, '\n');
+    };
+
+    bool read = log.for_each([&](std::int64_t time_ns, Span<const float> channels)
+    {
+        if (channels.size() != num_channels)
+            return;
+
+        if (pos == block.size())
+        {
+            if (next_block == num_blocks)
+            {
+                mismatch("missing from the archive");
+                return;
+            }
+            if (!reader.decode_block(next_block++, block))
+            {
+                block = {};
+                mismatch("in a block which can't be decoded");
+                return;
+            }
+            pos = 0;
+        }
+
+        std::int64_t first = block.times[0];
+        std::int64_t expected = first + (time_ns - first) / quantum * quantum;
+        if (block.times[pos] != expected)
+            mismatch("time " + std::to_string(block.times[pos]) + " ns, expected " +
+                     std::to_string(expected) + " ns");
+        for (std::size_t c = 0; c < num_channels; c++)
+        {
+            float v = block.values[c * block.size() + pos];
+            if (std::memcmp(&v, &channels[c], sizeof(float)) != 0)
+                mismatch(reader.get_channel_names()[c] + " is " + std::to_string(v) +
+                         ", expected " + std::to_string(channels[c]));
+        }
+        pos++;
+        compared++;
+    },
+    [](Span<const char>) {});
+
+    if (pos != block.size() || next_block != num_blocks)
+        mismatch("archive has more samples than the log");
+
+    if (!read || mismatches)
+    {
+        logger.log(LogLevel::error, "Verification failed, ", mismatches,
+            " mismatches in ", compared, " samples\n");
+        return false;
+    }
+    logger.log(LogLevel::info, "Verified ", compared, " samples: values bit-exact, times exact to ",
+        quantum, " ns\n");
+
+    // Decode the whole archive until enough time has passed to measure.
+    std::uint64_t decoded = 0;
+    auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    do
+    {
+        for (std::size_t b = 0; b < num_blocks; b++)
+        {
+            if (!reader.decode_block(b, block))
+                return false;
+            decoded += block.size();
+        }
+        elapsed = Clock::now() - start;
+    } while (num_blocks && elapsed < MIN_BENCHMARK_TIME);
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    double decoded_bytes = static_cast<double>(decoded) * (8 + 4 * num_channels);
+    logger.log(LogLevel::info, "Decoded ", decoded / seconds / 1e6, " M samples/s, ",
+        decoded_bytes / seconds / 1e9, " GB/s of times and floats\n");
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    ArchiveOptions opts{};
+    if (!parse_options(argc, argv, opts))
+        return 1;
+
+    SampleReader log(opts.log_dir);
+    if (!log.num_segments())
+    {
+        logger.log(LogLevel::error, "No flight log segments in ", opts.log_dir, '\n');
+        return 1;
+    }
+
+    if (!convert(opts, log))
+        return 1;
+    if (opts.verify && !verify(opts, log))
+        return 1;
+    return 0;
+}
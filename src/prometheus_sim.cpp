@@ -0,0 +1,544 @@
+/*
+ * Telemetry packet simulator. Opens a pseudo-terminal and writes drone
+ * telemetry packets to it in the same wire format as the Arduino ground station
+ * sketch (test/hardware/arduino_ground_station), or in one of the binary
+ * formats from telemetry_framing.hpp, so the viewer can be load-tested without
+ * any hardware:
+ *
+ *     ./build/prometheus_sim -r 1000 &
+ *     ./build/prometheus -p <slave path printed by the simulator>
+ *
+ * The viewer must be started with the same format, e.g. -e cobs / -f cobs.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "cobs.hpp"
+#include "crc16.hpp"
+#include "logger.hpp"
+#include "span.hpp"
+#include "telemetry_framing.hpp"
+
+Logger logger = Logger(LogLevel::info);
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+/*
+ * Packet format constants. Must match GroundStationFormat
+ * (telemetry_format.hpp) and the ground station sketch.
+ */
+constexpr char START_SYMBOL = '|';
+constexpr std::size_t NUM_FIELDS = 6;
+constexpr int FIELD_MIN = -9999;
+constexpr int FIELD_MAX = 99999;
+constexpr float CONVERSION_FACTOR = 1000.0f;
+
+constexpr double MIN_RATE_HZ = 10.0;
+constexpr double MAX_RATE_HZ = 20000.0;
+
+// Upper bound on packets coalesced into one write() when behind schedule.
+constexpr std::size_t MAX_BATCH_PACKETS = 256;
+
+enum class Profile
+{
+    Hover,    // sim1: noise while floating in place
+    Takeoff,  // sim2: cycle between taking off and landing
+    Script,   // replay field values from a file
+};
+
+struct SimOptions
+{
+    double rate_hz = 100.0;
+    Profile profile = Profile::Hover;
+    TelemetryFraming framing = TelemetryFraming::Ascii;
+    std::string script_path{};
+    std::string link_path{};
+    std::size_t packet_count = 0;  // 0 = unlimited
+    double duration_s = 0.0;       // 0 = unlimited
+    double corrupt_prob = 0.0;
+    double truncate_prob = 0.0;
+    std::size_t burst_len = 1;
+    unsigned int seed = 1;
+    bool quiet = false;
+};
+
+using Fields = std::array<int, NUM_FIELDS>;
+
+volatile sig_atomic_t running = 1;
+
+void handle_signal(int)
+{
+    running = 0;
+}
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -r <hz>     Packet rate, %.0f to %.0f Hz (default 100)\n"
+        "  -m <name>   Profile: hover, takeoff (default hover)\n"
+        "  -e <fmt>    Wire format: ascii, cobs, cobs-f32 (default ascii)\n"
+        "  -s <file>   Script profile: one packet per line, six comma\n"
+        "              separated integers (already scaled by 1000)\n"
+        "  -n <count>  Stop after this many packets\n"
+        "  -t <sec>    Stop after this many seconds\n"
+        "  -c <prob>   Probability of flipping one bit in a packet\n"
+        "  -x <prob>   Probability of truncating a packet\n"
+        "  -b <len>    Send packets in bursts of this length\n"
+        "  -S <seed>   Random seed (default 1)\n"
+        "  -l <path>   Symlink to create for the pty slave\n"
+        "  -q          Don't print per-second statistics\n"
+        "  -h          Show this help\n",
+        argv0, MIN_RATE_HZ, MAX_RATE_HZ);
+}
+
+bool parse_options(int argc, char** argv, SimOptions& opts)
+{
+    int flag;
+    while ((flag = getopt(argc, argv, "r:m:e:s:n:t:c:x:b:S:l:qh")) != -1)
+    {
+        switch (flag)
+        {
+        case 'r': opts.rate_hz = std::atof(optarg); break;
+        case 'm':
+            if (std::strcmp(optarg, "hover") == 0)
+                opts.profile = Profile::Hover;
+            else if (std::strcmp(optarg, "takeoff") == 0)
+                opts.profile = Profile::Takeoff;
+            else
+            {
+                logger.log(LogLevel::error, "Unknown profile: ", optarg, '\n');
+                return false;
+            }
+            break;
+        case 'e':
+            if (std::strcmp(optarg, "ascii") == 0)
+                opts.framing = TelemetryFraming::Ascii;
+            else if (std::strcmp(optarg, "cobs") == 0)
+                opts.framing = TelemetryFraming::CobsInt16;
+            else if (std::strcmp(optarg, "cobs-f32") == 0)
+                opts.framing = TelemetryFraming::CobsFloat32;
+            else
+            {
+                logger.log(LogLevel::error, "Unknown format: ", optarg, '\n');
+                return false;
+            }
+            break;
+        case 's':
+            opts.profile = Profile::Script;
+            opts.script_path = optarg;
+            break;
+        case 'n': opts.packet_count = std::strtoull(optarg, nullptr, 10); break;
+        case 't': opts.duration_s = std::atof(optarg); break;
+        case 'c': opts.corrupt_prob = std::atof(optarg); break;
+        case 'x': opts.truncate_prob = std::atof(optarg); break;
+        case 'b': opts.burst_len = std::max(1ull, std::strtoull(optarg, nullptr, 10)); break;
+        case 'S': opts.seed = std::strtoul(optarg, nullptr, 10); break;
+        case 'l': opts.link_path = optarg; break;
+        case 'q': opts.quiet = true; break;
+        default:
+            print_usage(argv[0]);
+            return false;
+        }
+    }
+
+    if (opts.rate_hz < MIN_RATE_HZ || opts.rate_hz > MAX_RATE_HZ)
+    {
+        logger.log(LogLevel::error, "Rate must be between ", MIN_RATE_HZ,
+            " and ", MAX_RATE_HZ, " Hz\n");
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Generates field values for each packet, ported from the ground station
+ * sketch. Values are pre-scaled by the float conversion factor (1000).
+ */
+class PacketSource
+{
+public:
+    PacketSource(Profile profile_, unsigned int seed) :
+        profile(profile_), rng(seed) {}
+
+    bool load_script(const std::string&);
+    Fields next();
+private:
+    Profile profile;
+    std::mt19937 rng;
+
+    // Equivalent of Arduino's random(max), which returns [0, max).
+    float random(long max)
+    {
+        return std::uniform_int_distribution<long>(0, max - 1)(rng);
+    }
+
+    float phase = 0.0f;
+
+    std::vector<Fields> script{};
+    std::size_t script_idx = 0;
+};
+
+bool PacketSource::load_script(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        logger.log(LogLevel::error, "Cannot open script: ", path, '\n');
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream ss(line);
+        Fields f{};
+        for (auto& v : f)
+            ss >> v;
+        if (!ss.fail())
+            script.push_back(f);
+    }
+
+    if (script.empty())
+    {
+        logger.log(LogLevel::error, "Script contains no packets: ", path, '\n');
+        return false;
+    }
+    return true;
+}
+
+Fields PacketSource::next()
+{
+    constexpr float a_noise = 5;
+    constexpr float r_noise = 100;
+
+    Fields f{};
+    switch (profile)
+    {
+    case Profile::Hover:
+    {
+        constexpr float y_offset = 2000;
+        f[0] = (random(a_noise) - a_noise / 2) * 100;
+        f[1] = (random(a_noise) - a_noise / 2) * 100 + y_offset;
+        f[2] = (random(a_noise) - a_noise / 2) * 100;
+        f[3] = (random(r_noise) - r_noise / 2) * 100;
+        f[4] = (random(r_noise) - r_noise / 2) * 100;
+        f[5] = (random(r_noise) - r_noise / 2) * 100;
+        break;
+    }
+    case Profile::Takeoff:
+    {
+        f[0] = (random(a_noise) - a_noise / 2) * 100;
+        f[1] = (random(a_noise) - a_noise / 2 + 40 * std::abs(std::sin(phase))) * 100;
+        f[2] = (random(a_noise) - a_noise / 2) * 100;
+        f[3] = (random(r_noise) - r_noise / 2) * 100;
+        f[4] = (random(r_noise) - r_noise / 2) * 100;
+        f[5] = (random(r_noise) - r_noise / 2) * 100;
+        phase += 0.025f;
+        break;
+    }
+    case Profile::Script:
+    {
+        f = script[script_idx];
+        script_idx = (script_idx + 1) % script.size();
+        break;
+    }
+    }
+
+    for (auto& v : f)
+        v = std::clamp(v, FIELD_MIN, FIELD_MAX);
+    return f;
+}
+
+/*
+ * Appends one packet in the ground station's ASCII format, e.g.
+ * "|00100,02000,-0150,01200,-0300,00000\r\n". The sketch uses println, hence
+ * the trailing "\r\n".
+ */
+void encode_ascii(const Fields& f, std::string& out)
+{
+    char buf[64];
+    int n = std::snprintf(buf, sizeof(buf), "%c%05i,%05i,%05i,%05i,%05i,%05i\r\n",
+        START_SYMBOL, f[0], f[1], f[2], f[3], f[4], f[5]);
+    out.append(buf, n);
+}
+
+/*
+ * Appends one COBS-framed binary packet, including the trailing delimiter.
+ * int16 fields carry the pre-scaled values (saturated to the int16 range),
+ * float32 fields the unscaled physical values.
+ */
+void encode_binary(TelemetryFraming framing, std::uint16_t seq, const Fields& f,
+                   std::string& out)
+{
+    std::uint8_t packet[binary_packet_len(TelemetryFraming::CobsFloat32, NUM_FIELDS)];
+    const std::size_t len = binary_packet_len(framing, NUM_FIELDS);
+    const std::size_t field_len = binary_field_len(framing);
+
+    put_le16(packet, seq);
+    for (std::size_t i = 0; i < NUM_FIELDS; i++)
+    {
+        std::uint8_t* p = packet + BINARY_SEQ_LEN + i * field_len;
+        if (framing == TelemetryFraming::CobsFloat32)
+            put_le_float(p, f[i] / CONVERSION_FACTOR);
+        else
+            put_le16(p, static_cast<std::int16_t>(std::clamp(f[i], -32768, 32767)));
+    }
+    std::size_t body_len = len - BINARY_CRC_LEN;
+    put_le16(packet + body_len, crc16_ccitt(Span<const std::uint8_t>(packet, body_len)));
+
+    std::uint8_t encoded[cobs_max_encoded_len(sizeof(packet))];
+    std::size_t n = cobs_encode(Span<const std::uint8_t>(packet, len), encoded);
+    out.append(reinterpret_cast<const char*>(encoded), n);
+    out += COBS_DELIMITER;
+}
+
+/*
+ * Link impairments, applied to the most recently encoded packet.
+ */
+class Impairments
+{
+public:
+    Impairments(const SimOptions& opts, unsigned int seed) :
+        corrupt_prob(opts.corrupt_prob),
+        truncate_prob(opts.truncate_prob),
+        rng(seed ^ 0x5bd1e995u) {}
+
+    void apply(std::string& out, std::size_t packet_start);
+
+    std::size_t corrupted = 0;
+    std::size_t truncated = 0;
+private:
+    double corrupt_prob;
+    double truncate_prob;
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> chance{0.0, 1.0};
+};
+
+void Impairments::apply(std::string& out, std::size_t packet_start)
+{
+    std::size_t len = out.size() - packet_start;
+    if (len == 0)
+        return;
+
+    if (corrupt_prob > 0.0 && chance(rng) < corrupt_prob)
+    {
+        std::size_t byte = std::uniform_int_distribution<std::size_t>(0, len - 1)(rng);
+        int bit = std::uniform_int_distribution<int>(0, 7)(rng);
+        out[packet_start + byte] ^= static_cast<char>(1 << bit);
+        corrupted++;
+    }
+
+    if (truncate_prob > 0.0 && chance(rng) < truncate_prob)
+    {
+        std::size_t keep = std::uniform_int_distribution<std::size_t>(0, len - 1)(rng);
+        out.resize(packet_start + keep);
+        truncated++;
+    }
+}
+
+/*
+ * Creates a pty pair. The slave side is put in raw mode and kept open, so the
+ * master doesn't see a hangup whenever the viewer closes the port.
+ */
+bool open_pty(int& master_fd, int& slave_fd, std::string& slave_path)
+{
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_fd < 0 || grantpt(master_fd) < 0 || unlockpt(master_fd) < 0)
+    {
+        logger.log(LogLevel::error, "Failed to create pty: ", std::strerror(errno), '\n');
+        return false;
+    }
+
+    const char* name = ptsname(master_fd);
+    if (!name)
+    {
+        logger.log(LogLevel::error, "ptsname failed: ", std::strerror(errno), '\n');
+        return false;
+    }
+    slave_path = name;
+
+    slave_fd = open(name, O_RDWR | O_NOCTTY);
+    if (slave_fd < 0)
+    {
+        logger.log(LogLevel::error, "Failed to open pty slave: ", std::strerror(errno), '\n');
+        return false;
+    }
+
+    termios tio{};
+    tcgetattr(slave_fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave_fd, TCSANOW, &tio);
+
+    // A real radio doesn't wait for the receiver; drop bytes instead of
+    // blocking when the viewer stops reading.
+    fcntl(master_fd, F_SETFL, fcntl(master_fd, F_GETFL) | O_NONBLOCK);
+
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    SimOptions opts{};
+    if (!parse_options(argc, argv, opts))
+        return 1;
+
+    PacketSource source(opts.profile, opts.seed);
+    if (opts.profile == Profile::Script && !source.load_script(opts.script_path))
+        return 1;
+    Impairments impairments(opts, opts.seed);
+
+    int master_fd = -1;
+    int slave_fd = -1;
+    std::string slave_path;
+    if (!open_pty(master_fd, slave_fd, slave_path))
+        return 1;
+
+    if (!opts.link_path.empty())
+    {
+        unlink(opts.link_path.c_str());
+        if (symlink(slave_path.c_str(), opts.link_path.c_str()) < 0)
+            logger.log(LogLevel::warning, "Failed to create symlink ",
+                opts.link_path, ": ", std::strerror(errno), '\n');
+    }
+
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    logger.log(LogLevel::info, "Simulating telemetry on ", slave_path, " at ",
+        opts.rate_hz, " Hz\n");
+
+    /*
+     * Packets are scheduled on a fixed grid of period / burst_len bursts. When
+     * the loop wakes up late (always the case at kHz rates, given sleep
+     * granularity) all overdue packets are coalesced into one write().
+     */
+    using Seconds = std::chrono::duration<double>;
+    const auto burst_period = std::chrono::duration_cast<Clock::duration>(
+        Seconds(opts.burst_len / opts.rate_hz));
+
+    const auto start_time = Clock::now();
+    auto next_burst = start_time;
+    auto next_report = start_time + std::chrono::seconds(1);
+
+    std::string out;
+    out.reserve(MAX_BATCH_PACKETS * 64);
+
+    std::size_t packets_sent = 0;
+    std::size_t bytes_written = 0;
+    std::size_t bytes_dropped = 0;
+    std::size_t report_packets = 0;
+    std::size_t report_bytes = 0;
+
+    while (running)
+    {
+        if (opts.packet_count && packets_sent >= opts.packet_count)
+            break;
+        if (opts.duration_s > 0.0 &&
+            Clock::now() - start_time >= Seconds(opts.duration_s))
+            break;
+
+        std::this_thread::sleep_until(next_burst);
+        auto now = Clock::now();
+
+        out.clear();
+        std::size_t batch = 0;
+        while (next_burst <= now && batch < MAX_BATCH_PACKETS)
+        {
+            for (std::size_t i = 0; i < opts.burst_len; i++)
+            {
+                if (opts.packet_count && packets_sent + batch >= opts.packet_count)
+                    break;
+                std::size_t packet_start = out.size();
+                if (opts.framing == TelemetryFraming::Ascii)
+                    encode_ascii(source.next(), out);
+                else
+                    encode_binary(opts.framing,
+                        static_cast<std::uint16_t>(packets_sent + batch),
+                        source.next(), out);
+                impairments.apply(out, packet_start);
+                batch++;
+            }
+            next_burst += burst_period;
+        }
+
+        // Hopelessly behind (e.g. the process was stopped); don't try to catch
+        // up on the backlog.
+        if (next_burst + 100 * burst_period < now)
+            next_burst = now;
+
+        std::size_t off = 0;
+        while (off < out.size())
+        {
+            ssize_t n = write(master_fd, out.data() + off, out.size() - off);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN)
+                    logger.log(LogLevel::error, "write failed: ", std::strerror(errno), '\n');
+                bytes_dropped += out.size() - off;
+                break;
+            }
+            off += n;
+        }
+
+        packets_sent += batch;
+        bytes_written += off;
+        report_packets += batch;
+        report_bytes += off;
+
+        if (!opts.quiet && now >= next_report)
+        {
+            double dt = Seconds(now - (next_report - std::chrono::seconds(1))).count();
+            logger.log(LogLevel::info, report_packets / dt, " packets/s, ",
+                report_bytes / dt, " bytes/s, ", bytes_dropped, " bytes dropped\n");
+            report_packets = 0;
+            report_bytes = 0;
+            next_report = now + std::chrono::seconds(1);
+        }
+    }
+
+    double elapsed = Seconds(Clock::now() - start_time).count();
+    logger.log(LogLevel::info, "Sent ", packets_sent, " packets (", bytes_written,
+        " bytes) in ", elapsed, " s: ", packets_sent / elapsed, " packets/s, ",
+        bytes_written / elapsed, " bytes/s; ", bytes_dropped, " bytes dropped, ",
+        impairments.corrupted, " corrupted, ", impairments.truncated, " truncated\n");
+
+    if (!opts.link_path.empty())
+        unlink(opts.link_path.c_str());
+    close(slave_fd);
+    close(master_fd);
+
+    return 0;
+}
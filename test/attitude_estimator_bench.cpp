@@ -0,0 +1,167 @@
+/*
+ * Benchmark for AttitudeEstimator at an 8 kHz IMU rate. Loops the samples of
+ * an IMU fixture through an estimator configured for 8 kHz and times each
+ * second's worth of updates:
+ *
+ *     ./build/attitude_estimator_bench test/data/imu_flight.csv
+ *
+ * Fails if any second's worth of updates took longer than a second, i.e. the
+ * estimator couldn't keep up with the IMU on one core.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "attitude_estimator.hpp"
+
+namespace
+{
+
+constexpr float SAMPLE_HZ = 8000.0f;
+constexpr std::size_t UPDATES_PER_SECOND = 8000;
+
+constexpr AttitudeEstimatorConfig ESTIMATOR_CONFIG{
+    SAMPLE_HZ,
+    0.1f,
+    3.14159265f / 180.0f,
+};
+
+// The ground station's fields are scaled by 1000.
+constexpr float CONVERSION_FACTOR = 1000.0f;
+
+struct ImuSample
+{
+    glm::vec3 accel;
+    glm::vec3 rot_rate;
+};
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options] <samples.csv>\n"
+        "  -s <sec>  Seconds of IMU data to process (default 600)\n"
+        "  -h        Show this help\n",
+        argv0);
+}
+
+bool load_samples(const std::string& path, std::vector<ImuSample>& samples)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::printf("Cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream ss(line);
+        int f[6];
+        for (int& v : f)
+            ss >> v;
+        if (ss.fail())
+        {
+            std::printf("Malformed sample in %s: %s\n", path.c_str(), line.c_str());
+            return false;
+        }
+        samples.push_back({
+            glm::vec3(f[0], f[1], f[2]) / CONVERSION_FACTOR,
+            glm::vec3(f[3], f[4], f[5]) / CONVERSION_FACTOR});
+    }
+    return !samples.empty();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long seconds = 600;
+    int flag;
+    while ((flag = getopt(argc, argv, "s:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 's':
+        {
+            char* end = nullptr;
+            seconds = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || seconds <= 0)
+            {
+                std::printf("Invalid duration: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 1)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<ImuSample> samples;
+    if (!load_samples(argv[optind], samples))
+        return 1;
+
+    using clock = std::chrono::steady_clock;
+    AttitudeEstimator estimator(ESTIMATOR_CONFIG);
+    std::size_t next = 0;
+    clock::duration total{};
+    clock::duration slowest{};
+
+    for (long s = 0; s < seconds; s++)
+    {
+        auto t0 = clock::now();
+        for (std::size_t i = 0; i < UPDATES_PER_SECOND; i++)
+        {
+            estimator.update(samples[next].rot_rate, samples[next].accel);
+            if (++next == samples.size())
+                next = 0;
+        }
+        auto elapsed = clock::now() - t0;
+        total += elapsed;
+        slowest = std::max(slowest, elapsed);
+    }
+
+    using ms = std::chrono::duration<double, std::milli>;
+    using ns = std::chrono::duration<double, std::nano>;
+    const double updates = static_cast<double>(seconds) * UPDATES_PER_SECOND;
+    const double mean_ns = ns(total).count() / updates;
+    const double slowest_ms = ms(slowest).count();
+
+    // Keeps the updates from being optimized away.
+    glm::quat q = estimator.get_orientation();
+    std::printf("%ld s of IMU data at %.0f Hz, final orientation (%.3f, %.3f, %.3f, %.3f)\n",
+        seconds, SAMPLE_HZ, q.w, q.x, q.y, q.z);
+    std::printf("Update: %.1f ns mean, %.2f M updates/s on one core\n",
+        mean_ns, 1e3 / mean_ns);
+    std::printf("Slowest second of data: %.3f ms (%.3f%% of the budget)\n",
+        slowest_ms, slowest_ms / 10.0);
+
+    if (!(slowest < std::chrono::seconds(1)))
+    {
+        std::printf("FAIL: can't keep up with %.0f Hz\n", SAMPLE_HZ);
+        return 1;
+    }
+    return 0;
+}
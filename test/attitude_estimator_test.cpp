@@ -0,0 +1,258 @@
+/*
+ * Regression test for AttitudeEstimator. Runs a fixture of recorded IMU
+ * samples through the estimator with the viewer's configuration and compares
+ * the orientation against a trace of expected quaternions:
+ *
+ *     ./build/attitude_estimator_test test/data/imu_flight.csv \
+ *         test/data/imu_flight_attitude.csv
+ *
+ * The trace was produced by the estimator itself and checked against the
+ * simulated flight's true attitude, so a mismatch means its output changed.
+ * After an intended change, rewrite the trace with -u and review the diff.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "attitude_estimator.hpp"
+
+namespace
+{
+
+// DroneViewer's TELEMETRY_ATTITUDE_ESTIMATOR.
+constexpr AttitudeEstimatorConfig ESTIMATOR_CONFIG{
+    100.0f,
+    0.1f,
+    3.14159265f / 180.0f,
+};
+
+// The ground station's fields are scaled by 1000.
+constexpr float CONVERSION_FACTOR = 1000.0f;
+
+// One expected orientation per this many samples.
+constexpr std::size_t TRACE_INTERVAL = 10;
+
+// Allows for float rounding differences between compilers, e.g. whether
+// multiply-adds are fused (4e-5 deg), while a 10% change in beta (0.04 deg)
+// still fails.
+constexpr double TOLERANCE_DEG = 0.001;
+
+struct ImuSample
+{
+    glm::vec3 accel;
+    glm::vec3 rot_rate;
+};
+
+struct TraceEntry
+{
+    std::size_t sample;
+    glm::quat orientation;
+};
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options] <samples.csv> <trace.csv>\n"
+        "  -u  Write the estimator's output as the new trace\n"
+        "  -h  Show this help\n",
+        argv0);
+}
+
+/*
+ * Reads the lines of a CSV file which aren't blank or comments, with commas
+ * replaced by spaces.
+ */
+bool read_rows(const std::string& path, std::vector<std::string>& rows)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::printf("Cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        for (char& c : line)
+            if (c == ',')
+                c = ' ';
+        rows.push_back(line);
+    }
+    return true;
+}
+
+bool load_samples(const std::string& path, std::vector<ImuSample>& samples)
+{
+    std::vector<std::string> rows;
+    if (!read_rows(path, rows))
+        return false;
+
+    for (const auto& row : rows)
+    {
+        std::istringstream ss(row);
+        int f[6];
+        for (int& v : f)
+            ss >> v;
+        if (ss.fail())
+        {
+            std::printf("Malformed sample in %s: %s\n", path.c_str(), row.c_str());
+            return false;
+        }
+        samples.push_back({
+            glm::vec3(f[0], f[1], f[2]) / CONVERSION_FACTOR,
+            glm::vec3(f[3], f[4], f[5]) / CONVERSION_FACTOR});
+    }
+    return !samples.empty();
+}
+
+bool load_trace(const std::string& path, std::vector<TraceEntry>& trace)
+{
+    std::vector<std::string> rows;
+    if (!read_rows(path, rows))
+        return false;
+
+    for (const auto& row : rows)
+    {
+        std::istringstream ss(row);
+        TraceEntry e{};
+        ss >> e.sample >> e.orientation.w >> e.orientation.x >>
+            e.orientation.y >> e.orientation.z;
+        if (ss.fail())
+        {
+            std::printf("Malformed trace entry in %s: %s\n", path.c_str(), row.c_str());
+            return false;
+        }
+        trace.push_back(e);
+    }
+    return true;
+}
+
+bool write_trace(const std::string& path, const std::vector<TraceEntry>& trace)
+{
+    std::FILE* f = std::fopen(path.c_str(), "w");
+    if (!f)
+    {
+        std::printf("Cannot open %s\n", path.c_str());
+        return false;
+    }
+
+    std::fprintf(f,
+        "# AttitudeEstimator output for imu_flight.csv with the viewer's\n"
+        "# configuration, every %zu samples: sample, then the body to world\n"
+        "# quaternion w, x, y, z.\n", TRACE_INTERVAL);
+    for (const auto& e : trace)
+        std::fprintf(f, "%zu,%.9f,%.9f,%.9f,%.9f\n", e.sample, e.orientation.w,
+            e.orientation.x, e.orientation.y, e.orientation.z);
+    return std::fclose(f) == 0;
+}
+
+/*
+ * Rotation angle between two orientations, in degrees. Taken from the chord
+ * between the quaternions rather than the acos of their dot product, which
+ * loses all precision for small angles.
+ */
+double angle_deg(glm::quat a, glm::quat b)
+{
+    glm::dvec4 da(a.w, a.x, a.y, a.z);
+    glm::dvec4 db(b.w, b.x, b.y, b.z);
+    double chord = std::fmin(glm::length(da - db), glm::length(da + db));
+    return 4.0 * std::asin(std::fmin(1.0, chord / 2.0)) * 180.0 / 3.14159265358979;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool update = false;
+    int flag;
+    while ((flag = getopt(argc, argv, "uh")) != -1)
+    {
+        switch (flag)
+        {
+        case 'u': update = true; break;
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 2)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const std::string samples_path = argv[optind];
+    const std::string trace_path = argv[optind + 1];
+
+    std::vector<ImuSample> samples;
+    if (!load_samples(samples_path, samples))
+        return 1;
+
+    AttitudeEstimator estimator(ESTIMATOR_CONFIG);
+    std::vector<TraceEntry> actual;
+    for (std::size_t i = 0; i < samples.size(); i++)
+    {
+        estimator.update(samples[i].rot_rate, samples[i].accel);
+        if ((i + 1) % TRACE_INTERVAL == 0)
+            actual.push_back({i + 1, estimator.get_orientation()});
+    }
+
+    if (update)
+    {
+        if (!write_trace(trace_path, actual))
+            return 1;
+        std::printf("Wrote %zu orientations to %s\n", actual.size(), trace_path.c_str());
+        return 0;
+    }
+
+    std::vector<TraceEntry> expected;
+    if (!load_trace(trace_path, expected))
+        return 1;
+    if (expected.size() != actual.size())
+    {
+        std::printf("FAIL: trace has %zu orientations, the estimator produced %zu\n",
+            expected.size(), actual.size());
+        return 1;
+    }
+
+    double worst = 0.0;
+    std::size_t worst_sample = 0;
+    for (std::size_t i = 0; i < actual.size(); i++)
+    {
+        if (expected[i].sample != actual[i].sample)
+        {
+            std::printf("FAIL: trace entry %zu is for sample %zu, expected %zu\n",
+                i, expected[i].sample, actual[i].sample);
+            return 1;
+        }
+        double err = angle_deg(expected[i].orientation, actual[i].orientation);
+        if (!(err <= worst))
+        {
+            worst = err;
+            worst_sample = actual[i].sample;
+        }
+    }
+
+    std::printf("%zu samples, worst deviation from the trace %.6f deg at sample %zu\n",
+        samples.size(), worst, worst_sample);
+    if (!(worst <= TOLERANCE_DEG))
+    {
+        std::printf("FAIL: deviation above %.3f deg\n", TOLERANCE_DEG);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Benchmark for BoundedBuffer's pop interfaces. Streams elements through a
+ * buffer on one thread and times each way of getting them out, for the serial
+ * bytes, the viewer's DroneData and a 64-byte packet:
+ *
+ *     ./build/bounded_buffer_bench
+ *
+ * Fails if popping into the caller's storage is slower than popping into a
+ * shared_ptr, or if the bulk interfaces are slower than the per-element ones.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <getopt.h>
+
+#include "bounded_buffer.hpp"
+#include "shared.hpp"
+
+namespace
+{
+
+// The serial reader's buffer size and read size.
+constexpr std::size_t CAPACITY = 4096;
+constexpr std::size_t BATCH = 64;
+
+// Best of this many short runs, to keep other load on the machine out of the
+// result.
+constexpr int RUNS = 50;
+
+struct Packet
+{
+    char bytes[64];
+};
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -n <count>  Elements streamed per run (default 100000)\n"
+        "  -h          Show this help\n",
+        argv0);
+}
+
+template <typename T>
+T make_element(std::size_t i);
+
+template <>
+char make_element<char>(std::size_t i)
+{
+    return static_cast<char>(i);
+}
+
+template <>
+DroneData make_element<DroneData>(std::size_t i)
+{
+    float f = static_cast<float>(i);
+    return DroneData(glm::vec3(f, 0.3f, 0.0f), glm::vec3(0.0f, f, 0.0f));
+}
+
+template <>
+Packet make_element<Packet>(std::size_t i)
+{
+    Packet p{};
+    p.bytes[0] = static_cast<char>(i);
+    return p;
+}
+
+float checksum(char e) { return e; }
+float checksum(const DroneData& e) { return e.position.x; }
+float checksum(const Packet& e) { return e.bytes[0]; }
+
+/*
+ * The three ways of streaming elements through the buffer: force_push and the
+ * shared_ptr try_pop, force_push and try_pop into a reused element, and
+ * force_push_n and try_pop_n a batch at a time.
+ */
+enum class Method
+{
+    SharedPtr,
+    Value,
+    Bulk,
+};
+
+constexpr Method METHODS[] = {Method::SharedPtr, Method::Value, Method::Bulk};
+const char* const METHOD_NAMES[] = {"shared_ptr pop", "pop into storage", "bulk"};
+
+/*
+ * Streams count elements through b in batches of BATCH and returns the time
+ * per element in nanoseconds.
+ */
+template <typename T>
+double time_stream(BoundedBuffer<T>& b, const std::vector<T>& elements, long count,
+                   Method method, float& sink)
+{
+    using clock = std::chrono::steady_clock;
+    std::vector<T> out(BATCH);
+    T e{};
+
+    auto t0 = clock::now();
+    for (long done = 0; done < count; done += BATCH)
+    {
+        switch (method)
+        {
+        case Method::SharedPtr:
+            for (const auto& x : elements)
+                b.force_push(x);
+            for (std::size_t i = 0; i < BATCH; i++)
+                sink += checksum(*b.try_pop());
+            break;
+        case Method::Value:
+            for (const auto& x : elements)
+                b.force_push(x);
+            for (std::size_t i = 0; i < BATCH; i++)
+            {
+                b.try_pop(e);
+                sink += checksum(e);
+            }
+            break;
+        case Method::Bulk:
+            b.force_push_n(elements);
+            b.try_pop_n(out.begin(), BATCH);
+            for (const auto& x : out)
+                sink += checksum(x);
+            break;
+        }
+    }
+    return std::chrono::duration<double, std::nano>(clock::now() - t0).count() / count;
+}
+
+/*
+ * Best time per element of each method over RUNS runs. The runs alternate
+ * between the methods, so a slow patch on the machine affects all alike.
+ */
+template <typename T>
+bool bench(const char* name, long count)
+{
+    std::vector<T> elements;
+    for (std::size_t i = 0; i < BATCH; i++)
+        elements.push_back(make_element<T>(i));
+
+    // Half full, as a reader a little behind its producer would see it.
+    BoundedBuffer<T> b(CAPACITY);
+    for (std::size_t i = 0; i < CAPACITY / 2; i++)
+        b.force_push(elements[i % BATCH]);
+
+    double best[3] = {};
+    float sink = 0.0f;
+    for (int run = 0; run < RUNS; run++)
+    {
+        for (std::size_t m = 0; m < 3; m++)
+        {
+            double ns = time_stream(b, elements, count, METHODS[m], sink);
+            best[m] = run == 0 ? ns : std::min(best[m], ns);
+        }
+    }
+
+    // Keeps the pops from being optimized away.
+    if (sink == 1.0f)
+        std::printf(" ");
+
+    std::printf("%s (%zu bytes):", name, sizeof(T));
+    for (std::size_t m = 0; m < 3; m++)
+        std::printf(" %s %.1f ns%s", METHOD_NAMES[m], best[m], m < 2 ? "," : "\n");
+
+    bool ok = true;
+    if (!(best[1] < best[0]))
+    {
+        std::printf("FAIL: %s popping into storage is slower than into a shared_ptr\n", name);
+        ok = false;
+    }
+    if (!(best[2] < best[1]))
+    {
+        std::printf("FAIL: %s bulk transfers are slower than single ones\n", name);
+        ok = false;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long count = 100000;
+    int flag;
+    while ((flag = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'n':
+        {
+            char* end = nullptr;
+            count = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || count <= 0)
+            {
+                std::printf("Invalid element count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool ok = bench<char>("char", count);
+    ok &= bench<DroneData>("DroneData", count);
+    ok &= bench<Packet>("packet", count);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+/*
+ * Test for BoundedBuffer's allocation-free and bulk interfaces. Checks their
+ * ordering, drop counting and eviction against the per-element interfaces,
+ * pushes move-only elements through them, and checks that blocked producers
+ * and consumers are woken by the bulk calls:
+ *
+ *     ./build/bounded_buffer_test
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "bounded_buffer.hpp"
+
+namespace
+{
+
+using namespace std::chrono_literals;
+
+// Long enough for a thread to block on the buffer first, on a loaded machine.
+constexpr auto SETTLE = 50ms;
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+    if (!ok)
+    {
+        std::printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+std::vector<int> drain(BoundedBuffer<int>& b)
+{
+    std::vector<int> out;
+    b.try_pop_n(std::back_inserter(out), b.size());
+    return out;
+}
+
+void test_single_pops()
+{
+    BoundedBuffer<int> b(4);
+    int out = -1;
+    check(!b.try_pop(out) && out == -1, "try_pop on an empty buffer changed its argument");
+    check(!b.try_pop_value(), "try_pop_value on an empty buffer returned a value");
+
+    for (int i = 0; i < 3; i++)
+        b.try_push(i);
+    check(b.try_pop(out) && out == 0, "try_pop didn't return the oldest element");
+    auto v = b.try_pop_value();
+    check(v && *v == 1, "try_pop_value didn't return the oldest element");
+    b.pop_wait(out);
+    check(out == 2 && b.empty(), "pop_wait didn't return the oldest element");
+}
+
+void test_bulk()
+{
+    const std::vector<int> six = {1, 2, 3, 4, 5, 6};
+
+    BoundedBuffer<int> b(4);
+    b.try_push(0);
+    check(b.push_n(six) == 3, "push_n didn't fill the free space");
+    check(b.dropped_elements() == 3, "push_n didn't count the rest as dropped");
+    check(drain(b) == std::vector<int>({0, 1, 2, 3}), "push_n changed the order");
+    check(b.push_n(Span<const int>()) == 0 && b.empty(), "push_n of nothing pushed");
+
+    // Eviction must match force_push element by element.
+    BoundedBuffer<int> reference(4);
+    b.try_push(0);
+    reference.try_push(0);
+    check(b.force_push_n(Span<const int>(six).first(2)) == 2, "force_push_n didn't push all");
+    for (int i = 0; i < 2; i++)
+        reference.force_push(six[i]);
+    check(drain(b) == drain(reference), "force_push_n and force_push differ with room left");
+
+    b.try_push(0);
+    reference.try_push(0);
+    check(b.force_push_n(six) == 4, "force_push_n didn't keep the last elements");
+    for (int e : six)
+        reference.force_push(e);
+    check(drain(b) == drain(reference), "force_push_n and force_push differ when overfilled");
+    check(b.dropped_elements() == 3, "force_push_n counted evictions as dropped");
+
+    b.push_n(six);
+    std::vector<int> out;
+    check(b.try_pop_n(std::back_inserter(out), 3) == 3 && out == std::vector<int>({1, 2, 3}),
+        "try_pop_n didn't pop the oldest elements");
+    check(b.try_pop_n(std::back_inserter(out), 10) == 1 && out.back() == 4,
+        "try_pop_n didn't stop at the last element");
+}
+
+void test_move_only()
+{
+    using Ptr = std::unique_ptr<int>;
+    BoundedBuffer<Ptr> b(2);
+    check(b.try_push(std::make_unique<int>(1)), "try_push of a move-only element failed");
+    b.force_push(std::make_unique<int>(2));
+    b.force_push(std::make_unique<int>(3));
+    check(!b.try_push(std::make_unique<int>(4)) && b.dropped_elements() == 1,
+        "try_push into a full buffer wasn't dropped");
+
+    Ptr p;
+    check(b.try_pop(p) && p && *p == 2, "try_pop of a move-only element failed");
+    auto v = b.try_pop_value();
+    check(v && *v && **v == 3, "try_pop_value of a move-only element failed");
+
+    b.push_wait(std::make_unique<int>(5));
+    check(b.push_wait_for(std::make_unique<int>(6)), "push_wait_for with room failed");
+    std::vector<Ptr> out;
+    check(b.try_pop_n(std::back_inserter(out), 2) == 2 && *out[0] == 5 && *out[1] == 6,
+        "try_pop_n of move-only elements failed");
+}
+
+void test_timeouts()
+{
+    BoundedBuffer<int> b(1, 20ms);
+    int out = -1;
+    auto t0 = std::chrono::steady_clock::now();
+    check(!b.pop_wait_for(out) && out == -1, "pop_wait_for on an empty buffer succeeded");
+    check(std::chrono::steady_clock::now() - t0 >= 20ms, "pop_wait_for returned early");
+
+    b.try_push(1);
+    check(!b.push_wait_for(2) && b.dropped_elements() == 1,
+        "push_wait_for into a full buffer wasn't dropped");
+    check(b.pop_wait_for(out) && out == 1, "pop_wait_for with an element failed");
+}
+
+/*
+ * Blocked threads must be woken by every call which makes room for them,
+ * including a bulk call which should wake all of them at once.
+ */
+void test_waiters()
+{
+    BoundedBuffer<int> b(2);
+    const std::vector<int> two = {7, 8};
+
+    std::atomic<int> sum{0};
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < 2; i++)
+        consumers.emplace_back([&]{ int e; b.pop_wait(e); sum += e; });
+    std::this_thread::sleep_for(SETTLE);
+    b.push_n(two);
+    for (auto& t : consumers)
+        t.join();
+    check(sum == 15, "push_n didn't wake every blocked consumer");
+
+    b.push_n(two);
+    std::atomic<int> pushed{0};
+    std::vector<std::thread> producers;
+    for (int i = 0; i < 2; i++)
+        producers.emplace_back([&]{ b.push_wait(9); pushed++; });
+    std::this_thread::sleep_for(SETTLE);
+    check(pushed == 0, "push_wait didn't block on a full buffer");
+    std::vector<int> out;
+    b.try_pop_n(std::back_inserter(out), 2);
+    for (auto& t : producers)
+        t.join();
+    check(pushed == 2 && drain(b) == std::vector<int>({9, 9}),
+        "try_pop_n didn't wake every blocked producer");
+
+    b.push_n(two);
+    std::thread producer([&]{ b.push_wait(10); });
+    std::this_thread::sleep_for(SETTLE);
+    b.clear();
+    producer.join();
+    check(drain(b) == std::vector<int>({10}), "clear didn't wake a blocked producer");
+
+    std::thread consumer([&]{ int e; b.pop_wait(e); sum += e; });
+    std::this_thread::sleep_for(SETTLE);
+    b.force_push_n(Span<const int>(two).first(1));
+    consumer.join();
+    check(sum == 22, "force_push_n didn't wake a blocked consumer");
+}
+
+} // namespace
+
+int main()
+{
+    test_single_pops();
+    test_bulk();
+    test_move_only();
+    test_timeouts();
+    test_waiters();
+
+    if (failures)
+    {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}
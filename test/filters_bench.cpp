@@ -0,0 +1,206 @@
+/*
+ * Benchmark for the telemetry filter stages. Times the per-sample cost of the
+ * windowed stages at 32, 256 and 4096 sample windows against the re-summed
+ * window filter_data used before, then of the window-free stages:
+ *
+ *     ./build/filters_bench
+ *
+ * The windowed stages are first checked against a brute force mean and
+ * median. Fails if they disagree, or if the moving average costs more than
+ * re-summing at any window.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include <getopt.h>
+
+#include "filters.hpp"
+#include "logger.hpp"
+
+Logger logger = Logger(LogLevel::error);
+
+namespace
+{
+
+constexpr std::size_t WINDOWS[] = {32, 256, 4096};
+
+// Samples checked against the brute force filters per window.
+constexpr std::size_t CHECK_SAMPLES = 20000;
+
+// The re-sum is timed on a fraction of the samples, since it's so slow at the
+// larger windows.
+constexpr std::size_t RESUM_FRACTION = 16;
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -n <count>  Samples per timing (default 4000000)\n"
+        "  -h          Show this help\n",
+        argv0);
+}
+
+/*
+ * filter_data's old approach: a vector of the window which shifts on every
+ * insert, passed by value and summed for every output.
+ */
+float resum(std::vector<float> window)
+{
+    float sum = 0.0f;
+    for (float v : window)
+        sum += v;
+    return sum / window.size();
+}
+
+double time_resum(const std::vector<float>& in, std::size_t window_len, float& sink)
+{
+    const std::size_t n = std::max<std::size_t>(in.size() / RESUM_FRACTION, 1);
+    std::vector<float> window;
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < n; i++)
+    {
+        window.push_back(in[i]);
+        if (window.size() > window_len)
+            window.erase(window.begin());
+        sink += resum(window);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / n;
+}
+
+double time_stage(const std::vector<float>& in, FilterStage& stage, float& sink)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (float x : in)
+        sink += stage.process(x);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / in.size();
+}
+
+/*
+ * Compares the windowed stages against a brute force window, on samples with
+ * many duplicates, where a median is easiest to get wrong.
+ */
+std::size_t count_mismatches(std::size_t window_len)
+{
+    std::mt19937 rng(static_cast<unsigned>(window_len));
+    std::uniform_int_distribution<int> value(-50, 50);
+    MovingAverage average(window_len);
+    SlidingMedian median(window_len);
+    std::deque<float> window;
+    std::vector<float> sorted;
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < CHECK_SAMPLES; i++)
+    {
+        const float x = value(rng) * 0.25f;
+        window.push_back(x);
+        if (window.size() > window_len)
+            window.pop_front();
+
+        double sum = 0.0;
+        for (float v : window)
+            sum += v;
+        sorted.assign(window.begin(), window.end());
+        std::sort(sorted.begin(), sorted.end());
+        const std::size_t mid = sorted.size() / 2;
+        const float expected_median = sorted.size() % 2 ?
+            sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+
+        const float a = average.process(x);
+        const float m = median.process(x);
+        mismatches += std::fabs(a - sum / window.size()) > 1e-4 || m != expected_median;
+    }
+    return mismatches;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long count = 4000000;
+    int flag;
+    while ((flag = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'n':
+        {
+            char* end = nullptr;
+            count = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || count <= 0)
+            {
+                std::printf("Invalid sample count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937 rng(15);
+    std::uniform_real_distribution<float> value(-5.0f, 5.0f);
+    std::vector<float> in(static_cast<std::size_t>(count));
+    for (float& x : in)
+        x = value(rng);
+
+    bool ok = true;
+    float sink = 0.0f;
+    for (std::size_t w : WINDOWS)
+    {
+        if (std::size_t mismatches = count_mismatches(w))
+        {
+            std::printf("FAIL: window %zu: %zu outputs differ from brute force\n", w, mismatches);
+            ok = false;
+        }
+
+        MovingAverage average(w);
+        SlidingMedian median(w);
+        const double average_ns = time_stage(in, average, sink);
+        const double median_ns = time_stage(in, median, sink);
+        const double resum_ns = time_resum(in, w, sink);
+        std::printf("window %4zu: moving average %6.2f ns/sample, sliding median %6.2f "
+            "ns/sample, re-sum %8.2f ns/sample\n", w, average_ns, median_ns, resum_ns);
+
+        if (!(average_ns < resum_ns))
+        {
+            std::printf("FAIL: window %zu: the moving average costs more than re-summing\n", w);
+            ok = false;
+        }
+    }
+
+    ExponentialMovingAverage ema(0.1f);
+    Biquad butterworth = Biquad::butterworth_lowpass(40.0f, 1000.0f);
+    FilterChain chain;
+    chain.add(make_filter({FilterType::SlidingMedian, 5}));
+    chain.add(make_filter({FilterType::ButterworthLowpass, 1, 1.0f, 40.0f, 1000.0f}));
+    const double ema_ns = time_stage(in, ema, sink);
+    const double butterworth_ns = time_stage(in, butterworth, sink);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (float x : in)
+        sink += chain.process(x);
+    const double chain_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - t0).count() / in.size();
+
+    std::printf("EMA %.2f ns/sample, Butterworth biquad %.2f ns/sample, "
+        "median 5 + biquad chain %.2f ns/sample\n", ema_ns, butterworth_ns, chain_ns);
+
+    // Keeps the filtering from being optimized away.
+    if (sink == 1.0f)
+        std::printf(" ");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+/*
+ * Benchmark for FrameScanner. Frames 64 MB of synthetic ground station stream
+ * in serial-read-sized chunks, once clean and once with bursts of random
+ * garbage between packets, and reports GB/s against the per-byte framer the
+ * viewer used before:
+ *
+ *     ./build/frame_scanner_bench
+ *
+ * Fails if the scanner is the slower of the two, or finds fewer packets.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include "frame_scanner.hpp"
+
+namespace
+{
+
+constexpr char START_SYMBOL = '|';
+constexpr char STOP_SYMBOL = '\n';
+constexpr std::size_t PACKET_LEN = 37;
+
+// What one read of the serial port returns at most.
+constexpr std::size_t CHUNK_LEN = 4096;
+
+// Fraction of packets followed by a burst of up to 63 random bytes.
+constexpr double GARBAGE_RATE = 0.2;
+
+// Best of this many runs, to keep other load on the machine out of the result.
+constexpr int RUNS = 3;
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -m <MB>  Megabytes of stream framed per run (default 64)\n"
+        "  -h       Show this help\n",
+        argv0);
+}
+
+std::string make_stream(std::size_t len, double garbage_rate)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::string s;
+    s.reserve(len + 128);
+    while (s.size() < len)
+    {
+        char b[64];
+        int n = std::snprintf(b, sizeof(b), "|%05d,%05d,%05d,%05d,%05d,%05d\r\n",
+            static_cast<int>(rng() % 100000), static_cast<int>(rng() % 100000),
+            static_cast<int>(rng() % 100000), static_cast<int>(rng() % 100000),
+            static_cast<int>(rng() % 100000), static_cast<int>(rng() % 100000));
+        s.append(b, static_cast<std::size_t>(n));
+        if (uniform(rng) < garbage_rate)
+        {
+            std::size_t burst = rng() % 64;
+            for (std::size_t i = 0; i < burst; i++)
+                s += static_cast<char>(rng());
+        }
+    }
+    return s;
+}
+
+/*
+ * The framer build_latest_packet used before FrameScanner: one byte at a time,
+ * appended to the packet being built, which is copied out when complete.
+ */
+class ByteFramer
+{
+public:
+    void feed(char c)
+    {
+        if (between_packets)
+        {
+            if (c == START_SYMBOL)
+            {
+                packet.clear();
+                packet += c;
+                between_packets = false;
+            }
+            return;
+        }
+        if (c != STOP_SYMBOL)
+        {
+            packet += c;
+            between_packets = packet.size() > PACKET_LEN;
+            return;
+        }
+        if (packet.size() == PACKET_LEN)
+        {
+            latest = packet;
+            packets++;
+        }
+        between_packets = true;
+    }
+
+    std::size_t packets = 0;
+    std::string latest;
+private:
+    bool between_packets = true;
+    std::string packet;
+};
+
+struct Result
+{
+    double seconds;
+    std::size_t packets;
+};
+
+Result time_byte_framer(const std::string& stream)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    ByteFramer framer;
+    for (char c : stream)
+        framer.feed(c);
+    return {std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(),
+        framer.packets};
+}
+
+Result time_scanner(const std::string& stream, unsigned& sink)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    FrameScanner scanner(START_SYMBOL, STOP_SYMBOL, PACKET_LEN);
+    std::vector<FrameCandidate> candidates;
+    for (std::size_t pos = 0; pos < stream.size(); pos += CHUNK_LEN)
+    {
+        std::size_t n = std::min(CHUNK_LEN, stream.size() - pos);
+        scanner.scan(Span<const char>(stream.data() + pos, n), candidates);
+
+        // Touch each packet, as the decoder would.
+        for (const auto& c : candidates)
+            sink += static_cast<unsigned char>(stream[pos + c.offset + 1]);
+    }
+    return {std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(),
+        scanner.get_packets_accepted()};
+}
+
+bool bench(const char* name, const std::string& stream)
+{
+    Result bytes{};
+    Result scan{};
+    unsigned sink = 0;
+    for (int run = 0; run < RUNS; run++)
+    {
+        Result r = time_byte_framer(stream);
+        if (run == 0 || r.seconds < bytes.seconds)
+            bytes = r;
+        r = time_scanner(stream, sink);
+        if (run == 0 || r.seconds < scan.seconds)
+            scan = r;
+    }
+
+    // Keeps the scanning from being optimized away.
+    if (sink == 1)
+        std::printf(" ");
+
+    const double gb = stream.size() / 1e9;
+    std::printf("%s: per-byte framer %.3f GB/s (%zu packets), FrameScanner %.3f GB/s "
+        "(%zu packets), %.1fx\n", name, gb / bytes.seconds, bytes.packets,
+        gb / scan.seconds, scan.packets, bytes.seconds / scan.seconds);
+
+    bool ok = true;
+    if (scan.packets < bytes.packets)
+    {
+        std::printf("FAIL: %s: FrameScanner found fewer packets\n", name);
+        ok = false;
+    }
+    if (!(scan.seconds < bytes.seconds))
+    {
+        std::printf("FAIL: %s: FrameScanner is slower than the per-byte framer\n", name);
+        ok = false;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long megabytes = 64;
+    int flag;
+    while ((flag = getopt(argc, argv, "m:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'm':
+        {
+            char* end = nullptr;
+            megabytes = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || megabytes <= 0)
+            {
+                std::printf("Invalid stream size: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const std::size_t len = static_cast<std::size_t>(megabytes) << 20;
+#if defined(__AVX2__)
+    std::printf("AVX2 masks, %ld MB per run\n", megabytes);
+#elif defined(__SSE2__)
+    std::printf("SSE2 masks, %ld MB per run\n", megabytes);
+#else
+    std::printf("Scalar masks, %ld MB per run\n", megabytes);
+#endif
+
+    bool ok = bench("clean", make_stream(len, 0.0));
+    ok &= bench("garbage", make_stream(len, GARBAGE_RATE));
+    return ok ? 0 : 1;
+}
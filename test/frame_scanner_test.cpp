@@ -0,0 +1,389 @@
+/*
+ * Deterministic fuzz test for the telemetry framers. Streams of packets in
+ * the ASCII and COBS formats are generated from a fixed seed, corrupted at
+ * controlled bit error rates, and framed. Every packet whose bytes survived
+ * must be recovered, and the yield must stay above a floor for each rate:
+ *
+ *     ./build/frame_scanner_test
+ *
+ * The ASCII scanner is also checked against a simple byte-at-a-time reference
+ * framer, fed in chunks of random size so packets straddle chunk boundaries.
+ *
+ * Randomness comes from std::mt19937, whose output is fixed by the standard,
+ * and is turned into probabilities here rather than with the standard
+ * distributions, which differ between library implementations. The results
+ * are therefore the same on every platform.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cobs.hpp"
+#include "cobs_framer.hpp"
+#include "crc16.hpp"
+#include "frame_scanner.hpp"
+#include "span.hpp"
+#include "telemetry_framing.hpp"
+
+namespace
+{
+
+constexpr char START_SYMBOL = '|';
+constexpr char STOP_SYMBOL = '\n';
+constexpr std::size_t NUM_FIELDS = 6;
+// "|00100,02000,-0150,01200,-0300,00000\r", the stop symbol follows.
+constexpr std::size_t ASCII_PACKET_LEN = 37;
+// Fewer than the 65536 sequence numbers, so gaps can be checked directly.
+constexpr std::size_t NUM_PACKETS = 50000;
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+    if (!ok)
+    {
+        std::printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+/*
+ * True with probability p.
+ */
+bool chance(std::mt19937& rng, double p)
+{
+    return rng() < p * 4294967296.0;
+}
+
+/*
+ * Byte-at-a-time reference for FrameScanner: finds every start symbol
+ * followed by a stop symbol exactly packet_len bytes later, resuming after the
+ * start symbol of a rejected packet.
+ */
+std::vector<std::string> reference_frame(const std::string& s, std::size_t packet_len)
+{
+    std::vector<std::string> out;
+    std::size_t i = 0;
+    while ((i = s.find(START_SYMBOL, i)) != std::string::npos)
+    {
+        std::size_t stop = s.find(STOP_SYMBOL, i + 1);
+        if (stop == std::string::npos)
+            break;
+        if (stop == i + packet_len)
+        {
+            out.push_back(s.substr(i, packet_len));
+            i = stop + 1;
+        }
+        else
+        {
+            i++;
+        }
+    }
+    return out;
+}
+
+/*
+ * Random streams of whole packets, truncated and overlong packets, stray
+ * delimiters and noise, fed to the scanner in random chunks.
+ */
+void test_against_reference()
+{
+    std::mt19937 rng(11);
+    const char alphabet[] = "0123456789,-|\n";
+    int mismatches = 0;
+
+    for (int iter = 0; iter < 2000; iter++)
+    {
+        const std::size_t len = 2 + rng() % 40;
+        // Every third stream also has delimiters inside packets.
+        const std::size_t symbols = iter % 3 == 0 ? 14 : 12;
+        std::string s;
+        for (int i = 0, n = rng() % 200; i < n; i++)
+        {
+            unsigned kind = rng() % 6;
+            if (kind < 3)
+            {
+                s += START_SYMBOL;
+                for (std::size_t k = 1; k < len; k++)
+                    s += alphabet[rng() % symbols];
+                s += STOP_SYMBOL;
+            }
+            else if (kind == 3)
+            {
+                for (int k = 0, m = rng() % 80; k < m; k++)
+                    s += "ab|\n0"[rng() % 5];
+            }
+            else
+            {
+                s += START_SYMBOL;
+                s.append(rng() % (2 * len), 'x');
+                if (rng() % 2)
+                    s += STOP_SYMBOL;
+            }
+        }
+
+        FrameScanner scanner(START_SYMBOL, STOP_SYMBOL, len);
+        std::vector<FrameCandidate> candidates;
+        std::vector<std::string> got;
+        // Alternate between small chunks and chunks larger than most packets.
+        const std::size_t max_chunk = iter % 2 ? 7 : 300;
+        for (std::size_t pos = 0; pos < s.size();)
+        {
+            std::size_t n = std::min<std::size_t>(s.size() - pos, rng() % max_chunk + 1);
+            scanner.scan(Span<const char>(s.data() + pos, n), candidates);
+            if (scanner.has_carried())
+                got.emplace_back(scanner.carried());
+            for (const auto& c : candidates)
+                got.push_back(s.substr(pos + c.offset, c.length));
+            pos += n;
+        }
+
+        if (got != reference_frame(s, len))
+            mismatches++;
+    }
+
+    std::printf("reference: %d mismatches in 2000 streams\n", mismatches);
+    check(mismatches == 0, "FrameScanner differs from the reference framer");
+}
+
+/*
+ * Range of where each packet lies in a stream, so the corruption can be
+ * traced back to the packets it hit.
+ */
+struct PacketExtent
+{
+    std::size_t begin;
+    std::size_t end;
+};
+
+std::string make_ascii_stream(std::mt19937& rng, std::vector<PacketExtent>& extents)
+{
+    std::string s;
+    for (std::size_t i = 0; i < NUM_PACKETS; i++)
+    {
+        char buf[64];
+        int n = std::snprintf(buf, sizeof(buf), "%c%05i,%05i,%05i,%05i,%05i,%05i\r\n",
+            START_SYMBOL,
+            static_cast<int>(rng() % 99999), static_cast<int>(rng() % 99999),
+            static_cast<int>(rng() % 99999), static_cast<int>(rng() % 99999),
+            static_cast<int>(rng() % 99999), static_cast<int>(rng() % 99999));
+        extents.push_back({s.size(), s.size() + n});
+        s.append(buf, n);
+    }
+    return s;
+}
+
+/*
+ * Flips one random bit in each byte hit, at the given bit error rate (8 bits
+ * per byte). Returns which bytes were hit.
+ */
+std::vector<bool> flip_bits(std::mt19937& rng, std::string& s, double ber)
+{
+    std::vector<bool> hit(s.size());
+    const double byte_rate = 1.0 - std::pow(1.0 - ber, 8);
+    for (std::size_t i = 0; i < s.size(); i++)
+    {
+        if (chance(rng, byte_rate))
+        {
+            s[i] = static_cast<char>(s[i] ^ (1 << (rng() % 8)));
+            hit[i] = true;
+        }
+    }
+    return hit;
+}
+
+/*
+ * Drops bytes at the given rate, as a UART overrun would. Returns which bytes
+ * of the original stream were dropped.
+ */
+std::vector<bool> drop_bytes(std::mt19937& rng, std::string& s, double rate)
+{
+    std::vector<bool> hit(s.size());
+    std::string kept;
+    kept.reserve(s.size());
+    for (std::size_t i = 0; i < s.size(); i++)
+    {
+        if (chance(rng, rate))
+            hit[i] = true;
+        else
+            kept += s[i];
+    }
+    s = std::move(kept);
+    return hit;
+}
+
+bool any_hit(const std::vector<bool>& hit, std::size_t begin, std::size_t end)
+{
+    return std::find(hit.begin() + begin, hit.begin() + end, true) != hit.begin() + end;
+}
+
+// Bit error rates for flipped bits, byte rates for dropped bytes.
+constexpr double ERROR_RATES[] = {0.0, 1e-5, 1e-4, 1e-3, 5e-3};
+
+/*
+ * Lowest acceptable fraction of packets delivered: nearly every packet whose
+ * bytes all survived the corruption. A packet spans n bytes on the wire.
+ */
+double min_yield(double rate, bool drop, std::size_t n)
+{
+    double byte_rate = drop ? rate : 1.0 - std::pow(1.0 - rate, 8);
+    return 0.98 * std::pow(1.0 - byte_rate, static_cast<double>(n));
+}
+
+/*
+ * Corrupts the ASCII stream at each rate. A packet whose own bytes weren't
+ * hit must always be framed, even when it starts inside the region claimed
+ * by a corrupted packet before it. The scanner may frame slightly more than
+ * that: a flipped digit doesn't break the framing, the decoder catches it.
+ */
+void test_ascii_yield(bool drop)
+{
+    for (double rate : ERROR_RATES)
+    {
+        std::mt19937 rng(5);
+        std::vector<PacketExtent> extents;
+        std::string s = make_ascii_stream(rng, extents);
+        auto hit = drop ? drop_bytes(rng, s, rate) : flip_bits(rng, s, rate);
+
+        std::size_t intact = 0;
+        for (const auto& e : extents)
+            intact += !any_hit(hit, e.begin, e.end);
+
+        FrameScanner scanner(START_SYMBOL, STOP_SYMBOL, ASCII_PACKET_LEN);
+        std::vector<FrameCandidate> candidates;
+        for (std::size_t pos = 0; pos < s.size(); pos += 4096)
+        {
+            std::size_t n = std::min<std::size_t>(4096, s.size() - pos);
+            scanner.scan(Span<const char>(s.data() + pos, n), candidates);
+        }
+
+        const std::size_t accepted = scanner.get_packets_accepted();
+        const double yield = static_cast<double>(accepted) / NUM_PACKETS;
+        std::printf("ascii %s %.0e: %zu intact, %zu framed (%.3f%%), %zu recovered, %zu rejected\n",
+            drop ? "drop" : "flip", rate, intact, accepted, 100.0 * yield,
+            scanner.get_packets_recovered(), scanner.get_packets_rejected());
+
+        check(accepted >= intact, "ASCII scanner lost an intact packet");
+        check(accepted <= NUM_PACKETS, "ASCII scanner framed more packets than were sent");
+        check(yield >= min_yield(rate, drop, ASCII_PACKET_LEN + 1), "ASCII yield below floor");
+        if (rate == 0.0)
+            check(scanner.get_bytes_skipped() == 0, "ASCII scanner skipped bytes of a clean stream");
+        // Dropped bytes shorten packets, and the packet after a shortened one
+        // starts inside the region it claimed.
+        if (drop && rate >= 1e-4)
+            check(scanner.get_packets_recovered() > 0, "ASCII scanner recovered no packets by rescanning");
+    }
+}
+
+/*
+ * Encodes a COBS-framed int16 packet, including the trailing delimiter.
+ */
+void encode_cobs(std::uint16_t seq, const std::array<std::int16_t, NUM_FIELDS>& fields,
+                 std::string& out)
+{
+    constexpr std::size_t len = binary_packet_len(TelemetryFraming::CobsInt16, NUM_FIELDS);
+    std::uint8_t packet[len];
+
+    put_le16(packet, seq);
+    for (std::size_t i = 0; i < NUM_FIELDS; i++)
+        put_le16(packet + BINARY_SEQ_LEN + 2 * i, static_cast<std::uint16_t>(fields[i]));
+    put_le16(packet + len - BINARY_CRC_LEN,
+        crc16_ccitt(Span<const std::uint8_t>(packet, len - BINARY_CRC_LEN)));
+
+    std::uint8_t encoded[cobs_max_encoded_len(len)];
+    std::size_t n = cobs_encode(Span<const std::uint8_t>(packet, len), encoded);
+    out.append(reinterpret_cast<const char*>(encoded), n);
+    out += COBS_DELIMITER;
+}
+
+/*
+ * Corrupts the COBS stream at each rate. A packet can only be delivered if
+ * its frame and both delimiters around it survived, and every such packet
+ * must be. Corrupted frames must be caught by the CRC, and the sequence
+ * numbers must account for every packet not delivered.
+ */
+void test_cobs_yield(bool drop)
+{
+    constexpr std::size_t packet_len = binary_packet_len(TelemetryFraming::CobsInt16, NUM_FIELDS);
+
+    for (double rate : ERROR_RATES)
+    {
+        std::mt19937 rng(7);
+        std::vector<PacketExtent> extents;
+        // The framer only syncs on a delimiter, so lead with one.
+        std::string s(1, COBS_DELIMITER);
+        for (std::size_t i = 0; i < NUM_PACKETS; i++)
+        {
+            std::array<std::int16_t, NUM_FIELDS> fields;
+            for (auto& f : fields)
+                f = static_cast<std::int16_t>(rng());
+            // Every frame shares its leading delimiter with the previous one.
+            std::size_t begin = s.size() - 1;
+            encode_cobs(static_cast<std::uint16_t>(i), fields, s);
+            extents.push_back({begin, s.size()});
+        }
+        auto hit = drop ? drop_bytes(rng, s, rate) : flip_bits(rng, s, rate);
+
+        std::size_t intact = 0;
+        for (const auto& e : extents)
+            intact += !any_hit(hit, e.begin, e.end);
+
+        CobsFramer framer(packet_len, cobs_max_encoded_len(packet_len));
+        std::size_t delivered = 0;
+        std::uint16_t first_seq = 0;
+        std::uint16_t last_seq = 0;
+        auto on_packet = [&](std::string_view p)
+        {
+            std::uint16_t seq = get_le16(reinterpret_cast<const std::uint8_t*>(p.data()));
+            if (delivered == 0)
+                first_seq = seq;
+            last_seq = seq;
+            delivered++;
+        };
+        for (std::size_t pos = 0; pos < s.size(); pos += 4096)
+        {
+            std::size_t n = std::min<std::size_t>(4096, s.size() - pos);
+            framer.frame(Span<const char>(s.data() + pos, n), on_packet);
+        }
+
+        const double yield = static_cast<double>(delivered) / NUM_PACKETS;
+        std::printf("cobs %s %.0e: %zu intact, %zu delivered (%.3f%%), %zu crc errors, %zu lost\n",
+            drop ? "drop" : "flip", rate, intact, delivered, 100.0 * yield,
+            framer.get_crc_errors(), framer.get_packets_lost());
+
+        check(delivered == intact, "COBS framer delivered a corrupted packet or lost an intact one");
+        check(delivered == 0 || framer.get_packets_lost() ==
+            static_cast<std::uint16_t>(last_seq - first_seq + 1) - delivered,
+            "COBS sequence gaps don't match the packets not delivered");
+        // The frame, its delimiter and the one before it.
+        check(yield >= min_yield(rate, drop, cobs_max_encoded_len(packet_len) + 2),
+            "COBS yield below floor");
+    }
+}
+
+} // namespace
+
+int main()
+{
+    test_against_reference();
+    for (bool drop : {false, true})
+    {
+        test_ascii_yield(drop);
+        test_cobs_yield(drop);
+    }
+
+    if (failures)
+    {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}
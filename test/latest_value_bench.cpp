@@ -0,0 +1,181 @@
+/*
+ * Contention benchmark for LatestValue. A writer thread publishes DroneData at
+ * 10 kHz while a reader picks it up, and each read's latency is recorded, for
+ * LatestValue and for the mutex-guarded copy ResourceManager used before:
+ *
+ *     ./build/latest_value_bench
+ *
+ * The reader runs once flat out, to maximize contention, and once at a 240 Hz
+ * frame rate. Every value the writer publishes is self-consistent, so a torn
+ * read or a value older than one already seen fails the run.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+
+#include "latest_value.hpp"
+#include "shared.hpp"
+
+namespace
+{
+
+using clock = std::chrono::steady_clock;
+
+constexpr auto WRITER_PERIOD = std::chrono::microseconds(100);
+constexpr auto FRAME_PERIOD = std::chrono::microseconds(4167);
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -s <sec>  Seconds per run (default 2)\n"
+        "  -h        Show this help\n",
+        argv0);
+}
+
+DroneData make_state(long i)
+{
+    float f = static_cast<float>(i);
+    return DroneData(glm::vec3(f, f, f), glm::vec3(f, f, f));
+}
+
+struct TripleBuffer
+{
+    LatestValue<DroneData> value;
+
+    void store(const DroneData& d) { value.store(d); }
+    DroneData load()
+    {
+        value.update();
+        return value.read();
+    }
+};
+
+struct Locked
+{
+    std::mutex m;
+    DroneData value;
+
+    void store(const DroneData& d)
+    {
+        std::lock_guard<std::mutex> g(m);
+        value = d;
+    }
+    DroneData load()
+    {
+        std::lock_guard<std::mutex> g(m);
+        return value;
+    }
+};
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    return sorted[static_cast<std::size_t>(p * (sorted.size() - 1))];
+}
+
+template <typename Shared>
+bool run(const char* name, bool frame_paced, long seconds)
+{
+    Shared shared;
+    std::atomic<bool> done{false};
+    std::atomic<long> writes{0};
+
+    std::thread writer([&]{
+        auto next = clock::now();
+        for (long i = 1; !done.load(); i++)
+        {
+            shared.store(make_state(i));
+            writes++;
+            next += WRITER_PERIOD;
+            std::this_thread::sleep_until(next);
+        }
+    });
+
+    std::vector<double> latencies;
+    long inconsistent = 0;
+    float last = 0.0f;
+    const auto end = clock::now() + std::chrono::seconds(seconds);
+    for (auto next = clock::now(); clock::now() < end; )
+    {
+        auto t0 = clock::now();
+        DroneData d = shared.load();
+        auto t1 = clock::now();
+        latencies.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+
+        const float v = d.position.x;
+        inconsistent += d.position != glm::vec3(v) || d.orientation != glm::vec3(v) || v < last;
+        last = v;
+
+        if (frame_paced)
+        {
+            next += FRAME_PERIOD;
+            std::this_thread::sleep_until(next);
+        }
+    }
+    done = true;
+    writer.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("%-11s reader %s: %8zu reads, p50 %5.0f ns, p99 %6.0f ns, max %8.0f ns, "
+        "writer %.1f kHz\n", name, frame_paced ? "240 Hz  " : "flat out", latencies.size(),
+        percentile(latencies, 0.5), percentile(latencies, 0.99), latencies.back(),
+        writes.load() / 1e3 / seconds);
+
+    if (inconsistent)
+    {
+        std::printf("FAIL: %s: %ld torn or out of order reads\n", name, inconsistent);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long seconds = 2;
+    int flag;
+    while ((flag = getopt(argc, argv, "s:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 's':
+        {
+            char* end = nullptr;
+            seconds = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || seconds <= 0)
+            {
+                std::printf("Invalid duration: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool ok = true;
+    for (bool frame_paced : {false, true})
+    {
+        ok &= run<TripleBuffer>("LatestValue", frame_paced, seconds);
+        ok &= run<Locked>("mutex", frame_paced, seconds);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/*
+ * Benchmark for the position EKF at an 8 kHz IMU rate. Loops a synthetic
+ * flight through the 9- and 15-state filters, fusing a position fix every 80
+ * samples (100 Hz), and times each second's worth of updates:
+ *
+ *     ./build/position_estimator_bench
+ *
+ * Fails if any second's worth of updates took longer than a second, i.e. the
+ * filter couldn't keep up with the IMU on one core, or if the estimate
+ * diverged.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <getopt.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "logger.hpp"
+#include "position_estimator.hpp"
+
+Logger logger = Logger(LogLevel::error);
+
+namespace
+{
+
+constexpr float SAMPLE_HZ = 8000.0f;
+constexpr std::size_t UPDATES_PER_SECOND = 8000;
+constexpr std::size_t SAMPLES_PER_FIX = 80;
+
+constexpr float GRAVITY = 9.81f;
+constexpr float DEG = 3.14159265f / 180.0f;
+
+// Further from the flight path than this and the estimate has diverged.
+constexpr float MAX_POSITION_ERROR = 1.0f;
+
+struct ImuSample
+{
+    glm::vec3 accel;
+    glm::vec3 rot_rate;
+    glm::quat attitude;
+    glm::vec3 position;
+    glm::vec3 fix;
+};
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -s <sec>  Seconds of IMU data to process per filter (default 60)\n"
+        "  -h        Show this help\n",
+        argv0);
+}
+
+PositionEstimatorConfig make_config(std::size_t states)
+{
+    return {
+        states, SAMPLE_HZ, 1.0f, DEG, GRAVITY,
+        0.05f, 0.001f, 0.2f * DEG, 0.01f * DEG,
+        0.05f, glm::vec3(0.0f, 1.0f, 0.0f), {}};
+}
+
+/*
+ * One lap of a 1.5 m circle in the horizontal plane, bobbing up and down and
+ * yawing as it goes, as a biased, noisy IMU would measure it, with equally
+ * noisy fixes. Ends where it starts, so it can be looped.
+ */
+std::vector<ImuSample> make_flight()
+{
+    const double lap_s = 4.0 * 3.14159265358979;
+    const double w = 2.0 * 3.14159265358979 / lap_s;
+    const std::size_t n = static_cast<std::size_t>(lap_s * SAMPLE_HZ);
+    std::vector<ImuSample> samples(n);
+    std::mt19937 rng(17);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    auto noise3 = [&](float sd) { return sd * glm::vec3(noise(rng), noise(rng), noise(rng)); };
+    const glm::vec3 accel_bias(0.08f, -0.05f, 0.06f);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const double t = i / static_cast<double>(SAMPLE_HZ);
+        glm::dvec3 p(1.5 * std::cos(w * t) - 1.5, 1.0 + 0.3 * std::sin(2.0 * w * t),
+            1.5 * std::sin(w * t));
+        glm::dvec3 a(-1.5 * w * w * std::cos(w * t), -1.2 * w * w * std::sin(2.0 * w * t),
+            -1.5 * w * w * std::sin(w * t));
+        glm::dquat q = glm::angleAxis(-w * t, glm::dvec3(0.0, 1.0, 0.0));
+        glm::dvec3 specific_force = glm::conjugate(q) * (a + glm::dvec3(0.0, GRAVITY, 0.0));
+        samples[i] = {glm::vec3(specific_force) + accel_bias + noise3(0.05f),
+            glm::vec3(0.0f, -w / DEG, 0.0f) + noise3(0.2f), glm::quat(q),
+            glm::vec3(p), glm::vec3(p) + noise3(0.05f)};
+    }
+    return samples;
+}
+
+bool bench(std::size_t states, const std::vector<ImuSample>& samples, long seconds)
+{
+    auto estimator = make_position_estimator(make_config(states));
+    if (!estimator)
+        return false;
+
+    using clock = std::chrono::steady_clock;
+    std::size_t next = 0;
+    std::size_t fixes = 0;
+    clock::duration total{};
+    clock::duration slowest{};
+    float worst_error = 0.0f;
+
+    for (long s = 0; s < seconds; s++)
+    {
+        auto t0 = clock::now();
+        for (std::size_t i = 0; i < UPDATES_PER_SECOND; i++)
+        {
+            const ImuSample& x = samples[next];
+            estimator->predict(x.accel, x.rot_rate, x.attitude);
+            if (++next % SAMPLES_PER_FIX == 0)
+            {
+                estimator->correct(x.fix);
+                fixes++;
+            }
+            if (next == samples.size())
+                next = 0;
+        }
+        auto elapsed = clock::now() - t0;
+        total += elapsed;
+        slowest = std::max(slowest, elapsed);
+
+        const ImuSample& last = samples[next == 0 ? samples.size() - 1 : next - 1];
+        float error = glm::length(estimator->get_position() - last.position);
+        worst_error = std::isfinite(error) ? std::max(worst_error, error) : INFINITY;
+    }
+
+    using ms = std::chrono::duration<double, std::milli>;
+    using ns = std::chrono::duration<double, std::nano>;
+    const double updates = static_cast<double>(seconds) * UPDATES_PER_SECOND;
+    const double mean_ns = ns(total).count() / updates;
+    const double slowest_ms = ms(slowest).count();
+
+    std::printf("%zu states: %.1f ns per update with %zu fixes, %.2f M updates/s on one "
+        "core, slowest second %.3f ms (%.3f%% of the budget), worst error %.3f\n", states,
+        mean_ns, fixes, 1e3 / mean_ns, slowest_ms, slowest_ms / 10.0, worst_error);
+
+    bool ok = true;
+    if (!(slowest < std::chrono::seconds(1)))
+    {
+        std::printf("FAIL: %zu states can't keep up with %.0f Hz\n", states, SAMPLE_HZ);
+        ok = false;
+    }
+    if (!(worst_error <= MAX_POSITION_ERROR))
+    {
+        std::printf("FAIL: %zu states diverged from the flight path\n", states);
+        ok = false;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long seconds = 60;
+    int flag;
+    while ((flag = getopt(argc, argv, "s:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 's':
+        {
+            char* end = nullptr;
+            seconds = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || seconds <= 0)
+            {
+                std::printf("Invalid duration: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const auto samples = make_flight();
+    bool ok = bench(9, samples, seconds);
+    ok &= bench(15, samples, seconds);
+    return ok ? 0 : 1;
+}
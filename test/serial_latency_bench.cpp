@@ -0,0 +1,187 @@
+/*
+ * Benchmark for the per-byte latency of LinuxSerialPort's backends. Opens a
+ * pseudo-terminal as the serial port and writes single bytes into it, timing
+ * each from the write until the telemetry worker's wait on the ring returns
+ * with it:
+ *
+ *     ./build/serial_latency_bench
+ *
+ * The termios backend is also run at a custom baud rate, which it sets through
+ * termios2, and with VTIME set. Every byte is checked on the way through, so
+ * the run doubles as an end to end test of both backends; it fails if a byte
+ * is lost, corrupted or takes longer than the worker's wait timeout.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
+
+#include "linux_serial_port.hpp"
+#include "logger.hpp"
+
+Logger logger = Logger(LogLevel::warning);
+
+namespace
+{
+
+using clock = std::chrono::steady_clock;
+
+constexpr std::size_t RING_LEN = 4096;
+constexpr auto TIMEOUT = std::chrono::milliseconds(100);
+
+struct Case
+{
+    const char* name;
+    LinuxSerialBackend backend;
+    std::size_t baud_rate;
+    cc_t vtime;
+};
+
+const Case CASES[] = {
+    {"libserial",        LinuxSerialBackend::LibSerial, 115200,  0},
+    {"termios",          LinuxSerialBackend::Termios,   115200,  0},
+    {"termios",          LinuxSerialBackend::Termios,   3000000, 0},
+    {"termios (custom)", LinuxSerialBackend::Termios,   3100000, 0},
+    {"termios vtime 1",  LinuxSerialBackend::Termios,   3000000, 1},
+};
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -n <count>  Bytes timed per backend (default 2000)\n"
+        "  -h          Show this help\n",
+        argv0);
+}
+
+double percentile(std::vector<double>& v, double p)
+{
+    auto it = v.begin() + static_cast<long>(p * (v.size() - 1));
+    std::nth_element(v.begin(), it, v.end());
+    return *it;
+}
+
+bool bench(const Case& c, long count)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+    {
+        std::printf("Cannot create a pseudo-terminal\n");
+        return false;
+    }
+
+    auto ring = std::make_shared<SpscRing<char>>(RING_LEN);
+    LinuxSerialPortConfig cfg(c.backend, c.baud_rate,
+        LibSerial::CharacterSize::CHAR_SIZE_8,
+        LibSerial::FlowControl::FLOW_CONTROL_NONE,
+        LibSerial::Parity::PARITY_NONE,
+        LibSerial::StopBits::STOP_BITS_1);
+    cfg.vtime = c.vtime;
+
+    std::vector<double> latencies;
+    std::size_t errors = 0;
+    {
+        LinuxSerialPort port(ring, &cfg);
+        if (!port.open(ptsname(master)) || !port.config() || !port.start_reading())
+        {
+            std::printf("FAIL: %s: cannot read from the pseudo-terminal at %zu baud\n",
+                c.name, c.baud_rate);
+            ::close(master);
+            return false;
+        }
+
+        for (long i = 0; i < count; i++)
+        {
+            const char byte = static_cast<char>(i * 7);
+            auto t0 = clock::now();
+            if (::write(master, &byte, 1) != 1)
+            {
+                errors++;
+                continue;
+            }
+            while (ring->read_available().empty())
+            {
+                if (!ring->wait_readable_for(TIMEOUT))
+                    break;
+            }
+            auto t1 = clock::now();
+
+            auto s = ring->read_available();
+            if (s.size() != 1 || s[0] != byte)
+            {
+                errors++;
+                ring->consume(s.size());
+                continue;
+            }
+            ring->consume(1);
+            latencies.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        }
+    }
+    ::close(master);
+
+    if (latencies.empty())
+    {
+        std::printf("FAIL: %s: no bytes came through\n", c.name);
+        return false;
+    }
+
+    double mean = 0.0;
+    for (double l : latencies)
+        mean += l;
+    mean /= latencies.size();
+    std::printf("%-17s %7zu baud: mean %.1f us, p50 %.1f us, p99 %.1f us\n", c.name,
+        c.baud_rate, mean, percentile(latencies, 0.5), percentile(latencies, 0.99));
+
+    if (errors)
+    {
+        std::printf("FAIL: %s: %zu bytes lost, corrupted or late\n", c.name, errors);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long count = 2000;
+    int flag;
+    while ((flag = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'n':
+        {
+            char* end = nullptr;
+            count = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || count <= 0)
+            {
+                std::printf("Invalid byte count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool ok = true;
+    for (const auto& c : CASES)
+        ok &= bench(c, count);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+/*
+ * Benchmark for LinuxSerialPort's reader thread. Opens a pseudo-terminal as the
+ * serial port, then for each baud rate leaves the link idle for a while and
+ * streams bytes into it at the rate's line speed, measuring the bytes the
+ * reader delivers to the ring and the CPU time the reader thread uses:
+ *
+ *     ./build/serial_read_bench
+ *
+ * A pty delivers bytes as fast as they're written, so the writer paces itself
+ * to 10 bits per byte (8N1) in 1 ms slices. Fails if the reader falls behind
+ * the line or uses more than 1% of a core while the link is idle.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "linux_serial_port.hpp"
+#include "logger.hpp"
+
+Logger logger = Logger(LogLevel::warning);
+
+namespace
+{
+
+using clock = std::chrono::steady_clock;
+
+constexpr std::size_t BAUD_RATES[] = {115200, 921600, 3000000};
+
+// Bits on the line per byte: start, 8 data and stop bits.
+constexpr double BITS_PER_BYTE = 10.0;
+
+constexpr auto SLICE = std::chrono::milliseconds(1);
+
+// Large enough that the ring never fills, so every byte is accounted for.
+constexpr std::size_t RING_LEN = 1 << 20;
+
+constexpr double MIN_DELIVERED = 0.99;
+constexpr double MAX_IDLE_CPU_PERCENT = 1.0;
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -s <sec>  Seconds idle and seconds streaming per baud rate (default 2)\n"
+        "  -l        Use the libserial backend instead of termios\n"
+        "  -h        Show this help\n",
+        argv0);
+}
+
+double cpu_seconds(int who)
+{
+    rusage r{};
+    getrusage(who, &r);
+    return r.ru_utime.tv_sec + r.ru_stime.tv_sec +
+        (r.ru_utime.tv_usec + r.ru_stime.tv_usec) / 1e6;
+}
+
+struct Sample
+{
+    std::size_t bytes;
+    double seconds;
+    double reader_cpu_percent;
+};
+
+/*
+ * Writes bytes_per_second into the pty master for the given time, draining the
+ * ring every slice. The reader thread is the only other thread in the process,
+ * so its CPU time is the process's less this thread's.
+ */
+Sample run(int master, SpscRing<char>& ring, double bytes_per_second, long seconds)
+{
+    const std::string pattern(4096, 'x');
+    const auto start = clock::now();
+    const auto end = start + std::chrono::seconds(seconds);
+    const double cpu0 = cpu_seconds(RUSAGE_SELF) - cpu_seconds(RUSAGE_THREAD);
+
+    double owed = 0.0;
+    std::size_t received = 0;
+    auto next = start;
+    while (next < end)
+    {
+        next += SLICE;
+        owed += bytes_per_second * std::chrono::duration<double>(SLICE).count();
+        while (owed >= 1.0)
+        {
+            std::size_t n = std::min(pattern.size(), static_cast<std::size_t>(owed));
+            ssize_t w = ::write(master, pattern.data(), n);
+            if (w <= 0)
+                break;
+            owed -= static_cast<double>(w);
+        }
+
+        for (auto s = ring.read_available(); !s.empty(); s = ring.read_available())
+        {
+            received += s.size();
+            ring.consume(s.size());
+        }
+        std::this_thread::sleep_until(next);
+    }
+
+    // Bytes still in flight at the end are the reader's to deliver.
+    ring.wait_readable_for(std::chrono::milliseconds(10));
+    for (auto s = ring.read_available(); !s.empty(); s = ring.read_available())
+    {
+        received += s.size();
+        ring.consume(s.size());
+    }
+
+    double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    double cpu = cpu_seconds(RUSAGE_SELF) - cpu_seconds(RUSAGE_THREAD) - cpu0;
+    return {received, elapsed, 100.0 * cpu / elapsed};
+}
+
+bool bench(LinuxSerialBackend backend, std::size_t baud, long seconds)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0)
+    {
+        std::printf("Cannot create a pseudo-terminal\n");
+        return false;
+    }
+
+    auto ring = std::make_shared<SpscRing<char>>(RING_LEN);
+    LinuxSerialPortConfig cfg(backend, baud,
+        LibSerial::CharacterSize::CHAR_SIZE_8,
+        LibSerial::FlowControl::FLOW_CONTROL_NONE,
+        LibSerial::Parity::PARITY_NONE,
+        LibSerial::StopBits::STOP_BITS_1);
+    bool ok = true;
+    {
+        LinuxSerialPort port(ring, &cfg);
+        if (!port.open(ptsname(master)) || !port.config() || !port.start_reading())
+        {
+            std::printf("Cannot read from the pseudo-terminal at %zu baud\n", baud);
+            ::close(master);
+            return false;
+        }
+
+        const double line_rate = baud / BITS_PER_BYTE;
+        Sample idle = run(master, *ring, 0.0, seconds);
+        Sample busy = run(master, *ring, line_rate, seconds);
+        const double delivered = busy.bytes / (line_rate * busy.seconds);
+
+        std::printf("%7zu baud: %.0f bytes/s of %.0f (%.1f%%), reader CPU %.2f%% streaming, "
+            "%.3f%% idle\n", baud, busy.bytes / busy.seconds, line_rate, 100.0 * delivered,
+            busy.reader_cpu_percent, idle.reader_cpu_percent);
+
+        if (idle.bytes != 0 || ring->dropped_elements() != 0)
+        {
+            std::printf("FAIL: %zu baud: bytes appeared while idle or were dropped\n", baud);
+            ok = false;
+        }
+        if (!(delivered >= MIN_DELIVERED))
+        {
+            std::printf("FAIL: %zu baud: reader fell behind the line\n", baud);
+            ok = false;
+        }
+        if (!(idle.reader_cpu_percent <= MAX_IDLE_CPU_PERCENT))
+        {
+            std::printf("FAIL: %zu baud: reader above %.0f%% CPU while idle\n",
+                baud, MAX_IDLE_CPU_PERCENT);
+            ok = false;
+        }
+    }
+    ::close(master);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long seconds = 2;
+    LinuxSerialBackend backend = LinuxSerialBackend::Termios;
+    int flag;
+    while ((flag = getopt(argc, argv, "s:lh")) != -1)
+    {
+        switch (flag)
+        {
+        case 's':
+        {
+            char* end = nullptr;
+            seconds = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || seconds <= 0)
+            {
+                std::printf("Invalid duration: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'l': backend = LinuxSerialBackend::LibSerial; break;
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::printf("%s backend\n", backend == LinuxSerialBackend::Termios ? "termios" : "libserial");
+    bool ok = true;
+    for (std::size_t baud : BAUD_RATES)
+        ok &= bench(backend, baud, seconds);
+    return ok ? 0 : 1;
+}
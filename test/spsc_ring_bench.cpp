@@ -0,0 +1,208 @@
+/*
+ * Benchmark for SpscRing against BoundedBuffer<char> on the serial-to-parser
+ * path. A producer thread writes a byte stream in serial-read-sized blocks and
+ * a consumer thread checks every byte it takes out:
+ *
+ *     ./build/spsc_ring_bench
+ *
+ * The ring moves whole spans, while the buffer takes the path it used to: a
+ * force_push per byte and a try_pop per byte. Fails if a byte is lost or out
+ * of order, or if the ring costs more per byte than the buffer.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+
+#include "bounded_buffer.hpp"
+#include "spsc_ring.hpp"
+
+namespace
+{
+
+// The viewer's minimum telemetry buffer size.
+constexpr std::size_t RING_LEN = 4096;
+
+// Bytes per producer write, about what one serial read returns at high baud
+// rates. Odd, so the writes don't line up with the ring's wrap around.
+constexpr std::size_t BLOCK = 251;
+
+// Best of this many runs, to keep other load on the machine out of the result.
+constexpr int RUNS = 10;
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -n <bytes>  Bytes streamed per run (default 4000000)\n"
+        "  -h          Show this help\n",
+        argv0);
+}
+
+char byte_at(std::size_t i)
+{
+    return static_cast<char>(i * 7);
+}
+
+struct Result
+{
+    double ns_per_byte;
+    std::size_t errors;
+};
+
+/*
+ * Streams count bytes through the ring. Either side yields when it can't make
+ * progress, so the threads also share a single core.
+ */
+Result time_ring(std::size_t count)
+{
+    SpscRing<char> ring(RING_LEN);
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::thread producer([&]{
+        char block[BLOCK];
+        for (std::size_t i = 0; i < count; )
+        {
+            std::size_t n = std::min(BLOCK, count - i);
+            for (std::size_t j = 0; j < n; j++)
+                block[j] = byte_at(i + j);
+            for (std::size_t w = 0; w < n; )
+            {
+                std::size_t k = ring.write(Span<const char>(block + w, n - w));
+                if (k == 0)
+                    std::this_thread::yield();
+                w += k;
+            }
+            i += n;
+        }
+    });
+
+    std::size_t errors = 0;
+    for (std::size_t i = 0; i < count; )
+    {
+        auto s = ring.read_available();
+        if (s.empty())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        for (char c : s)
+            errors += c != byte_at(i++);
+        ring.consume(s.size());
+    }
+    producer.join();
+
+    double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - t0).count();
+    return {ns / count, errors};
+}
+
+/*
+ * Streams count bytes through a BoundedBuffer. It holds the whole stream, so
+ * force_push never has to evict and every byte can be checked.
+ */
+Result time_bounded_buffer(std::size_t count)
+{
+    BoundedBuffer<char> buffer(count);
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::thread producer([&]{
+        char block[BLOCK];
+        for (std::size_t i = 0; i < count; )
+        {
+            std::size_t n = std::min(BLOCK, count - i);
+            for (std::size_t j = 0; j < n; j++)
+                block[j] = byte_at(i + j);
+            for (std::size_t j = 0; j < n; j++)
+                buffer.force_push(block[j]);
+            i += n;
+        }
+    });
+
+    std::size_t errors = 0;
+    for (std::size_t i = 0; i < count; )
+    {
+        auto c = buffer.try_pop();
+        if (!c)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        errors += *c != byte_at(i++);
+    }
+    producer.join();
+
+    double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - t0).count();
+    return {ns / count, errors + buffer.dropped_elements()};
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long count = 4000000;
+    int flag;
+    while ((flag = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'n':
+        {
+            char* end = nullptr;
+            count = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || count <= 0)
+            {
+                std::printf("Invalid byte count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // The runs alternate, so a slow patch on the machine affects both alike.
+    double ring_ns = 0.0;
+    double buffer_ns = 0.0;
+    std::size_t errors = 0;
+    for (int run = 0; run < RUNS; run++)
+    {
+        Result r = time_ring(static_cast<std::size_t>(count));
+        ring_ns = run == 0 ? r.ns_per_byte : std::min(ring_ns, r.ns_per_byte);
+        errors += r.errors;
+        r = time_bounded_buffer(static_cast<std::size_t>(count));
+        buffer_ns = run == 0 ? r.ns_per_byte : std::min(buffer_ns, r.ns_per_byte);
+        errors += r.errors;
+    }
+
+    std::printf("SpscRing write/read_available: %.2f ns/byte\n", ring_ns);
+    std::printf("BoundedBuffer<char> force_push/try_pop: %.2f ns/byte (%.1fx)\n",
+        buffer_ns, buffer_ns / ring_ns);
+
+    bool ok = true;
+    if (errors)
+    {
+        std::printf("FAIL: %zu bytes lost or out of order\n", errors);
+        ok = false;
+    }
+    if (!(ring_ns < buffer_ns))
+    {
+        std::printf("FAIL: the ring costs more per byte than the buffer\n");
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+/*
+ * Benchmark for the compile-time ASCII decoder. Decodes the ground station's
+ * packets with the layout read from TelemetryFormat at runtime, then with
+ * GroundStationFormat through TelemetryData and through
+ * StaticTelemetryDecoder directly:
+ *
+ *     ./build/static_telemetry_format_bench
+ *
+ * Fails if the paths decode any packet differently, accept a malformed one, or
+ * if the compile-time decoder is slower than the runtime one.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include <glm/glm.hpp>
+
+#include "logger.hpp"
+#include "telemetry_format.hpp"
+
+Logger logger = Logger(LogLevel::fatal);
+
+namespace
+{
+
+// Distinct packets per run, cycled through so they stay in the L1 cache
+// and the timings are of decoding rather than of memory.
+constexpr std::size_t NUM_PACKETS = 64;
+
+// Best of this many short runs, to keep other load on the machine out of the
+// result.
+constexpr int RUNS = 200;
+
+// The ground station's layout, read at runtime.
+const TelemetryFormat RUNTIME_FORMAT(37, '|', '\n', 1000, 5, {1, 7, 13}, {19, 25, 31});
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -n <count>  Packets decoded per run (default 20000)\n"
+        "  -h          Show this help\n",
+        argv0);
+}
+
+std::vector<std::string> make_packets()
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> field(-9999, 99999);
+    std::vector<std::string> packets(NUM_PACKETS);
+    for (auto& p : packets)
+    {
+        char b[64];
+        std::snprintf(b, sizeof(b), "|%05d,%05d,%05d,%05d,%05d,%05d\r", field(rng),
+            field(rng), field(rng), field(rng), field(rng), field(rng));
+        p = b;
+    }
+    return packets;
+}
+
+/*
+ * Decodes count packets, cycling through packets, and returns the time per
+ * packet in nanoseconds.
+ */
+template <typename Decode>
+double time_decode(const std::vector<std::string>& packets, long count, Decode decode)
+{
+    using clock = std::chrono::steady_clock;
+    float sink = 0.0f;
+
+    auto t0 = clock::now();
+    for (long i = 0; i < count; i++)
+        sink += decode(packets[static_cast<std::size_t>(i) % NUM_PACKETS]);
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count() / count;
+
+    // Keeps the decoding from being optimized away.
+    if (sink == 1.0f)
+        std::printf(" ");
+    return ns;
+}
+
+/*
+ * Both formats must decode every packet to the same values and reject the
+ * same damaged packets.
+ */
+bool same_results(const std::vector<std::string>& packets)
+{
+    TelemetryData runtime(RUNTIME_FORMAT);
+    TelemetryData compiled{TelemetryFormat(GroundStationFormat{})};
+    for (const auto& p : packets)
+    {
+        if (!runtime.extract_packet_data(p) || !compiled.extract_packet_data(p) ||
+            runtime.get_accel() != compiled.get_accel() ||
+            runtime.get_rot_rate() != compiled.get_rot_rate())
+            return false;
+
+        for (std::size_t i = 1; i < p.size() - 1; i++)
+        {
+            for (char c : {'x', '+', ' ', '-'})
+            {
+                std::string damaged = p;
+                damaged[i] = c;
+                if (runtime.extract_packet_data(damaged) != compiled.extract_packet_data(damaged))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long count = 20000;
+    int flag;
+    while ((flag = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'n':
+        {
+            char* end = nullptr;
+            count = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || count <= 0)
+            {
+                std::printf("Invalid packet count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const auto packets = make_packets();
+    if (!same_results(packets))
+    {
+        std::printf("FAIL: runtime and compile-time formats disagree\n");
+        return 1;
+    }
+
+    TelemetryData runtime(RUNTIME_FORMAT);
+    TelemetryData compiled{TelemetryFormat(GroundStationFormat{})};
+    glm::vec3 accel{};
+    glm::vec3 rot_rate{};
+
+    // The runs alternate between the paths, so a slow patch on the machine
+    // affects all alike.
+    double best[3] = {};
+    for (int run = 0; run < RUNS; run++)
+    {
+        double ns[3] = {
+            time_decode(packets, count, [&](const std::string& p) {
+                runtime.extract_packet_data(p);
+                return runtime.get_accel().x;
+            }),
+            time_decode(packets, count, [&](const std::string& p) {
+                compiled.extract_packet_data(p);
+                return compiled.get_accel().x;
+            }),
+            time_decode(packets, count, [&](const std::string& p) {
+                StaticTelemetryDecoder<GroundStationFormat>::decode(p, accel, rot_rate);
+                return accel.x;
+            }),
+        };
+        for (int i = 0; i < 3; i++)
+            best[i] = run == 0 ? ns[i] : std::min(best[i], ns[i]);
+    }
+
+    std::printf("runtime offsets:                    %.1f ns/packet\n", best[0]);
+    std::printf("GroundStationFormat, TelemetryData: %.1f ns/packet (%.2fx)\n",
+        best[1], best[0] / best[1]);
+    std::printf("GroundStationFormat, inlined:       %.1f ns/packet (%.2fx)\n",
+        best[2], best[0] / best[2]);
+
+    if (!(best[2] < best[0]))
+    {
+        std::printf("FAIL: the compile-time decoder is slower than the runtime one\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,313 @@
+/*
+ * Round trip test for the telemetry archive. Writes a seeded synthetic flight
+ * whose channels cover every column encoding, including NaN and -0 values and
+ * time gaps too large for the packed time column, then reads it back:
+ *
+ *     ./build/telemetry_archive_test
+ *
+ * Every value must come back bit for bit and every time to the quantum, block
+ * lookups and channel ranges must agree with the data, and corrupted,
+ * truncated and unclosed archives must be rejected.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "logger.hpp"
+#include "telemetry_archive.hpp"
+
+// The corruption checks make the reader log errors on purpose, and failures
+// are reported by the checks themselves.
+Logger logger = Logger(LogLevel::fatal);
+
+namespace
+{
+
+constexpr std::size_t NUM_SAMPLES = 200000;
+
+const std::vector<std::string> CHANNEL_NAMES = {
+    "smooth",      // 0.001 steps changing slowly, packs as deltas
+    "noise",       // Arbitrary floats, no step, XORed
+    "nan_zero",    // NaN, -0 and small values, XORed
+    "constant",    // One value, packs at width 0
+    "fixed",       // 2^-14 steps over the int16 range, frame of reference
+    "large",       // Integers over the whole int32 range
+    "decimal",     // 0.1 steps
+};
+
+int failures = 0;
+
+void check(bool ok, const char* what)
+{
+    if (!ok)
+    {
+        std::printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+struct Flight
+{
+    std::vector<std::int64_t> times;
+    std::vector<std::vector<float>> samples;
+};
+
+/*
+ * About 1 kHz with jitter. Every 10000 samples the link drops for 3 s and
+ * every 777 samples a packet is 50 ms late, too large a change for the packed
+ * time deltas to hold, so they're escaped.
+ */
+Flight make_flight()
+{
+    std::mt19937 rng(7);
+    Flight f;
+    std::int64_t t = 123456789;
+    for (std::size_t i = 0; i < NUM_SAMPLES; i++)
+    {
+        t += 1000000 + static_cast<std::int64_t>(rng() % 5000) - 2500;
+        if (i % 10000 == 0)
+            t += 3000000000;
+        if (i % 777 == 0 && rng() % 2)
+            t += 50000000;
+        f.times.push_back(t);
+
+        std::vector<float> v(CHANNEL_NAMES.size());
+        v[0] = static_cast<float>(static_cast<int>(1000 * std::sin(i * 0.001))) * 0.001f;
+        v[1] = static_cast<float>(rng() / 4294967296.0 * 10.0 - 5.0);
+        v[2] = i % 3 == 0 ? NAN : i % 3 == 1 ? -0.0f : static_cast<float>(i % 50) * 0.01f;
+        v[3] = 42.0f;
+        v[4] = static_cast<float>(static_cast<int>(rng() % 65536) - 32768) * 0x1p-14f;
+        v[5] = static_cast<float>(static_cast<int>(rng()));
+        v[6] = static_cast<float>(static_cast<int>(rng() % 2000) - 1000) * 0.1f;
+        f.samples.push_back(std::move(v));
+    }
+    return f;
+}
+
+bool same_bits(float a, float b)
+{
+    return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+void test_round_trip(const Flight& flight, const fs::path& path, std::int64_t quantum)
+{
+    {
+        ArchiveWriter writer(CHANNEL_NAMES, std::chrono::milliseconds(700),
+            std::chrono::nanoseconds(quantum));
+        if (!writer.open(path))
+        {
+            check(false, "Cannot create the archive");
+            return;
+        }
+        bool appended = true;
+        for (std::size_t i = 0; i < NUM_SAMPLES; i++)
+            appended = writer.append(flight.times[i], flight.samples[i]) && appended;
+        check(appended, "Append failed");
+        check(!writer.append(flight.times.back() - 1, flight.samples[0]),
+            "Sample out of time order was accepted");
+        check(writer.close(), "Close failed");
+
+        auto stats = writer.get_stats();
+        std::printf("quantum %lld ns: %llu bytes in %llu blocks, columns: %llu frame of "
+            "reference, %llu delta, %llu float xor\n",
+            static_cast<long long>(quantum),
+            static_cast<unsigned long long>(stats.bytes),
+            static_cast<unsigned long long>(stats.blocks),
+            static_cast<unsigned long long>(stats.columns[0]),
+            static_cast<unsigned long long>(stats.columns[1]),
+            static_cast<unsigned long long>(stats.columns[2]));
+        check(stats.samples == NUM_SAMPLES, "Writer lost samples");
+        for (auto n : stats.columns)
+            check(n > 0, "A column encoding was never used");
+    }
+
+    ArchiveReader reader;
+    if (!reader.open(path))
+    {
+        check(false, "Cannot open the archive");
+        return;
+    }
+    check(reader.get_channel_names() == CHANNEL_NAMES, "Channel names differ");
+    check(reader.get_time_quantum().count() == quantum, "Time quantum differs");
+
+    const auto& index = reader.get_index();
+    ArchiveBlock block;
+    std::size_t k = 0;
+    std::size_t time_mismatches = 0;
+    std::size_t value_mismatches = 0;
+    std::size_t range_mismatches = 0;
+    for (std::size_t b = 0; b < index.size(); b++)
+    {
+        if (!reader.decode_block(b, block) || block.size() != index[b].count ||
+            k + block.size() > NUM_SAMPLES)
+        {
+            check(false, "Block failed to decode");
+            return;
+        }
+
+        const std::int64_t first = block.times[0];
+        for (std::size_t j = 0; j < block.size(); j++, k++)
+        {
+            std::int64_t expected = first + (flight.times[k] - first) / quantum * quantum;
+            time_mismatches += block.times[j] != expected;
+            for (std::size_t c = 0; c < CHANNEL_NAMES.size(); c++)
+                value_mismatches += !same_bits(block.values[c * block.size() + j],
+                    flight.samples[k][c]);
+        }
+
+        // The header's range must be that of the non-NaN values.
+        for (std::size_t c = 0; c < CHANNEL_NAMES.size(); c++)
+        {
+            float min = NAN;
+            float max = NAN;
+            for (std::size_t j = 0; j < block.size(); j++)
+            {
+                float v = block.values[c * block.size() + j];
+                if (std::isnan(v))
+                    continue;
+                min = std::isnan(min) ? v : std::fmin(min, v);
+                max = std::isnan(max) ? v : std::fmax(max, v);
+            }
+            float header_min;
+            float header_max;
+            reader.get_channel_range(b, c, header_min, header_max);
+            range_mismatches += !(header_min == min && header_max == max);
+        }
+    }
+    std::printf("quantum %lld ns: %zu samples read, %zu time, %zu value and %zu range mismatches\n",
+        static_cast<long long>(quantum), k, time_mismatches, value_mismatches, range_mismatches);
+    check(k == NUM_SAMPLES, "Samples missing from the archive");
+    check(time_mismatches == 0, "Times don't match to the quantum");
+    check(value_mismatches == 0, "Values don't match bit for bit");
+    check(range_mismatches == 0, "Block channel ranges don't match the values");
+
+    // Every sample's time must be found in its own block, i.e. the first one
+    // ending at or after it.
+    std::mt19937 rng(3);
+    std::size_t lookup_mismatches = 0;
+    for (int i = 0; i < 10000; i++)
+    {
+        std::int64_t t = flight.times[rng() % NUM_SAMPLES];
+        std::size_t b = reader.find_block(t);
+        lookup_mismatches += b >= index.size() || index[b].last_time_ns < t ||
+            (b > 0 && index[b - 1].last_time_ns >= t);
+    }
+    check(lookup_mismatches == 0, "find_block returned the wrong block");
+    check(reader.find_block(flight.times.back() + quantum) == index.size(),
+        "find_block found a block past the end");
+    check(reader.find_block(flight.times.front() - 1) == 0,
+        "find_block didn't return the first block for an early time");
+}
+
+/*
+ * One flipped bit in a block must fail that block's CRC and no other's.
+ */
+void test_corruption(const fs::path& path)
+{
+    std::size_t block = 0;
+    {
+        ArchiveReader reader;
+        if (!reader.open(path))
+        {
+            check(false, "Cannot open the archive");
+            return;
+        }
+        const auto& index = reader.get_index();
+        block = index.size() / 2;
+        std::uint64_t offset = index[block].offset +
+            (index[block + 1].offset - index[block].offset) * 3 / 4;
+
+        std::FILE* f = std::fopen(path.c_str(), "r+b");
+        std::fseek(f, static_cast<long>(offset), SEEK_SET);
+        int c = std::fgetc(f);
+        std::fseek(f, static_cast<long>(offset), SEEK_SET);
+        std::fputc(c ^ 0x10, f);
+        std::fclose(f);
+    }
+
+    ArchiveReader reader;
+    if (!reader.open(path))
+    {
+        check(false, "Cannot open the corrupted archive");
+        return;
+    }
+    ArchiveBlock b;
+    std::size_t failed = 0;
+    bool failed_corrupted = false;
+    for (std::size_t i = 0; i < reader.get_index().size(); i++)
+    {
+        bool ok = reader.decode_block(i, b);
+        failed += !ok;
+        failed_corrupted |= !ok && i == block;
+    }
+    std::printf("corruption: %zu of %zu blocks rejected\n", failed, reader.get_index().size());
+    check(failed == 1 && failed_corrupted, "Corrupted block not rejected on its own");
+}
+
+/*
+ * Archives which end before their index, as left by a crash or a full disk,
+ * must be rejected on open. An empty archive is valid.
+ */
+void test_incomplete(const fs::path& path)
+{
+    std::uint64_t last_block;
+    {
+        ArchiveReader reader;
+        if (!reader.open(path))
+        {
+            check(false, "Cannot open the archive");
+            return;
+        }
+        last_block = reader.get_index().back().offset;
+    }
+
+    fs::resize_file(path, last_block);
+    ArchiveReader unclosed;
+    check(!unclosed.open(path), "Archive without an index was opened");
+
+    fs::resize_file(path, 40);
+    ArchiveReader truncated;
+    check(!truncated.open(path), "Truncated archive was opened");
+
+    {
+        ArchiveWriter writer(CHANNEL_NAMES, std::chrono::seconds(1));
+        check(writer.open(path) && writer.close(), "Cannot write an empty archive");
+    }
+    ArchiveReader empty;
+    check(empty.open(path) && empty.get_index().empty() &&
+        empty.get_channel_names() == CHANNEL_NAMES, "Empty archive didn't read back");
+}
+
+} // namespace
+
+int main()
+{
+    const fs::path path = fs::temp_directory_path() /
+        ("telemetry_archive_test." + std::to_string(::getpid()));
+    const Flight flight = make_flight();
+
+    // Exact times, then the converter's default quantum of 1 us.
+    test_round_trip(flight, path, 1);
+    test_round_trip(flight, path, 1000);
+    test_corruption(path);
+    test_incomplete(path);
+
+    std::error_code ec;
+    fs::remove(path, ec);
+
+    if (failures)
+    {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("All checks passed\n");
+    return 0;
+}
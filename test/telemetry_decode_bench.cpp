@@ -0,0 +1,207 @@
+/*
+ * Benchmark for decoding the ground station's 6-field ASCII packets. Decodes
+ * synthetic packets the way the viewer used to, then with
+ * TelemetryData::extract_packet_data, and reports packets/s on one core:
+ *
+ *     ./build/telemetry_decode_bench
+ *
+ * The old path built each packet a character at a time, copied it into a
+ * shared_ptr, then parsed each field from a substr() with std::stof and
+ * divided it by the conversion factor. Fails if the two paths disagree by more
+ * than a float ulp, or if the new path is the slower one.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include <glm/glm.hpp>
+
+#include "logger.hpp"
+#include "telemetry_format.hpp"
+
+Logger logger = Logger(LogLevel::error);
+
+namespace
+{
+
+// Distinct packets, cycled through so they stay in the cache and the timings
+// are of decoding rather than of memory.
+constexpr std::size_t NUM_PACKETS = 1024;
+
+// The ground station's layout.
+const TelemetryFormat FORMAT(37, '|', '\n', 1000, 5, {1, 7, 13}, {19, 25, 31});
+
+// One rounding of the old divide and one of the new multiply.
+constexpr float MAX_RELATIVE_ERROR = 2.4e-7f;
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -n <count>  Packets decoded each way (default 1000000)\n"
+        "  -h          Show this help\n",
+        argv0);
+}
+
+std::vector<std::string> make_packets()
+{
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> field(-9999, 99999);
+    std::vector<std::string> packets(NUM_PACKETS);
+    for (auto& p : packets)
+    {
+        char b[64];
+        std::snprintf(b, sizeof(b), "|%05d,%05d,%05d,%05d,%05d,%05d\r", field(rng),
+            field(rng), field(rng), field(rng), field(rng), field(rng));
+        p = b;
+    }
+    return packets;
+}
+
+struct Fields
+{
+    glm::vec3 accel;
+    glm::vec3 rot_rate;
+};
+
+/*
+ * The decoder before it worked in place.
+ */
+Fields old_extract(const std::string& packet)
+{
+    auto field = [&](std::size_t offset) {
+        return std::stof(packet.substr(offset, FORMAT.element_size)) /
+            FORMAT.conversion_factor;
+    };
+    Fields f;
+    for (int i = 0; i < 3; i++)
+    {
+        f.accel[i] = field(FORMAT.accel_offsets[i]);
+        f.rot_rate[i] = field(FORMAT.rot_rate_offsets[i]);
+    }
+    return f;
+}
+
+double time_old(const std::vector<std::string>& packets, long count, float& sink)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    std::string latest;
+    for (long i = 0; i < count; i++)
+    {
+        latest.clear();
+        for (char c : packets[static_cast<std::size_t>(i) % NUM_PACKETS])
+            latest += c;
+        auto packet = std::make_shared<std::string>(latest);
+        sink += old_extract(*packet).accel.x;
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+double time_new(const std::vector<std::string>& packets, long count, float& sink,
+                long& failed)
+{
+    TelemetryData data(FORMAT);
+    auto t0 = std::chrono::steady_clock::now();
+    for (long i = 0; i < count; i++)
+    {
+        failed += !data.extract_packet_data(packets[static_cast<std::size_t>(i) % NUM_PACKETS]);
+        sink += data.get_accel().x;
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool close_enough(float a, float b)
+{
+    return std::fabs(a - b) <= std::fabs(b) * MAX_RELATIVE_ERROR;
+}
+
+std::size_t count_mismatches(const std::vector<std::string>& packets)
+{
+    TelemetryData data(FORMAT);
+    std::size_t mismatches = 0;
+    for (const auto& p : packets)
+    {
+        Fields expected = old_extract(p);
+        bool ok = data.extract_packet_data(p);
+        for (int i = 0; i < 3; i++)
+        {
+            ok = ok && close_enough(data.get_accel()[i], expected.accel[i]) &&
+                close_enough(data.get_rot_rate()[i], expected.rot_rate[i]);
+        }
+        mismatches += !ok;
+    }
+    return mismatches;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long count = 1000000;
+    int flag;
+    while ((flag = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'n':
+        {
+            char* end = nullptr;
+            count = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || count <= 0)
+            {
+                std::printf("Invalid packet count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const auto packets = make_packets();
+    const std::size_t mismatches = count_mismatches(packets);
+
+    float sink = 0.0f;
+    long failed = 0;
+    const double old_s = time_old(packets, count, sink);
+    const double new_s = time_new(packets, count, sink, failed);
+
+    // Keeps the decoding from being optimized away.
+    if (sink == 1.0f)
+        std::printf(" ");
+
+    std::printf("%ld packets\n", count);
+    std::printf("substr + std::stof:        %6.2f M packets/s\n", count / old_s / 1e6);
+    std::printf("extract_packet_data:       %6.2f M packets/s (%.1fx)\n",
+        count / new_s / 1e6, old_s / new_s);
+
+    bool ok = true;
+    if (mismatches || failed)
+    {
+        std::printf("FAIL: %zu packets decoded differently, %ld rejected\n", mismatches, failed);
+        ok = false;
+    }
+    if (!(new_s < old_s))
+    {
+        std::printf("FAIL: extract_packet_data is slower than the old decoder\n");
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
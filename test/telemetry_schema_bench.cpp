@@ -0,0 +1,237 @@
+/*
+ * Benchmark for schema decoding. Times TelemetryData::extract_packet_data on
+ * 20-field schemas against the hardcoded 6-field paths, for both the ASCII and
+ * the binary int16 framings:
+ *
+ *     ./build/telemetry_schema_bench test/data/telemetry_20_ascii.schema \
+ *         test/data/telemetry_20_cobs.schema
+ *
+ * Fails if decoding a 20-field packet costs more than twice as much as
+ * decoding a packet of the same framing through the hardcoded path.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+
+#include <glm/glm.hpp>
+
+#include "logger.hpp"
+#include "telemetry_format.hpp"
+#include "telemetry_schema.hpp"
+
+Logger logger = Logger(LogLevel::error);
+
+namespace
+{
+
+constexpr double MAX_RATIO = 2.0;
+
+// Distinct packets per run, cycled through so they stay in the L1 cache
+// and the timings are of decoding rather than of memory.
+constexpr std::size_t NUM_PACKETS = 64;
+
+// Best of this many short runs, to keep other load on the machine out of the
+// result.
+constexpr int RUNS = 200;
+
+// The ground station's layout, as hardcoded before schemas.
+const TelemetryFormat HARDCODED_ASCII(37, '|', '\n', 1000, 5,
+    {1, 7, 13}, {19, 25, 31});
+const TelemetryFormat HARDCODED_INT16(TelemetryFraming::CobsInt16, 1000);
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options] <20-field ascii schema> <20-field cobs schema>\n"
+        "  -n <count>  Packets decoded per run (default 20000)\n"
+        "  -h          Show this help\n",
+        argv0);
+}
+
+/*
+ * Packets of comma-separated, zero-padded five digit fields, between the
+ * start symbol and a carriage return.
+ */
+std::vector<std::string> make_ascii_packets(std::size_t fields)
+{
+    std::mt19937 rng(1);
+    std::vector<std::string> packets(NUM_PACKETS);
+    for (auto& p : packets)
+    {
+        p = "|";
+        for (std::size_t i = 0; i < fields; i++)
+        {
+            char field[8];
+            std::snprintf(field, sizeof(field), "%05d",
+                static_cast<int>(rng() % 109999) - 9999);
+            p += field;
+            p += i + 1 < fields ? ',' : '\r';
+        }
+    }
+    return packets;
+}
+
+/*
+ * Decoded binary packets. Every byte pattern is a valid int16 field, and the
+ * CRC was checked during framing, so random bytes will do.
+ */
+std::vector<std::string> make_binary_packets(std::size_t len)
+{
+    std::mt19937 rng(2);
+    std::vector<std::string> packets(NUM_PACKETS, std::string(len, '\0'));
+    for (auto& p : packets)
+        for (char& c : p)
+            c = static_cast<char>(rng());
+    return packets;
+}
+
+/*
+ * Decodes count packets, cycling through packets, and returns the time per
+ * packet in nanoseconds.
+ */
+double time_decode(TelemetryData& data, const std::vector<std::string>& packets, long count)
+{
+    using clock = std::chrono::steady_clock;
+    float sink = 0.0f;
+
+    auto t0 = clock::now();
+    for (long i = 0; i < count; i++)
+    {
+        data.extract_packet_data(packets[static_cast<std::size_t>(i) % NUM_PACKETS]);
+        sink += data.get_accel().x;
+    }
+    double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count() / count;
+
+    // Keeps the decoding from being optimized away.
+    if (sink == 1.0f)
+        std::printf(" ");
+    return ns;
+}
+
+/*
+ * Best time per packet of each path over RUNS runs. The runs alternate
+ * between the paths, so a slow patch on the machine affects both alike.
+ */
+void compare(const TelemetryFormat& hardcoded, const std::vector<std::string>& hardcoded_packets,
+             const TelemetryFormat& schema, const std::vector<std::string>& schema_packets,
+             long count, double& hardcoded_ns, double& schema_ns)
+{
+    TelemetryData a(hardcoded);
+    TelemetryData b(schema);
+    for (int run = 0; run < RUNS; run++)
+    {
+        double ns = time_decode(a, hardcoded_packets, count);
+        hardcoded_ns = run == 0 ? ns : std::min(hardcoded_ns, ns);
+        ns = time_decode(b, schema_packets, count);
+        schema_ns = run == 0 ? ns : std::min(schema_ns, ns);
+    }
+}
+
+/*
+ * Decodes every packet both ways and checks the schema gives the same
+ * standard channels as the hardcoded path.
+ */
+bool same_standard_channels(const TelemetryFormat& hardcoded, const TelemetryFormat& schema,
+                            const std::vector<std::string>& packets, std::size_t len)
+{
+    TelemetryData a(hardcoded);
+    TelemetryData b(schema);
+    for (const auto& p : packets)
+    {
+        if (!a.extract_packet_data(std::string_view(p).substr(0, len)) ||
+            !b.extract_packet_data(p) ||
+            a.get_accel() != b.get_accel() || a.get_rot_rate() != b.get_rot_rate())
+            return false;
+    }
+    return true;
+}
+
+bool report(const char* name, std::size_t fields, double hardcoded_ns, double schema_ns)
+{
+    double ratio = schema_ns / hardcoded_ns;
+    std::printf("%s: hardcoded 6 fields %.1f ns/packet, schema %zu fields %.1f ns/packet, "
+        "%.2fx\n", name, hardcoded_ns, fields, schema_ns, ratio);
+    if (!(ratio <= MAX_RATIO))
+    {
+        std::printf("FAIL: %s schema decoding above %.1fx the hardcoded path\n",
+            name, MAX_RATIO);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long count = 20000;
+    int flag;
+    while ((flag = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'n':
+        {
+            char* end = nullptr;
+            count = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || count <= 0)
+            {
+                std::printf("Invalid packet count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 2)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    auto ascii_schema = load_telemetry_schema(argv[optind]);
+    auto int16_schema = load_telemetry_schema(argv[optind + 1]);
+    if (!ascii_schema || !int16_schema)
+        return 1;
+    const TelemetryFormat schema_ascii(*ascii_schema);
+    const TelemetryFormat schema_int16(*int16_schema);
+    const std::size_t ascii_fields = ascii_schema->program.size();
+    const std::size_t int16_fields = int16_schema->program.size();
+
+    auto ascii_6 = make_ascii_packets(6);
+    auto ascii_20 = make_ascii_packets(ascii_fields);
+    auto int16_6 = make_binary_packets(HARDCODED_INT16.packet_len);
+    auto int16_20 = make_binary_packets(schema_int16.packet_len);
+    if (ascii_20[0].size() != schema_ascii.packet_len)
+    {
+        std::printf("The ASCII schema isn't laid out like the ground station's packets\n");
+        return 1;
+    }
+
+    // The 20-field layouts start with the hardcoded ones.
+    if (!same_standard_channels(HARDCODED_ASCII, schema_ascii, ascii_20, HARDCODED_ASCII.packet_len) ||
+        !same_standard_channels(HARDCODED_INT16, schema_int16, int16_20, HARDCODED_INT16.packet_len))
+    {
+        std::printf("FAIL: schema and hardcoded decoding disagree\n");
+        return 1;
+    }
+
+    double hardcoded_ns;
+    double schema_ns;
+    compare(HARDCODED_ASCII, ascii_6, schema_ascii, ascii_20, count, hardcoded_ns, schema_ns);
+    bool ok = report("ascii", ascii_fields, hardcoded_ns, schema_ns);
+    compare(HARDCODED_INT16, int16_6, schema_int16, int16_20, count, hardcoded_ns, schema_ns);
+    ok &= report("int16", int16_fields, hardcoded_ns, schema_ns);
+    return ok ? 0 : 1;
+}
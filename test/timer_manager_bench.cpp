@@ -0,0 +1,243 @@
+/*
+ * Benchmark for TimerManager. Times cancelling and re-arming timers with
+ * thousands pending, and an update() with none due, then measures how late
+ * timers fire when checked once per frame, next to the thread-per-timer design
+ * it replaced:
+ *
+ *     ./build/timer_manager_bench
+ *
+ * Fails if a timer fires before its deadline or doesn't fire at all.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <getopt.h>
+
+#include "logger.hpp"
+#include "timer_manager.hpp"
+
+Logger logger = Logger(LogLevel::error);
+
+namespace
+{
+
+using Clock = TimerManager::Clock;
+using ms = std::chrono::duration<double, std::milli>;
+
+constexpr std::size_t PENDING_COUNTS[] = {1000, 10000, 100000};
+
+// Timers armed at once for the lateness runs, due over the first 100 ms.
+constexpr std::size_t JITTER_TIMERS = 2000;
+
+// A frame loop at 1 kHz and one at 60 Hz.
+constexpr std::chrono::microseconds FRAME_PERIODS[] = {
+    std::chrono::microseconds(1000),
+    std::chrono::microseconds(16667),
+};
+
+// The thread-per-timer design only gets one round, as each timer is a thread.
+constexpr std::size_t THREAD_TIMERS = 1000;
+constexpr auto THREAD_TIMEOUT = std::chrono::milliseconds(50);
+
+void print_usage(const char* argv0)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "  -n <count>  Cancel and re-arm operations per run (default 2000000)\n"
+        "  -h          Show this help\n",
+        argv0);
+}
+
+/*
+ * The timer TimerManager used to hand out: start() spawns a detached thread
+ * which polls the clock every millisecond until the timeout has passed.
+ */
+class ThreadTimer
+{
+public:
+    explicit ThreadTimer(std::chrono::duration<double, std::milli> timeout_) :
+        timeout(timeout_) {}
+
+    bool is_finished() const { return done.load(); }
+
+    void start()
+    {
+        done.store(false);
+        std::thread([this]{
+            auto start_time = Clock::now();
+            while (Clock::now() - start_time <= timeout)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            done.store(true);
+        }).detach();
+    }
+private:
+    std::chrono::duration<double, std::milli> timeout;
+    std::atomic<bool> done{true};
+};
+
+void print_lateness(const char* name, std::vector<double>& late)
+{
+    std::sort(late.begin(), late.end());
+    std::printf("%s: lateness p50 %.3f ms, p99 %.3f ms, max %.3f ms\n", name,
+        late[late.size() / 2], late[late.size() * 99 / 100], late.back());
+}
+
+bool bench_arm_cancel(long count)
+{
+    bool ok = true;
+    for (std::size_t pending : PENDING_COUNTS)
+    {
+        TimerManager timers;
+        std::mt19937_64 rng(2);
+        const auto now = Clock::now();
+        auto deadline = [&] { return now + std::chrono::microseconds(1000000 + rng() % 1000000); };
+
+        std::vector<TimerHandle> handles;
+        for (std::size_t i = 0; i < pending; i++)
+            handles.push_back(timers.arm_at(deadline()));
+
+        auto t0 = Clock::now();
+        for (long i = 0; i < count; i++)
+        {
+            std::size_t k = rng() % pending;
+            timers.cancel(handles[k]);
+            handles[k] = timers.arm_at(deadline());
+        }
+        const double arm_ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / count;
+
+        std::size_t fired = 0;
+        t0 = Clock::now();
+        for (long i = 0; i < count; i++)
+            fired += timers.update(now);
+        const double update_ns = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / count;
+
+        std::printf("%6zu pending: cancel + arm %.1f ns, update with none due %.2f ns\n",
+            pending, arm_ns, update_ns);
+        if (fired)
+        {
+            std::printf("FAIL: %zu timers fired before their deadlines\n", fired);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/*
+ * Arms timers due over the next 100 ms and fires them from a frame loop.
+ */
+bool bench_frame_lateness(std::chrono::microseconds frame)
+{
+    TimerManager timers;
+    std::mt19937_64 rng(3);
+    std::vector<double> late;
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < JITTER_TIMERS; i++)
+    {
+        auto deadline = start + std::chrono::microseconds(1000 + rng() % 99000);
+        timers.arm_at(deadline, [&late, deadline]{
+            late.push_back(ms(Clock::now() - deadline).count());
+        });
+    }
+
+    for (auto next = start; timers.num_pending(); )
+    {
+        next += frame;
+        std::this_thread::sleep_until(next);
+        timers.update();
+    }
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "TimerManager, %5.1f ms frames", ms(frame).count());
+    print_lateness(name, late);
+
+    if (late.size() != JITTER_TIMERS || late.front() < 0.0)
+    {
+        std::printf("FAIL: %zu of %zu timers fired, earliest %.3f ms after its deadline\n",
+            late.size(), JITTER_TIMERS, late.empty() ? 0.0 : late.front());
+        return false;
+    }
+    return true;
+}
+
+void bench_thread_timers()
+{
+    std::vector<std::unique_ptr<ThreadTimer>> timers;
+    for (std::size_t i = 0; i < THREAD_TIMERS; i++)
+        timers.push_back(std::make_unique<ThreadTimer>(THREAD_TIMEOUT));
+
+    std::vector<Clock::time_point> deadlines;
+    const auto t0 = Clock::now();
+    for (auto& t : timers)
+    {
+        deadlines.push_back(Clock::now() + THREAD_TIMEOUT);
+        t->start();
+    }
+    const double start_us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() /
+        THREAD_TIMERS;
+
+    // Polled flat out, so the lateness is the threads' own.
+    std::vector<double> late;
+    std::vector<bool> seen(THREAD_TIMERS);
+    while (late.size() < THREAD_TIMERS)
+    {
+        for (std::size_t i = 0; i < THREAD_TIMERS; i++)
+        {
+            if (!seen[i] && timers[i]->is_finished())
+            {
+                seen[i] = true;
+                late.push_back(ms(Clock::now() - deadlines[i]).count());
+            }
+        }
+    }
+
+    std::printf("%zu thread-per-timer timers: start %.1f us each\n", THREAD_TIMERS, start_us);
+    print_lateness("thread per timer", late);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    long count = 2000000;
+    int flag;
+    while ((flag = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (flag)
+        {
+        case 'n':
+        {
+            char* end = nullptr;
+            count = std::strtol(optarg, &end, 10);
+            if (*end != '\0' || count <= 0)
+            {
+                std::printf("Invalid operation count: %s\n", optarg);
+                return 1;
+            }
+            break;
+        }
+        case 'h':
+        default:
+            print_usage(argv[0]);
+            return flag == 'h' ? 0 : 1;
+        }
+    }
+    if (argc - optind != 0)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    bool ok = bench_arm_cancel(count);
+    for (auto frame : FRAME_PERIODS)
+        ok &= bench_frame_lateness(frame);
+    bench_thread_timers();
+    return ok ? 0 : 1;
+}